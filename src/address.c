@@ -0,0 +1,265 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "address.h"
+#include "cache.h"
+#include "layout.h"
+#include "plugin.h"
+#include "timing.h"
+
+#define ADDRESS_REQUEST_INTERVAL 1000
+#define ADDRESS_INITIAL_CAPACITY 64
+#define ADDRESS_QUEUED_WORDS (65536 / 64)
+#define IDENTITY_RETRY_INTERVAL 10000 /* Same as for the requests of an info frame */
+
+/* Clients waiting for one kind of request */
+struct ClientRing {
+    anyID* pending; /* Ring buffer */
+    size_t head;
+    size_t count;
+    size_t capacity;
+    uint64 queued[ADDRESS_QUEUED_WORDS]; /* Bit per client ID in the ring buffer */
+};
+
+/* Clients waiting for a request on a connection, both kinds share the batches */
+struct AddressQueue {
+    struct AddressQueue* next;
+    uint64               serverConnectionHandlerID;
+    struct ClientRing    addresses;  /* Connection info requests */
+    struct ClientRing    identities; /* Client variable requests for the occupants of the shown channel */
+    uint64               lastBatch;
+    bool                 seeded; /* Clients cached before the first event have been queued */
+};
+
+static mtx_t                addressMutex;
+static struct AddressQueue* queues    = NULL;
+static unsigned int         batchSize = 0;
+
+static struct AddressQueue* getQueue(uint64 serverConnectionHandlerID, bool create) {
+    for (struct AddressQueue* queue = queues; queue; queue = queue->next) {
+        if (queue->serverConnectionHandlerID == serverConnectionHandlerID) return queue;
+    }
+    if (!create) return NULL;
+    struct AddressQueue* queue = (struct AddressQueue*)calloc(1, sizeof(struct AddressQueue));
+    if (!queue) return NULL;
+    queue->serverConnectionHandlerID = serverConnectionHandlerID;
+    queue->next                      = queues;
+    queues                           = queue;
+    return queue;
+}
+
+static void freeQueue(struct AddressQueue* queue) {
+    free(queue->addresses.pending);
+    free(queue->identities.pending);
+    free(queue);
+}
+
+static void push(struct ClientRing* ring, anyID clientID) {
+    const uint64 bit = 1ULL << (clientID & 63);
+    if (ring->queued[clientID >> 6] & bit) return;
+    if (ring->count == ring->capacity) {
+        const size_t capacity = ring->capacity ? ring->capacity * 2 : ADDRESS_INITIAL_CAPACITY;
+        anyID*       pending  = (anyID*)malloc(capacity * sizeof(anyID));
+        if (!pending) return;
+        for (size_t index = 0; index < ring->count; ++index) pending[index] = ring->pending[(ring->head + index) % ring->capacity];
+        free(ring->pending);
+        ring->pending  = pending;
+        ring->head     = 0;
+        ring->capacity = capacity;
+    }
+    ring->pending[(ring->head + ring->count++) % ring->capacity] = clientID;
+    ring->queued[clientID >> 6] |= bit;
+}
+
+static anyID pop(struct ClientRing* ring) {
+    const anyID clientID = ring->pending[ring->head];
+    ring->head           = (ring->head + 1) % ring->capacity;
+    --ring->count;
+    ring->queued[clientID >> 6] &= ~(1ULL << (clientID & 63));
+    return clientID;
+}
+
+static void clear(struct ClientRing* ring) {
+    while (ring->count > 0) pop(ring);
+}
+
+/* Client IDs copied out of the cache */
+struct ClientList {
+    anyID* clients;
+    size_t count;
+};
+
+static void collectClient(struct CachedClient* client, void* context) {
+    struct ClientList* list      = (struct ClientList*)context;
+    list->clients[list->count++] = client->clientID;
+}
+
+/* Returns false if the connection is not populated yet */
+static bool collectCached(uint64 serverConnectionHandlerID, struct ClientList* list) {
+    list->clients = NULL;
+    list->count   = 0;
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server && server->populated) list->clients = (anyID*)malloc((server->clientCount + 1) * sizeof(anyID));
+    if (list->clients) cacheForEachClient(server, collectClient, list);
+    cacheUnlock();
+    return list->clients != NULL;
+}
+
+/* Returns false if the address of a client is already known or the client is gone */
+static bool addressMissing(struct ServerCache* server, anyID clientID) {
+    const struct CachedClient* client = server ? cacheGetClient(server, clientID, false) : NULL;
+    return client && !client->tallies[CACHE_TALLY_ADDRESS];
+}
+
+/* Returns false if the identity of a client has been fetched already or shared recently, query clients are left out */
+static bool identityMissing(struct ServerCache* server, const struct CachedClient* client, uint64 now) {
+    if (client->type != ClientType_NORMAL || !client->uniqueID[0]) return false;
+    const struct IdentityRecord* identity = cacheGetIdentity(server, client->uniqueID, false);
+    return !identity || identity->updatedAt == 0 || (identity->shared && now - identity->updatedAt >= SHARED_IDENTITY_TTL);
+}
+
+/* Marks the identity of a client as requested, returns false if it is known or was requested recently */
+static bool identityDue(struct ServerCache* server, anyID clientID, uint64 now) {
+    const struct CachedClient* client   = server ? cacheGetClient(server, clientID, false) : NULL;
+    struct IdentityRecord*     identity = client && identityMissing(server, client, now) ? cacheGetIdentity(server, client->uniqueID, true) : NULL;
+    if (!identity || (identity->requestedAt != 0 && now - identity->requestedAt < IDENTITY_RETRY_INTERVAL)) return false;
+    identity->requestedAt = now;
+    return true;
+}
+
+void addressInit(unsigned int requestsPerSecond) {
+    mtx_init(&addressMutex, mtx_plain);
+    batchSize = requestsPerSecond;
+}
+
+void addressShutdown(void) {
+    mtx_lock(&addressMutex);
+    while (queues) {
+        struct AddressQueue* next = queues->next;
+        freeQueue(queues);
+        queues = next;
+    }
+    mtx_unlock(&addressMutex);
+    mtx_destroy(&addressMutex);
+}
+
+void addressQueueClient(uint64 serverConnectionHandlerID, anyID clientID) {
+    if (batchSize == 0) return;
+    mtx_lock(&addressMutex);
+    struct AddressQueue* queue = getQueue(serverConnectionHandlerID, true);
+    if (queue) push(&queue->addresses, clientID);
+    mtx_unlock(&addressMutex);
+}
+
+void addressPrefetchChannel(uint64 serverConnectionHandlerID, const anyID* clients) {
+    if (batchSize == 0) return;
+    size_t count = 0;
+    while (clients[count]) ++count;
+    anyID* missing = (anyID*)malloc((count + 1) * sizeof(anyID));
+    if (!missing) return;
+
+    size_t       missingCount = 0;
+    const uint64 now          = timingMonotonicMs();
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    for (size_t index = 0; server && index < count; ++index) {
+        const struct CachedClient* client = cacheGetClient(server, clients[index], false);
+        if (client && identityMissing(server, client, now)) missing[missingCount++] = clients[index];
+    }
+    cacheUnlock();
+
+    /* Occupants of the channel shown before are no longer worth the requests */
+    mtx_lock(&addressMutex);
+    struct AddressQueue* queue = getQueue(serverConnectionHandlerID, true);
+    if (queue) {
+        while (queue->identities.count > 0) pop(&queue->identities);
+        for (size_t index = 0; index < missingCount; ++index) push(&queue->identities, missing[index]);
+    }
+    mtx_unlock(&addressMutex);
+    free(missing);
+}
+
+void addressDropServer(uint64 serverConnectionHandlerID) {
+    mtx_lock(&addressMutex);
+    for (struct AddressQueue** link = &queues; *link; link = &(*link)->next) {
+        if ((*link)->serverConnectionHandlerID == serverConnectionHandlerID) {
+            struct AddressQueue* queue = *link;
+            *link                      = queue->next;
+            freeQueue(queue);
+            break;
+        }
+    }
+    mtx_unlock(&addressMutex);
+}
+
+void addressPump(uint64 serverConnectionHandlerID) {
+    if (batchSize == 0) return;
+    const uint64 now    = timingMonotonicMs();
+    const bool   needed = layoutNeeds(LAYOUT_NEEDS_ADDRESSES);
+
+    mtx_lock(&addressMutex);
+    struct AddressQueue* queue = getQueue(serverConnectionHandlerID, true);
+    /* Without an address field the queue is dropped and seeded again once a reload adds one */
+    if (queue && !needed) {
+        clear(&queue->addresses);
+        queue->seeded = false;
+    }
+    const bool           seed  = queue && needed && !queue->seeded;
+    const bool           due   = queue && queue->addresses.count + queue->identities.count > 0 && now - queue->lastBatch >= ADDRESS_REQUEST_INTERVAL;
+    mtx_unlock(&addressMutex);
+    if (!seed && !due) return;
+
+    /* The cache lock is never taken while holding the queue lock */
+    struct ClientList cached;
+    if (seed && collectCached(serverConnectionHandlerID, &cached)) {
+        mtx_lock(&addressMutex);
+        queue = getQueue(serverConnectionHandlerID, true);
+        if (queue && !queue->seeded) {
+            for (size_t index = 0; index < cached.count; ++index) push(&queue->addresses, cached.clients[index]);
+            queue->seeded = true;
+        }
+        mtx_unlock(&addressMutex);
+        free(cached.clients);
+    }
+
+    /* Identities go first, their channel is on screen */
+    anyID  identities[64];
+    anyID  addresses[64];
+    size_t identityCount = 0;
+    size_t addressCount  = 0;
+    mtx_lock(&addressMutex);
+    queue = getQueue(serverConnectionHandlerID, false);
+    if (queue && queue->addresses.count + queue->identities.count > 0 && now - queue->lastBatch >= ADDRESS_REQUEST_INTERVAL) {
+        const size_t limit = batchSize < sizeof(addresses) / sizeof(addresses[0]) ? batchSize : sizeof(addresses) / sizeof(addresses[0]);
+        queue->lastBatch   = now;
+        while (queue->identities.count > 0 && identityCount < limit) identities[identityCount++] = pop(&queue->identities);
+        while (queue->addresses.count > 0 && identityCount + addressCount < limit) addresses[addressCount++] = pop(&queue->addresses);
+    }
+    mtx_unlock(&addressMutex);
+    if (identityCount + addressCount == 0) return;
+
+    size_t dueIdentities = 0;
+    size_t missing       = 0;
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    for (size_t index = 0; index < identityCount; ++index) {
+        if (identityDue(server, identities[index], now)) identities[dueIdentities++] = identities[index];
+    }
+    for (size_t index = 0; index < addressCount; ++index) {
+        if (addressMissing(server, addresses[index])) addresses[missing++] = addresses[index];
+    }
+    cacheUnlock();
+    for (size_t index = 0; index < dueIdentities; ++index) ts3Functions.requestClientVariables(serverConnectionHandlerID, identities[index], NULL);
+    for (size_t index = 0; index < missing; ++index) ts3Functions.requestConnectionInfo(serverConnectionHandlerID, addresses[index], NULL);
+}
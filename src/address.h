@@ -0,0 +1,36 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef ADDRESS_H
+#define ADDRESS_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Connection info of every client is requested once to learn its address, and the client variables of the occupants
+ * of a shown channel are requested ahead so that their identity records are cached before their frames are opened.
+ * Requests are queued per connection and sent in small batches so that a raid or a fresh connection does not trip the server antiflood.
+ */
+void addressInit(unsigned int requestsPerSecond);
+void addressShutdown(void);
+
+void addressQueueClient(uint64 serverConnectionHandlerID, anyID clientID);
+
+/* Queues the clients of a shown channel with a missing identity, replacing those of the channel shown before */
+void addressPrefetchChannel(uint64 serverConnectionHandlerID, const anyID* clients);
+void addressDropServer(uint64 serverConnectionHandlerID);
+
+/* Sends the requests that are due, called from client events since the plugin has no timer */
+void addressPump(uint64 serverConnectionHandlerID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
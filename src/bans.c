@@ -0,0 +1,779 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "bans.h"
+#include "timing.h"
+
+#define BAN_REFRESH_INTERVAL 600000
+#define BAN_TRIE_SYMBOLS 18
+#define BAN_NONE (-1)
+
+/* Ban as received, the strings share one allocation */
+struct BanRule {
+    uint64 banID;
+    uint64 expiresAt; /* Unix time, 0 if permanent */
+    char*  ip;
+    char*  name;
+    char*  uniqueID;
+    char*  reason;
+    int    nextAddress; /* Next rule with the same trie key */
+    int    nextUID;     /* Next rule in the same unique identifier bucket */
+};
+
+/* Address characters, one child per digit, hex letter, '.' and ':' */
+struct TrieNode {
+    int child[BAN_TRIE_SYMBOLS];
+    int exact;  /* Rules for exactly this address */
+    int prefix; /* Rules for every address starting here */
+};
+
+/* Thompson automaton states, consuming states continue at out */
+enum NfaOp {
+    NFA_CHAR,
+    NFA_ANY,
+    NFA_CLASS,
+    NFA_SPLIT,
+    NFA_EMPTY,
+    NFA_MATCH,    /* Accepts anywhere, rule in out1 */
+    NFA_MATCH_END /* Accepts at the end of the input, rule in out1 */
+};
+
+struct NfaState {
+    unsigned char op;
+    unsigned char ch;
+    int           out;
+    int           out1; /* Second branch of a split, class of a class state, rule of a match state */
+};
+
+/* Combined automaton of many patterns with buffers for running it */
+struct Automaton {
+    struct NfaState* states;
+    size_t           count;
+    size_t           capacity;
+    uint8_t (*classes)[32];
+    size_t    classCount;
+    size_t    classCapacity;
+    int       anchoredStart; /* Patterns starting with '^', entered only at the first character */
+    int       floatingStart; /* Patterns entered at every character */
+    int*      current;
+    int*      next;
+    int*      stack;
+    unsigned* marks;
+    unsigned  generation;
+};
+
+/* Rules and compiled matchers of a connection */
+struct BanList {
+    struct BanList*  next;
+    uint64           serverConnectionHandlerID;
+    struct BanRule*  rules;
+    size_t           ruleCount;
+    size_t           ruleCapacity;
+    size_t           skipped;
+    uint64           requestedAt; /* Monotonic milliseconds, 0 if never requested */
+    bool             replacing;   /* Next rule received starts a new list */
+    bool             denied;      /* The server refused the list, it is not requested again on this connection */
+    bool             dirty;       /* Rules changed since compiling */
+    struct TrieNode* trie;
+    size_t           trieCount;
+    size_t           trieCapacity;
+    int*             uidBuckets;
+    size_t           uidBucketCount;
+    struct Automaton names;
+    struct Automaton addresses;
+};
+
+static mtx_t           bansMutex;
+static struct BanList* lists = NULL;
+
+/*********************************** Automaton ************************************/
+
+/* Parser of one pattern, dangling outs are chained through the out fields as state * 2 + branch */
+struct Parser {
+    struct Automaton* automaton;
+    const char*       pattern;
+    bool              failed;
+};
+
+struct Fragment {
+    int start;
+    int outs;
+};
+
+static int addState(struct Automaton* automaton, unsigned char op, unsigned char ch, int out, int out1) {
+    if (automaton->count == automaton->capacity) {
+        const size_t     capacity = automaton->capacity ? automaton->capacity * 2 : 64;
+        struct NfaState* states   = (struct NfaState*)realloc(automaton->states, capacity * sizeof(struct NfaState));
+        if (!states) return BAN_NONE;
+        automaton->states   = states;
+        automaton->capacity = capacity;
+    }
+    automaton->states[automaton->count] = (struct NfaState){op, ch, out, out1};
+    return (int)automaton->count++;
+}
+
+static int addClass(struct Automaton* automaton, const uint8_t* bits) {
+    if (automaton->classCount == automaton->classCapacity) {
+        const size_t capacity = automaton->classCapacity ? automaton->classCapacity * 2 : 8;
+        uint8_t(*classes)[32] = realloc(automaton->classes, capacity * sizeof(*classes));
+        if (!classes) return BAN_NONE;
+        automaton->classes       = classes;
+        automaton->classCapacity = capacity;
+    }
+    memcpy(automaton->classes[automaton->classCount], bits, 32);
+    return (int)automaton->classCount++;
+}
+
+static int* outField(struct Automaton* automaton, int entry) {
+    struct NfaState* state = &automaton->states[entry >> 1];
+    return entry & 1 ? &state->out1 : &state->out;
+}
+
+static void patch(struct Automaton* automaton, int outs, int target) {
+    while (outs != BAN_NONE) {
+        int* field = outField(automaton, outs);
+        outs       = *field;
+        *field     = target;
+    }
+}
+
+static int append(struct Automaton* automaton, int first, int second) {
+    if (first == BAN_NONE) return second;
+    int entry = first;
+    while (*outField(automaton, entry) != BAN_NONE) entry = *outField(automaton, entry);
+    *outField(automaton, entry) = second;
+    return first;
+}
+
+/* Single state fragment with a dangling out */
+static struct Fragment single(struct Parser* parser, unsigned char op, unsigned char ch, int out1) {
+    const int state = addState(parser->automaton, op, ch, BAN_NONE, out1);
+    if (state == BAN_NONE) parser->failed = true;
+    return (struct Fragment){state, state == BAN_NONE ? BAN_NONE : state * 2};
+}
+
+static void setBit(uint8_t* bits, unsigned char ch) {
+    bits[ch >> 3] |= (uint8_t)(1 << (ch & 7));
+}
+
+static void setFolded(uint8_t* bits, unsigned char ch) {
+    setBit(bits, (unsigned char)tolower(ch));
+    setBit(bits, (unsigned char)toupper(ch));
+}
+
+/* Adds the characters of a \d, \w or \s shorthand, returns false for other escapes */
+static bool addShorthand(uint8_t* bits, char shorthand) {
+    for (int ch = 0; ch < 256; ++ch) {
+        bool member;
+        switch (tolower((unsigned char)shorthand)) {
+            case 'd':
+                member = isdigit(ch);
+                break;
+            case 'w':
+                member = isalnum(ch) || ch == '_';
+                break;
+            case 's':
+                member = isspace(ch);
+                break;
+            default:
+                return false;
+        }
+        if (member != (bool)isupper((unsigned char)shorthand)) setBit(bits, (unsigned char)ch);
+    }
+    return true;
+}
+
+static struct Fragment classFragment(struct Parser* parser, uint8_t* bits, bool negated) {
+    if (negated) {
+        for (size_t index = 0; index < 32; ++index) bits[index] = (uint8_t)~bits[index];
+    }
+    const int index = addClass(parser->automaton, bits);
+    if (index == BAN_NONE) parser->failed = true;
+    return single(parser, NFA_CLASS, 0, index);
+}
+
+static struct Fragment parseClass(struct Parser* parser) {
+    uint8_t    bits[32] = {0};
+    const bool negated  = *parser->pattern == '^';
+    if (negated) ++parser->pattern;
+    bool first = true;
+    while (*parser->pattern && (first || *parser->pattern != ']')) {
+        unsigned char low = (unsigned char)*parser->pattern++;
+        first             = false;
+        if (low == '\\') {
+            if (!*parser->pattern) break;
+            if (addShorthand(bits, *parser->pattern)) {
+                ++parser->pattern;
+                continue;
+            }
+            low = (unsigned char)*parser->pattern++;
+        }
+        unsigned char high = low;
+        if (parser->pattern[0] == '-' && parser->pattern[1] && parser->pattern[1] != ']') {
+            high = (unsigned char)parser->pattern[1];
+            parser->pattern += 2;
+        }
+        for (unsigned int ch = low; ch <= high; ++ch) setFolded(bits, (unsigned char)ch);
+    }
+    if (*parser->pattern != ']') {
+        parser->failed = true;
+        return (struct Fragment){BAN_NONE, BAN_NONE};
+    }
+    ++parser->pattern;
+    return classFragment(parser, bits, negated);
+}
+
+static struct Fragment parseAlternation(struct Parser* parser);
+
+static struct Fragment parseAtom(struct Parser* parser) {
+    const char ch = *parser->pattern++;
+    switch (ch) {
+        case '(': {
+            if (parser->pattern[0] == '?' && parser->pattern[1] == ':') parser->pattern += 2;
+            const struct Fragment group = parseAlternation(parser);
+            if (*parser->pattern == ')') {
+                ++parser->pattern;
+            } else {
+                parser->failed = true;
+            }
+            return group;
+        }
+        case '[':
+            return parseClass(parser);
+        case '.':
+            return single(parser, NFA_ANY, 0, BAN_NONE);
+        case '\\': {
+            const char escaped = *parser->pattern;
+            if (!escaped) break;
+            ++parser->pattern;
+            uint8_t bits[32] = {0};
+            if (addShorthand(bits, escaped)) return classFragment(parser, bits, false);
+            return single(parser, NFA_CHAR, (unsigned char)tolower((unsigned char)escaped), BAN_NONE);
+        }
+        case '^':
+        case '$':
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            break;
+        default:
+            return single(parser, NFA_CHAR, (unsigned char)tolower((unsigned char)ch), BAN_NONE);
+    }
+    parser->failed = true;
+    return (struct Fragment){BAN_NONE, BAN_NONE};
+}
+
+static struct Fragment parseRepeat(struct Parser* parser) {
+    struct Fragment fragment = parseAtom(parser);
+    while (!parser->failed && (*parser->pattern == '*' || *parser->pattern == '+' || *parser->pattern == '?')) {
+        const char quantifier = *parser->pattern++;
+        const int  split      = addState(parser->automaton, NFA_SPLIT, 0, fragment.start, BAN_NONE);
+        if (split == BAN_NONE) {
+            parser->failed = true;
+            break;
+        }
+        if (quantifier == '*') {
+            patch(parser->automaton, fragment.outs, split);
+            fragment = (struct Fragment){split, split * 2 + 1};
+        } else if (quantifier == '+') {
+            patch(parser->automaton, fragment.outs, split);
+            fragment.outs = split * 2 + 1;
+        } else {
+            fragment = (struct Fragment){split, append(parser->automaton, fragment.outs, split * 2 + 1)};
+        }
+    }
+    return fragment;
+}
+
+static bool concatenationEnds(const char* pattern) {
+    return !*pattern || *pattern == '|' || *pattern == ')' || (pattern[0] == '$' && !pattern[1]);
+}
+
+static struct Fragment parseConcatenation(struct Parser* parser) {
+    if (concatenationEnds(parser->pattern)) return single(parser, NFA_EMPTY, 0, BAN_NONE);
+    struct Fragment fragment = parseRepeat(parser);
+    while (!parser->failed && !concatenationEnds(parser->pattern)) {
+        const struct Fragment following = parseRepeat(parser);
+        if (parser->failed) break;
+        patch(parser->automaton, fragment.outs, following.start);
+        fragment.outs = following.outs;
+    }
+    return fragment;
+}
+
+static struct Fragment parseAlternation(struct Parser* parser) {
+    struct Fragment fragment = parseConcatenation(parser);
+    while (!parser->failed && *parser->pattern == '|') {
+        ++parser->pattern;
+        const struct Fragment alternative = parseConcatenation(parser);
+        if (parser->failed) break;
+        const int split = addState(parser->automaton, NFA_SPLIT, 0, fragment.start, alternative.start);
+        if (split == BAN_NONE) {
+            parser->failed = true;
+            break;
+        }
+        fragment = (struct Fragment){split, append(parser->automaton, fragment.outs, alternative.outs)};
+    }
+    return fragment;
+}
+
+/* Adds a pattern for a rule, returns false and leaves the automaton unchanged if the syntax is unsupported */
+static bool addPattern(struct Automaton* automaton, const char* pattern, int rule) {
+    const size_t  stateCount = automaton->count;
+    const size_t  classCount = automaton->classCount;
+    const bool    anchored   = *pattern == '^';
+    struct Parser parser     = {automaton, pattern + anchored, false};
+
+    const struct Fragment fragment = parseAlternation(&parser);
+    const bool            atEnd    = parser.pattern[0] == '$' && !parser.pattern[1];
+    if (!parser.failed && (atEnd || !*parser.pattern)) {
+        const int match = addState(automaton, atEnd ? NFA_MATCH_END : NFA_MATCH, 0, BAN_NONE, rule);
+        int*      start = anchored ? &automaton->anchoredStart : &automaton->floatingStart;
+        const int entry = match == BAN_NONE ? BAN_NONE : addState(automaton, NFA_SPLIT, 0, fragment.start, *start);
+        if (entry != BAN_NONE) {
+            patch(automaton, fragment.outs, match);
+            *start = entry;
+            return true;
+        }
+    }
+    automaton->count      = stateCount;
+    automaton->classCount = classCount;
+    return false;
+}
+
+static bool prepareRun(struct Automaton* automaton) {
+    if (automaton->count == 0) return false;
+    free(automaton->current);
+    free(automaton->next);
+    free(automaton->stack);
+    free(automaton->marks);
+    automaton->current    = (int*)malloc(automaton->count * sizeof(int));
+    automaton->next       = (int*)malloc(automaton->count * sizeof(int));
+    automaton->stack      = (int*)malloc((automaton->count * 2 + 1) * sizeof(int));
+    automaton->marks      = (unsigned*)calloc(automaton->count, sizeof(unsigned));
+    automaton->generation = 0;
+    return automaton->current && automaton->next && automaton->stack && automaton->marks;
+}
+
+static void freeAutomaton(struct Automaton* automaton) {
+    free(automaton->states);
+    free(automaton->classes);
+    free(automaton->current);
+    free(automaton->next);
+    free(automaton->stack);
+    free(automaton->marks);
+    memset(automaton, 0, sizeof(*automaton));
+    automaton->anchoredStart = BAN_NONE;
+    automaton->floatingStart = BAN_NONE;
+}
+
+static bool ruleActive(const struct BanRule* rule, uint64 now) {
+    return rule->expiresAt == 0 || now < rule->expiresAt;
+}
+
+/* Follows the empty transitions of a state into list, returns an accepted active rule or BAN_NONE */
+static int follow(struct Automaton* automaton, const struct BanList* list, int* states, size_t* count, int start, uint64 now) {
+    size_t depth                = 0;
+    automaton->stack[depth++]   = start;
+    while (depth > 0) {
+        const int state = automaton->stack[--depth];
+        if (state == BAN_NONE || automaton->marks[state] == automaton->generation) continue;
+        automaton->marks[state]        = automaton->generation;
+        const struct NfaState* current = &automaton->states[state];
+        switch (current->op) {
+            case NFA_SPLIT:
+                automaton->stack[depth++] = current->out1;
+                automaton->stack[depth++] = current->out;
+                break;
+            case NFA_EMPTY:
+                automaton->stack[depth++] = current->out;
+                break;
+            case NFA_MATCH:
+                if (ruleActive(&list->rules[current->out1], now)) return current->out1;
+                break;
+            default:
+                states[(*count)++] = state;
+        }
+    }
+    return BAN_NONE;
+}
+
+static bool consumes(const struct Automaton* automaton, const struct NfaState* state, unsigned char ch) {
+    switch (state->op) {
+        case NFA_CHAR:
+            return state->ch == ch;
+        case NFA_ANY:
+            return true;
+        case NFA_CLASS:
+            return automaton->classes[state->out1][ch >> 3] & (1 << (ch & 7));
+        default:
+            return false;
+    }
+}
+
+/* Searches the input with all patterns at once, returns the first active rule found */
+static int runAutomaton(struct Automaton* automaton, const struct BanList* list, const char* input, uint64 now) {
+    if (!automaton->marks) return BAN_NONE;
+    size_t count = 0;
+    int    rule  = BAN_NONE;
+    ++automaton->generation;
+    if (automaton->anchoredStart != BAN_NONE) rule = follow(automaton, list, automaton->current, &count, automaton->anchoredStart, now);
+    if (rule == BAN_NONE && automaton->floatingStart != BAN_NONE) rule = follow(automaton, list, automaton->current, &count, automaton->floatingStart, now);
+
+    for (const unsigned char* c = (const unsigned char*)input; *c && rule == BAN_NONE; ++c) {
+        const unsigned char ch        = (unsigned char)tolower(*c);
+        size_t              nextCount = 0;
+        ++automaton->generation;
+        for (size_t index = 0; index < count && rule == BAN_NONE; ++index) {
+            const struct NfaState* state = &automaton->states[automaton->current[index]];
+            if (consumes(automaton, state, ch)) rule = follow(automaton, list, automaton->next, &nextCount, state->out, now);
+        }
+        if (rule == BAN_NONE && automaton->floatingStart != BAN_NONE) rule = follow(automaton, list, automaton->next, &nextCount, automaton->floatingStart, now);
+        int* swap          = automaton->current;
+        automaton->current = automaton->next;
+        automaton->next    = swap;
+        count              = nextCount;
+    }
+
+    for (size_t index = 0; index < count && rule == BAN_NONE; ++index) {
+        const struct NfaState* state = &automaton->states[automaton->current[index]];
+        if (state->op == NFA_MATCH_END && ruleActive(&list->rules[state->out1], now)) rule = state->out1;
+    }
+    return rule;
+}
+
+/*********************************** Address trie ************************************/
+
+static int trieSymbol(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    if (ch == '.') return 16;
+    if (ch == ':') return 17;
+    return BAN_NONE;
+}
+
+static int addTrieNode(struct BanList* list) {
+    if (list->trieCount == list->trieCapacity) {
+        const size_t     capacity = list->trieCapacity ? list->trieCapacity * 2 : 64;
+        struct TrieNode* trie     = (struct TrieNode*)realloc(list->trie, capacity * sizeof(struct TrieNode));
+        if (!trie) return BAN_NONE;
+        list->trie         = trie;
+        list->trieCapacity = capacity;
+    }
+    struct TrieNode* node = &list->trie[list->trieCount];
+    for (size_t symbol = 0; symbol < BAN_TRIE_SYMBOLS; ++symbol) node->child[symbol] = BAN_NONE;
+    node->exact  = BAN_NONE;
+    node->prefix = BAN_NONE;
+    return (int)list->trieCount++;
+}
+
+/*
+ * Reduces an address pattern to a trie key where the search it stands for is a plain address or address prefix:
+ * '^', then digits, hex letters, colons and escaped dots, then '$' for an exact address or nothing, .* or .*$ for a prefix.
+ * Returns false for everything else, unescaped dots match any character and unanchored patterns match anywhere.
+ */
+static bool addressKey(const char* pattern, char* key, size_t size, bool* prefix) {
+    size_t length = 0;
+    *prefix       = true;
+    if (*pattern++ != '^') return false;
+    while (*pattern) {
+        if (strcmp(pattern, "$") == 0) {
+            *prefix = false;
+            break;
+        }
+        if (strcmp(pattern, ".*") == 0 || strcmp(pattern, ".*$") == 0) break;
+        char ch = *pattern++;
+        if (ch == '.') return false;
+        if (ch == '\\' && *pattern == '.') ch = *pattern++;
+        if (trieSymbol(ch) == BAN_NONE || length + 1 >= size) return false;
+        key[length++] = ch;
+    }
+    key[length] = '\0';
+    return length > 0;
+}
+
+static bool addAddress(struct BanList* list, const char* key, bool prefix, int rule) {
+    if (list->trieCount == 0 && addTrieNode(list) == BAN_NONE) return false;
+    int node = 0;
+    for (const char* c = key; *c; ++c) {
+        const int symbol = trieSymbol(*c);
+        int       child  = list->trie[node].child[symbol];
+        if (child == BAN_NONE) {
+            child = addTrieNode(list);
+            if (child == BAN_NONE) return false;
+            list->trie[node].child[symbol] = child;
+        }
+        node = child;
+    }
+    int* head                     = prefix ? &list->trie[node].prefix : &list->trie[node].exact;
+    list->rules[rule].nextAddress = *head;
+    *head                         = rule;
+    return true;
+}
+
+static int activeRule(const struct BanList* list, int rule, bool address, uint64 now) {
+    for (; rule != BAN_NONE; rule = address ? list->rules[rule].nextAddress : list->rules[rule].nextUID) {
+        if (ruleActive(&list->rules[rule], now)) return rule;
+    }
+    return BAN_NONE;
+}
+
+static int matchAddress(const struct BanList* list, const char* address, uint64 now) {
+    if (list->trieCount == 0) return BAN_NONE;
+    int node = 0;
+    for (const char* c = address;; ++c) {
+        const int rule = activeRule(list, list->trie[node].prefix, true, now);
+        if (rule != BAN_NONE) return rule;
+        if (!*c) return activeRule(list, list->trie[node].exact, true, now);
+        const int symbol = trieSymbol(*c);
+        if (symbol == BAN_NONE || list->trie[node].child[symbol] == BAN_NONE) return BAN_NONE;
+        node = list->trie[node].child[symbol];
+    }
+}
+
+/*********************************** Unique identifiers ************************************/
+
+/* FNV-1a hash of a string */
+static size_t hashString(const char* text) {
+    uint64 hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)text; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static int matchUID(const struct BanList* list, const char* uniqueID, uint64 now) {
+    if (list->uidBucketCount == 0) return BAN_NONE;
+    for (int rule = list->uidBuckets[hashString(uniqueID) & (list->uidBucketCount - 1)]; rule != BAN_NONE; rule = list->rules[rule].nextUID) {
+        if (strcmp(list->rules[rule].uniqueID, uniqueID) == 0 && ruleActive(&list->rules[rule], now)) return rule;
+    }
+    return BAN_NONE;
+}
+
+/*********************************** Ban lists ************************************/
+
+static void freeMatchers(struct BanList* list) {
+    free(list->trie);
+    free(list->uidBuckets);
+    list->trie           = NULL;
+    list->trieCount      = 0;
+    list->trieCapacity   = 0;
+    list->uidBuckets     = NULL;
+    list->uidBucketCount = 0;
+    freeAutomaton(&list->names);
+    freeAutomaton(&list->addresses);
+}
+
+static void clearRules(struct BanList* list) {
+    for (size_t rule = 0; rule < list->ruleCount; ++rule) free(list->rules[rule].ip);
+    list->ruleCount = 0;
+    list->skipped   = 0;
+    list->dirty     = true;
+}
+
+static void freeList(struct BanList* list) {
+    clearRules(list);
+    freeMatchers(list);
+    free(list->rules);
+    free(list);
+}
+
+static struct BanList* getList(uint64 serverConnectionHandlerID, bool create) {
+    for (struct BanList* list = lists; list; list = list->next) {
+        if (list->serverConnectionHandlerID == serverConnectionHandlerID) return list;
+    }
+    if (!create) return NULL;
+    struct BanList* list = (struct BanList*)calloc(1, sizeof(struct BanList));
+    if (!list) return NULL;
+    freeAutomaton(&list->names);
+    freeAutomaton(&list->addresses);
+    list->serverConnectionHandlerID = serverConnectionHandlerID;
+    list->next                      = lists;
+    lists                           = list;
+    return list;
+}
+
+/* Builds all matchers from the rules, rules that cannot be compiled are counted as skipped */
+static void compile(struct BanList* list) {
+    freeMatchers(list);
+    list->skipped = 0;
+    list->dirty   = false;
+
+    size_t buckets = 16;
+    while (buckets < list->ruleCount) buckets *= 2;
+    list->uidBuckets = (int*)malloc(buckets * sizeof(int));
+    if (list->uidBuckets) {
+        list->uidBucketCount = buckets;
+        for (size_t bucket = 0; bucket < buckets; ++bucket) list->uidBuckets[bucket] = BAN_NONE;
+    }
+
+    for (size_t index = 0; index < list->ruleCount; ++index) {
+        struct BanRule* rule = &list->rules[index];
+        bool            ok   = true;
+        rule->nextAddress    = BAN_NONE;
+        rule->nextUID        = BAN_NONE;
+        if (rule->ip[0]) {
+            char key[64];
+            bool prefix;
+            ok &= addressKey(rule->ip, key, sizeof(key), &prefix) ? addAddress(list, key, prefix, (int)index) : addPattern(&list->addresses, rule->ip, (int)index);
+        }
+        if (rule->name[0]) ok &= addPattern(&list->names, rule->name, (int)index);
+        if (rule->uniqueID[0] && list->uidBucketCount) {
+            int* bucket   = &list->uidBuckets[hashString(rule->uniqueID) & (list->uidBucketCount - 1)];
+            rule->nextUID = *bucket;
+            *bucket       = (int)index;
+        }
+        if (!ok) ++list->skipped;
+    }
+    prepareRun(&list->names);
+    prepareRun(&list->addresses);
+}
+
+static void fillMatch(const struct BanList* list, int rule, enum BanCriterion criterion, struct BanMatch* match) {
+    match->banID     = list->rules[rule].banID;
+    match->criterion = criterion;
+    strncpy(match->reason, list->rules[rule].reason, BAN_REASON_BUFSIZE - 1);
+    match->reason[BAN_REASON_BUFSIZE - 1] = '\0';
+}
+
+void bansInit(void) {
+    mtx_init(&bansMutex, mtx_plain);
+}
+
+void bansShutdown(void) {
+    mtx_lock(&bansMutex);
+    while (lists) {
+        struct BanList* next = lists->next;
+        freeList(lists);
+        lists = next;
+    }
+    mtx_unlock(&bansMutex);
+    mtx_destroy(&bansMutex);
+}
+
+bool bansRefreshDue(uint64 serverConnectionHandlerID) {
+    const uint64 now = timingMonotonicMs();
+    bool         due = false;
+    mtx_lock(&bansMutex);
+    struct BanList* list = getList(serverConnectionHandlerID, true);
+    if (list && !list->denied && (list->requestedAt == 0 || now - list->requestedAt >= BAN_REFRESH_INTERVAL)) {
+        list->requestedAt = now;
+        list->replacing   = true;
+        due               = true;
+    }
+    mtx_unlock(&bansMutex);
+    return due;
+}
+
+void bansAdd(uint64 serverConnectionHandlerID, uint64 banID, const char* ip, const char* name, const char* uniqueID, uint64 creationTime, uint64 durationTime, const char* reason) {
+    ip       = ip ? ip : "";
+    name     = name ? name : "";
+    uniqueID = uniqueID ? uniqueID : "";
+    reason   = reason ? reason : "";
+    const size_t ipLength     = strlen(ip) + 1;
+    const size_t nameLength   = strlen(name) + 1;
+    const size_t uidLength    = strlen(uniqueID) + 1;
+    const size_t reasonLength = strlen(reason) + 1;
+
+    mtx_lock(&bansMutex);
+    struct BanList* list = getList(serverConnectionHandlerID, true);
+    if (list && list->replacing) {
+        clearRules(list);
+        list->replacing = false;
+    }
+    if (list && list->ruleCount == list->ruleCapacity) {
+        const size_t    capacity = list->ruleCapacity ? list->ruleCapacity * 2 : 64;
+        struct BanRule* rules    = (struct BanRule*)realloc(list->rules, capacity * sizeof(struct BanRule));
+        if (rules) {
+            list->rules        = rules;
+            list->ruleCapacity = capacity;
+        }
+    }
+    char* text = list && list->ruleCount < list->ruleCapacity ? (char*)malloc(ipLength + nameLength + uidLength + reasonLength) : NULL;
+    if (text) {
+        struct BanRule* rule = &list->rules[list->ruleCount++];
+        rule->banID          = banID;
+        rule->expiresAt      = durationTime == 0 ? 0 : creationTime + durationTime;
+        rule->ip             = memcpy(text, ip, ipLength);
+        rule->name           = memcpy(text + ipLength, name, nameLength);
+        rule->uniqueID       = memcpy(text + ipLength + nameLength, uniqueID, uidLength);
+        rule->reason         = memcpy(text + ipLength + nameLength + uidLength, reason, reasonLength);
+        list->dirty          = true;
+    }
+    mtx_unlock(&bansMutex);
+}
+
+void bansRequestEnded(uint64 serverConnectionHandlerID, bool denied) {
+    mtx_lock(&bansMutex);
+    struct BanList* list = getList(serverConnectionHandlerID, false);
+    /* No rule arrived since the request, the server has no bans left or none that can be seen */
+    if (list && (list->replacing || denied)) {
+        clearRules(list);
+        list->replacing = false;
+        list->denied    = denied;
+    }
+    mtx_unlock(&bansMutex);
+}
+
+bool bansDenied(uint64 serverConnectionHandlerID) {
+    mtx_lock(&bansMutex);
+    const struct BanList* list   = getList(serverConnectionHandlerID, false);
+    const bool            denied = list && list->denied;
+    mtx_unlock(&bansMutex);
+    return denied;
+}
+
+void bansDropServer(uint64 serverConnectionHandlerID) {
+    mtx_lock(&bansMutex);
+    for (struct BanList** link = &lists; *link; link = &(*link)->next) {
+        if ((*link)->serverConnectionHandlerID == serverConnectionHandlerID) {
+            struct BanList* list = *link;
+            *link                = list->next;
+            freeList(list);
+            break;
+        }
+    }
+    mtx_unlock(&bansMutex);
+}
+
+bool bansMatch(uint64 serverConnectionHandlerID, const char* address, const char* nickname, const char* uniqueID, struct BanMatch* match) {
+    const uint64 now   = (uint64)time(NULL);
+    bool         found = false;
+    mtx_lock(&bansMutex);
+    struct BanList* list = getList(serverConnectionHandlerID, false);
+    if (list && list->dirty) compile(list);
+    if (list && list->ruleCount > 0) {
+        int rule = BAN_NONE;
+        if (uniqueID && uniqueID[0] && (rule = matchUID(list, uniqueID, now)) != BAN_NONE) {
+            fillMatch(list, rule, BAN_CRITERION_UID, match);
+        } else if (address && address[0] && ((rule = matchAddress(list, address, now)) != BAN_NONE || (rule = runAutomaton(&list->addresses, list, address, now)) != BAN_NONE)) {
+            fillMatch(list, rule, BAN_CRITERION_ADDRESS, match);
+        } else if (nickname && nickname[0] && (rule = runAutomaton(&list->names, list, nickname, now)) != BAN_NONE) {
+            fillMatch(list, rule, BAN_CRITERION_NAME, match);
+        }
+        found = rule != BAN_NONE;
+    }
+    mtx_unlock(&bansMutex);
+    return found;
+}
+
+void bansGetCounts(uint64 serverConnectionHandlerID, size_t* rules, size_t* skipped) {
+    mtx_lock(&bansMutex);
+    struct BanList* list = getList(serverConnectionHandlerID, false);
+    if (list && list->dirty) compile(list);
+    *rules   = list ? list->ruleCount : 0;
+    *skipped = list ? list->skipped : 0;
+    mtx_unlock(&bansMutex);
+}
@@ -0,0 +1,57 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef BANS_H
+#define BANS_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BAN_REASON_BUFSIZE 128
+
+/* Client property that matched a ban */
+enum BanCriterion {
+    BAN_CRITERION_ADDRESS,
+    BAN_CRITERION_NAME,
+    BAN_CRITERION_UID
+};
+
+struct BanMatch {
+    uint64            banID;
+    enum BanCriterion criterion;
+    char              reason[BAN_REASON_BUFSIZE];
+};
+
+/*
+ * Ban list of each connection compiled into matchers once it changes:
+ * a trie of anchored plain and prefix addresses, a hash set of unique identifiers and one automaton for all name and remaining address patterns.
+ * Patterns are case-insensitive searches like on the server, whichever matcher compiles them, patterns with unsupported syntax are skipped.
+ */
+void bansInit(void);
+void bansShutdown(void);
+
+/* Returns true once the ban list should be requested again, the first rule added afterwards replaces the current list */
+bool bansRefreshDue(uint64 serverConnectionHandlerID);
+void bansAdd(uint64 serverConnectionHandlerID, uint64 banID, const char* ip, const char* name, const char* uniqueID, uint64 creationTime, uint64 durationTime, const char* reason);
+
+/* Ends a request answered without rules or refused, clearing the list, a refused list is not requested again on the connection */
+void bansRequestEnded(uint64 serverConnectionHandlerID, bool denied);
+bool bansDenied(uint64 serverConnectionHandlerID);
+void bansDropServer(uint64 serverConnectionHandlerID);
+
+/* Finds an active ban of any of the properties, empty properties are skipped */
+bool bansMatch(uint64 serverConnectionHandlerID, const char* address, const char* nickname, const char* uniqueID, struct BanMatch* match);
+
+/* Rules received and rules skipped for unsupported patterns */
+void bansGetCounts(uint64 serverConnectionHandlerID, size_t* rules, size_t* skipped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
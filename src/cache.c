@@ -0,0 +1,731 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_rare_definitions.h"
+
+#include "cache.h"
+#include "timing.h"
+
+#define IDENTITY_INITIAL_BUCKETS 64
+#define CHANNEL_INITIAL_BUCKETS 64
+#define EVICTION_SLACK 8 /* Evicting stops 1/8 below the budget so that eviction does not run for every new identity */
+#define HEAT_HALF_LIFE 300000
+#define HEAT_RESCALE_HALF_LIVES 256 /* Heat is rescaled to a new epoch before the scale factor grows out of range */
+
+static mtx_t               cacheMutex;
+static struct ServerCache* servers           = NULL;
+static size_t              serverBudget      = 0;
+static size_t              globalBudget      = 0;
+static size_t              globalEvictAbove  = 0;
+static size_t              descriptionBudget = 0;
+static size_t              totalBytes[CACHE_SUBSYSTEM_COUNT];
+static uint64              totalEvictions    = 0;
+static uint64              heatHalfLife      = HEAT_HALF_LIFE;
+
+/* FNV-1a hash of a string */
+static size_t hashString(const char* text) {
+    uint64 hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)text; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+/* Mixes the bits of a channel ID */
+static size_t hashChannelID(uint64 channelID) {
+    channelID ^= channelID >> 33;
+    channelID *= 0xff51afd7ed558ccdULL;
+    channelID ^= channelID >> 33;
+    return (size_t)channelID;
+}
+
+static void account(struct ServerCache* server, enum CacheSubsystem subsystem, size_t bytes, bool released) {
+    if (released) {
+        server->bytes[subsystem] -= bytes;
+        totalBytes[subsystem] -= bytes;
+    } else {
+        server->bytes[subsystem] += bytes;
+        totalBytes[subsystem] += bytes;
+    }
+}
+
+static size_t sumBytes(const size_t* bytes) {
+    size_t total = 0;
+    for (size_t subsystem = 0; subsystem < CACHE_SUBSYSTEM_COUNT; ++subsystem) total += bytes[subsystem];
+    return total;
+}
+
+static void freeServer(struct ServerCache* server) {
+    for (size_t subsystem = 0; subsystem < CACHE_SUBSYSTEM_COUNT; ++subsystem) totalBytes[subsystem] -= server->bytes[subsystem];
+    for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) free(server->pages[page]);
+    for (size_t bucket = 0; bucket < server->channelBuckets; ++bucket) {
+        struct CachedChannel* channel = server->channels[bucket];
+        while (channel) {
+            struct CachedChannel* next = channel->next;
+            free(channel->description);
+            free(channel);
+            channel = next;
+        }
+    }
+    free(server->channels);
+    for (size_t tally = 0; tally < CACHE_TALLY_COUNT; ++tally) {
+        for (size_t bucket = 0; bucket < CACHE_TALLY_BUCKETS; ++bucket) {
+            struct TallyKey* key = server->tallies[tally][bucket];
+            while (key) {
+                struct TallyKey* next = key->next;
+                free(key);
+                key = next;
+            }
+        }
+    }
+    for (size_t bucket = 0; bucket < server->identityBuckets; ++bucket) {
+        struct IdentityRecord* identity = server->identities[bucket];
+        while (identity) {
+            struct IdentityRecord* next = identity->next;
+            free(identity);
+            identity = next;
+        }
+    }
+    free(server->identities);
+    free(server);
+}
+
+static void unlinkIdentity(struct ServerCache* server, struct IdentityRecord* identity) {
+    if (identity->newer) {
+        identity->newer->older = identity->older;
+    } else {
+        server->newestIdentity = identity->older;
+    }
+    if (identity->older) {
+        identity->older->newer = identity->newer;
+    } else {
+        server->oldestIdentity = identity->newer;
+    }
+    identity->newer = NULL;
+    identity->older = NULL;
+}
+
+static void pushNewest(struct ServerCache* server, struct IdentityRecord* identity) {
+    identity->older = server->newestIdentity;
+    identity->newer = NULL;
+    if (server->newestIdentity) {
+        server->newestIdentity->newer = identity;
+    } else {
+        server->oldestIdentity = identity;
+    }
+    server->newestIdentity = identity;
+}
+
+static struct IdentityRecord* findIdentity(struct ServerCache* server, const char* uniqueID) {
+    for (struct IdentityRecord* identity = server->identities[hashString(uniqueID) & (server->identityBuckets - 1)]; identity; identity = identity->next) {
+        if (strcmp(identity->uniqueID, uniqueID) == 0) return identity;
+    }
+    return NULL;
+}
+
+/* Marks the identities of present clients, the selected client is always present */
+static void pinVisible(struct ServerCache* server) {
+    ++server->pinMark;
+    for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) {
+        struct CachedClient* clients = server->pages[page];
+        if (!clients) continue;
+        for (size_t slot = 0; slot < CACHE_PAGE_SIZE; ++slot) {
+            if (!clients[slot].present || !clients[slot].uniqueID[0]) continue;
+            struct IdentityRecord* identity = findIdentity(server, clients[slot].uniqueID);
+            if (identity) identity->pinnedMark = server->pinMark;
+        }
+    }
+}
+
+/* Least recently used identity that may be evicted, pinned identities are moved to the front on the way */
+static struct IdentityRecord* oldestEvictable(struct ServerCache* server, const struct IdentityRecord* keep) {
+    for (size_t checked = 0; checked < server->identityCount && server->oldestIdentity; ++checked) {
+        struct IdentityRecord* identity = server->oldestIdentity;
+        if (identity != keep && identity->pinnedMark != server->pinMark) return identity;
+        unlinkIdentity(server, identity);
+        pushNewest(server, identity);
+    }
+    return NULL;
+}
+
+static void evictIdentity(struct ServerCache* server, struct IdentityRecord* identity) {
+    for (struct IdentityRecord** link = &server->identities[hashString(identity->uniqueID) & (server->identityBuckets - 1)]; *link; link = &(*link)->next) {
+        if (*link == identity) {
+            *link = identity->next;
+            break;
+        }
+    }
+    unlinkIdentity(server, identity);
+    free(identity);
+    account(server, CACHE_SUBSYSTEM_IDENTITIES, sizeof(struct IdentityRecord), true);
+    --server->identityCount;
+    ++server->evictions;
+    ++totalEvictions;
+}
+
+/*
+ * Evicts identities of clients out of view until the connection and all connections are below their budgets.
+ * If visible data alone exceeds a budget, the next pass waits until the cache has grown by another slack step.
+ */
+static void enforceBudgets(struct ServerCache* server, const struct IdentityRecord* keep) {
+    struct IdentityRecord* victim;
+    if (serverBudget && sumBytes(server->bytes) > serverBudget && sumBytes(server->bytes) > server->evictAbove) {
+        const size_t target = serverBudget - serverBudget / EVICTION_SLACK;
+        pinVisible(server);
+        while (sumBytes(server->bytes) > target && (victim = oldestEvictable(server, keep))) evictIdentity(server, victim);
+        server->evictAbove = sumBytes(server->bytes) > target ? sumBytes(server->bytes) + serverBudget / EVICTION_SLACK : 0;
+    }
+    if (globalBudget && sumBytes(totalBytes) > globalBudget && sumBytes(totalBytes) > globalEvictAbove) {
+        const size_t target = globalBudget - globalBudget / EVICTION_SLACK;
+        for (struct ServerCache* candidate = servers; candidate; candidate = candidate->next) pinVisible(candidate);
+        while (sumBytes(totalBytes) > target) {
+            struct ServerCache* victimServer = NULL;
+            victim                           = NULL;
+            for (struct ServerCache* candidate = servers; candidate; candidate = candidate->next) {
+                struct IdentityRecord* oldest = oldestEvictable(candidate, keep);
+                if (oldest && (!victim || oldest->usedAt < victim->usedAt)) {
+                    victim       = oldest;
+                    victimServer = candidate;
+                }
+            }
+            if (!victim) break;
+            evictIdentity(victimServer, victim);
+        }
+        globalEvictAbove = sumBytes(totalBytes) > target ? sumBytes(totalBytes) + globalBudget / EVICTION_SLACK : 0;
+    }
+}
+
+static void unlinkDescription(struct ServerCache* server, struct CachedChannel* channel) {
+    if (channel->descriptionNewer) {
+        channel->descriptionNewer->descriptionOlder = channel->descriptionOlder;
+    } else {
+        server->newestDescription = channel->descriptionOlder;
+    }
+    if (channel->descriptionOlder) {
+        channel->descriptionOlder->descriptionNewer = channel->descriptionNewer;
+    } else {
+        server->oldestDescription = channel->descriptionNewer;
+    }
+    channel->descriptionNewer = NULL;
+    channel->descriptionOlder = NULL;
+}
+
+static void pushNewestDescription(struct ServerCache* server, struct CachedChannel* channel) {
+    channel->descriptionOlder = server->newestDescription;
+    channel->descriptionNewer = NULL;
+    if (server->newestDescription) {
+        server->newestDescription->descriptionNewer = channel;
+    } else {
+        server->oldestDescription = channel;
+    }
+    server->newestDescription = channel;
+}
+
+/* Factor of activity added now relative to activity added at the heat epoch */
+static double heatScale(const struct ServerCache* server, uint64 now) {
+    return exp2((double)(now - server->heatEpoch) / (double)heatHalfLife);
+}
+
+/* Moves the heat epoch to now, scaling every channel equally keeps the heap order */
+static void rescaleHeat(struct ServerCache* server, uint64 now) {
+    const double factor = 1.0 / heatScale(server, now);
+    for (size_t bucket = 0; bucket < server->channelBuckets; ++bucket) {
+        for (struct CachedChannel* channel = server->channels[bucket]; channel; channel = channel->next) channel->heat *= factor;
+    }
+    server->heatEpoch = now;
+}
+
+static void placeHottest(struct ServerCache* server, struct CachedChannel* channel, size_t index) {
+    server->hottest[index] = channel;
+    channel->hottestSlot   = (unsigned int)index + 1;
+}
+
+static void siftHottestUp(struct ServerCache* server, size_t index) {
+    struct CachedChannel* channel = server->hottest[index];
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (server->hottest[parent]->heat <= channel->heat) break;
+        placeHottest(server, server->hottest[parent], index);
+        index = parent;
+    }
+    placeHottest(server, channel, index);
+}
+
+static void siftHottestDown(struct ServerCache* server, size_t index) {
+    struct CachedChannel* channel = server->hottest[index];
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= server->hottestCount) break;
+        if (child + 1 < server->hottestCount && server->hottest[child + 1]->heat < server->hottest[child]->heat) ++child;
+        if (channel->heat <= server->hottest[child]->heat) break;
+        placeHottest(server, server->hottest[child], index);
+        index = child;
+    }
+    placeHottest(server, channel, index);
+}
+
+/* Ranks a channel that is not in the heap if it is hotter than the coldest ranked one */
+static void offerHottest(struct ServerCache* server, struct CachedChannel* channel) {
+    if (server->hottestCount < CACHE_HOTTEST_COUNT) {
+        server->hottest[server->hottestCount] = channel;
+        siftHottestUp(server, server->hottestCount++);
+    } else if (channel->heat > server->hottest[0]->heat) {
+        server->hottest[0]->hottestSlot = 0;
+        server->hottest[0]              = channel;
+        siftHottestDown(server, 0);
+    }
+}
+
+/* Removes a ranked channel, the next hottest channel takes its place */
+static void removeHottest(struct ServerCache* server, struct CachedChannel* channel) {
+    const size_t          index = channel->hottestSlot - 1;
+    struct CachedChannel* last  = server->hottest[--server->hottestCount];
+    channel->hottestSlot        = 0;
+    if (last != channel) {
+        server->hottest[index] = last;
+        siftHottestUp(server, index);
+        siftHottestDown(server, last->hottestSlot - 1);
+    }
+
+    struct CachedChannel* candidate = NULL;
+    for (size_t bucket = 0; bucket < server->channelBuckets; ++bucket) {
+        for (struct CachedChannel* cached = server->channels[bucket]; cached; cached = cached->next) {
+            if (!cached->hottestSlot && cached->heat > 0 && (!candidate || cached->heat > candidate->heat)) candidate = cached;
+        }
+    }
+    if (candidate) offerHottest(server, candidate);
+}
+
+/* Doubles the identity buckets once the table is fully loaded */
+static void growIdentities(struct ServerCache* server) {
+    const size_t            buckets    = server->identityBuckets * 2;
+    struct IdentityRecord** identities = (struct IdentityRecord**)calloc(buckets, sizeof(struct IdentityRecord*));
+    if (!identities) return;
+    for (size_t bucket = 0; bucket < server->identityBuckets; ++bucket) {
+        struct IdentityRecord* identity = server->identities[bucket];
+        while (identity) {
+            struct IdentityRecord* next  = identity->next;
+            const size_t           index = hashString(identity->uniqueID) & (buckets - 1);
+            identity->next               = identities[index];
+            identities[index]            = identity;
+            identity                     = next;
+        }
+    }
+    free(server->identities);
+    account(server, CACHE_SUBSYSTEM_IDENTITIES, server->identityBuckets * sizeof(struct IdentityRecord*), false);
+    server->identities      = identities;
+    server->identityBuckets = buckets;
+}
+
+/* Doubles the channel buckets once the table is fully loaded */
+static void growChannels(struct ServerCache* server) {
+    const size_t           buckets  = server->channelBuckets * 2;
+    struct CachedChannel** channels = (struct CachedChannel**)calloc(buckets, sizeof(struct CachedChannel*));
+    if (!channels) return;
+    for (size_t bucket = 0; bucket < server->channelBuckets; ++bucket) {
+        struct CachedChannel* channel = server->channels[bucket];
+        while (channel) {
+            struct CachedChannel* next  = channel->next;
+            const size_t          index = hashChannelID(channel->channelID) & (buckets - 1);
+            channel->next               = channels[index];
+            channels[index]             = channel;
+            channel                     = next;
+        }
+    }
+    free(server->channels);
+    account(server, CACHE_SUBSYSTEM_CHANNELS, server->channelBuckets * sizeof(struct CachedChannel*), false);
+    server->channels       = channels;
+    server->channelBuckets = buckets;
+}
+
+void cacheInit(void) {
+    mtx_init(&cacheMutex, mtx_plain);
+}
+
+void cacheShutdown(void) {
+    cacheLock();
+    while (servers) {
+        struct ServerCache* next = servers->next;
+        freeServer(servers);
+        servers = next;
+    }
+    cacheUnlock();
+    mtx_destroy(&cacheMutex);
+}
+
+void cacheLock(void) {
+    mtx_lock(&cacheMutex);
+}
+
+void cacheUnlock(void) {
+    mtx_unlock(&cacheMutex);
+}
+
+void cacheSetBudgets(size_t newServerBudget, size_t newGlobalBudget) {
+    cacheLock();
+    serverBudget = newServerBudget;
+    globalBudget = newGlobalBudget;
+    cacheUnlock();
+}
+
+void cacheSetDescriptionBudget(size_t budget) {
+    cacheLock();
+    descriptionBudget = budget;
+    cacheUnlock();
+}
+
+void cacheGetUsage(const struct ServerCache* server, struct CacheUsage* usage) {
+    memset(usage, 0, sizeof(*usage));
+    if (server) {
+        memcpy(usage->bytes, server->bytes, sizeof(usage->bytes));
+        usage->budget        = serverBudget;
+        usage->identityCount = server->identityCount;
+        usage->evictions     = server->evictions;
+    } else {
+        memcpy(usage->bytes, totalBytes, sizeof(usage->bytes));
+        usage->budget    = globalBudget;
+        usage->evictions = totalEvictions;
+        for (struct ServerCache* cached = servers; cached; cached = cached->next) usage->identityCount += cached->identityCount;
+    }
+    usage->totalBytes = sumBytes(usage->bytes);
+}
+
+struct ServerCache* cacheGetServer(uint64 serverConnectionHandlerID, bool create) {
+    for (struct ServerCache* server = servers; server; server = server->next) {
+        if (server->serverConnectionHandlerID == serverConnectionHandlerID) return server;
+    }
+    if (!create) return NULL;
+
+    struct ServerCache* server = (struct ServerCache*)calloc(1, sizeof(struct ServerCache));
+    if (!server) return NULL;
+    server->identities = (struct IdentityRecord**)calloc(IDENTITY_INITIAL_BUCKETS, sizeof(struct IdentityRecord*));
+    server->channels   = (struct CachedChannel**)calloc(CHANNEL_INITIAL_BUCKETS, sizeof(struct CachedChannel*));
+    if (!server->identities || !server->channels) {
+        free(server->identities);
+        free(server->channels);
+        free(server);
+        return NULL;
+    }
+    server->serverConnectionHandlerID = serverConnectionHandlerID;
+    server->identityBuckets           = IDENTITY_INITIAL_BUCKETS;
+    server->channelBuckets            = CHANNEL_INITIAL_BUCKETS;
+    server->heatEpoch                 = timingMonotonicMs();
+    server->next                      = servers;
+    servers                           = server;
+    account(server, CACHE_SUBSYSTEM_CLIENTS, sizeof(struct ServerCache), false);
+    account(server, CACHE_SUBSYSTEM_CHANNELS, CHANNEL_INITIAL_BUCKETS * sizeof(struct CachedChannel*), false);
+    account(server, CACHE_SUBSYSTEM_IDENTITIES, IDENTITY_INITIAL_BUCKETS * sizeof(struct IdentityRecord*), false);
+    return server;
+}
+
+void cacheDestroyServer(uint64 serverConnectionHandlerID) {
+    for (struct ServerCache** link = &servers; *link; link = &(*link)->next) {
+        if ((*link)->serverConnectionHandlerID == serverConnectionHandlerID) {
+            struct ServerCache* server = *link;
+            *link                      = server->next;
+            freeServer(server);
+            return;
+        }
+    }
+}
+
+struct CachedClient* cacheGetClient(struct ServerCache* server, anyID clientID, bool create) {
+    const size_t          pageIndex = clientID >> CACHE_PAGE_BITS;
+    struct CachedClient** page      = &server->pages[pageIndex];
+    if (!*page) {
+        if (!create) return NULL;
+        *page = (struct CachedClient*)calloc(CACHE_PAGE_SIZE, sizeof(struct CachedClient));
+        if (!*page) return NULL;
+        account(server, CACHE_SUBSYSTEM_CLIENTS, CACHE_PAGE_SIZE * sizeof(struct CachedClient), false);
+    }
+    struct CachedClient* client = &(*page)[clientID & (CACHE_PAGE_SIZE - 1)];
+    if (!client->present) {
+        if (!create) return NULL;
+        client->present  = true;
+        client->clientID = clientID;
+        client->seenAt   = timingWallclockNs() / 1000000000;
+        ++server->clientCount;
+        ++server->pageClients[pageIndex];
+    }
+    return client;
+}
+
+void cacheRemoveClient(struct ServerCache* server, anyID clientID) {
+    const size_t         pageIndex = clientID >> CACHE_PAGE_BITS;
+    struct CachedClient* page      = server->pages[pageIndex];
+    if (!page) return;
+    struct CachedClient* client = &page[clientID & (CACHE_PAGE_SIZE - 1)];
+    if (!client->present) return;
+    for (size_t tally = 0; tally < CACHE_TALLY_COUNT; ++tally) cacheSetClientTally(server, client, (enum CacheTally)tally, "");
+    cacheSetClientType(server, client, ClientType_NORMAL);
+    memset(client, 0, sizeof(struct CachedClient));
+    --server->clientCount;
+    if (--server->pageClients[pageIndex] == 0) {
+        free(page);
+        server->pages[pageIndex] = NULL;
+        account(server, CACHE_SUBSYSTEM_CLIENTS, CACHE_PAGE_SIZE * sizeof(struct CachedClient), true);
+    }
+}
+
+struct CachedChannel* cacheGetChannel(struct ServerCache* server, uint64 channelID, bool create) {
+    const size_t index = hashChannelID(channelID) & (server->channelBuckets - 1);
+    for (struct CachedChannel* channel = server->channels[index]; channel; channel = channel->next) {
+        if (channel->channelID == channelID) return channel;
+    }
+    if (!create) return NULL;
+
+    struct CachedChannel* channel = (struct CachedChannel*)calloc(1, sizeof(struct CachedChannel));
+    if (!channel) return NULL;
+    channel->channelID      = channelID;
+    channel->next           = server->channels[index];
+    server->channels[index] = channel;
+    account(server, CACHE_SUBSYSTEM_CHANNELS, sizeof(struct CachedChannel), false);
+    if (++server->channelCount > server->channelBuckets) growChannels(server);
+    return channel;
+}
+
+void cacheRemoveChannel(struct ServerCache* server, uint64 channelID) {
+    for (struct CachedChannel** link = &server->channels[hashChannelID(channelID) & (server->channelBuckets - 1)]; *link; link = &(*link)->next) {
+        if ((*link)->channelID == channelID) {
+            struct CachedChannel* channel = *link;
+            *link                         = channel->next;
+            if (channel->hottestSlot) removeHottest(server, channel);
+            cacheClearChannelDescription(server, channel);
+            free(channel);
+            account(server, CACHE_SUBSYSTEM_CHANNELS, sizeof(struct CachedChannel), true);
+            --server->channelCount;
+            return;
+        }
+    }
+}
+
+struct IdentityRecord* cacheGetIdentity(struct ServerCache* server, const char* uniqueID, bool create) {
+    struct IdentityRecord* identity = findIdentity(server, uniqueID);
+    if (identity) {
+        unlinkIdentity(server, identity);
+        pushNewest(server, identity);
+        identity->usedAt = timingMonotonicMs();
+        return identity;
+    }
+    if (!create || strlen(uniqueID) >= UID_BUFSIZE) return NULL;
+
+    identity = (struct IdentityRecord*)calloc(1, sizeof(struct IdentityRecord));
+    if (!identity) return NULL;
+    const size_t index = hashString(uniqueID) & (server->identityBuckets - 1);
+    strcpy(identity->uniqueID, uniqueID);
+    identity->usedAt          = timingMonotonicMs();
+    identity->next            = server->identities[index];
+    server->identities[index] = identity;
+    pushNewest(server, identity);
+    account(server, CACHE_SUBSYSTEM_IDENTITIES, sizeof(struct IdentityRecord), false);
+    if (++server->identityCount > server->identityBuckets) growIdentities(server);
+    enforceBudgets(server, identity);
+    return identity;
+}
+
+const char* cacheGetChannelDescription(struct ServerCache* server, struct CachedChannel* channel) {
+    if (!channel->description) return NULL;
+    unlinkDescription(server, channel);
+    pushNewestDescription(server, channel);
+    return channel->description;
+}
+
+bool cacheSetChannelDescription(struct ServerCache* server, struct CachedChannel* channel, const char* preview) {
+    cacheClearChannelDescription(server, channel);
+    const size_t bytes = strlen(preview) + 1;
+    if (bytes > descriptionBudget || !(channel->description = (char*)malloc(bytes))) return false;
+    memcpy(channel->description, preview, bytes);
+    pushNewestDescription(server, channel);
+    account(server, CACHE_SUBSYSTEM_DESCRIPTIONS, bytes, false);
+    while (server->bytes[CACHE_SUBSYSTEM_DESCRIPTIONS] > descriptionBudget) {
+        struct CachedChannel* oldest = server->oldestDescription;
+        cacheClearChannelDescription(server, oldest);
+        oldest->descriptionRequestedAt = 0;
+    }
+    return true;
+}
+
+void cacheClearChannelDescription(struct ServerCache* server, struct CachedChannel* channel) {
+    if (!channel->description) return;
+    unlinkDescription(server, channel);
+    account(server, CACHE_SUBSYSTEM_DESCRIPTIONS, strlen(channel->description) + 1, true);
+    free(channel->description);
+    channel->description = NULL;
+}
+
+void cacheSetHeatHalfLife(uint64 halfLifeMs) {
+    const uint64 now = timingMonotonicMs();
+    cacheLock();
+    for (struct ServerCache* server = servers; server; server = server->next) rescaleHeat(server, now);
+    heatHalfLife = halfLifeMs ? halfLifeMs : HEAT_HALF_LIFE;
+    cacheUnlock();
+}
+
+void cacheAddChannelActivity(struct ServerCache* server, struct CachedChannel* channel, double weight) {
+    const uint64 now = timingMonotonicMs();
+    if (now - server->heatEpoch >= HEAT_RESCALE_HALF_LIVES * heatHalfLife) rescaleHeat(server, now);
+    channel->heat += weight * heatScale(server, now);
+    if (channel->hottestSlot) {
+        siftHottestDown(server, channel->hottestSlot - 1);
+    } else {
+        offerHottest(server, channel);
+    }
+}
+
+double cacheGetChannelHeat(const struct ServerCache* server, const struct CachedChannel* channel) {
+    return channel->heat / heatScale(server, timingMonotonicMs());
+}
+
+size_t cacheGetHottestChannels(const struct ServerCache* server, struct CachedChannel** channels, size_t count) {
+    if (count > server->hottestCount) count = server->hottestCount;
+    /* Sorting a copy of the few ranked channels is cheaper than popping the heap */
+    size_t sorted = 0;
+    for (size_t index = 0; index < server->hottestCount; ++index) {
+        struct CachedChannel* channel  = server->hottest[index];
+        size_t                position = sorted < count ? sorted++ : count;
+        while (position > 0 && channels[position - 1]->heat < channel->heat) {
+            if (position < count) channels[position] = channels[position - 1];
+            --position;
+        }
+        if (position < count) channels[position] = channel;
+    }
+    return count;
+}
+
+/* Frees a value once no present client has it, so a long session does not keep every address it has seen */
+static void releaseTallyKey(struct ServerCache* server, enum CacheTally tally, struct TallyKey* key) {
+    for (struct TallyKey** link = &server->tallies[tally][hashString(key->value) & (CACHE_TALLY_BUCKETS - 1)]; *link; link = &(*link)->next) {
+        if (*link == key) {
+            *link = key->next;
+            break;
+        }
+    }
+    account(server, CACHE_SUBSYSTEM_CLIENTS, sizeof(struct TallyKey) + strlen(key->value) + 1, true);
+    free(key);
+}
+
+void cacheSetClientTally(struct ServerCache* server, struct CachedClient* client, enum CacheTally tally, const char* value) {
+    struct TallyKey* key = NULL;
+    if (value[0] != '\0') {
+        struct TallyKey** bucket = &server->tallies[tally][hashString(value) & (CACHE_TALLY_BUCKETS - 1)];
+        for (key = *bucket; key && strcmp(key->value, value) != 0; key = key->next) {}
+        if (!key) {
+            const size_t length = strlen(value) + 1;
+            key                 = (struct TallyKey*)malloc(sizeof(struct TallyKey) + length);
+            if (!key) return;
+            memcpy(key->value, value, length);
+            key->clients = 0;
+            key->members = NULL;
+            key->next    = *bucket;
+            *bucket      = key;
+            account(server, CACHE_SUBSYSTEM_CLIENTS, sizeof(struct TallyKey) + length, false);
+        }
+    }
+
+    struct TallyKey* previous = client->tallies[tally];
+    if (previous == key) return;
+    if (previous) {
+        --previous->clients;
+        --server->tallied[tally];
+        if (tally == CACHE_TALLY_ADDRESS) {
+            if (client->addressPrevious) {
+                client->addressPrevious->addressNext = client->addressNext;
+            } else {
+                previous->members = client->addressNext;
+            }
+            if (client->addressNext) client->addressNext->addressPrevious = client->addressPrevious;
+            client->addressNext     = NULL;
+            client->addressPrevious = NULL;
+        }
+        if (previous->clients == 0) releaseTallyKey(server, tally, previous);
+    }
+    if (key) {
+        ++key->clients;
+        ++server->tallied[tally];
+        if (tally == CACHE_TALLY_ADDRESS) {
+            client->addressNext = key->members;
+            if (key->members) key->members->addressPrevious = client;
+            key->members = client;
+        }
+    }
+    client->tallies[tally] = key;
+}
+
+void cacheSetClientType(struct ServerCache* server, struct CachedClient* client, int type) {
+    const bool wasQuery = client->type == ClientType_SERVERQUERY;
+    client->type        = type;
+    if (wasQuery == (type == ClientType_SERVERQUERY)) return;
+    if (wasQuery) {
+        if (client->queryPrevious) {
+            client->queryPrevious->queryNext = client->queryNext;
+        } else {
+            server->queryClients = client->queryNext;
+        }
+        if (client->queryNext) client->queryNext->queryPrevious = client->queryPrevious;
+        client->queryNext     = NULL;
+        client->queryPrevious = NULL;
+        --server->queryCount;
+    } else {
+        client->queryNext = server->queryClients;
+        if (server->queryClients) server->queryClients->queryPrevious = client;
+        server->queryClients = client;
+        ++server->queryCount;
+    }
+}
+
+size_t cacheGetSameAddress(const struct CachedClient* client, const struct CachedClient** clients, size_t count) {
+    const struct TallyKey* key = client->tallies[CACHE_TALLY_ADDRESS];
+    if (!key) return 0;
+    size_t others = 0;
+    for (const struct CachedClient* member = key->members; member; member = member->addressNext) {
+        if (member == client) continue;
+        if (others < count) clients[others] = member;
+        ++others;
+    }
+    return others;
+}
+
+size_t cacheGetTally(const struct ServerCache* server, enum CacheTally tally, const struct TallyKey** keys, size_t count) {
+    size_t values = 0;
+    for (size_t bucket = 0; bucket < CACHE_TALLY_BUCKETS; ++bucket) {
+        for (const struct TallyKey* key = server->tallies[tally][bucket]; key; key = key->next) {
+            if (key->clients == 0) continue;
+            size_t position = values < count ? values : count;
+            ++values;
+            while (position > 0 && keys[position - 1]->clients < key->clients) {
+                if (position < count) keys[position] = keys[position - 1];
+                --position;
+            }
+            if (position < count) keys[position] = key;
+        }
+    }
+    return values;
+}
+
+void cacheForEachClient(struct ServerCache* server, void (*visit)(struct CachedClient* client, void* context), void* context) {
+    for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) {
+        struct CachedClient* clients = server->pages[page];
+        if (!clients) continue;
+        for (size_t slot = 0; slot < CACHE_PAGE_SIZE; ++slot) {
+            if (clients[slot].present) visit(&clients[slot], context);
+        }
+    }
+}
+
+void cacheForEachServer(void (*visit)(struct ServerCache* server, void* context), void* context) {
+    for (struct ServerCache* server = servers; server; server = server->next) visit(server, context);
+}
+
+void cacheForEachChannel(struct ServerCache* server, void (*visit)(struct CachedChannel* channel, void* context), void* context) {
+    for (size_t bucket = 0; bucket < server->channelBuckets; ++bucket) {
+        for (struct CachedChannel* channel = server->channels[bucket]; channel; channel = channel->next) visit(channel, context);
+    }
+}
@@ -0,0 +1,250 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+
+#include "teamspeak/public_definitions.h"
+#include "plugin_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UID_BUFSIZE 64
+#define NICKNAME_BUFSIZE 128
+#define CHANNELNAME_BUFSIZE 160
+#define COUNTRY_BUFSIZE 8
+#define DESCRIPTION_PREVIEW_LENGTH 160                      /* Bytes of description text kept per channel or identity */
+#define DESCRIPTION_BUFSIZE (DESCRIPTION_PREVIEW_LENGTH + 4) /* Preview with an ellipsis */
+
+/* Client slots are paged by the high byte of the anyID */
+#define CACHE_PAGE_BITS 8
+#define CACHE_PAGE_SIZE (1 << CACHE_PAGE_BITS)
+#define CACHE_PAGE_COUNT (65536 / CACHE_PAGE_SIZE)
+
+/* Milliseconds identity data from another plugin user stands in for an own fetch, counted from the peer's fetch */
+#define SHARED_IDENTITY_TTL 300000
+
+/* Channels ranked by decayed activity on each connection */
+#define CACHE_HOTTEST_COUNT 8
+
+/* Connection info sample of a client */
+struct ConnectionStats {
+    uint64 ping;          /* Round trip time in milliseconds */
+    double packetLoss;    /* Total packet loss in percentage points */
+    uint64 connectedTime; /* Seconds connected when sampled */
+    uint64 updatedAt;     /* Monotonic milliseconds of the sample, 0 if never sampled */
+    uint64 requestedAt;   /* Monotonic milliseconds of the last own request */
+};
+
+/* Server database data of an identity, keyed by unique identifier */
+struct IdentityRecord {
+    struct IdentityRecord* next;
+    struct IdentityRecord* newer; /* Least recently used list of the connection */
+    struct IdentityRecord* older;
+    uint64                 usedAt;     /* Monotonic milliseconds of the last lookup */
+    uint64                 pinnedMark; /* Equals the pin mark of the connection while a present client uses it */
+    char                   uniqueID[UID_BUFSIZE];
+    uint64                 databaseID;
+    uint64                 created;                          /* Unix time of the first connection */
+    uint64                 lastConnected;                    /* Unix time of the previous connection */
+    uint64                 totalConnections;
+    char                   description[DESCRIPTION_BUFSIZE]; /* Preview of the client description, empty if unset or shared */
+    uint64                 updatedAt;                        /* Monotonic milliseconds, 0 if never fetched */
+    uint64                 requestedAt;                      /* Monotonic milliseconds of the last own request */
+    bool                   shared;                           /* Data came from another plugin user, replaced by the next own fetch */
+};
+
+/* Client variables counted over the present clients of a connection */
+enum CacheTally {
+    CACHE_TALLY_VERSION,
+    CACHE_TALLY_PLATFORM,
+    CACHE_TALLY_COUNTRY,
+    CACHE_TALLY_ADDRESS,
+    CACHE_TALLY_COUNT
+};
+
+#define CACHE_TALLY_BUCKETS 256
+
+struct CachedClient;
+
+/* Interned value of a tallied variable, freed when its last present client drops it and counted with the clients */
+struct TallyKey {
+    struct TallyKey*     next;
+    size_t               clients; /* Present clients with this value */
+    struct CachedClient* members; /* Present clients with this address, only linked for addresses */
+    char                 value[];
+};
+
+/* Status flags of a cached client */
+enum CachedClientFlags {
+    CACHED_CLIENT_AWAY         = 1 << 0,
+    CACHED_CLIENT_INPUT_MUTED  = 1 << 1,
+    CACHED_CLIENT_OUTPUT_MUTED = 1 << 2,
+    CACHED_CLIENT_TALKER       = 1 << 3
+};
+
+/* Cached data of a client on a connection */
+struct CachedClient {
+    bool                   present;
+    bool                   loaded; /* Variables below the unique identifier have been read from the client */
+    anyID                  clientID;
+    int                    type;
+    unsigned int           flags;
+    uint64                 channelID;
+    uint64                 databaseID;
+    char                   uniqueID[UID_BUFSIZE];
+    char                   nickname[NICKNAME_BUFSIZE];
+    char                   country[COUNTRY_BUFSIZE];
+    struct TallyKey*       tallies[CACHE_TALLY_COUNT]; /* NULL while the value is unknown */
+    struct CachedClient*   addressNext;                /* Other clients of the address key */
+    struct CachedClient*   addressPrevious;
+    struct CachedClient*   queryNext;     /* Other query clients of the connection */
+    struct CachedClient*   queryPrevious;
+    uint64                 seenAt;        /* Unix time the client came into view */
+    struct ConnectionStats stats;
+};
+
+/* Status flags of a cached channel */
+enum CachedChannelFlags {
+    CACHED_CHANNEL_PERMANENT      = 1 << 0,
+    CACHED_CHANNEL_SEMI_PERMANENT = 1 << 1,
+    CACHED_CHANNEL_DEFAULT        = 1 << 2,
+    CACHED_CHANNEL_PASSWORD       = 1 << 3
+};
+
+/* Cached data of a channel on a connection */
+struct CachedChannel {
+    struct CachedChannel* next;
+    uint64                channelID;
+    uint64                parentID;
+    uint64                order;
+    int                   maxClients;
+    unsigned int          flags;
+    char                  name[CHANNELNAME_BUFSIZE];
+    double                heat;                   /* Activity scaled to the heat epoch of the connection */
+    unsigned int          hottestSlot;            /* Position in the hottest heap plus one, 0 if not ranked */
+    char*                 description;            /* Preview of the description, NULL while not cached */
+    uint64                descriptionRequestedAt; /* Monotonic milliseconds of the last own request */
+    struct CachedChannel* descriptionNewer;       /* Least recently shown list of the cached descriptions */
+    struct CachedChannel* descriptionOlder;
+};
+
+/* Memory accounting of the cache, only identities of clients out of view can be evicted */
+enum CacheSubsystem {
+    CACHE_SUBSYSTEM_CLIENTS,
+    CACHE_SUBSYSTEM_CHANNELS,
+    CACHE_SUBSYSTEM_IDENTITIES,
+    CACHE_SUBSYSTEM_DESCRIPTIONS,
+    CACHE_SUBSYSTEM_COUNT
+};
+
+struct CacheUsage {
+    size_t bytes[CACHE_SUBSYSTEM_COUNT];
+    size_t totalBytes;
+    size_t budget; /* 0 if unlimited */
+    size_t identityCount;
+    uint64 evictions;
+};
+
+/* Cached data of a server connection */
+struct ServerCache {
+    struct ServerCache*     next;
+    uint64                  serverConnectionHandlerID;
+    struct CachedClient*    pages[CACHE_PAGE_COUNT];
+    unsigned short          pageClients[CACHE_PAGE_COUNT]; /* Present clients per page, empty pages are released */
+    size_t                  clientCount;
+    struct CachedChannel**  channels;
+    size_t                  channelBuckets;
+    size_t                  channelCount;
+    struct IdentityRecord** identities;
+    size_t                  identityBuckets;
+    size_t                  identityCount;
+    struct IdentityRecord*  newestIdentity;
+    struct IdentityRecord*  oldestIdentity;
+    struct CachedChannel*   newestDescription;
+    struct CachedChannel*   oldestDescription;
+    uint64                  pinMark;
+    size_t                  evictAbove; /* Bytes before the next eviction pass if the last one could not reach the budget */
+    size_t                  bytes[CACHE_SUBSYSTEM_COUNT];
+    uint64                  evictions;
+    uint64                  heatEpoch;                    /* Monotonic milliseconds that channel heat is scaled to */
+    struct CachedChannel*   hottest[CACHE_HOTTEST_COUNT]; /* Min-heap of the channels with the most heat */
+    size_t                  hottestCount;
+    struct TallyKey*        tallies[CACHE_TALLY_COUNT][CACHE_TALLY_BUCKETS];
+    size_t                  tallied[CACHE_TALLY_COUNT]; /* Present clients with a known value */
+    bool                    talliesLoaded;              /* Every loaded client has been counted since the tallies were last skipped */
+    struct CachedClient*    queryClients;               /* Present query clients, latest first */
+    size_t                  queryCount;
+    bool                    populated; /* Client and channel lists have been read since connecting */
+    enum PluginItemType     selectedType;
+    uint64                  selectedID;
+};
+
+void cacheInit(void);
+void cacheShutdown(void);
+
+/* All cache access happens between cacheLock and cacheUnlock */
+void cacheLock(void);
+void cacheUnlock(void);
+
+/* Memory budgets in bytes for each connection and for all connections together, 0 disables a budget */
+void cacheSetBudgets(size_t serverBudget, size_t globalBudget);
+
+/* Bytes of channel description previews kept for each connection, 0 disables them */
+void cacheSetDescriptionBudget(size_t budget);
+
+/* Memory use of one connection, or of all connections if server is NULL */
+void cacheGetUsage(const struct ServerCache* server, struct CacheUsage* usage);
+
+struct ServerCache*    cacheGetServer(uint64 serverConnectionHandlerID, bool create);
+void                   cacheDestroyServer(uint64 serverConnectionHandlerID);
+struct CachedClient*   cacheGetClient(struct ServerCache* server, anyID clientID, bool create);
+void                   cacheRemoveClient(struct ServerCache* server, anyID clientID);
+struct CachedChannel*  cacheGetChannel(struct ServerCache* server, uint64 channelID, bool create);
+void                   cacheRemoveChannel(struct ServerCache* server, uint64 channelID);
+
+/* Lookups mark the identity as recently used, creating one may evict old identities to stay within the budgets */
+struct IdentityRecord* cacheGetIdentity(struct ServerCache* server, const char* uniqueID, bool create);
+
+/* Description preview of a channel, getting it marks it as recently shown and setting it drops the least recently shown previews above the budget */
+const char* cacheGetChannelDescription(struct ServerCache* server, struct CachedChannel* channel);
+bool        cacheSetChannelDescription(struct ServerCache* server, struct CachedChannel* channel, const char* preview);
+void        cacheClearChannelDescription(struct ServerCache* server, struct CachedChannel* channel);
+
+/*
+ * Channel heat is activity decayed with a half-life. New activity is scaled up instead of decaying old activity,
+ * so the order of channels only changes when one of them gains activity and the hottest heap stays valid.
+ */
+void   cacheSetHeatHalfLife(uint64 halfLifeMs);
+void   cacheAddChannelActivity(struct ServerCache* server, struct CachedChannel* channel, double weight);
+double cacheGetChannelHeat(const struct ServerCache* server, const struct CachedChannel* channel);
+size_t cacheGetHottestChannels(const struct ServerCache* server, struct CachedChannel** channels, size_t count); /* Hottest first */
+
+/* Moves a client to the interned key of a value, an empty value marks it unknown */
+void   cacheSetClientTally(struct ServerCache* server, struct CachedClient* client, enum CacheTally tally, const char* value);
+size_t cacheGetTally(const struct ServerCache* server, enum CacheTally tally, const struct TallyKey** keys, size_t count); /* Writes up to count keys with the most clients first, returns the number of values in use */
+
+/* Sets the type of a client, query clients are linked into the query list of the connection */
+void cacheSetClientType(struct ServerCache* server, struct CachedClient* client, int type);
+
+/* Writes up to count other present clients with the address of a client, returns their number */
+size_t cacheGetSameAddress(const struct CachedClient* client, const struct CachedClient** clients, size_t count);
+
+/* Visits every cached connection */
+void cacheForEachServer(void (*visit)(struct ServerCache* server, void* context), void* context);
+
+/* Visits every present client or channel of a connection */
+void cacheForEachClient(struct ServerCache* server, void (*visit)(struct CachedClient* client, void* context), void* context);
+void cacheForEachChannel(struct ServerCache* server, void (*visit)(struct CachedChannel* channel, void* context), void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
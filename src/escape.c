@@ -0,0 +1,147 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ESCAPE_X86
+#include <immintrin.h>
+#endif
+
+#include "escape.h"
+
+#define ESCAPE_PREFIX '\\'
+
+/* Returns the offset of the first character to escape in text[0, length), or length if there is none */
+typedef size_t (*EscapeScan)(const char* text, size_t length);
+
+static bool needsEscape(char ch) {
+    return ch == '[' || ch == ']' || ch == ESCAPE_PREFIX;
+}
+
+static size_t scanScalar(const char* text, size_t length) {
+    size_t offset = 0;
+    while (offset < length && !needsEscape(text[offset])) ++offset;
+    return offset;
+}
+
+#ifdef ESCAPE_X86
+__attribute__((target("sse2"))) static size_t scanSSE2(const char* text, size_t length) {
+    const __m128i open   = _mm_set1_epi8('[');
+    const __m128i close  = _mm_set1_epi8(']');
+    const __m128i prefix = _mm_set1_epi8(ESCAPE_PREFIX);
+    size_t        offset = 0;
+    for (; offset + 16 <= length; offset += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)(text + offset));
+        const __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, open), _mm_cmpeq_epi8(chunk, close)), _mm_cmpeq_epi8(chunk, prefix));
+        const int     mask  = _mm_movemask_epi8(found);
+        if (mask) return offset + (size_t)__builtin_ctz((unsigned int)mask);
+    }
+    return offset + scanScalar(text + offset, length - offset);
+}
+
+__attribute__((target("avx2"))) static size_t scanAVX2(const char* text, size_t length) {
+    const __m256i open   = _mm256_set1_epi8('[');
+    const __m256i close  = _mm256_set1_epi8(']');
+    const __m256i prefix = _mm256_set1_epi8(ESCAPE_PREFIX);
+    size_t        offset = 0;
+    for (; offset + 32 <= length; offset += 32) {
+        const __m256i  chunk = _mm256_loadu_si256((const __m256i*)(text + offset));
+        const __m256i  found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, open), _mm256_cmpeq_epi8(chunk, close)), _mm256_cmpeq_epi8(chunk, prefix));
+        const unsigned mask  = (unsigned)_mm256_movemask_epi8(found);
+        if (mask) return offset + (size_t)__builtin_ctz(mask);
+    }
+    /* The tail stays in VEX encoded code, calling the SSE2 kernel here would pay for a state transition */
+    if (offset + 16 <= length) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)(text + offset));
+        const __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(open)), _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(close))), _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(prefix)));
+        const int     mask  = _mm_movemask_epi8(found);
+        if (mask) return offset + (size_t)__builtin_ctz((unsigned int)mask);
+        offset += 16;
+    }
+    return offset + scanScalar(text + offset, length - offset);
+}
+#endif
+
+static EscapeScan        scan   = scanScalar;
+static enum EscapeKernel active = ESCAPE_KERNEL_SCALAR;
+static bool              selected;
+
+static bool kernelSupported(enum EscapeKernel kernel) {
+    switch (kernel) {
+        case ESCAPE_KERNEL_SCALAR:
+            return true;
+#ifdef ESCAPE_X86
+        case ESCAPE_KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case ESCAPE_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+bool escapeSelectKernel(enum EscapeKernel kernel) {
+#ifdef ESCAPE_X86
+    __builtin_cpu_init();
+#endif
+    if (kernel == ESCAPE_KERNEL_AUTO) {
+        kernel = kernelSupported(ESCAPE_KERNEL_AVX2) ? ESCAPE_KERNEL_AVX2 : kernelSupported(ESCAPE_KERNEL_SSE2) ? ESCAPE_KERNEL_SSE2 : ESCAPE_KERNEL_SCALAR;
+    }
+    if (!kernelSupported(kernel)) return false;
+    switch (kernel) {
+#ifdef ESCAPE_X86
+        case ESCAPE_KERNEL_SSE2:
+            scan = scanSSE2;
+            break;
+        case ESCAPE_KERNEL_AVX2:
+            scan = scanAVX2;
+            break;
+#endif
+        default:
+            scan = scanScalar;
+    }
+    active   = kernel;
+    selected = true;
+    return true;
+}
+
+enum EscapeKernel escapeActiveKernel(void) {
+    return active;
+}
+
+const char* escapeKernelName(enum EscapeKernel kernel) {
+    switch (kernel) {
+        case ESCAPE_KERNEL_SCALAR:
+            return "scalar";
+        case ESCAPE_KERNEL_SSE2:
+            return "sse2";
+        case ESCAPE_KERNEL_AVX2:
+            return "avx2";
+        default:
+            return "auto";
+    }
+}
+
+size_t escapeBBCode(char* destination, size_t size, const char* text) {
+    if (size == 0) return 0;
+    if (!selected) escapeSelectKernel(ESCAPE_KERNEL_AUTO);
+    const size_t length  = strlen(text);
+    size_t       read    = 0;
+    size_t       written = 0;
+    while (read < length && written + 1 < size) {
+        size_t run = scan(text + read, length - read);
+        if (run > size - 1 - written) run = size - 1 - written;
+        memcpy(destination + written, text + read, run);
+        read    += run;
+        written += run;
+        if (read == length || written + 2 >= size) break;
+        destination[written++] = ESCAPE_PREFIX;
+        destination[written++] = text[read++];
+    }
+    destination[written] = '\0';
+    return written;
+}
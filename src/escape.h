@@ -0,0 +1,39 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Scanners for characters that need escaping, the widest one the CPU supports is used by default */
+enum EscapeKernel {
+    ESCAPE_KERNEL_AUTO,
+    ESCAPE_KERNEL_SCALAR,
+    ESCAPE_KERNEL_SSE2,
+    ESCAPE_KERNEL_AVX2
+};
+
+/* Selects a scanner, returns false and keeps the current one if the CPU does not support it */
+bool              escapeSelectKernel(enum EscapeKernel kernel);
+enum EscapeKernel escapeActiveKernel(void);
+const char*       escapeKernelName(enum EscapeKernel kernel);
+
+/*
+ * Copies host text into BBCode with '[', ']' and '\' escaped by a backslash. Runs without anything to escape
+ * are found by the scanner and copied with memcpy. The output is truncated before an escape that does not fit
+ * and always terminated, returns the number of characters written.
+ */
+size_t escapeBBCode(char* destination, size_t size, const char* text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "exchange.h"
+#include "plugin.h"
+#include "presence.h"
+#include "timing.h"
+
+#define EXCHANGE_MAGIC "AIX"
+#define EXCHANGE_BATCH_BUFSIZE 1024
+#define EXCHANGE_RECORD_BUFSIZE 192
+#define EXCHANGE_FLUSH_INTERVAL 1000
+#define EXCHANGE_AGE_DIGITS 16 /* Hex digits of the largest age a record can be sent with */
+#define EXCHANGE_PRESENCE_CHECKED 16 /* Connections of an identity looked at for its presence */
+
+/* Pending records of a connection */
+struct ExchangeBatch {
+    struct ExchangeBatch* next;
+    uint64                serverConnectionHandlerID;
+    char                  buffer[EXCHANGE_BATCH_BUFSIZE];
+    size_t                length;
+    size_t                reserved; /* Bytes the ages of the queued records may need beyond their sample times */
+    uint64                lastFlush;
+};
+
+static mtx_t                 exchangeMutex;
+static atomic_bool           sharingEnabled = false;
+static struct ExchangeBatch* batches        = NULL;
+
+static struct ExchangeBatch* getBatch(uint64 serverConnectionHandlerID) {
+    for (struct ExchangeBatch* batch = batches; batch; batch = batch->next) {
+        if (batch->serverConnectionHandlerID == serverConnectionHandlerID) return batch;
+    }
+    struct ExchangeBatch* batch = (struct ExchangeBatch*)calloc(1, sizeof(struct ExchangeBatch));
+    if (!batch) return NULL;
+    batch->serverConnectionHandlerID = serverConnectionHandlerID;
+    batch->next                      = batches;
+    batches                          = batch;
+    return batch;
+}
+
+/*
+ * Moves the batch into command, returns false if nothing is pending.
+ * Records end with the monotonic sample time while queued, which becomes their age as of sending.
+ * A batch waits for the next record or flush call without a time limit, so the age can need more digits than the time,
+ * queueRecord keeps room for the widest age of every record.
+ */
+static bool takeBatch(struct ExchangeBatch* batch, char* command) {
+    if (batch->length == 0) return false;
+    const uint64 now    = timingMonotonicMs();
+    const char*  record = strchr(batch->buffer, ';');
+    size_t       length = (size_t)(record - batch->buffer);
+    memcpy(command, batch->buffer, length);
+    while (record) {
+        const char* end  = strchr(record + 1, ';');
+        const char* last = end ? end : batch->buffer + batch->length;
+        while (last > record && *last != ',') --last;
+        const uint64 sampledAt = strtoull(last + 1, NULL, 16);
+        length += (size_t)snprintf(command + length, EXCHANGE_BATCH_BUFSIZE - length, "%.*s%llx", (int)(last + 1 - record), record, (unsigned long long)(now > sampledAt ? now - sampledAt : 0));
+        record = end;
+    }
+    batch->length    = 0;
+    batch->reserved  = 0;
+    batch->lastFlush = now;
+    return true;
+}
+
+static void sendCommand(uint64 serverConnectionHandlerID, const char* command) {
+    ts3Functions.sendPluginCommand(serverConnectionHandlerID, pluginID, command, PluginCommandTarget_CURRENT_CHANNEL, NULL, NULL);
+}
+
+/* Appends a record to the batch of a connection and sends whatever is due */
+static void queueRecord(uint64 serverConnectionHandlerID, const char* record) {
+    char         command[EXCHANGE_BATCH_BUFSIZE];
+    char         overflow[EXCHANGE_BATCH_BUFSIZE];
+    bool         sendOverflow = false;
+    bool         sendNow      = false;
+    const size_t recordLength = strlen(record);
+    const size_t timeDigits   = (size_t)(record + recordLength - strrchr(record, ',') - 1);
+    const size_t reserve      = timeDigits < EXCHANGE_AGE_DIGITS ? EXCHANGE_AGE_DIGITS - timeDigits : 0;
+
+    mtx_lock(&exchangeMutex);
+    struct ExchangeBatch* batch = getBatch(serverConnectionHandlerID);
+    if (!batch) {
+        mtx_unlock(&exchangeMutex);
+        return;
+    }
+    if (batch->length + batch->reserved + recordLength + reserve + 2 > EXCHANGE_BATCH_BUFSIZE) sendOverflow = takeBatch(batch, overflow);
+    if (batch->length == 0) batch->length = (size_t)snprintf(batch->buffer, EXCHANGE_BATCH_BUFSIZE, EXCHANGE_MAGIC "%d", EXCHANGE_PROTOCOL_VERSION);
+    batch->buffer[batch->length++] = ';';
+    memcpy(batch->buffer + batch->length, record, recordLength + 1);
+    batch->length   += recordLength;
+    batch->reserved += reserve;
+    if (timingMonotonicMs() - batch->lastFlush >= EXCHANGE_FLUSH_INTERVAL) sendNow = takeBatch(batch, command);
+    mtx_unlock(&exchangeMutex);
+
+    if (sendOverflow) sendCommand(serverConnectionHandlerID, overflow);
+    if (sendNow) sendCommand(serverConnectionHandlerID, command);
+}
+
+void exchangeInit(void) {
+    mtx_init(&exchangeMutex, mtx_plain);
+}
+
+void exchangeShutdown(void) {
+    mtx_lock(&exchangeMutex);
+    while (batches) {
+        struct ExchangeBatch* next = batches->next;
+        free(batches);
+        batches = next;
+    }
+    mtx_unlock(&exchangeMutex);
+    mtx_destroy(&exchangeMutex);
+}
+
+void exchangeSetEnabled(bool enabled) {
+    atomic_store(&sharingEnabled, enabled);
+}
+
+bool exchangeIsEnabled(void) {
+    return atomic_load(&sharingEnabled);
+}
+
+void exchangeQueueStats(uint64 serverConnectionHandlerID, anyID clientID, const struct ConnectionStats* stats) {
+    if (!exchangeIsEnabled() || stats->updatedAt == 0) return;
+    char record[EXCHANGE_RECORD_BUFSIZE];
+    snprintf(record, sizeof(record), "S%x,%llx,%llx,%llx,%llx", (unsigned int)clientID, (unsigned long long)stats->ping, (unsigned long long)(stats->packetLoss * 100.0 + 0.5), (unsigned long long)stats->connectedTime,
+             (unsigned long long)stats->updatedAt);
+    queueRecord(serverConnectionHandlerID, record);
+}
+
+void exchangeQueueIdentity(uint64 serverConnectionHandlerID, const struct IdentityRecord* identity) {
+    if (!exchangeIsEnabled() || identity->updatedAt == 0) return;
+    char record[EXCHANGE_RECORD_BUFSIZE];
+    snprintf(record, sizeof(record), "I%s,%llx,%llx,%llx,%llx,%llx", identity->uniqueID, (unsigned long long)identity->databaseID, (unsigned long long)identity->created, (unsigned long long)identity->lastConnected,
+             (unsigned long long)identity->totalConnections, (unsigned long long)identity->updatedAt);
+    queueRecord(serverConnectionHandlerID, record);
+}
+
+void exchangeFlushDue(uint64 serverConnectionHandlerID) {
+    char command[EXCHANGE_BATCH_BUFSIZE];
+    bool sendNow = false;
+
+    mtx_lock(&exchangeMutex);
+    for (struct ExchangeBatch* batch = batches; batch; batch = batch->next) {
+        if (batch->serverConnectionHandlerID != serverConnectionHandlerID) continue;
+        if (batch->length > 0 && timingMonotonicMs() - batch->lastFlush >= EXCHANGE_FLUSH_INTERVAL) sendNow = takeBatch(batch, command);
+        break;
+    }
+    mtx_unlock(&exchangeMutex);
+
+    if (sendNow) sendCommand(serverConnectionHandlerID, command);
+}
+
+void exchangeDropServer(uint64 serverConnectionHandlerID) {
+    mtx_lock(&exchangeMutex);
+    for (struct ExchangeBatch** link = &batches; *link; link = &(*link)->next) {
+        if ((*link)->serverConnectionHandlerID == serverConnectionHandlerID) {
+            struct ExchangeBatch* batch = *link;
+            *link                       = batch->next;
+            free(batch);
+            break;
+        }
+    }
+    mtx_unlock(&exchangeMutex);
+}
+
+/* Parses up to count comma separated hex fields, returns the number parsed */
+static size_t parseFields(const char* text, uint64* fields, size_t count) {
+    size_t parsed = 0;
+    while (parsed < count && *text) {
+        char* end;
+        fields[parsed++] = strtoull(text, &end, 16);
+        if (*end != ',') break;
+        text = end + 1;
+    }
+    return parsed;
+}
+
+/* Merges a stats record, returns true and the client ID if it changed the cache */
+static bool mergeStats(struct ServerCache* server, const char* record, uint64 now, anyID* clientID) {
+    uint64 fields[5];
+    if (parseFields(record, fields, 5) < 5 || fields[0] > 0xFFFF || fields[4] > now) return false;
+    struct CachedClient* client = cacheGetClient(server, (anyID)fields[0], false);
+    if (!client) return false;
+    const uint64 sampledAt = now - fields[4];
+    if (client->stats.updatedAt >= sampledAt) return false;
+    client->stats.ping          = fields[1];
+    client->stats.packetLoss    = (double)fields[2] / 100.0;
+    client->stats.connectedTime = fields[3];
+    client->stats.updatedAt     = sampledAt;
+    *clientID                   = (anyID)fields[0];
+    return true;
+}
+
+/* Returns true if a client with the unique identifier is on the connection */
+static bool identityPresent(uint64 serverConnectionHandlerID, const char* uniqueID) {
+    struct PresenceEntry entries[EXCHANGE_PRESENCE_CHECKED];
+    /* Connection 0 does not exist, so every connection of the identity is found */
+    const size_t count = presenceFind(uniqueID, 0, entries, EXCHANGE_PRESENCE_CHECKED);
+    for (size_t index = 0; index < count && index < EXCHANGE_PRESENCE_CHECKED; ++index) {
+        if (entries[index].serverConnectionHandlerID == serverConnectionHandlerID) return true;
+    }
+    return false;
+}
+
+/*
+ * Merges an identity record, returns true if it changed the cache.
+ * Only identities of present clients are taken and never over own fetched data, so a peer can neither
+ * flood the identity cache nor keep the plugin from fetching the real data when the frame is opened.
+ */
+static bool mergeIdentity(struct ServerCache* server, char* record, uint64 now) {
+    char* separator = strchr(record, ',');
+    if (!separator) return false;
+    *separator = '\0';
+    uint64 fields[5];
+    if (parseFields(separator + 1, fields, 5) < 5 || fields[4] > now || !identityPresent(server->serverConnectionHandlerID, record)) return false;
+    struct IdentityRecord* identity = cacheGetIdentity(server, record, true);
+    if (!identity || (identity->updatedAt != 0 && !identity->shared)) return false;
+    const uint64 fetchedAt = now - fields[4];
+    if (identity->updatedAt >= fetchedAt) return false;
+    identity->databaseID       = fields[0];
+    identity->created          = fields[1];
+    identity->lastConnected    = fields[2];
+    identity->totalConnections = fields[3];
+    identity->description[0]   = '\0';
+    identity->updatedAt        = fetchedAt;
+    identity->shared           = true;
+    return true;
+}
+
+bool exchangeHandleCommand(uint64 serverConnectionHandlerID, const char* command, anyID invokerClientID) {
+    const size_t magicLength = strlen(EXCHANGE_MAGIC);
+    if (strncmp(command, EXCHANGE_MAGIC, magicLength) != 0) return false;
+    char*      records;
+    const long version = strtol(command + magicLength, &records, 10);
+    if (version != EXCHANGE_PROTOCOL_VERSION || *records != ';' || !exchangeIsEnabled()) return true;
+
+    anyID ownID;
+    if (ts3Functions.getClientID(serverConnectionHandlerID, &ownID) != ERROR_ok || ownID == invokerClientID) return true;
+
+    char* copy = (char*)malloc(strlen(records) + 1);
+    if (!copy) return true;
+    strcpy(copy, records + 1);
+
+    const uint64 now             = timingMonotonicMs();
+    bool         refreshSelected = false;
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, true);
+    char*               next   = copy;
+    while (server && next) {
+        char* record = next;
+        next         = strchr(record, ';');
+        if (next) *next++ = '\0';
+        anyID clientID;
+        switch (record[0]) {
+            case 'S':
+                if (mergeStats(server, record + 1, now, &clientID) && server->selectedType == PLUGIN_CLIENT && server->selectedID == clientID) refreshSelected = true;
+                break;
+            case 'I':
+                if (mergeIdentity(server, record + 1, now) && server->selectedType == PLUGIN_CLIENT) refreshSelected = true;
+                break;
+            default:
+                break;
+        }
+    }
+    const uint64 selectedID = server ? server->selectedID : 0;
+    cacheUnlock();
+    free(copy);
+
+    if (refreshSelected) ts3Functions.requestInfoUpdate(serverConnectionHandlerID, PLUGIN_CLIENT, selectedID);
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef EXCHANGE_H
+#define EXCHANGE_H
+
+#include "cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Plugin-to-plugin exchange of cached data
+ *
+ * Commands are sent to the current channel as "AIX<version>" followed by ';'-separated records.
+ * Numbers are lowercase hex, ages are milliseconds relative to the moment the batch was sent.
+ *   S<clientID>,<ping>,<packetLoss * 100>,<connectedTime>,<age>
+ *   I<uniqueID>,<databaseID>,<created>,<lastConnected>,<totalConnections>,<age>
+ * Unknown record types and trailing fields are skipped, a new version is only needed for incompatible changes.
+ */
+#define EXCHANGE_PROTOCOL_VERSION 1
+
+void exchangeInit(void);
+void exchangeShutdown(void);
+
+void exchangeSetEnabled(bool enabled);
+bool exchangeIsEnabled(void);
+
+/* Queue own query results, the batch is sent once full or by the first queue or flush call after the flush interval */
+void exchangeQueueStats(uint64 serverConnectionHandlerID, anyID clientID, const struct ConnectionStats* stats);
+void exchangeQueueIdentity(uint64 serverConnectionHandlerID, const struct IdentityRecord* identity);
+void exchangeFlushDue(uint64 serverConnectionHandlerID);
+void exchangeDropServer(uint64 serverConnectionHandlerID);
+
+/* Merges a received command into the cache, returns false if it is not an exchange command */
+bool exchangeHandleCommand(uint64 serverConnectionHandlerID, const char* command, anyID invokerClientID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <Windows.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "cache.h"
+#include "journal.h"
+#include "log.h"
+#include "storage.h"
+#include "timing.h"
+
+#define JOURNAL_RING_SIZE 8192
+#define JOURNAL_BATCH_SIZE 256
+#define JOURNAL_WRITE_INTERVAL 100
+#define JOURNAL_SYNC_INTERVAL 1000
+#define JOURNAL_PATH_BUFSIZE 512
+#define JOURNAL_DIRECTORY "journal"
+#define JOURNAL_DAY_NS (86400ULL * 1000000000ULL)
+
+/* Ring buffer slot, the sequence tells producers and the writer who owns it */
+struct JournalSlot {
+    atomic_size_t        sequence;
+    struct JournalRecord record;
+};
+
+static struct JournalSlot*   ring = NULL;
+static atomic_size_t         enqueuePosition;
+static size_t                dequeuePosition;
+static atomic_uint_least64_t droppedRecords;
+static atomic_bool           running = false;
+static thrd_t                writerThread;
+
+static FILE*        journalFile   = NULL;
+static uint32_t     journalDay    = 0;
+static unsigned int retentionDays = 0;
+
+/* Copies text into a fixed field without splitting an UTF-8 sequence */
+static void copyField(char* destination, size_t size, const char* text) {
+    memset(destination, 0, size);
+    if (!text) return;
+    size_t length = strlen(text);
+    if (length >= size) {
+        length = size - 1;
+        while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80) --length;
+    }
+    memcpy(destination, text, length);
+}
+
+static bool enqueue(const struct JournalRecord* record) {
+    size_t position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+    for (;;) {
+        struct JournalSlot* slot     = &ring[position & (JOURNAL_RING_SIZE - 1)];
+        const size_t        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        const intptr_t      distance = (intptr_t)sequence - (intptr_t)position;
+        if (distance == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                slot->record = *record;
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                return true;
+            }
+        } else if (distance < 0) {
+            return false;
+        } else {
+            position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+        }
+    }
+}
+
+static bool dequeue(struct JournalRecord* record) {
+    struct JournalSlot* slot = &ring[dequeuePosition & (JOURNAL_RING_SIZE - 1)];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != dequeuePosition + 1) return false;
+    *record = slot->record;
+    atomic_store_explicit(&slot->sequence, dequeuePosition + JOURNAL_RING_SIZE, memory_order_release);
+    ++dequeuePosition;
+    return true;
+}
+
+static void syncFile(FILE* file) {
+    fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+/* UTC day of a wall clock timestamp as YYYYMMDD */
+static uint32_t dayOf(uint64_t wallclockNs) {
+    const time_t time = (time_t)(wallclockNs / 1000000000ULL);
+    struct tm    utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    return (uint32_t)((utc.tm_year + 1900) * 10000 + (utc.tm_mon + 1) * 100 + utc.tm_mday);
+}
+
+/* Deletes the journal of a day if it is older than the retention limit */
+static void pruneFile(const char* directory, const char* name, uint32_t oldestDay) {
+    unsigned int day;
+    char         extension[8];
+    char         path[JOURNAL_PATH_BUFSIZE];
+    if (strlen(name) != sizeof("journal-YYYYMMDD.aij") - 1 || sscanf(name, "journal-%8u.%7s", &day, extension) != 2 || strcmp(extension, "aij") != 0 || day >= oldestDay) return;
+    const int length = snprintf(path, sizeof(path), "%s/%s", directory, name);
+    if (length > 0 && (size_t)length < sizeof(path) && remove(path) == 0) LOG(LOG_INFO, "journal_pruned", "file=%s", name);
+}
+
+/* Deletes the journals of days before the retention limit, called once per new day by the writer */
+static void pruneJournals(const char* directory, uint64_t wallclockNs) {
+    if (retentionDays == 0 || wallclockNs < retentionDays * JOURNAL_DAY_NS) return;
+    const uint32_t oldestDay = dayOf(wallclockNs - retentionDays * JOURNAL_DAY_NS);
+#ifdef _WIN32
+    char pattern[JOURNAL_PATH_BUFSIZE];
+    snprintf(pattern, sizeof(pattern), "%s\\journal-*.aij", directory);
+    WIN32_FIND_DATAA entry;
+    HANDLE           search = FindFirstFileA(pattern, &entry);
+    if (search == INVALID_HANDLE_VALUE) return;
+    do {
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) pruneFile(directory, entry.cFileName, oldestDay);
+    } while (FindNextFileA(search, &entry));
+    FindClose(search);
+#else
+    DIR* journals = opendir(directory);
+    if (!journals) return;
+    struct dirent* entry;
+    while ((entry = readdir(journals))) pruneFile(directory, entry->d_name, oldestDay);
+    closedir(journals);
+#endif
+}
+
+/* Makes sure the journal of the given day is open for appending */
+static bool openJournal(uint64_t wallclockNs) {
+    const uint32_t day = dayOf(wallclockNs);
+    if (journalFile && day == journalDay) return true;
+    if (journalFile) {
+        syncFile(journalFile);
+        fclose(journalFile);
+        journalFile = NULL;
+    }
+
+    char directory[JOURNAL_PATH_BUFSIZE];
+    char fileName[JOURNAL_PATH_BUFSIZE];
+    char path[JOURNAL_PATH_BUFSIZE];
+    if (!storagePath(directory, sizeof(directory), JOURNAL_DIRECTORY) || !storageCreateDirectory(directory)) return false;
+    pruneJournals(directory, wallclockNs);
+    snprintf(fileName, sizeof(fileName), JOURNAL_DIRECTORY "/journal-%08u.aij", (unsigned int)day);
+    if (!storagePath(path, sizeof(path), fileName)) return false;
+
+    journalFile = fopen(path, "ab");
+    if (!journalFile) {
+        LOG(LOG_WARNING, "journal_open_failed", "file=%s", fileName);
+        return false;
+    }
+    journalDay = day;
+    fseek(journalFile, 0, SEEK_END);
+    if (ftell(journalFile) == 0) {
+        struct JournalFileHeader header = {0};
+        memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+        header.version    = JOURNAL_VERSION;
+        header.recordSize = JOURNAL_RECORD_SIZE;
+        header.createdAt  = wallclockNs;
+        fwrite(&header, sizeof(header), 1, journalFile);
+    }
+    return true;
+}
+
+/* Drains the ring buffer into the journal, returns the number of records written */
+static size_t writeBatch(void) {
+    static struct JournalRecord batch[JOURNAL_BATCH_SIZE];
+    size_t                      count = 0;
+    while (count < JOURNAL_BATCH_SIZE && dequeue(&batch[count])) ++count;
+
+    size_t written = 0;
+    while (written < count) {
+        /* Records of one batch may straddle midnight */
+        size_t end = written + 1;
+        while (end < count && dayOf(batch[end].wallclockNs) == dayOf(batch[written].wallclockNs)) ++end;
+        if (openJournal(batch[written].wallclockNs)) fwrite(&batch[written], sizeof(struct JournalRecord), end - written, journalFile);
+        written = end;
+    }
+    return count;
+}
+
+static int writerMain(void* argument) {
+    uint64_t lastSync = timingMonotonicMs();
+    bool     dirty    = false;
+    while (atomic_load(&running)) {
+        size_t written;
+        while ((written = writeBatch()) > 0) {
+            dirty = true;
+            if (written < JOURNAL_BATCH_SIZE) break;
+        }
+        if (dirty && journalFile && timingMonotonicMs() - lastSync >= JOURNAL_SYNC_INTERVAL) {
+            syncFile(journalFile);
+            lastSync = timingMonotonicMs();
+            dirty    = false;
+        }
+        thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = JOURNAL_WRITE_INTERVAL * 1000000L}, NULL);
+    }
+    while (writeBatch() > 0) {}
+    if (journalFile) {
+        syncFile(journalFile);
+        fclose(journalFile);
+        journalFile = NULL;
+    }
+    return 0;
+}
+
+void journalInit(bool enabled, unsigned int keepDays) {
+    if (!enabled) return;
+    retentionDays = keepDays;
+    ring = (struct JournalSlot*)malloc(JOURNAL_RING_SIZE * sizeof(struct JournalSlot));
+    if (!ring) return;
+    for (size_t index = 0; index < JOURNAL_RING_SIZE; ++index) atomic_init(&ring[index].sequence, index);
+    atomic_init(&enqueuePosition, 0);
+    dequeuePosition = 0;
+    atomic_store(&running, true);
+    if (thrd_create(&writerThread, writerMain, NULL) != thrd_success) {
+        atomic_store(&running, false);
+        free(ring);
+        ring = NULL;
+        return;
+    }
+    journalRecord(0, JOURNAL_EVENT_START, 0, 0, 0, 0, NULL, NULL);
+}
+
+void journalShutdown(void) {
+    if (!ring) return;
+    journalRecord(0, JOURNAL_EVENT_STOP, 0, 0, 0, 0, NULL, NULL);
+    atomic_store(&running, false);
+    thrd_join(writerThread, NULL);
+    free(ring);
+    ring = NULL;
+}
+
+void journalRecord(uint64 serverConnectionHandlerID, enum JournalEventType type, anyID clientID, uint64 fromChannelID, uint64 toChannelID, anyID actorID, const char* uniqueID, const char* text) {
+    if (!ring || !atomic_load_explicit(&running, memory_order_relaxed)) return;
+    struct JournalRecord record;
+    record.monotonicNs               = timingMonotonicNs();
+    record.wallclockNs               = timingWallclockNs();
+    record.serverConnectionHandlerID = serverConnectionHandlerID;
+    record.fromChannelID             = fromChannelID;
+    record.toChannelID               = toChannelID;
+    record.type                      = (uint16_t)type;
+    record.clientID                  = clientID;
+    record.actorID                   = actorID;
+    record.reserved                  = 0;
+    copyField(record.uniqueID, sizeof(record.uniqueID), uniqueID);
+    copyField(record.text, sizeof(record.text), text);
+    if (!enqueue(&record)) atomic_fetch_add_explicit(&droppedRecords, 1, memory_order_relaxed);
+}
+
+void journalClientEvent(uint64 serverConnectionHandlerID, enum JournalEventType type, anyID clientID, uint64 fromChannelID, uint64 toChannelID, anyID actorID) {
+    if (!ring) return;
+    char uniqueID[UID_BUFSIZE]      = "";
+    char nickname[NICKNAME_BUFSIZE] = "";
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedClient* client = server ? cacheGetClient(server, clientID, false) : NULL;
+    if (client) {
+        memcpy(uniqueID, client->uniqueID, UID_BUFSIZE);
+        memcpy(nickname, client->nickname, NICKNAME_BUFSIZE);
+    }
+    cacheUnlock();
+    journalRecord(serverConnectionHandlerID, type, clientID, fromChannelID, toChannelID, actorID, uniqueID, nickname);
+}
+
+static void recordPresent(struct CachedClient* client, void* context) {
+    journalRecord(*(const uint64*)context, JOURNAL_EVENT_PRESENT, client->clientID, 0, client->channelID, 0, client->uniqueID, client->nickname);
+}
+
+void journalPresentClients(uint64 serverConnectionHandlerID) {
+    if (!ring) return;
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server) cacheForEachClient(server, recordPresent, &serverConnectionHandlerID);
+    cacheUnlock();
+}
+
+uint64 journalDroppedRecords(void) {
+    return atomic_load_explicit(&droppedRecords, memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "teamspeak/public_definitions.h"
+
+#include "journalformat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Starts and stops the background writer, journals older than keepDays are deleted as days begin, 0 keeps them all */
+void journalInit(bool enabled, unsigned int keepDays);
+void journalShutdown(void);
+
+/* Enqueues a record without touching the disk, drops it if the ring buffer is full */
+void journalRecord(uint64 serverConnectionHandlerID, enum JournalEventType type, anyID clientID, uint64 fromChannelID, uint64 toChannelID, anyID actorID, const char* uniqueID, const char* text);
+
+/* Enqueues a client record with the unique identifier and nickname from the cache */
+void journalClientEvent(uint64 serverConnectionHandlerID, enum JournalEventType type, anyID clientID, uint64 fromChannelID, uint64 toChannelID, anyID actorID);
+
+/* Enqueues present records for all cached clients of a connection */
+void journalPresentClients(uint64 serverConnectionHandlerID);
+
+/* Records lost because the writer could not keep up */
+uint64 journalDroppedRecords(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
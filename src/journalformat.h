@@ -0,0 +1,67 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef JOURNALFORMAT_H
+#define JOURNALFORMAT_H
+
+#include <stdint.h>
+
+/*
+ * Event journal file, little endian
+ *
+ * Journals are written per UTC day as journal/journal-YYYYMMDD.aij in the plugin data directory.
+ * A file starts with a header padded to the record size, followed by fixed size records in the
+ * order they were recorded. Strings are NUL padded UTF-8 and may be truncated.
+ */
+
+#define JOURNAL_MAGIC "AIJN"
+#define JOURNAL_VERSION 1
+#define JOURNAL_RECORD_SIZE 128
+#define JOURNAL_UID_SIZE 32
+#define JOURNAL_TEXT_SIZE 48
+
+enum JournalEventType {
+    JOURNAL_EVENT_START = 1,    /* Plugin started recording, ends all open sessions */
+    JOURNAL_EVENT_CONNECTED,    /* Own connection established, text holds the virtual server unique identifier */
+    JOURNAL_EVENT_DISCONNECTED, /* Own connection closed, ends all sessions of the connection */
+    JOURNAL_EVENT_PRESENT,      /* Client already connected when our connection was established */
+    JOURNAL_EVENT_JOIN,         /* Client connected, text holds the nickname */
+    JOURNAL_EVENT_LEAVE,        /* Client disconnected */
+    JOURNAL_EVENT_TIMEOUT,      /* Client connection timed out */
+    JOURNAL_EVENT_MOVE,         /* Client switched or was moved to another channel, actor is the mover */
+    JOURNAL_EVENT_KICK_CHANNEL, /* Client kicked from a channel, actor is the kicker */
+    JOURNAL_EVENT_KICK_SERVER,  /* Client kicked from the server, actor is the kicker */
+    JOURNAL_EVENT_BAN,          /* Client banned from the server, actor is the banner */
+    JOURNAL_EVENT_NICKNAME,     /* Client changed the nickname, text holds the new nickname */
+    JOURNAL_EVENT_STOP          /* Plugin stopped recording, ends all open sessions */
+};
+
+struct JournalFileHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t createdAt; /* Unix time in nanoseconds */
+    uint8_t  padding[JOURNAL_RECORD_SIZE - 24];
+};
+
+struct JournalRecord {
+    uint64_t monotonicNs;
+    uint64_t wallclockNs; /* Unix time in nanoseconds */
+    uint64_t serverConnectionHandlerID;
+    uint64_t fromChannelID;
+    uint64_t toChannelID;
+    uint16_t type;
+    uint16_t clientID;
+    uint16_t actorID;
+    uint16_t reserved;
+    char     uniqueID[JOURNAL_UID_SIZE];
+    char     text[JOURNAL_TEXT_SIZE];
+};
+
+_Static_assert(sizeof(struct JournalFileHeader) == JOURNAL_RECORD_SIZE, "journal header must match the record size");
+_Static_assert(sizeof(struct JournalRecord) == JOURNAL_RECORD_SIZE, "journal records must have a fixed size");
+
+#endif
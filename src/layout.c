@@ -0,0 +1,282 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <Windows.h>
+#include <shellapi.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+#include "layout.h"
+#include "log.h"
+#include "storage.h"
+#include "timing.h"
+
+#define LAYOUT_FILE "fields.ini"
+#define LAYOUT_PATH_BUFSIZE 512
+#define LAYOUT_LINE_BUFSIZE 512
+#define LAYOUT_CHECK_INTERVAL 1000 /* Milliseconds between modification time checks without inotify */
+
+struct LayoutFieldName {
+    enum LayoutFrame frame;
+    const char*      name;
+    unsigned int     needs;
+    bool             baseline; /* Shown without a line for its frame, the other fields have to be listed */
+};
+
+/* Every field in its default order */
+static const struct LayoutFieldName fieldNames[LAYOUT_FIELD_COUNT] = {
+    [LAYOUT_SERVER_ID]               = {LAYOUT_FRAME_SERVER, "id", 0, true},
+    [LAYOUT_SERVER_QUERIES]          = {LAYOUT_FRAME_SERVER, "queries", 0, true},
+    [LAYOUT_SERVER_QUERY_CLIENTS]    = {LAYOUT_FRAME_SERVER, "query_clients", 0, false},
+    [LAYOUT_SERVER_TALLIES]          = {LAYOUT_FRAME_SERVER, "tallies", LAYOUT_NEEDS_TALLIES, false},
+    [LAYOUT_SERVER_HOTTEST_CHANNELS] = {LAYOUT_FRAME_SERVER, "hottest_channels", LAYOUT_NEEDS_HEAT, false},
+    [LAYOUT_SERVER_BANS]             = {LAYOUT_FRAME_SERVER, "bans", 0, false},
+    [LAYOUT_SERVER_CACHE]            = {LAYOUT_FRAME_SERVER, "cache", 0, false},
+    [LAYOUT_CHANNEL_ID]              = {LAYOUT_FRAME_CHANNEL, "id", 0, true},
+    [LAYOUT_CHANNEL_ACTIVITY]        = {LAYOUT_FRAME_CHANNEL, "activity", LAYOUT_NEEDS_HEAT, false},
+    [LAYOUT_CHANNEL_TOPIC]           = {LAYOUT_FRAME_CHANNEL, "topic", 0, false},
+    [LAYOUT_CHANNEL_DESCRIPTION]     = {LAYOUT_FRAME_CHANNEL, "description", 0, false},
+    [LAYOUT_CLIENT_ID]               = {LAYOUT_FRAME_CLIENT, "id", 0, true},
+    [LAYOUT_CLIENT_UNIQUE_ID]        = {LAYOUT_FRAME_CLIENT, "unique_id", LAYOUT_NEEDS_UNIQUE_ID, true},
+    [LAYOUT_CLIENT_CONNECTION]       = {LAYOUT_FRAME_CLIENT, "connection", LAYOUT_NEEDS_CACHED_CLIENT, false},
+    [LAYOUT_CLIENT_SAME_ADDRESS]     = {LAYOUT_FRAME_CLIENT, "same_address", LAYOUT_NEEDS_CACHED_CLIENT | LAYOUT_NEEDS_ADDRESSES, false},
+    [LAYOUT_CLIENT_DATABASE_ID]      = {LAYOUT_FRAME_CLIENT, "database_id", 0, false},
+    [LAYOUT_CLIENT_IDENTITY]         = {LAYOUT_FRAME_CLIENT, "identity", LAYOUT_NEEDS_UNIQUE_ID | LAYOUT_NEEDS_CACHED_CLIENT | LAYOUT_NEEDS_IDENTITIES, false},
+    [LAYOUT_CLIENT_TALK]             = {LAYOUT_FRAME_CLIENT, "talk", LAYOUT_NEEDS_TALK, false},
+    [LAYOUT_CLIENT_MICROPHONE]       = {LAYOUT_FRAME_CLIENT, "microphone", LAYOUT_NEEDS_CAPTURED_VOICE, false},
+    [LAYOUT_CLIENT_LOUDNESS]         = {LAYOUT_FRAME_CLIENT, "loudness", LAYOUT_NEEDS_PLAYBACK_VOICE, false},
+    [LAYOUT_CLIENT_OTHER_SERVERS]    = {LAYOUT_FRAME_CLIENT, "other_servers", LAYOUT_NEEDS_UNIQUE_ID, false},
+    [LAYOUT_CLIENT_BAN]              = {LAYOUT_FRAME_CLIENT, "ban", LAYOUT_NEEDS_UNIQUE_ID | LAYOUT_NEEDS_CACHED_CLIENT | LAYOUT_NEEDS_ADDRESSES | LAYOUT_NEEDS_BAN_LIST, false},
+};
+
+static const char* const frameNames[LAYOUT_FRAME_COUNT] = {"server", "channel", "client"};
+
+static struct LayoutPlan plans[LAYOUT_FRAME_COUNT];
+static atomic_uint       neededData;
+static mtx_t             planMutex;
+static bool              initialized = false;
+
+#ifdef __linux__
+static int watchDescriptor = -1;
+#else
+static time_t   modifiedAt = 0;
+static uint64_t checkedAt  = 0;
+#endif
+
+/* Plan of a frame with its baseline fields in the default order */
+static void defaultPlan(enum LayoutFrame frame, struct LayoutPlan* plan) {
+    plan->count = 0;
+    plan->needs = 0;
+    for (size_t field = 0; field < LAYOUT_FIELD_COUNT; ++field) {
+        if (fieldNames[field].frame != frame || !fieldNames[field].baseline) continue;
+        plan->fields[plan->count++] = (enum LayoutField)field;
+        plan->needs |= fieldNames[field].needs;
+    }
+}
+
+/* Compiles a comma separated field list, unknown and repeated names are skipped */
+static void compilePlan(enum LayoutFrame frame, char* list, struct LayoutPlan* plan) {
+    bool used[LAYOUT_FIELD_COUNT] = {false};
+    plan->count                   = 0;
+    plan->needs                   = 0;
+    for (char* name = strtok(list, ", \t"); name; name = strtok(NULL, ", \t")) {
+        size_t field = 0;
+        while (field < LAYOUT_FIELD_COUNT && (fieldNames[field].frame != frame || strcmp(fieldNames[field].name, name) != 0)) ++field;
+        if (field == LAYOUT_FIELD_COUNT) {
+            LOG(LOG_WARNING, "layout_unknown_field", "frame=%s field=%s", frameNames[frame], name);
+            continue;
+        }
+        if (used[field]) continue;
+        used[field]                 = true;
+        plan->fields[plan->count++] = (enum LayoutField)field;
+        plan->needs |= fieldNames[field].needs;
+    }
+}
+
+static char* trim(char* text) {
+    while (isspace((unsigned char)*text)) ++text;
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char)text[length - 1])) text[--length] = '\0';
+    return text;
+}
+
+/* Reads the file into new plans and publishes them */
+static void loadPlans(void) {
+    struct LayoutPlan loaded[LAYOUT_FRAME_COUNT];
+    for (size_t frame = 0; frame < LAYOUT_FRAME_COUNT; ++frame) defaultPlan((enum LayoutFrame)frame, &loaded[frame]);
+
+    char  path[LAYOUT_PATH_BUFSIZE];
+    FILE* file = storagePath(path, sizeof(path), LAYOUT_FILE) ? fopen(path, "r") : NULL;
+    if (file) {
+        char line[LAYOUT_LINE_BUFSIZE];
+        while (fgets(line, sizeof(line), file)) {
+            char* text = trim(line);
+            if (*text == '\0' || *text == '#' || *text == ';' || *text == '[') continue;
+            char* separator = strchr(text, '=');
+            if (!separator) continue;
+            *separator        = '\0';
+            const char* key   = trim(text);
+            size_t      frame = 0;
+            while (frame < LAYOUT_FRAME_COUNT && strcmp(frameNames[frame], key) != 0) ++frame;
+            if (frame < LAYOUT_FRAME_COUNT) compilePlan((enum LayoutFrame)frame, separator + 1, &loaded[frame]);
+        }
+        fclose(file);
+    }
+
+    unsigned int needs = 0;
+    for (size_t frame = 0; frame < LAYOUT_FRAME_COUNT; ++frame) needs |= loaded[frame].needs;
+    mtx_lock(&planMutex);
+    memcpy(plans, loaded, sizeof(plans));
+    mtx_unlock(&planMutex);
+    atomic_store_explicit(&neededData, needs, memory_order_relaxed);
+    LOG(LOG_INFO, "layout_loaded", "server=%zu channel=%zu client=%zu needs=0x%x", loaded[LAYOUT_FRAME_SERVER].count, loaded[LAYOUT_FRAME_CHANNEL].count, loaded[LAYOUT_FRAME_CLIENT].count, needs);
+}
+
+#ifdef __linux__
+/* Drains pending notifications, returns whether one was about the file */
+static bool fileChanged(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    for (;;) {
+        const ssize_t length = read(watchDescriptor, buffer, sizeof(buffer));
+        if (length <= 0) return changed;
+        for (ssize_t offset = 0; offset < length;) {
+            const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+            if (event->len > 0 && strcmp(event->name, LAYOUT_FILE) == 0) changed = true;
+            offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+        }
+    }
+}
+#else
+static time_t modificationTime(void) {
+    char        path[LAYOUT_PATH_BUFSIZE];
+    struct stat status;
+    return storagePath(path, sizeof(path), LAYOUT_FILE) && stat(path, &status) == 0 ? status.st_mtime : 0;
+}
+#endif
+
+void layoutInit(void) {
+    if (mtx_init(&planMutex, mtx_plain) != thrd_success) return;
+    initialized = true;
+#ifdef __linux__
+    char directory[LAYOUT_PATH_BUFSIZE];
+    watchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchDescriptor >= 0 && (!storagePath(directory, sizeof(directory), "") || inotify_add_watch(watchDescriptor, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0)) {
+        LOG(LOG_WARNING, "layout_watch_failed", "directory=%s", directory);
+        close(watchDescriptor);
+        watchDescriptor = -1;
+    }
+#else
+    modifiedAt = modificationTime();
+    checkedAt  = timingMonotonicMs();
+#endif
+    loadPlans();
+}
+
+void layoutShutdown(void) {
+    if (!initialized) return;
+#ifdef __linux__
+    if (watchDescriptor >= 0) close(watchDescriptor);
+    watchDescriptor = -1;
+#endif
+    mtx_destroy(&planMutex);
+    initialized = false;
+}
+
+void layoutPump(void) {
+    if (!initialized) return;
+#ifdef __linux__
+    if (watchDescriptor >= 0 && fileChanged()) loadPlans();
+#else
+    const uint64_t now = timingMonotonicMs();
+    if (now - checkedAt < LAYOUT_CHECK_INTERVAL) return;
+    checkedAt            = now;
+    const time_t current = modificationTime();
+    if (current == modifiedAt) return;
+    modifiedAt = current;
+    loadPlans();
+#endif
+}
+
+void layoutGetPlan(enum LayoutFrame frame, struct LayoutPlan* plan) {
+    if (!initialized) {
+        defaultPlan(frame, plan);
+        return;
+    }
+    mtx_lock(&planMutex);
+    *plan = plans[frame];
+    mtx_unlock(&planMutex);
+}
+
+bool layoutNeeds(unsigned int needs) {
+    return (atomic_load_explicit(&neededData, memory_order_relaxed) & needs) != 0;
+}
+
+/* Appends the fields of a frame separated by commas, all of them or only the baseline */
+static int renderFields(char* text, size_t size, int length, size_t frame, bool baseline) {
+    bool first = true;
+    for (size_t field = 0; field < LAYOUT_FIELD_COUNT && (size_t)length < size; ++field) {
+        if (fieldNames[field].frame != frame || (baseline && !fieldNames[field].baseline)) continue;
+        length += snprintf(text + length, size - (size_t)length, "%s %s", first ? "" : ",", fieldNames[field].name);
+        first = false;
+    }
+    return length;
+}
+
+/* Default file content, each frame with its baseline fields and a comment listing all of them */
+static size_t renderDefaults(char* text, size_t size) {
+    int length = snprintf(text, size, "# Fields of the Advanced Information frames in the order they are shown, separated by commas\n"
+                                      "# Add a field from the list above a frame to show it, an empty list hides the whole frame\n");
+    for (size_t frame = 0; frame < LAYOUT_FRAME_COUNT && length > 0 && (size_t)length < size; ++frame) {
+        length += snprintf(text + length, size - (size_t)length, "# %s:", frameNames[frame]);
+        length = renderFields(text, size, length, frame, false);
+        if ((size_t)length < size) length += snprintf(text + length, size - (size_t)length, "\n%s =", frameNames[frame]);
+        length = renderFields(text, size, length, frame, true);
+        if ((size_t)length < size) length += snprintf(text + length, size - (size_t)length, "\n");
+    }
+    return length > 0 && (size_t)length < size ? (size_t)length : 0;
+}
+
+bool layoutEdit(void) {
+    char path[LAYOUT_PATH_BUFSIZE];
+    if (!storagePath(path, sizeof(path), LAYOUT_FILE)) return false;
+    struct stat status;
+    if (stat(path, &status) != 0) {
+        char         defaults[LAYOUT_LINE_BUFSIZE * 2];
+        const size_t length = renderDefaults(defaults, sizeof(defaults));
+        if (length == 0 || !storageWriteFile(LAYOUT_FILE, defaults, length)) return false;
+    }
+    LOG(LOG_INFO, "layout_edit", "file=%s", path);
+
+#ifdef _WIN32
+    return (INT_PTR)ShellExecuteA(NULL, "open", path, NULL, NULL, SW_SHOWNORMAL) > 32;
+#else
+#ifdef __APPLE__
+    char* const arguments[] = {"open", "-t", path, NULL};
+#else
+    char* const arguments[] = {"xdg-open", path, NULL};
+#endif
+    extern char** environ;
+    pid_t         child;
+    int           exitStatus;
+    if (posix_spawnp(&child, arguments[0], NULL, NULL, arguments, environ) != 0) return false;
+    return waitpid(child, &exitStatus, 0) == child && WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0;
+#endif
+}
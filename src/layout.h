@@ -0,0 +1,96 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum LayoutFrame {
+    LAYOUT_FRAME_SERVER,
+    LAYOUT_FRAME_CHANNEL,
+    LAYOUT_FRAME_CLIENT,
+    LAYOUT_FRAME_COUNT
+};
+
+enum LayoutField {
+    LAYOUT_SERVER_ID,
+    LAYOUT_SERVER_QUERIES,
+    LAYOUT_SERVER_QUERY_CLIENTS,
+    LAYOUT_SERVER_TALLIES,
+    LAYOUT_SERVER_HOTTEST_CHANNELS,
+    LAYOUT_SERVER_BANS,
+    LAYOUT_SERVER_CACHE,
+    LAYOUT_CHANNEL_ID,
+    LAYOUT_CHANNEL_ACTIVITY,
+    LAYOUT_CHANNEL_TOPIC,
+    LAYOUT_CHANNEL_DESCRIPTION,
+    LAYOUT_CLIENT_ID,
+    LAYOUT_CLIENT_UNIQUE_ID,
+    LAYOUT_CLIENT_CONNECTION,
+    LAYOUT_CLIENT_SAME_ADDRESS,
+    LAYOUT_CLIENT_DATABASE_ID,
+    LAYOUT_CLIENT_IDENTITY,
+    LAYOUT_CLIENT_TALK,
+    LAYOUT_CLIENT_MICROPHONE,
+    LAYOUT_CLIENT_LOUDNESS,
+    LAYOUT_CLIENT_OTHER_SERVERS,
+    LAYOUT_CLIENT_BAN,
+    LAYOUT_FIELD_COUNT
+};
+
+/* Data the fields of a plan depend on, anything not needed is neither fetched nor maintained */
+enum LayoutNeed {
+    LAYOUT_NEEDS_UNIQUE_ID      = 1 << 0, /* Unique identifier of the client from the host */
+    LAYOUT_NEEDS_CACHED_CLIENT  = 1 << 1, /* Cache entry of the client, its connection info and identity requests */
+    LAYOUT_NEEDS_ADDRESSES      = 1 << 2, /* Connection info requests for the IP addresses of joining clients */
+    LAYOUT_NEEDS_BAN_LIST       = 1 << 3, /* Ban list requests */
+    LAYOUT_NEEDS_CAPTURED_VOICE = 1 << 4, /* Level measurement of the own microphone */
+    LAYOUT_NEEDS_PLAYBACK_VOICE = 1 << 5, /* Loudness measurement of other speakers */
+    LAYOUT_NEEDS_IDENTITIES     = 1 << 6, /* Client variable requests for the occupants of a shown channel */
+    LAYOUT_NEEDS_TALK           = 1 << 7, /* Talk bursts of visible clients */
+    LAYOUT_NEEDS_HEAT           = 1 << 8, /* Joins and talk bursts added to the heat of channels */
+    LAYOUT_NEEDS_TALLIES        = 1 << 9  /* Versions, platforms and countries counted when clients are loaded */
+};
+
+/* Fields of a frame in the order they are shown */
+struct LayoutPlan {
+    enum LayoutField fields[LAYOUT_FIELD_COUNT];
+    size_t           count;
+    unsigned int     needs;
+};
+
+/*
+ * Field selection of the info frames from AdvancedInformation/fields.ini in the Teamspeak config directory
+ *
+ * One line per frame lists its fields separated by commas in the order they are shown, for example
+ * "client = id, connection, talk". A frame without a line shows its cheap baseline fields, an empty list none.
+ * The file is compiled into a plan per frame and reloaded by layoutPump when it changes, through inotify
+ * on Linux and the modification time elsewhere.
+ */
+void layoutInit(void);
+void layoutShutdown(void);
+
+/* Reloads the plans if the file changed, called on the event thread */
+void layoutPump(void);
+
+/* Copies the current plan of a frame */
+void layoutGetPlan(enum LayoutFrame frame, struct LayoutPlan* plan);
+
+/* Whether any frame needs the given data, safe on every thread */
+bool layoutNeeds(unsigned int needs);
+
+/* Writes the file with the default fields if it is missing and opens it in the system editor */
+bool layoutEdit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "ts3_functions.h"
+
+#include "log.h"
+#include "plugin.h"
+#include "storage.h"
+#include "timing.h"
+
+#define LOG_RING_COUNT 16
+#define LOG_RING_RECORDS 128 /* Power of two */
+#define LOG_FIELDS_BUFSIZE 224
+#define LOG_LINE_BUFSIZE 320
+#define LOG_PATH_BUFSIZE 512
+#define LOG_RATE_SLOTS 64
+#define LOG_RATE_BURST 10 /* Messages of one event per second */
+#define LOG_FLUSH_INTERVAL 100
+#define LOG_CHANNEL "AdvancedInformation"
+#define LOG_FILE "advancedinformation.log"
+#define LOG_FILE_PREVIOUS "advancedinformation.log.1"
+
+struct LogRecord {
+    uint64_t          wallclockNs;
+    enum LogVerbosity level;
+    const char*       event;
+    char              fields[LOG_FIELDS_BUFSIZE];
+};
+
+/* Single producer ring of one thread, the flusher is the only consumer */
+struct LogRing {
+    atomic_bool      claimed;
+    atomic_bool      abandoned; /* The owner thread ended, the ring is released once drained */
+    atomic_size_t    head;
+    atomic_size_t    tail;
+    struct LogRecord records[LOG_RING_RECORDS];
+};
+
+/* Messages of an event in the current second, events are told apart by the address of their name */
+struct LogRate {
+    _Atomic(const char*) event;
+    atomic_uint_fast64_t second;
+    atomic_uint          count;
+    atomic_uint          suppressed;
+};
+
+static atomic_int           activeLevel = LOG_OFF;
+static struct LogRing*      rings       = NULL;
+static tss_t                ringKey;
+static struct LogRate       rates[LOG_RATE_SLOTS];
+static atomic_uint_fast64_t droppedMessages;
+static atomic_bool          running = false;
+static thrd_t               flusherThread;
+
+static bool   forwardToClient = true;
+static size_t fileLimit       = 0;
+static FILE*  logFile         = NULL;
+static size_t fileBytes       = 0;
+
+static const char* verbosityName(enum LogVerbosity level) {
+    switch (level) {
+        case LOG_ERROR:
+            return "ERROR";
+        case LOG_WARNING:
+            return "WARNING";
+        case LOG_INFO:
+            return "INFO";
+        default:
+            return "DEBUG";
+    }
+}
+
+static enum LogLevel clientLevel(enum LogVerbosity level) {
+    switch (level) {
+        case LOG_ERROR:
+            return LogLevel_ERROR;
+        case LOG_WARNING:
+            return LogLevel_WARNING;
+        case LOG_INFO:
+            return LogLevel_INFO;
+        default:
+            return LogLevel_DEBUG;
+    }
+}
+
+/* Called by the C runtime when a thread with a ring ends */
+static void abandonRing(void* ring) {
+    atomic_store_explicit(&((struct LogRing*)ring)->abandoned, true, memory_order_release);
+}
+
+static struct LogRing* threadRing(void) {
+    struct LogRing* ring = (struct LogRing*)tss_get(ringKey);
+    if (ring) return ring;
+    for (size_t index = 0; index < LOG_RING_COUNT; ++index) {
+        bool expected = false;
+        if (atomic_load_explicit(&rings[index].claimed, memory_order_relaxed) || !atomic_compare_exchange_strong(&rings[index].claimed, &expected, true)) continue;
+        tss_set(ringKey, &rings[index]);
+        return &rings[index];
+    }
+    return NULL;
+}
+
+/* Counts the message against its event, suppressed tells how many were held back in the previous second */
+static bool admit(const char* event, unsigned int* suppressed) {
+    *suppressed          = 0;
+    struct LogRate* rate = &rates[((uintptr_t)event >> 3) % LOG_RATE_SLOTS];
+    const char*     used = NULL;
+    if (!atomic_compare_exchange_strong(&rate->event, &used, event) && used != event) return true;
+
+    const uint64_t second = timingMonotonicMs() / 1000;
+    uint_fast64_t  window = atomic_load_explicit(&rate->second, memory_order_relaxed);
+    if (window != second && atomic_compare_exchange_strong(&rate->second, &window, second)) {
+        atomic_store_explicit(&rate->count, 0, memory_order_relaxed);
+        *suppressed = atomic_exchange_explicit(&rate->suppressed, 0, memory_order_relaxed);
+    }
+    if (atomic_fetch_add_explicit(&rate->count, 1, memory_order_relaxed) < LOG_RATE_BURST) return true;
+    atomic_fetch_add_explicit(&rate->suppressed, 1, memory_order_relaxed);
+    return false;
+}
+
+/*********************************** Flusher ************************************/
+
+static void openFile(void) {
+    char path[LOG_PATH_BUFSIZE];
+    if (!storagePath(path, sizeof(path), LOG_FILE)) return;
+    logFile = fopen(path, "ab");
+    if (!logFile) return;
+    fseek(logFile, 0, SEEK_END);
+    const long size = ftell(logFile);
+    fileBytes       = size > 0 ? (size_t)size : 0;
+}
+
+/* Moves the full file aside and starts a new one */
+static void rotateFile(void) {
+    char path[LOG_PATH_BUFSIZE];
+    char previous[LOG_PATH_BUFSIZE];
+    fclose(logFile);
+    logFile = NULL;
+    if (storagePath(path, sizeof(path), LOG_FILE) && storagePath(previous, sizeof(previous), LOG_FILE_PREVIOUS)) storageReplaceFile(path, previous);
+    openFile();
+}
+
+static void emit(const struct LogRecord* record) {
+    char line[LOG_LINE_BUFSIZE];
+    if (snprintf(line, sizeof(line), "%s%s%s", record->event, record->fields[0] ? " " : "", record->fields) < 0) return;
+    if (forwardToClient) ts3Functions.logMessage(line, clientLevel(record->level), LOG_CHANNEL, 0);
+    if (!logFile) return;
+
+    const time_t seconds = (time_t)(record->wallclockNs / 1000000000ULL);
+    struct tm    utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    const int written = fprintf(logFile, "%04d-%02d-%02dT%02d:%02d:%02d.%03uZ %-7s %s\n", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, (unsigned int)(record->wallclockNs / 1000000 % 1000),
+                                verbosityName(record->level), line);
+    if (written > 0) fileBytes += (size_t)written;
+    if (fileBytes >= fileLimit) rotateFile();
+}
+
+/* Drains every ring, returns the number of messages written */
+static size_t flush(void) {
+    size_t count = 0;
+    for (size_t index = 0; index < LOG_RING_COUNT; ++index) {
+        struct LogRing* ring = &rings[index];
+        if (!atomic_load_explicit(&ring->claimed, memory_order_acquire)) continue;
+        const bool   abandoned = atomic_load_explicit(&ring->abandoned, memory_order_acquire);
+        const size_t head      = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t       tail      = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        for (; tail != head; ++tail, ++count) emit(&ring->records[tail & (LOG_RING_RECORDS - 1)]);
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        if (abandoned) {
+            atomic_store_explicit(&ring->abandoned, false, memory_order_relaxed);
+            atomic_store_explicit(&ring->claimed, false, memory_order_release);
+        }
+    }
+
+    const uint_fast64_t dropped = atomic_exchange_explicit(&droppedMessages, 0, memory_order_relaxed);
+    if (dropped > 0) {
+        struct LogRecord record = {timingWallclockNs(), LOG_WARNING, "log_dropped", ""};
+        snprintf(record.fields, sizeof(record.fields), "messages=%llu", (unsigned long long)dropped);
+        emit(&record);
+        ++count;
+    }
+    if (count > 0 && logFile) fflush(logFile);
+    return count;
+}
+
+static int flusherMain(void* argument) {
+    while (atomic_load(&running)) {
+        flush();
+        thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = LOG_FLUSH_INTERVAL * 1000000L}, NULL);
+    }
+    flush();
+    if (logFile) {
+        fclose(logFile);
+        logFile = NULL;
+    }
+    return 0;
+}
+
+/*********************************** Interface ************************************/
+
+void logInit(enum LogVerbosity level, bool clientLog, size_t fileLimitBytes) {
+    if (level == LOG_OFF || (!clientLog && fileLimitBytes == 0)) return;
+    rings = (struct LogRing*)calloc(LOG_RING_COUNT, sizeof(struct LogRing));
+    if (!rings) return;
+    if (tss_create(&ringKey, abandonRing) != thrd_success) {
+        free(rings);
+        rings = NULL;
+        return;
+    }
+    forwardToClient = clientLog;
+    fileLimit       = fileLimitBytes;
+    if (fileLimit > 0) openFile();
+
+    atomic_store(&running, true);
+    if (thrd_create(&flusherThread, flusherMain, NULL) != thrd_success) {
+        atomic_store(&running, false);
+        if (logFile) fclose(logFile);
+        logFile = NULL;
+        tss_delete(ringKey);
+        free(rings);
+        rings = NULL;
+        return;
+    }
+    atomic_store(&activeLevel, level > LOG_DEBUG ? LOG_DEBUG : level);
+}
+
+void logShutdown(void) {
+    if (!rings) return;
+    atomic_store(&activeLevel, LOG_OFF);
+    atomic_store(&running, false);
+    thrd_join(flusherThread, NULL);
+    tss_delete(ringKey);
+    free(rings);
+    rings = NULL;
+}
+
+bool logEnabled(enum LogVerbosity level) {
+    return level != LOG_OFF && (int)level <= atomic_load_explicit(&activeLevel, memory_order_relaxed);
+}
+
+void logWrite(enum LogVerbosity level, const char* event, const char* fields, ...) {
+    unsigned int suppressed;
+    if (!logEnabled(level) || !admit(event, &suppressed)) return;
+    struct LogRing* ring = threadRing();
+    if (!ring) {
+        atomic_fetch_add_explicit(&droppedMessages, 1, memory_order_relaxed);
+        return;
+    }
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_RECORDS) {
+        atomic_fetch_add_explicit(&droppedMessages, 1, memory_order_relaxed);
+        return;
+    }
+
+    struct LogRecord* record = &ring->records[head & (LOG_RING_RECORDS - 1)];
+    record->wallclockNs      = timingWallclockNs();
+    record->level            = level;
+    record->event            = event;
+    va_list args;
+    va_start(args, fields);
+    const int written = vsnprintf(record->fields, sizeof(record->fields), fields, args);
+    va_end(args);
+    if (written < 0) {
+        record->fields[0] = '\0';
+    } else if (suppressed > 0 && (size_t)written < sizeof(record->fields)) {
+        snprintf(record->fields + written, sizeof(record->fields) - (size_t)written, "%ssuppressed=%u", written ? " " : "", suppressed);
+    }
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
@@ -0,0 +1,51 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Verbosity of a message, a configured level shows that level and all below it */
+enum LogVerbosity {
+    LOG_OFF = 0,
+    LOG_ERROR,
+    LOG_WARNING,
+    LOG_INFO,
+    LOG_DEBUG
+};
+
+/*
+ * Structured diagnostics in the client log and optionally AdvancedInformation/advancedinformation.log
+ *
+ * A message is an event name followed by key=value fields. Callers format it into a ring buffer owned by
+ * their thread without locking or allocating, a background flusher forwards the rings to the client log
+ * and appends them to the file, which is moved to advancedinformation.log.1 once it reaches the size
+ * limit. Each event is limited to a burst of messages per second, the number suppressed is added to the
+ * next message of the event. A full ring drops messages instead of waiting.
+ */
+void logInit(enum LogVerbosity level, bool clientLog, size_t fileLimitBytes);
+void logShutdown(void);
+
+bool logEnabled(enum LogVerbosity level);
+
+/* Event must be a string with static storage, fields is a format of space separated key=value pairs */
+void logWrite(enum LogVerbosity level, const char* event, const char* fields, ...);
+
+/* Skips formatting the fields when the level is filtered */
+#define LOG(level, event, ...)                                      \
+    do {                                                            \
+        if (logEnabled(level)) logWrite(level, event, __VA_ARGS__); \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,339 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "teamspeak/public_errors.h"
+#include "ts3_functions.h"
+
+#include "cache.h"
+#include "log.h"
+#include "metrics.h"
+#include "plugin.h"
+#include "storage.h"
+#include "timing.h"
+
+#define METRICS_FILE "advancedinformation.prom"
+#define METRICS_BUFSIZE 131072
+#define METRICS_POLL_INTERVAL 100
+#define METRICS_MAX_CALLBACKS 32
+#define METRICS_BUCKET_COUNT 9
+#define METRICS_NAME_BUFSIZE 128
+#define METRICS_UID_BUFSIZE 64
+#define METRICS_PATH_BUFSIZE 512
+
+/* Upper bounds of the latency buckets, a last bucket counts everything slower */
+static const uint64 bucketBoundsNs[METRICS_BUCKET_COUNT] = {10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 50000000, 100000000};
+
+/* Latencies of one callback, claimed by the first call and never released while the plugin runs */
+struct CallbackHistogram {
+    _Atomic(const char*)  name;
+    atomic_uint_least64_t buckets[METRICS_BUCKET_COUNT + 1];
+    atomic_uint_least64_t sumNs;
+};
+
+/* Connection properties of the own client, taken on the event thread */
+struct ConnectionSample {
+    char   name[METRICS_NAME_BUFSIZE];
+    char   uniqueID[METRICS_UID_BUFSIZE];
+    uint64 ping;
+    double packetLoss;
+    uint64 sentPerSecond;
+    uint64 receivedPerSecond;
+    uint64 sentTotal;
+    uint64 receivedTotal;
+};
+
+struct MetricsServer {
+    struct MetricsServer*   next;
+    uint64                  serverConnectionHandlerID;
+    uint64                  pumpedAt;
+    uint64                  sampledAt; /* 0 until the first sample */
+    struct ConnectionSample sample;
+};
+
+/* Rendered Prometheus text, lines that do not fit are left out whole */
+struct MetricsText {
+    char*  data;
+    size_t size;
+    size_t length;
+};
+
+static struct CallbackHistogram callbacks[METRICS_MAX_CALLBACKS];
+static atomic_bool              enabled = false;
+static atomic_bool              running = false;
+static uint64                   intervalMs;
+static mtx_t                    metricsMutex;
+static struct MetricsServer*    servers = NULL;
+static thrd_t                   writerThread;
+static char*                    buffer = NULL;
+
+static struct MetricsServer* getServer(uint64 serverConnectionHandlerID, bool create) {
+    for (struct MetricsServer* server = servers; server; server = server->next) {
+        if (server->serverConnectionHandlerID == serverConnectionHandlerID) return server;
+    }
+    if (!create) return NULL;
+    struct MetricsServer* server = (struct MetricsServer*)calloc(1, sizeof(struct MetricsServer));
+    if (!server) return NULL;
+    server->serverConnectionHandlerID = serverConnectionHandlerID;
+    server->next                      = servers;
+    servers                           = server;
+    return server;
+}
+
+static void appendText(struct MetricsText* text, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(text->data + text->length, text->size - text->length, format, args);
+    va_end(args);
+    if (written > 0 && (size_t)written < text->size - text->length) {
+        text->length += (size_t)written;
+    } else {
+        text->data[text->length] = '\0';
+    }
+}
+
+/* Label value with backslash, double quote and line feed escaped as the text format requires */
+static void escapeLabel(char* destination, size_t size, const char* value) {
+    size_t length = 0;
+    for (const char* c = value; *c && length + 2 < size; ++c) {
+        if (*c == '\\' || *c == '"') {
+            destination[length++] = '\\';
+            destination[length++] = *c;
+        } else if (*c == '\n') {
+            destination[length++] = '\\';
+            destination[length++] = 'n';
+        } else {
+            destination[length++] = *c;
+        }
+    }
+    destination[length] = '\0';
+}
+
+static void appendHeader(struct MetricsText* text, const char* name, const char* type, const char* help) {
+    appendText(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Copies of the sampled connections with their cached client counts */
+struct RenderedServer {
+    char                    labels[METRICS_NAME_BUFSIZE * 2 + METRICS_UID_BUFSIZE * 2 + 64];
+    struct ConnectionSample sample;
+    uint64                  ageMs;
+    size_t                  clients;
+    size_t                  queryClients;
+};
+
+static size_t collectServers(struct RenderedServer** rendered) {
+    const uint64 now   = timingMonotonicMs();
+    size_t       count = 0;
+    mtx_lock(&metricsMutex);
+    for (struct MetricsServer* server = servers; server; server = server->next) count += server->sampledAt != 0;
+    *rendered = count ? (struct RenderedServer*)calloc(count, sizeof(struct RenderedServer)) : NULL;
+    uint64* handlers = count ? (uint64*)calloc(count, sizeof(uint64)) : NULL;
+    if (!*rendered || !handlers) count = 0;
+    size_t index = 0;
+    for (struct MetricsServer* server = servers; server && index < count; server = server->next) {
+        if (server->sampledAt == 0) continue;
+        char name[METRICS_NAME_BUFSIZE * 2];
+        char uniqueID[METRICS_UID_BUFSIZE * 2];
+        escapeLabel(name, sizeof(name), server->sample.name);
+        escapeLabel(uniqueID, sizeof(uniqueID), server->sample.uniqueID);
+        /* Two tabs on the same virtual server are told apart by their connection handler */
+        snprintf((*rendered)[index].labels, sizeof((*rendered)[index].labels), "server=\"%s\",server_uid=\"%s\",connection=\"%llu\"", name, uniqueID, (unsigned long long)server->serverConnectionHandlerID);
+        (*rendered)[index].sample = server->sample;
+        (*rendered)[index].ageMs  = now - server->sampledAt;
+        handlers[index++]         = server->serverConnectionHandlerID;
+    }
+    mtx_unlock(&metricsMutex);
+
+    /* The cache lock is never taken while holding the metrics lock */
+    cacheLock();
+    for (index = 0; index < count; ++index) {
+        struct ServerCache* server = cacheGetServer(handlers[index], false);
+        if (!server) continue;
+        (*rendered)[index].clients      = server->clientCount;
+        (*rendered)[index].queryClients = server->queryCount;
+    }
+    cacheUnlock();
+    free(handlers);
+    return count;
+}
+
+static void render(struct MetricsText* text) {
+    struct RenderedServer* rendered = NULL;
+    const size_t           count    = collectServers(&rendered);
+
+    appendHeader(text, "advancedinformation_clients", "gauge", "Clients visible to the plugin on the connection");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_clients{%s} %zu\n", rendered[index].labels, rendered[index].clients);
+    appendHeader(text, "advancedinformation_query_clients", "gauge", "Query clients visible to the plugin on the connection");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_query_clients{%s} %zu\n", rendered[index].labels, rendered[index].queryClients);
+    appendHeader(text, "advancedinformation_ping_seconds", "gauge", "Ping of the own client to the server");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_ping_seconds{%s} %.3f\n", rendered[index].labels, (double)rendered[index].sample.ping / 1000.0);
+    appendHeader(text, "advancedinformation_packet_loss_percent", "gauge", "Packet loss of the own client as reported by the client");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_packet_loss_percent{%s} %.4f\n", rendered[index].labels, rendered[index].sample.packetLoss);
+    appendHeader(text, "advancedinformation_bandwidth_sent_bytes_per_second", "gauge", "Bytes per second sent by the own client, averaged over the last minute");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_bandwidth_sent_bytes_per_second{%s} %llu\n", rendered[index].labels, (unsigned long long)rendered[index].sample.sentPerSecond);
+    appendHeader(text, "advancedinformation_bandwidth_received_bytes_per_second", "gauge", "Bytes per second received by the own client, averaged over the last minute");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_bandwidth_received_bytes_per_second{%s} %llu\n", rendered[index].labels, (unsigned long long)rendered[index].sample.receivedPerSecond);
+    appendHeader(text, "advancedinformation_sent_bytes_total", "counter", "Bytes sent by the own client on the connection");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_sent_bytes_total{%s} %llu\n", rendered[index].labels, (unsigned long long)rendered[index].sample.sentTotal);
+    appendHeader(text, "advancedinformation_received_bytes_total", "counter", "Bytes received by the own client on the connection");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_received_bytes_total{%s} %llu\n", rendered[index].labels, (unsigned long long)rendered[index].sample.receivedTotal);
+    appendHeader(text, "advancedinformation_sample_age_seconds", "gauge", "Time since the connection properties were sampled");
+    for (size_t index = 0; index < count; ++index) appendText(text, "advancedinformation_sample_age_seconds{%s} %.1f\n", rendered[index].labels, (double)rendered[index].ageMs / 1000.0);
+    free(rendered);
+
+    appendHeader(text, "advancedinformation_callback_duration_seconds", "histogram", "Time the plugin spent in client callbacks");
+    for (size_t slot = 0; slot < METRICS_MAX_CALLBACKS; ++slot) {
+        const char* name = atomic_load_explicit(&callbacks[slot].name, memory_order_acquire);
+        if (!name) break;
+        if (strncmp(name, "ts3plugin_", 10) == 0) name += 10;
+        uint64 cumulative = 0;
+        for (size_t bucket = 0; bucket < METRICS_BUCKET_COUNT; ++bucket) {
+            cumulative += atomic_load_explicit(&callbacks[slot].buckets[bucket], memory_order_relaxed);
+            appendText(text, "advancedinformation_callback_duration_seconds_bucket{callback=\"%s\",le=\"%g\"} %llu\n", name, (double)bucketBoundsNs[bucket] / 1e9, (unsigned long long)cumulative);
+        }
+        cumulative += atomic_load_explicit(&callbacks[slot].buckets[METRICS_BUCKET_COUNT], memory_order_relaxed);
+        appendText(text, "advancedinformation_callback_duration_seconds_bucket{callback=\"%s\",le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        appendText(text, "advancedinformation_callback_duration_seconds_sum{callback=\"%s\"} %.9f\n", name, (double)atomic_load_explicit(&callbacks[slot].sumNs, memory_order_relaxed) / 1e9);
+        appendText(text, "advancedinformation_callback_duration_seconds_count{callback=\"%s\"} %llu\n", name, (unsigned long long)cumulative);
+    }
+
+    appendHeader(text, "advancedinformation_last_write_timestamp_seconds", "gauge", "Wall clock time this file was written");
+    appendText(text, "advancedinformation_last_write_timestamp_seconds %llu\n", (unsigned long long)(timingWallclockNs() / 1000000000ULL));
+}
+
+static int writerMain(void* argument) {
+    uint64 lastWrite = 0;
+    while (atomic_load(&running)) {
+        const uint64 now = timingMonotonicMs();
+        if (lastWrite == 0 || now - lastWrite >= intervalMs) {
+            lastWrite               = now;
+            struct MetricsText text = {buffer, METRICS_BUFSIZE, 0};
+            buffer[0]               = '\0';
+            render(&text);
+            if (!storageWriteFile(METRICS_FILE, text.data, text.length)) LOG(LOG_WARNING, "metrics_write_failed", "file=%s", METRICS_FILE);
+        }
+        thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = METRICS_POLL_INTERVAL * 1000000L}, NULL);
+    }
+    return 0;
+}
+
+void metricsInit(unsigned int intervalSeconds) {
+    for (size_t slot = 0; slot < METRICS_MAX_CALLBACKS; ++slot) {
+        atomic_init(&callbacks[slot].name, NULL);
+        for (size_t bucket = 0; bucket <= METRICS_BUCKET_COUNT; ++bucket) atomic_init(&callbacks[slot].buckets[bucket], 0);
+        atomic_init(&callbacks[slot].sumNs, 0);
+    }
+    if (intervalSeconds == 0) return;
+    intervalMs = (uint64)intervalSeconds * 1000;
+    buffer     = (char*)malloc(METRICS_BUFSIZE);
+    if (!buffer) return;
+    mtx_init(&metricsMutex, mtx_plain);
+    atomic_store(&running, true);
+    if (thrd_create(&writerThread, writerMain, NULL) != thrd_success) {
+        atomic_store(&running, false);
+        mtx_destroy(&metricsMutex);
+        free(buffer);
+        buffer = NULL;
+        return;
+    }
+    atomic_store(&enabled, true);
+}
+
+void metricsShutdown(void) {
+    if (!atomic_load(&enabled)) return;
+    atomic_store(&enabled, false);
+    atomic_store(&running, false);
+    thrd_join(writerThread, NULL);
+
+    /* A stale file would keep reporting a healthy connection to the collector */
+    char path[METRICS_PATH_BUFSIZE];
+    if (storagePath(path, sizeof(path), METRICS_FILE)) remove(path);
+
+    while (servers) {
+        struct MetricsServer* next = servers->next;
+        free(servers);
+        servers = next;
+    }
+    mtx_destroy(&metricsMutex);
+    free(buffer);
+    buffer = NULL;
+}
+
+void metricsPump(uint64 serverConnectionHandlerID) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) return;
+    const uint64 now = timingMonotonicMs();
+    mtx_lock(&metricsMutex);
+    struct MetricsServer* server = getServer(serverConnectionHandlerID, true);
+    const bool            due    = server && (server->pumpedAt == 0 || now - server->pumpedAt >= intervalMs);
+    if (due) server->pumpedAt = now;
+    mtx_unlock(&metricsMutex);
+    if (!due) return;
+
+    /* Connection properties of the own client are kept by the client and need no request */
+    anyID                   ownID;
+    struct ConnectionSample sample = {0};
+    if (ts3Functions.getClientID(serverConnectionHandlerID, &ownID) != ERROR_ok) return;
+    if (ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, ownID, CONNECTION_PING, &sample.ping) != ERROR_ok) return;
+    ts3Functions.getConnectionVariableAsDouble(serverConnectionHandlerID, ownID, CONNECTION_PACKETLOSS_TOTAL, &sample.packetLoss);
+    ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, ownID, CONNECTION_BANDWIDTH_SENT_LAST_MINUTE_TOTAL, &sample.sentPerSecond);
+    ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, ownID, CONNECTION_BANDWIDTH_RECEIVED_LAST_MINUTE_TOTAL, &sample.receivedPerSecond);
+    ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, ownID, CONNECTION_BYTES_SENT_TOTAL, &sample.sentTotal);
+    ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, ownID, CONNECTION_BYTES_RECEIVED_TOTAL, &sample.receivedTotal);
+    char* text = NULL;
+    if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_NAME, &text) == ERROR_ok && text) {
+        snprintf(sample.name, sizeof(sample.name), "%s", text);
+        ts3Functions.freeMemory(text);
+    }
+    text = NULL;
+    if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_UNIQUE_IDENTIFIER, &text) == ERROR_ok && text) {
+        snprintf(sample.uniqueID, sizeof(sample.uniqueID), "%s", text);
+        ts3Functions.freeMemory(text);
+    }
+
+    mtx_lock(&metricsMutex);
+    server = getServer(serverConnectionHandlerID, false);
+    if (server) {
+        server->sample    = sample;
+        server->sampledAt = now ? now : 1;
+    }
+    mtx_unlock(&metricsMutex);
+}
+
+void metricsDropServer(uint64 serverConnectionHandlerID) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) return;
+    mtx_lock(&metricsMutex);
+    for (struct MetricsServer** link = &servers; *link; link = &(*link)->next) {
+        if ((*link)->serverConnectionHandlerID == serverConnectionHandlerID) {
+            struct MetricsServer* server = *link;
+            *link                        = server->next;
+            free(server);
+            break;
+        }
+    }
+    mtx_unlock(&metricsMutex);
+}
+
+void metricsCallback(const char* name, uint64 startedNs) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) return;
+    const uint64 elapsed = timingMonotonicNs() - startedNs;
+    for (size_t slot = 0; slot < METRICS_MAX_CALLBACKS; ++slot) {
+        const char* claimed = atomic_load_explicit(&callbacks[slot].name, memory_order_acquire);
+        if (!claimed && atomic_compare_exchange_strong(&callbacks[slot].name, &claimed, name)) claimed = name;
+        if (claimed != name) continue;
+        size_t bucket = 0;
+        while (bucket < METRICS_BUCKET_COUNT && elapsed > bucketBoundsNs[bucket]) ++bucket;
+        atomic_fetch_add_explicit(&callbacks[slot].buckets[bucket], 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&callbacks[slot].sumNs, elapsed, memory_order_relaxed);
+        return;
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Prometheus text format export of per-connection health into AdvancedInformation/advancedinformation.prom
+ *
+ * Connection properties are sampled by metricsPump on the event thread whenever the interval has passed,
+ * a background writer renders them together with client counts from the cache and callback latencies
+ * and replaces the file with a rename. An interval of 0 disables the export.
+ */
+void metricsInit(unsigned int intervalSeconds);
+void metricsShutdown(void);
+
+void metricsPump(uint64 serverConnectionHandlerID);
+void metricsDropServer(uint64 serverConnectionHandlerID);
+
+/* Adds the duration of a plugin callback since startedNs, name must be a string with static storage */
+void metricsCallback(const char* name, uint64 startedNs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
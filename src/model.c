@@ -0,0 +1,279 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "layout.h"
+#include "model.h"
+#include "plugin.h"
+#include "presence.h"
+
+/* Copies a string variable of a client, keeps the previous value on failure */
+static void readClientString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char* destination, size_t size) {
+    char* value;
+    if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, flag, &value) != ERROR_ok) return;
+    strncpy(destination, value, size - 1);
+    destination[size - 1] = '\0';
+    ts3Functions.freeMemory(value);
+}
+
+/* Counts a string variable of a client, keeps the previous value on failure */
+static void readClientTally(uint64 serverConnectionHandlerID, struct ServerCache* server, struct CachedClient* client, size_t flag, enum CacheTally tally) {
+    char* value;
+    if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, client->clientID, flag, &value) != ERROR_ok) return;
+    /* Builds of the same version are counted together */
+    char* build = flag == CLIENT_VERSION ? strstr(value, " [") : NULL;
+    if (build) *build = '\0';
+    cacheSetClientTally(server, client, tally, value);
+    ts3Functions.freeMemory(value);
+}
+
+static void readClientTallies(uint64 serverConnectionHandlerID, struct ServerCache* server, struct CachedClient* client) {
+    cacheSetClientTally(server, client, CACHE_TALLY_COUNTRY, client->country);
+    readClientTally(serverConnectionHandlerID, server, client, CLIENT_VERSION, CACHE_TALLY_VERSION);
+    readClientTally(serverConnectionHandlerID, server, client, CLIENT_PLATFORM, CACHE_TALLY_PLATFORM);
+}
+
+/* Sets a cache flag from an integer variable of a client */
+static void readClientFlag(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, unsigned int* flags, unsigned int cachedFlag) {
+    int value;
+    if (ts3Functions.getClientVariableAsInt(serverConnectionHandlerID, clientID, flag, &value) != ERROR_ok) return;
+    if (value) {
+        *flags |= cachedFlag;
+    } else {
+        *flags &= ~cachedFlag;
+    }
+}
+
+/* Sets a cache flag from an integer variable of a channel */
+static void readChannelFlag(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, unsigned int* flags, unsigned int cachedFlag) {
+    int value;
+    if (ts3Functions.getChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, &value) != ERROR_ok) return;
+    if (value) {
+        *flags |= cachedFlag;
+    } else {
+        *flags &= ~cachedFlag;
+    }
+}
+
+/* Description text without BBCode tags and line breaks, cut at a character boundary after the preview length */
+static void previewDescription(const char* description, char* preview) {
+    const char* c      = description;
+    size_t      length = 0;
+    bool        space  = false;
+    for (; *c; ++c) {
+        if (*c == '[' && strchr(c, ']')) {
+            c = strchr(c, ']');
+        } else if (isspace((unsigned char)*c)) {
+            space = length > 0;
+        } else {
+            if (length + space >= DESCRIPTION_PREVIEW_LENGTH) break;
+            if (space) preview[length++] = ' ';
+            space             = false;
+            preview[length++] = *c;
+        }
+    }
+    const bool cut = *c != '\0';
+    if (cut) {
+        size_t start = length;
+        while (start > 0 && ((unsigned char)preview[start - 1] & 0xC0) == 0x80) --start;
+        const unsigned char lead  = start > 0 ? (unsigned char)preview[start - 1] : 0;
+        const size_t        bytes = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        if (start > 0 && length - (start - 1) < bytes) length = start - 1;
+    }
+    strcpy(preview + length, cut ? "..." : "");
+}
+
+void modelLoadClient(uint64 serverConnectionHandlerID, struct ServerCache* server, anyID clientID) {
+    struct CachedClient* client = cacheGetClient(server, clientID, true);
+    if (!client) return;
+    readClientString(serverConnectionHandlerID, clientID, CLIENT_UNIQUE_IDENTIFIER, client->uniqueID, UID_BUFSIZE);
+    presenceAdd(serverConnectionHandlerID, clientID, client->uniqueID);
+    readClientString(serverConnectionHandlerID, clientID, CLIENT_NICKNAME, client->nickname, NICKNAME_BUFSIZE);
+    readClientString(serverConnectionHandlerID, clientID, CLIENT_COUNTRY, client->country, COUNTRY_BUFSIZE);
+    /* Without a tallies field the client is counted once one is shown */
+    if (layoutNeeds(LAYOUT_NEEDS_TALLIES)) {
+        readClientTallies(serverConnectionHandlerID, server, client);
+    } else {
+        server->talliesLoaded = false;
+    }
+    ts3Functions.getChannelOfClient(serverConnectionHandlerID, clientID, &client->channelID);
+    ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_DATABASE_ID, &client->databaseID);
+    int type = client->type;
+    ts3Functions.getClientVariableAsInt(serverConnectionHandlerID, clientID, CLIENT_TYPE, &type);
+    cacheSetClientType(server, client, type);
+    readClientFlag(serverConnectionHandlerID, clientID, CLIENT_AWAY, &client->flags, CACHED_CLIENT_AWAY);
+    readClientFlag(serverConnectionHandlerID, clientID, CLIENT_INPUT_MUTED, &client->flags, CACHED_CLIENT_INPUT_MUTED);
+    readClientFlag(serverConnectionHandlerID, clientID, CLIENT_OUTPUT_MUTED, &client->flags, CACHED_CLIENT_OUTPUT_MUTED);
+    readClientFlag(serverConnectionHandlerID, clientID, CLIENT_IS_TALKER, &client->flags, CACHED_CLIENT_TALKER);
+    client->loaded = true;
+}
+
+void modelLoadChannel(uint64 serverConnectionHandlerID, struct ServerCache* server, uint64 channelID) {
+    struct CachedChannel* channel = cacheGetChannel(server, channelID, true);
+    if (!channel) return;
+    char* name;
+    if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelID, CHANNEL_NAME, &name) == ERROR_ok) {
+        strncpy(channel->name, name, CHANNELNAME_BUFSIZE - 1);
+        channel->name[CHANNELNAME_BUFSIZE - 1] = '\0';
+        ts3Functions.freeMemory(name);
+    }
+    ts3Functions.getParentChannelOfChannel(serverConnectionHandlerID, channelID, &channel->parentID);
+    ts3Functions.getChannelVariableAsUInt64(serverConnectionHandlerID, channelID, CHANNEL_ORDER, &channel->order);
+    ts3Functions.getChannelVariableAsInt(serverConnectionHandlerID, channelID, CHANNEL_MAXCLIENTS, &channel->maxClients);
+    readChannelFlag(serverConnectionHandlerID, channelID, CHANNEL_FLAG_PERMANENT, &channel->flags, CACHED_CHANNEL_PERMANENT);
+    readChannelFlag(serverConnectionHandlerID, channelID, CHANNEL_FLAG_SEMI_PERMANENT, &channel->flags, CACHED_CHANNEL_SEMI_PERMANENT);
+    readChannelFlag(serverConnectionHandlerID, channelID, CHANNEL_FLAG_DEFAULT, &channel->flags, CACHED_CHANNEL_DEFAULT);
+    readChannelFlag(serverConnectionHandlerID, channelID, CHANNEL_FLAG_PASSWORD, &channel->flags, CACHED_CHANNEL_PASSWORD);
+}
+
+/* Connection and cache of the clients being counted */
+struct TallyPass {
+    uint64              serverConnectionHandlerID;
+    struct ServerCache* server;
+};
+
+static void tallyClient(struct CachedClient* client, void* context) {
+    const struct TallyPass* pass = (const struct TallyPass*)context;
+    if (client->loaded) readClientTallies(pass->serverConnectionHandlerID, pass->server, client);
+}
+
+void modelLoadTallies(uint64 serverConnectionHandlerID, struct ServerCache* server) {
+    if (server->talliesLoaded) return;
+    struct TallyPass pass = {serverConnectionHandlerID, server};
+    cacheForEachClient(server, tallyClient, &pass);
+    server->talliesLoaded = true;
+}
+
+bool modelLoadChannelDescription(uint64 serverConnectionHandlerID, struct ServerCache* server, struct CachedChannel* channel, bool answered) {
+    char* description;
+    if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channel->channelID, CHANNEL_DESCRIPTION, &description) != ERROR_ok) return false;
+    char preview[DESCRIPTION_BUFSIZE];
+    previewDescription(description, preview);
+    ts3Functions.freeMemory(description);
+    return (preview[0] || answered) && cacheSetChannelDescription(server, channel, preview);
+}
+
+bool modelLoadIdentity(uint64 serverConnectionHandlerID, anyID clientID, struct IdentityRecord* identity) {
+    uint64 databaseID = 0, created = 0, lastConnected = 0, totalConnections = 0;
+    ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_DATABASE_ID, &databaseID);
+    ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_CREATED, &created);
+    ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_LASTCONNECTED, &lastConnected);
+    ts3Functions.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, CLIENT_TOTALCONNECTIONS, &totalConnections);
+    /* Every identity has connected once, 0 means the variables have not arrived */
+    if (totalConnections == 0) return false;
+    identity->databaseID       = databaseID;
+    identity->created          = created;
+    identity->lastConnected    = lastConnected;
+    identity->totalConnections = totalConnections;
+    char* description;
+    if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, CLIENT_DESCRIPTION, &description) == ERROR_ok) {
+        previewDescription(description, identity->description);
+        ts3Functions.freeMemory(description);
+    }
+    return true;
+}
+
+void modelPopulate(uint64 serverConnectionHandlerID) {
+    uint64* channels = NULL;
+    anyID*  clients  = NULL;
+
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, true);
+    if (server && ts3Functions.getChannelList(serverConnectionHandlerID, &channels) == ERROR_ok) {
+        for (uint64* channel = channels; *channel; ++channel) modelLoadChannel(serverConnectionHandlerID, server, *channel);
+        ts3Functions.freeMemory(channels);
+    }
+    if (server && ts3Functions.getClientList(serverConnectionHandlerID, &clients) == ERROR_ok) {
+        /* Every client is loaded below, a client loaded without tallies clears this again */
+        server->talliesLoaded = layoutNeeds(LAYOUT_NEEDS_TALLIES);
+        for (anyID* client = clients; *client; ++client) modelLoadClient(serverConnectionHandlerID, server, *client);
+        ts3Functions.freeMemory(clients);
+        server->populated = true;
+    }
+    cacheUnlock();
+}
+
+void modelClientMoved(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID) {
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(serverConnectionHandlerID, true);
+    struct CachedClient* client = server ? cacheGetClient(server, clientID, true) : NULL;
+    if (client && !client->loaded) {
+        modelLoadClient(serverConnectionHandlerID, server, clientID);
+    } else if (client) {
+        client->channelID = newChannelID;
+    }
+    cacheUnlock();
+}
+
+void modelClientLeft(uint64 serverConnectionHandlerID, anyID clientID) {
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedClient* client = server ? cacheGetClient(server, clientID, false) : NULL;
+    if (client) {
+        presenceRemove(serverConnectionHandlerID, clientID, client->uniqueID);
+        cacheRemoveClient(server, clientID);
+    }
+    cacheUnlock();
+}
+
+bool modelClientUpdated(uint64 serverConnectionHandlerID, anyID clientID) {
+    bool renamed = false;
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(serverConnectionHandlerID, true);
+    struct CachedClient* client = server ? cacheGetClient(server, clientID, true) : NULL;
+    if (client) {
+        char       nickname[NICKNAME_BUFSIZE];
+        const bool loaded = client->loaded;
+        memcpy(nickname, client->nickname, NICKNAME_BUFSIZE);
+        modelLoadClient(serverConnectionHandlerID, server, clientID);
+        renamed = loaded && strcmp(nickname, client->nickname) != 0;
+    }
+    cacheUnlock();
+    return renamed;
+}
+
+void modelChannelUpdated(uint64 serverConnectionHandlerID, uint64 channelID) {
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, true);
+    if (server) modelLoadChannel(serverConnectionHandlerID, server, channelID);
+    cacheUnlock();
+}
+
+void modelChannelMoved(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newParentID) {
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel) {
+        channel->parentID = newParentID;
+        ts3Functions.getChannelVariableAsUInt64(serverConnectionHandlerID, channelID, CHANNEL_ORDER, &channel->order);
+    }
+    cacheUnlock();
+}
+
+void modelChannelDeleted(uint64 serverConnectionHandlerID, uint64 channelID) {
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server) cacheRemoveChannel(server, channelID);
+    cacheUnlock();
+}
+
+void modelChannelActivity(uint64 serverConnectionHandlerID, anyID clientID, uint64 channelID) {
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server && channelID == 0) {
+        struct CachedClient* client = cacheGetClient(server, clientID, false);
+        if (client) channelID = client->channelID;
+    }
+    struct CachedChannel* channel = server && channelID ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel) cacheAddChannelActivity(server, channel, 1.0);
+    cacheUnlock();
+}
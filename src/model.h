@@ -0,0 +1,49 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Reads all channels and clients of a connection into the cache */
+void modelPopulate(uint64 serverConnectionHandlerID);
+
+/* Incremental cache maintenance from client events */
+void modelClientMoved(uint64 serverConnectionHandlerID, anyID clientID, uint64 newChannelID);
+void modelClientLeft(uint64 serverConnectionHandlerID, anyID clientID);
+bool modelClientUpdated(uint64 serverConnectionHandlerID, anyID clientID); /* Returns true if the nickname changed */
+void modelChannelUpdated(uint64 serverConnectionHandlerID, uint64 channelID);
+void modelChannelMoved(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newParentID);
+void modelChannelDeleted(uint64 serverConnectionHandlerID, uint64 channelID);
+
+/* Adds a join or talk burst of a client to the heat of a channel, channel 0 uses the cached channel of the client */
+void modelChannelActivity(uint64 serverConnectionHandlerID, anyID clientID, uint64 channelID);
+
+/* Readers for callers that already hold the cache lock */
+void modelLoadClient(uint64 serverConnectionHandlerID, struct ServerCache* server, anyID clientID);
+void modelLoadChannel(uint64 serverConnectionHandlerID, struct ServerCache* server, uint64 channelID);
+
+/* Counts the clients loaded while no tallies field was shown, does nothing if all of them are counted */
+void modelLoadTallies(uint64 serverConnectionHandlerID, struct ServerCache* server);
+
+/*
+ * Caches a preview of the description the client has for a channel, returns false while it is unknown.
+ * The client has an empty description for channels it never fetched, so only the answer to a request caches an empty preview.
+ */
+bool modelLoadChannelDescription(uint64 serverConnectionHandlerID, struct ServerCache* server, struct CachedChannel* channel, bool answered);
+
+/* Reads requested client variables into the identity record of the client, returns false while they have not arrived */
+bool modelLoadIdentity(uint64 serverConnectionHandlerID, anyID clientID, struct IdentityRecord* identity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "ts3_functions.h"
+
+#include "notify.h"
+#include "plugin.h"
+#include "timing.h"
+
+#define NOTIFY_QUEUE_SIZE 16
+#define NOTIFY_MESSAGE_BUFSIZE 1024
+#define NOTIFY_DISPLAY_BUFSIZE (NOTIFY_MESSAGE_BUFSIZE + 64)
+#define NOTIFY_COALESCE_INTERVAL 2000
+
+/* Recently shown message */
+struct Notification {
+    uint64       serverConnectionHandlerID;
+    uint64       shownAt; /* Monotonic milliseconds, 0 if the slot is free */
+    unsigned int repeats; /* Collapsed since the message was last shown */
+    char         message[NOTIFY_MESSAGE_BUFSIZE];
+};
+
+static mtx_t               notifyMutex;
+static struct Notification recent[NOTIFY_QUEUE_SIZE];
+
+static void display(uint64 serverConnectionHandlerID, const char* message) {
+    int status = STATUS_DISCONNECTED;
+    if (serverConnectionHandlerID != 0 && ts3Functions.getConnectionStatus(serverConnectionHandlerID, &status) == ERROR_ok && status != STATUS_DISCONNECTED) {
+        ts3Functions.printMessage(serverConnectionHandlerID, message, PLUGIN_MESSAGE_TARGET_SERVER);
+    } else {
+        ts3Functions.printMessageToCurrentTab(message);
+    }
+}
+
+/* Message text followed by the number of collapsed repeats */
+static void formatNotification(char* text, size_t size, const struct Notification* notification) {
+    if (notification->repeats == 0) {
+        snprintf(text, size, "%s", notification->message);
+    } else {
+        snprintf(text, size, "%s [i](repeated %u times)[/i]", notification->message, notification->repeats);
+    }
+}
+
+void notifyInit(void) {
+    mtx_init(&notifyMutex, mtx_plain);
+    memset(recent, 0, sizeof(recent));
+}
+
+void notifyShutdown(void) {
+    mtx_destroy(&notifyMutex);
+}
+
+void notifyPost(uint64 serverConnectionHandlerID, const char* message) {
+    char         text[NOTIFY_DISPLAY_BUFSIZE];
+    char         displaced[NOTIFY_DISPLAY_BUFSIZE];
+    uint64       displacedServer = 0;
+    bool         showDisplaced   = false;
+    const uint64 now             = timingMonotonicMs();
+
+    mtx_lock(&notifyMutex);
+    struct Notification* slot   = NULL;
+    struct Notification* oldest = &recent[0];
+    for (size_t index = 0; index < NOTIFY_QUEUE_SIZE && !slot; ++index) {
+        struct Notification* notification = &recent[index];
+        if (notification->shownAt != 0 && notification->serverConnectionHandlerID == serverConnectionHandlerID && strncmp(notification->message, message, NOTIFY_MESSAGE_BUFSIZE - 1) == 0) {
+            slot = notification;
+        } else if (notification->shownAt < oldest->shownAt) {
+            oldest = notification;
+        }
+    }
+    if (slot && now - slot->shownAt < NOTIFY_COALESCE_INTERVAL) {
+        ++slot->repeats;
+        mtx_unlock(&notifyMutex);
+        return;
+    }
+    if (!slot) {
+        /* Repeats of the displaced message would be lost otherwise */
+        slot = oldest;
+        if (slot->shownAt != 0 && slot->repeats > 0) {
+            formatNotification(displaced, sizeof(displaced), slot);
+            displacedServer = slot->serverConnectionHandlerID;
+            showDisplaced   = true;
+        }
+        slot->serverConnectionHandlerID = serverConnectionHandlerID;
+        slot->repeats                   = 0;
+        snprintf(slot->message, NOTIFY_MESSAGE_BUFSIZE, "%s", message);
+    }
+    formatNotification(text, sizeof(text), slot);
+    slot->shownAt = now;
+    slot->repeats = 0;
+    mtx_unlock(&notifyMutex);
+
+    if (showDisplaced) display(displacedServer, displaced);
+    display(serverConnectionHandlerID, text);
+}
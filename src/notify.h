@@ -0,0 +1,32 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Local status messages of the plugin
+ *
+ * Messages are printed into the server tab of a connection, or the current tab without a connection,
+ * and never leave the client. A message repeated within the coalescing interval is collapsed, the
+ * number of collapsed repeats is shown with the next display of the same message.
+ */
+
+void notifyInit(void);
+void notifyShutdown(void);
+
+void notifyPost(uint64 serverConnectionHandlerID, const char* message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
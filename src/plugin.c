@@ -9,10 +9,12 @@
 #endif
 
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 #include "teamspeak/public_definitions.h"
 #include "teamspeak/public_errors.h"
@@ -20,9 +22,30 @@
 #include "teamspeak/public_rare_definitions.h"
 #include "ts3_functions.h"
 
+#include "address.h"
+#include "bans.h"
+#include "cache.h"
+#include "escape.h"
+#include "exchange.h"
+#include "journal.h"
+#include "layout.h"
+#include "log.h"
+#include "metrics.h"
+#include "model.h"
+#include "notify.h"
 #include "plugin.h"
+#include "presence.h"
+#include "query.h"
+#include "recorder.h"
+#include "settings.h"
+#include "snapshot.h"
+#include "storage.h"
+#include "talk.h"
+#include "timing.h"
+#include "voice.h"
+#include "warmup.h"
 
-static struct TS3Functions ts3Functions;
+struct TS3Functions ts3Functions;
 
 #ifdef _WIN32
 #define _strcpy(dest, destSize, src) strcpy_s(dest, destSize, src)
@@ -39,13 +62,43 @@ static struct TS3Functions ts3Functions;
 
 #define PATH_BUFSIZE 512
 #define COMMAND_BUFSIZE 128
-#define INFODATA_BUFSIZE 128
-#define SERVERINFO_BUFSIZE 256
-#define CHANNELINFO_BUFSIZE 512
+#define SERVERINFO_BUFSIZE 2048
+#define CHANNELINFO_BUFSIZE 1024
 #define RETURNCODE_BUFSIZE 128
+#define CLIENTINFO_BUFSIZE 1536
+#define FIELD_BUFSIZE 256
 
-static char* pluginID = NULL;
+#define CONNECTION_STATS_TTL 5000
+#define REQUEST_RETRY_INTERVAL 10000
+
+/* Default cache budgets in KiB, overridden by cache_server_budget_kb and cache_global_budget_kb */
+#define CACHE_SERVER_BUDGET_KB 8192
+#define CACHE_GLOBAL_BUDGET_KB 32768
+#define CHANNEL_HEAT_HALF_LIFE_S 300
+#define CHANNEL_DESCRIPTION_CACHE_KB 64
+#define HOTTEST_CHANNELS_SHOWN 5
+#define TALLY_VALUES_SHOWN 5
+#define SAME_ADDRESS_SHOWN 8
+#define QUERY_CLIENTS_SHOWN 10
+#define OTHER_CONNECTIONS_SHOWN 4
+#define ADDRESS_REQUESTS_PER_SECOND 4
+#define BAN_LIST_LIMIT 1000
+#define METRICS_INTERVAL_S 15
+#define QUERY_SOCKET_ENABLED 0
+#define JOURNAL_ENABLED 1
+#define JOURNAL_RETENTION_DAYS 90
+#define WARMUP_THREAD 1
+#define LOG_LEVEL LOG_INFO
+#define LOG_CLIENT 1
+#define LOG_FILE_KB 0
+#define LOUD_VOICE_DBFS 14
+#define VOICE_LOUDNESS_SHOWN_MS 600000
+
+char* pluginID = NULL;
 static boolean enabled = false;
+static unsigned int loudVoiceDbfs = LOUD_VOICE_DBFS;
+static size_t descriptionCacheBytes = CHANNEL_DESCRIPTION_CACHE_KB * 1024;
+static char banListReturnCode[RETURNCODE_BUFSIZE] = ""; /* One code for every ban list request, answers are told apart by their connection */
 
 /*********************************** Required functions ************************************/
 
@@ -86,28 +139,82 @@ int ts3plugin_init() {
     char configPath[PATH_BUFSIZE];
     char pluginPath[PATH_BUFSIZE];
 
-    printf("[%s] Loading plugin...\n", ts3plugin_name());
+    recorderInit();
+    recorderEntry(RECORD_ENTRY_INIT, "");
 
     ts3Functions.getAppPath(appPath, PATH_BUFSIZE);
     ts3Functions.getResourcesPath(resourcesPath, PATH_BUFSIZE);
     ts3Functions.getConfigPath(configPath, PATH_BUFSIZE);
     ts3Functions.getPluginPath(pluginPath, PATH_BUFSIZE, pluginID);
 
+    storageInit(configPath);
+    settingsLoad();
+    logInit((enum LogVerbosity)settingsGetUnsigned("log_level", LOG_LEVEL), settingsGetUnsigned("log_client", LOG_CLIENT) != 0, (size_t)settingsGetUnsigned("log_file_kb", LOG_FILE_KB) * 1024);
+    escapeSelectKernel(ESCAPE_KERNEL_AUTO);
+    cacheInit();
+    presenceInit();
+    notifyInit();
+    talkInit();
+    bansInit();
+    voiceInit();
+    loudVoiceDbfs = (unsigned int)settingsGetUnsigned("loud_voice_dbfs", LOUD_VOICE_DBFS);
+    addressInit(settingsGetUnsigned("address_requests_per_second", ADDRESS_REQUESTS_PER_SECOND));
+    cacheSetBudgets((size_t)settingsGetUnsigned("cache_server_budget_kb", CACHE_SERVER_BUDGET_KB) * 1024, (size_t)settingsGetUnsigned("cache_global_budget_kb", CACHE_GLOBAL_BUDGET_KB) * 1024);
+    cacheSetHeatHalfLife((uint64)settingsGetUnsigned("channel_heat_half_life_s", CHANNEL_HEAT_HALF_LIFE_S) * 1000);
+    descriptionCacheBytes = (size_t)settingsGetUnsigned("channel_description_cache_kb", CHANNEL_DESCRIPTION_CACHE_KB) * 1024;
+    cacheSetDescriptionBudget(descriptionCacheBytes);
+    exchangeInit();
+    journalInit(settingsGetUnsigned("journal", JOURNAL_ENABLED) != 0, (unsigned int)settingsGetUnsigned("journal_retention_days", JOURNAL_RETENTION_DAYS));
+    metricsInit((unsigned int)settingsGetUnsigned("metrics_interval_s", METRICS_INTERVAL_S));
+    queryInit(settingsGetUnsigned("query_socket", QUERY_SOCKET_ENABLED) != 0);
+    layoutInit();
+    /* Recorded host calls have to belong to the entry point that made them */
+    warmupInit(settingsGetUnsigned("warmup_thread", WARMUP_THREAD) != 0 && !recorderActive());
+    warmupAll();
+    LOG(LOG_INFO, "plugin_loaded", "version=%s api=%d escape_kernel=%s voice_kernel=%s", ts3plugin_version(), ts3plugin_apiVersion(), escapeKernelName(escapeActiveKernel()), voiceKernelName(voiceActiveKernel()));
+
     return 0;
 }
 
 /* Plugin unloading function */
 void ts3plugin_shutdown() {
-    printf("[%s] Unloading plugin...\n", ts3plugin_name());
+    recorderEntry(RECORD_ENTRY_SHUTDOWN, "");
+    LOG(LOG_INFO, "plugin_unloading", "");
+
+    queryShutdown();
+    warmupShutdown();
+    metricsShutdown();
+    journalShutdown();
+    exchangeShutdown();
+    notifyShutdown();
+    addressShutdown();
+    voiceShutdown();
+    bansShutdown();
+    talkShutdown();
+    presenceShutdown();
+    cacheShutdown();
+    layoutShutdown();
+    logShutdown();
 
     if (pluginID) {
         free(pluginID);
         pluginID = NULL;
     }
+    recorderShutdown();
 }
 
 /*********************************** Optional functions ************************************/
 
+/* Field selection is edited in a text file opened in the system editor */
+int ts3plugin_offersConfigure() {
+    return PLUGIN_OFFERS_CONFIGURE_NEW_THREAD;
+}
+
+/* Opens the field selection, changes are picked up when the file is saved */
+void ts3plugin_configure(void* handle, void* qParentWidget) {
+    if (!layoutEdit()) LOG(LOG_WARNING, "layout_edit_failed", "");
+}
+
 /* Registering plugin id */
 void ts3plugin_registerPluginID(const char* id) {
     const size_t sz = strlen(id) + 1;
@@ -125,37 +232,519 @@ const char* ts3plugin_infoTitle() {
     return "Advanced Information";
 }
 
+/* Appends formatted text to an info buffer, returns the new length */
+static size_t appendInfo(char* info, size_t size, size_t length, const char* format, ...) {
+    if (length >= size) return length;
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(info + length, size - length, format, args);
+    va_end(args);
+    if (written < 0) return length;
+    return length + (size_t)written < size ? length + (size_t)written : size - 1;
+}
+
+/* Host text like nicknames and channel names, escaped so it cannot break the frame markup */
+static size_t appendText(char* info, size_t size, size_t length, const char* text) {
+    if (length >= size) return length;
+    return length + escapeBBCode(info + length, size - length, text);
+}
+
+/* Duration in seconds as readable text */
+static void formatDuration(char* text, size_t size, uint64 seconds) {
+    if (seconds >= 86400) {
+        snprintf(text, size, "%llud %02lluh %02llum", (unsigned long long)(seconds / 86400), (unsigned long long)(seconds % 86400 / 3600), (unsigned long long)(seconds % 3600 / 60));
+    } else {
+        snprintf(text, size, "%lluh %02llum %02llus", (unsigned long long)(seconds / 3600), (unsigned long long)(seconds % 3600 / 60), (unsigned long long)(seconds % 60));
+    }
+}
+
+/* Unix time as readable local date */
+static void formatDate(char* text, size_t size, uint64 unixTime) {
+    const time_t     time  = (time_t)unixTime;
+    const struct tm* local = localtime(&time);
+    if (!local || strftime(text, size, "%Y-%m-%d %H:%M", local) == 0) snprintf(text, size, "%llu", (unsigned long long)unixTime);
+}
+
+/* Memory use as "<used> of <budget>" in KiB */
+static void formatBudget(char* text, size_t size, const struct CacheUsage* usage) {
+    if (usage->budget == 0) {
+        snprintf(text, size, "%zu KiB, no budget", usage->totalBytes / 1024);
+    } else {
+        snprintf(text, size, "%zu of %zu KiB", usage->totalBytes / 1024, usage->budget / 1024);
+    }
+}
+
+/* Cache memory of a connection and of all connections */
+static size_t appendCacheUsage(uint64 serverConnectionHandlerID, char* info, size_t size, size_t length) {
+    struct CacheUsage serverUsage;
+    struct CacheUsage globalUsage;
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server) cacheGetUsage(server, &serverUsage);
+    cacheGetUsage(NULL, &globalUsage);
+    cacheUnlock();
+    if (!server) return length;
+
+    char serverBudget[FIELD_BUFSIZE];
+    char globalBudget[FIELD_BUFSIZE];
+    formatBudget(serverBudget, sizeof(serverBudget), &serverUsage);
+    formatBudget(globalBudget, sizeof(globalBudget), &globalUsage);
+    return appendInfo(info, size, length, "\n\n[b]Cache:[/b] %s (clients %zu KiB, channels %zu KiB, descriptions %zu KiB, %zu identities %zu KiB, %llu evicted)\n\n[b]Cache of all servers:[/b] %s (%llu evicted)", serverBudget,
+                      serverUsage.bytes[CACHE_SUBSYSTEM_CLIENTS] / 1024, serverUsage.bytes[CACHE_SUBSYSTEM_CHANNELS] / 1024, serverUsage.bytes[CACHE_SUBSYSTEM_DESCRIPTIONS] / 1024, serverUsage.identityCount,
+                      serverUsage.bytes[CACHE_SUBSYSTEM_IDENTITIES] / 1024, (unsigned long long)serverUsage.evictions, globalBudget, (unsigned long long)globalUsage.evictions);
+}
+
+/* Channels with the most recent joins and talk bursts of a connection */
+static size_t appendHottestChannels(uint64 serverConnectionHandlerID, char* info, size_t size, size_t length) {
+    cacheLock();
+    struct ServerCache*   server = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedChannel* hottest[HOTTEST_CHANNELS_SHOWN];
+    const size_t          count  = server ? cacheGetHottestChannels(server, hottest, HOTTEST_CHANNELS_SHOWN) : 0;
+    if (count != 0) length = appendInfo(info, size, length, "\n\n[b]Hottest channels:[/b]");
+    for (size_t index = 0; index < count; ++index) {
+        length = appendInfo(info, size, length, "\n%zu. ", index + 1);
+        length = appendText(info, size, length, hottest[index]->name);
+        length = appendInfo(info, size, length, " (%.1f)", cacheGetChannelHeat(server, hottest[index]));
+    }
+    cacheUnlock();
+    return length;
+}
+
+/* Visible query clients with the time they connected, or came into view if their connection info is unknown */
+static size_t appendQueryClients(uint64 serverConnectionHandlerID, char* info, size_t size, size_t length) {
+    const uint64 now = timingMonotonicMs();
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server && server->queryCount != 0) {
+        length       = appendInfo(info, size, length, "\n\n[b]Visible queries:[/b] %zu", server->queryCount);
+        size_t shown = 0;
+        for (const struct CachedClient* client = server->queryClients; client && shown < QUERY_CLIENTS_SHOWN; client = client->queryNext, ++shown) {
+            const struct ConnectionStats* stats = &client->stats;
+            const bool                    known = stats->updatedAt != 0;
+            char                          since[FIELD_BUFSIZE];
+            formatDate(since, sizeof(since), known ? (uint64)time(NULL) - stats->connectedTime - (now - stats->updatedAt) / 1000 : client->seenAt);
+            length = appendText(info, size, appendInfo(info, size, length, "\n"), client->nickname);
+            length = appendInfo(info, size, length, " (ID %u, %s %s)", (unsigned int)client->clientID, known ? "connected" : "in view since", since);
+        }
+        if (server->queryCount > shown) length = appendInfo(info, size, length, "\nand %zu more", server->queryCount - shown);
+    }
+    cacheUnlock();
+    return length;
+}
+
+/* Most common versions, platforms and countries of the present clients */
+static size_t appendClientTallies(uint64 serverConnectionHandlerID, char* info, size_t size, size_t length) {
+    static const char* titles[CACHE_TALLY_COUNT] = {"Versions", "Platforms", "Countries", NULL};
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server) modelLoadTallies(serverConnectionHandlerID, server);
+    for (size_t tally = 0; server && tally < CACHE_TALLY_COUNT; ++tally) {
+        if (!titles[tally]) continue;
+        const struct TallyKey* keys[TALLY_VALUES_SHOWN];
+        const size_t           count = cacheGetTally(server, (enum CacheTally)tally, keys, TALLY_VALUES_SHOWN);
+        if (count == 0) continue;
+        length = appendInfo(info, size, length, "\n\n[b]%s:[/b] ", titles[tally]);
+        for (size_t index = 0; index < count && index < TALLY_VALUES_SHOWN; ++index) {
+            length = appendText(info, size, appendInfo(info, size, length, "%s", index ? ", " : ""), keys[index]->value);
+            length = appendInfo(info, size, length, " (%zu)", keys[index]->clients);
+        }
+        if (count > TALLY_VALUES_SHOWN) length = appendInfo(info, size, length, ", %zu more", count - TALLY_VALUES_SHOWN);
+        length = appendInfo(info, size, length, " - %zu of %zu clients known", server->tallied[tally], server->clientCount);
+    }
+    cacheUnlock();
+    return length;
+}
+
+/* Size of the compiled ban list of a connection */
+static size_t appendBanCounts(uint64 serverConnectionHandlerID, char* info, size_t size, size_t length) {
+    size_t rules;
+    size_t skipped;
+    if (bansDenied(serverConnectionHandlerID)) return appendInfo(info, size, length, "\n\n[b]Ban list:[/b] not permitted");
+    bansGetCounts(serverConnectionHandlerID, &rules, &skipped);
+    if (rules == 0) return length;
+    length = appendInfo(info, size, length, "\n\n[b]Ban list:[/b] %zu rules", rules);
+    if (skipped != 0) length = appendInfo(info, size, length, ", %zu with unsupported patterns", skipped);
+    return length;
+}
+
+/* Decayed activity of a channel and its rank among the hottest channels */
+static size_t appendChannelHeat(uint64 serverConnectionHandlerID, uint64 channelID, char* info, size_t size, size_t length) {
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel && channel->heat > 0) {
+        struct CachedChannel* hottest[CACHE_HOTTEST_COUNT];
+        const size_t          count = channel->hottestSlot ? cacheGetHottestChannels(server, hottest, CACHE_HOTTEST_COUNT) : 0;
+        size_t                rank  = 0;
+        while (rank < count && hottest[rank] != channel) ++rank;
+        if (rank < count) {
+            length = appendInfo(info, size, length, "\n\n[b]Activity:[/b] %.1f (#%zu on this server)", cacheGetChannelHeat(server, channel), rank + 1);
+        } else {
+            length = appendInfo(info, size, length, "\n\n[b]Activity:[/b] %.1f", cacheGetChannelHeat(server, channel));
+        }
+    }
+    cacheUnlock();
+    return length;
+}
+
+/* State shared by the fields of one client frame */
+struct ClientFrame {
+    uint64      serverConnectionHandlerID;
+    anyID       clientID;
+    const char* uniqueID; /* NULL unless a field of the plan needs it */
+    bool        requestStats;
+    bool        requestIdentity;
+    char        address[FIELD_BUFSIZE];
+    char        nickname[NICKNAME_BUFSIZE];
+};
+
+/* Creates the cache entry of the client and selects it, so data arriving for it refreshes the frame */
+static void prepareCachedClient(struct ClientFrame* frame) {
+    exchangeFlushDue(frame->serverConnectionHandlerID);
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(frame->serverConnectionHandlerID, true);
+    struct CachedClient* client = server ? cacheGetClient(server, frame->clientID, true) : NULL;
+    if (client) {
+        server->selectedType = PLUGIN_CLIENT;
+        server->selectedID   = frame->clientID;
+        if (frame->uniqueID) _strcpy(client->uniqueID, UID_BUFSIZE, frame->uniqueID);
+        _strcpy(frame->address, FIELD_BUFSIZE, client->tallies[CACHE_TALLY_ADDRESS] ? client->tallies[CACHE_TALLY_ADDRESS]->value : "");
+        _strcpy(frame->nickname, NICKNAME_BUFSIZE, client->nickname);
+    }
+    cacheUnlock();
+}
+
+/* Cached ping, packet loss and connection time, requests them if missing or stale */
+static size_t appendConnection(struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    const uint64 now = timingMonotonicMs();
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(frame->serverConnectionHandlerID, false);
+    struct CachedClient* client = server ? cacheGetClient(server, frame->clientID, false) : NULL;
+    if (client) {
+        struct ConnectionStats* stats = &client->stats;
+        if (now - stats->updatedAt >= CONNECTION_STATS_TTL && (stats->requestedAt <= stats->updatedAt || now - stats->requestedAt >= REQUEST_RETRY_INTERVAL)) {
+            stats->requestedAt  = now;
+            frame->requestStats = true;
+        }
+        if (stats->updatedAt != 0) {
+            char connected[FIELD_BUFSIZE];
+            formatDuration(connected, sizeof(connected), stats->connectedTime + (now - stats->updatedAt) / 1000);
+            length = appendInfo(info, size, length, "\n\n[b]Ping:[/b] %llu ms\n\n[b]Packet loss:[/b] %.2f %%\n\n[b]Connected:[/b] %s", (unsigned long long)stats->ping, stats->packetLoss, connected);
+        }
+    }
+    cacheUnlock();
+    return length;
+}
+
+/* Other visible clients with the same IP address */
+static size_t appendSameAddress(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    cacheLock();
+    struct ServerCache*        server = cacheGetServer(frame->serverConnectionHandlerID, false);
+    struct CachedClient*       client = server ? cacheGetClient(server, frame->clientID, false) : NULL;
+    const struct CachedClient* sameAddress[SAME_ADDRESS_SHOWN];
+    const size_t               count = client ? cacheGetSameAddress(client, sameAddress, SAME_ADDRESS_SHOWN) : 0;
+    if (count != 0) {
+        length = appendInfo(info, size, length, "\n\n[b]Same IP:[/b] ");
+        for (size_t index = 0; index < count && index < SAME_ADDRESS_SHOWN; ++index) length = appendText(info, size, appendInfo(info, size, length, "%s", index ? ", " : ""), sameAddress[index]->nickname);
+        if (count > SAME_ADDRESS_SHOWN) length = appendInfo(info, size, length, " and %zu more", count - SAME_ADDRESS_SHOWN);
+    }
+    cacheUnlock();
+    return length;
+}
+
+static size_t appendDatabaseID(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    uint64 databaseID = 0;
+    ts3Functions.getClientVariableAsUInt64(frame->serverConnectionHandlerID, frame->clientID, CLIENT_DATABASE_ID, &databaseID);
+    if (databaseID == 0) return length;
+    return appendInfo(info, size, length, "\n\n[b]DatabaseID:[/b] %llu", (unsigned long long)databaseID);
+}
+
+/* Cached first and last connection and description of the identity, requests them if missing */
+static size_t appendIdentity(struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    const uint64 now = timingMonotonicMs();
+    cacheLock();
+    struct ServerCache*    server   = cacheGetServer(frame->serverConnectionHandlerID, false);
+    struct IdentityRecord* identity = server ? cacheGetIdentity(server, frame->uniqueID, true) : NULL;
+    if (identity && identity->updatedAt != 0) {
+        char created[FIELD_BUFSIZE];
+        char lastConnected[FIELD_BUFSIZE];
+        formatDate(created, sizeof(created), identity->created);
+        formatDate(lastConnected, sizeof(lastConnected), identity->lastConnected);
+        length = appendInfo(info, size, length, "\n\n[b]First connection:[/b] %s\n\n[b]Last connection:[/b] %s\n\n[b]Total connections:[/b] %llu", created, lastConnected, (unsigned long long)identity->totalConnections);
+        if (identity->description[0]) length = appendText(info, size, appendInfo(info, size, length, "\n\n[b]Description:[/b] "), identity->description);
+    }
+    /* Shared data is shown until it expires and the own request returns */
+    if (identity && (identity->updatedAt == 0 || (identity->shared && now - identity->updatedAt >= SHARED_IDENTITY_TTL)) && (identity->requestedAt == 0 || now - identity->requestedAt >= REQUEST_RETRY_INTERVAL)) {
+        identity->requestedAt  = now;
+        frame->requestIdentity = true;
+    }
+    cacheUnlock();
+    return length;
+}
+
+static size_t appendTalk(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    struct TalkStats talk;
+    if (!talkGetStats(frame->serverConnectionHandlerID, frame->clientID, &talk)) return length;
+    char talkTime[FIELD_BUFSIZE];
+    char longest[FIELD_BUFSIZE];
+    formatDuration(talkTime, sizeof(talkTime), talk.talkMs / 1000);
+    formatDuration(longest, sizeof(longest), talk.longestMs / 1000);
+    return appendInfo(info, size, length, "\n\n[b]Talk time:[/b] %s in %llu bursts, longest %s", talkTime, (unsigned long long)talk.bursts, longest);
+}
+
+/* Levels of the own microphone, only shown on the own client */
+static size_t appendMicrophone(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    anyID              ownID = 0;
+    struct VoiceLevels voice;
+    if (ts3Functions.getClientID(frame->serverConnectionHandlerID, &ownID) != ERROR_ok || ownID != frame->clientID || !voiceGetCaptured(frame->serverConnectionHandlerID, &voice)) return length;
+    length = appendInfo(info, size, length, "\n\n[b]Microphone:[/b] RMS %.1f dBFS, peak %.1f dBFS, clipping %.2f %%", voice.rmsDb, voice.peakDb, voice.clipRatio * 100.0);
+    if (voice.hasFloor) length = appendInfo(info, size, length, ", noise floor %.1f dBFS", voice.floorDb);
+    return length;
+}
+
+static size_t appendLoudness(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    struct VoiceLoudness loudness;
+    if (!voiceGetPlayback(frame->serverConnectionHandlerID, frame->clientID, &loudness) || loudness.ageMs > VOICE_LOUDNESS_SHOWN_MS) return length;
+    char heard[FIELD_BUFSIZE];
+    formatDuration(heard, sizeof(heard), loudness.ageMs / 1000);
+    length = appendInfo(info, size, length, "\n\n[b]Voice loudness:[/b] %.1f dBFS short-term, peak %.1f dBFS, heard %s ago", loudness.loudnessDb, loudness.peakDb, heard);
+    if (loudness.loudnessDb > -(double)loudVoiceDbfs) length = appendInfo(info, size, length, " [color=red](too loud)[/color]");
+    return length;
+}
+
+/* Other server tabs the identity is connected to */
+static size_t appendOtherServers(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    struct PresenceEntry others[OTHER_CONNECTIONS_SHOWN];
+    const size_t         count = presenceFind(frame->uniqueID, frame->serverConnectionHandlerID, others, OTHER_CONNECTIONS_SHOWN);
+    if (count == 0) return length;
+    length = appendInfo(info, size, length, "\n\n[b]Also on:[/b] ");
+    for (size_t index = 0; index < count && index < OTHER_CONNECTIONS_SHOWN; ++index) {
+        char* serverName = NULL;
+        ts3Functions.getServerVariableAsString(others[index].serverConnectionHandlerID, VIRTUALSERVER_NAME, &serverName);
+        length = appendText(info, size, appendInfo(info, size, length, "%s", index ? ", " : ""), serverName ? serverName : "Unknown server");
+        length = appendInfo(info, size, length, " (ClientID %u)", (unsigned int)others[index].clientID);
+        if (serverName) ts3Functions.freeMemory(serverName);
+    }
+    if (count > OTHER_CONNECTIONS_SHOWN) length = appendInfo(info, size, length, " and %zu more", count - OTHER_CONNECTIONS_SHOWN);
+    return length;
+}
+
+/* First ban of the server list matching the address, nickname or unique identifier */
+static size_t appendBan(const struct ClientFrame* frame, char* info, size_t size, size_t length) {
+    static const char* const criteria[] = {"IP", "nickname", "unique identifier"};
+    struct BanMatch          ban;
+    if (!bansMatch(frame->serverConnectionHandlerID, frame->address, frame->nickname, frame->uniqueID, &ban)) return length;
+    length = appendInfo(info, size, length, "\n\n[b][color=red]Banned:[/color][/b] matches ban #%llu by %s", (unsigned long long)ban.banID, criteria[ban.criterion]);
+    if (ban.reason[0]) length = appendInfo(info, size, appendText(info, size, appendInfo(info, size, length, " ("), ban.reason), ")");
+    return length;
+}
+
+/* Client frame from the fields of the plan, only fetches and requests what they need */
+static size_t appendClientInfo(uint64 serverConnectionHandlerID, anyID clientID, const struct LayoutPlan* plan, char* info, size_t size) {
+    struct ClientFrame frame = {serverConnectionHandlerID, clientID, NULL, false, false, "", ""};
+    char*              uniqueID = NULL;
+    size_t             length   = 0;
+    if (plan->needs & LAYOUT_NEEDS_UNIQUE_ID) {
+        if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, clientID, CLIENT_UNIQUE_IDENTIFIER, &uniqueID) != ERROR_ok) return 0;
+        frame.uniqueID = uniqueID;
+    }
+    if (plan->needs & LAYOUT_NEEDS_CACHED_CLIENT) prepareCachedClient(&frame);
+
+    for (size_t index = 0; index < plan->count; ++index) {
+        switch (plan->fields[index]) {
+            case LAYOUT_CLIENT_ID:
+                length = appendInfo(info, size, length, "\n\n[b]ClientID:[/b] %u", (unsigned int)clientID);
+                break;
+            case LAYOUT_CLIENT_UNIQUE_ID:
+                length = appendInfo(info, size, length, "\n\n[b]UniqueID:[/b] %s", uniqueID);
+                break;
+            case LAYOUT_CLIENT_CONNECTION:
+                length = appendConnection(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_SAME_ADDRESS:
+                length = appendSameAddress(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_DATABASE_ID:
+                length = appendDatabaseID(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_IDENTITY:
+                length = appendIdentity(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_TALK:
+                length = appendTalk(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_MICROPHONE:
+                length = appendMicrophone(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_LOUDNESS:
+                length = appendLoudness(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_OTHER_SERVERS:
+                length = appendOtherServers(&frame, info, size, length);
+                break;
+            case LAYOUT_CLIENT_BAN:
+                length = appendBan(&frame, info, size, length);
+                break;
+            default:
+                break;
+        }
+    }
+    if (uniqueID) ts3Functions.freeMemory(uniqueID);
+
+    if (frame.requestStats) ts3Functions.requestConnectionInfo(serverConnectionHandlerID, clientID, NULL);
+    if (frame.requestIdentity) ts3Functions.requestClientVariables(serverConnectionHandlerID, clientID, NULL);
+    if ((plan->needs & LAYOUT_NEEDS_BAN_LIST) && bansRefreshDue(serverConnectionHandlerID)) {
+        if (!banListReturnCode[0]) ts3Functions.createReturnCode(pluginID, banListReturnCode, RETURNCODE_BUFSIZE);
+        ts3Functions.requestBanList(serverConnectionHandlerID, 0, BAN_LIST_LIMIT, banListReturnCode);
+    }
+    return length;
+}
+
+/* Server variable as a titled line */
+static size_t appendServerVariable(uint64 serverConnectionHandlerID, size_t flag, const char* title, char* info, size_t size, size_t length) {
+    char* value = NULL;
+    if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, flag, &value) != ERROR_ok) return length;
+    length = appendInfo(info, size, length, "\n\n[b]%s:[/b] %s", title, value);
+    ts3Functions.freeMemory(value);
+    return length;
+}
+
+static size_t appendServerInfo(uint64 serverConnectionHandlerID, const struct LayoutPlan* plan, char* info, size_t size) {
+    size_t length = 0;
+    for (size_t index = 0; index < plan->count; ++index) {
+        switch (plan->fields[index]) {
+            case LAYOUT_SERVER_ID:
+                length = appendServerVariable(serverConnectionHandlerID, VIRTUALSERVER_ID, "VirtualserverID", info, size, length);
+                break;
+            case LAYOUT_SERVER_QUERIES:
+                length = appendServerVariable(serverConnectionHandlerID, VIRTUALSERVER_QUERYCLIENTS_ONLINE, "Queries", info, size, length);
+                break;
+            case LAYOUT_SERVER_QUERY_CLIENTS:
+                length = appendQueryClients(serverConnectionHandlerID, info, size, length);
+                break;
+            case LAYOUT_SERVER_TALLIES:
+                length = appendClientTallies(serverConnectionHandlerID, info, size, length);
+                break;
+            case LAYOUT_SERVER_HOTTEST_CHANNELS:
+                length = appendHottestChannels(serverConnectionHandlerID, info, size, length);
+                break;
+            case LAYOUT_SERVER_BANS:
+                length = appendBanCounts(serverConnectionHandlerID, info, size, length);
+                break;
+            case LAYOUT_SERVER_CACHE:
+                length = appendCacheUsage(serverConnectionHandlerID, info, size, length);
+                break;
+            default:
+                break;
+        }
+    }
+    return length;
+}
+
+static size_t appendChannelTopic(uint64 serverConnectionHandlerID, uint64 channelID, char* info, size_t size, size_t length) {
+    char* topic = NULL;
+    if (ts3Functions.getChannelVariableAsString(serverConnectionHandlerID, channelID, CHANNEL_TOPIC, &topic) != ERROR_ok) return length;
+    if (topic[0]) length = appendText(info, size, appendInfo(info, size, length, "\n\n[b]Topic:[/b] "), topic);
+    ts3Functions.freeMemory(topic);
+    return length;
+}
+
+/* Cached preview of the description, requested from the server the first time the channel is shown */
+static size_t appendChannelDescription(uint64 serverConnectionHandlerID, uint64 channelID, bool* requestDescription, char* info, size_t size, size_t length) {
+    if (descriptionCacheBytes == 0) return length;
+    const uint64 now = timingMonotonicMs();
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(serverConnectionHandlerID, true);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel) {
+        server->selectedType    = PLUGIN_CHANNEL;
+        server->selectedID      = channelID;
+        const char* description = cacheGetChannelDescription(server, channel);
+        /* The client may already know the description because the channel was opened before */
+        if (!description && modelLoadChannelDescription(serverConnectionHandlerID, server, channel, false)) description = cacheGetChannelDescription(server, channel);
+        /* An empty preview is a channel without description */
+        if (description && description[0]) {
+            length = appendText(info, size, appendInfo(info, size, length, "\n\n[b]Description:[/b] "), description);
+        } else if (!description && (channel->descriptionRequestedAt == 0 || now - channel->descriptionRequestedAt >= REQUEST_RETRY_INTERVAL)) {
+            channel->descriptionRequestedAt = now;
+            *requestDescription             = true;
+        }
+    }
+    cacheUnlock();
+    return length;
+}
+
+static size_t appendChannelInfo(uint64 serverConnectionHandlerID, uint64 channelID, const struct LayoutPlan* plan, char* info, size_t size) {
+    size_t length             = 0;
+    bool   requestDescription = false;
+    for (size_t index = 0; index < plan->count; ++index) {
+        switch (plan->fields[index]) {
+            case LAYOUT_CHANNEL_ID:
+                length = appendInfo(info, size, length, "\n\n[b]ChannelID:[/b] %llu", (unsigned long long)channelID);
+                break;
+            case LAYOUT_CHANNEL_ACTIVITY:
+                length = appendChannelHeat(serverConnectionHandlerID, channelID, info, size, length);
+                break;
+            case LAYOUT_CHANNEL_TOPIC:
+                length = appendChannelTopic(serverConnectionHandlerID, channelID, info, size, length);
+                break;
+            case LAYOUT_CHANNEL_DESCRIPTION:
+                length = appendChannelDescription(serverConnectionHandlerID, channelID, &requestDescription, info, size, length);
+                break;
+            default:
+                break;
+        }
+    }
+    if (requestDescription) ts3Functions.requestChannelDescription(serverConnectionHandlerID, channelID, NULL);
+    return length;
+}
+
+/* Identities of the occupants of a shown channel are fetched before their frames are opened */
+static void prefetchIdentities(uint64 serverConnectionHandlerID, uint64 channelID) {
+    anyID* clients;
+    if (!layoutNeeds(LAYOUT_NEEDS_IDENTITIES) || ts3Functions.getChannelClientList(serverConnectionHandlerID, channelID, &clients) != ERROR_ok) return;
+    addressPrefetchChannel(serverConnectionHandlerID, clients);
+    ts3Functions.freeMemory(clients);
+    addressPump(serverConnectionHandlerID);
+}
+
 /* Dynamic content in info frame */
 void ts3plugin_infoData(uint64 serverConnectionHandlerID, uint64 id, enum PluginItemType type, char** data) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_INFO_DATA, "UUI", serverConnectionHandlerID, id, (int)type);
+    addressPump(serverConnectionHandlerID);
+    metricsPump(serverConnectionHandlerID);
+    layoutPump();
+
+    struct LayoutPlan plan;
+    char*             info   = NULL;
+    size_t            length = 0;
     switch (type) {
         case PLUGIN_SERVER:
-            char* serverID;
-            char* queries;
-            if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_ID, &serverID) != ERROR_ok) return;
-            if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_QUERYCLIENTS_ONLINE, &queries) != ERROR_ok) return;
-            *data = (char*)malloc(INFODATA_BUFSIZE * sizeof(char));
-            snprintf(*data, INFODATA_BUFSIZE, "\n[b]VirtualserverID:[/b] %s\n\n[b]Queries:[/b] %s", serverID, queries);
-            ts3Functions.freeMemory(serverID);
-            ts3Functions.freeMemory(queries);
+            layoutGetPlan(LAYOUT_FRAME_SERVER, &plan);
+            if (plan.count != 0 && (info = (char*)malloc(SERVERINFO_BUFSIZE * sizeof(char)))) length = appendServerInfo(serverConnectionHandlerID, &plan, info, SERVERINFO_BUFSIZE);
             break;
         case PLUGIN_CHANNEL:
-            char channelID[31];
-            snprintf(channelID, sizeof(channelID), "%llu", (unsigned long long)id);
-            *data = (char*)malloc(INFODATA_BUFSIZE * sizeof(char));
-            snprintf(*data, INFODATA_BUFSIZE, "\n[b]ChannelID:[/b] %s", channelID);
+            prefetchIdentities(serverConnectionHandlerID, id);
+            layoutGetPlan(LAYOUT_FRAME_CHANNEL, &plan);
+            if (plan.count != 0 && (info = (char*)malloc(CHANNELINFO_BUFSIZE * sizeof(char)))) length = appendChannelInfo(serverConnectionHandlerID, id, &plan, info, CHANNELINFO_BUFSIZE);
             break;
         case PLUGIN_CLIENT:
-            char* uniqueID;
-            if (ts3Functions.getClientVariableAsString(serverConnectionHandlerID, (anyID)id, CLIENT_UNIQUE_IDENTIFIER, &uniqueID) != ERROR_ok) return;
-            char clientID[31];
-            snprintf(clientID, sizeof(clientID), "%llu", (unsigned long long)id);
-            *data = (char*)malloc(INFODATA_BUFSIZE * sizeof(char));
-            snprintf(*data, INFODATA_BUFSIZE, "\n[b]ClientID:[/b] %s\n\n[b]UniqueID:[/b] %s", clientID, uniqueID);
-            ts3Functions.freeMemory(uniqueID);
+            layoutGetPlan(LAYOUT_FRAME_CLIENT, &plan);
+            if (plan.count != 0 && (info = (char*)malloc(CLIENTINFO_BUFSIZE * sizeof(char)))) length = appendClientInfo(serverConnectionHandlerID, (anyID)id, &plan, info, CLIENTINFO_BUFSIZE);
             break;
         default:
-            data = NULL;
+            break;
+    }
+    /* Every field starts with a blank line, the frame itself with a single line break */
+    if (info && length != 0) {
+        memmove(info, info + 1, length);
+        *data = info;
+    } else {
+        free(info);
     }
+    LOG(LOG_DEBUG, "info_data", "server=%llu type=%d id=%llu us=%llu", (unsigned long long)serverConnectionHandlerID, (int)type, (unsigned long long)id, (unsigned long long)((timingMonotonicNs() - started) / 1000));
+    metricsCallback(__func__, started);
 }
 
 /* Menu item creation */
@@ -181,14 +770,21 @@ static struct PluginMenuItem* createMenuItem(enum PluginMenuType type, int id, c
 /* Menu IDs for menu items */
 enum {
     MENU_ID_GLOBAL_1,
-    MENU_ID_GLOBAL_2
+    MENU_ID_GLOBAL_2,
+    MENU_ID_GLOBAL_3,
+    MENU_ID_GLOBAL_4,
+    MENU_ID_GLOBAL_5
 };
 
 /* Initialize plugin menus */
 void ts3plugin_initMenus(struct PluginMenuItem*** menuItems, char** menuIcon) {
-    BEGIN_CREATE_MENUS(2);
+    recorderEntry(RECORD_ENTRY_INIT_MENUS, "");
+    BEGIN_CREATE_MENUS(5);
     CREATE_MENU_ITEM(PLUGIN_MENU_TYPE_GLOBAL, MENU_ID_GLOBAL_1, "Enable Plugin", "enable.png");
     CREATE_MENU_ITEM(PLUGIN_MENU_TYPE_GLOBAL, MENU_ID_GLOBAL_2, "Disable Plugin", "disable.png");
+    CREATE_MENU_ITEM(PLUGIN_MENU_TYPE_GLOBAL, MENU_ID_GLOBAL_3, "Enable Data Sharing", "enable.png");
+    CREATE_MENU_ITEM(PLUGIN_MENU_TYPE_GLOBAL, MENU_ID_GLOBAL_4, "Disable Data Sharing", "disable.png");
+    CREATE_MENU_ITEM(PLUGIN_MENU_TYPE_GLOBAL, MENU_ID_GLOBAL_5, "Export Server Snapshot", "plugin.png");
     END_CREATE_MENUS;
 
     /* Plugin menu icon */
@@ -196,23 +792,25 @@ void ts3plugin_initMenus(struct PluginMenuItem*** menuItems, char** menuIcon) {
     _strcpy(*menuIcon, PLUGIN_MENU_BUFSZ, "plugin.png");
 
     ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_2, 0);
+    ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_4, 0);
 }
 
 /*********************************** TeamSpeak callbacks ************************************/
 
 /* Client UI callback */
 void ts3plugin_onMenuItemEvent(uint64 serverConnectionHandlerID, enum PluginMenuType type, int menuItemID, uint64 selectedItemID) {
+    recorderEntry(RECORD_ENTRY_MENU_ITEM, "UIIU", serverConnectionHandlerID, (int)type, menuItemID, selectedItemID);
     switch (type) {
         case PLUGIN_MENU_TYPE_GLOBAL:
             switch (menuItemID) {
                 case MENU_ID_GLOBAL_1:
                     if (enabled) {
-                        sendMessage(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=red]Plugin[/color] is already enabled");
+                        notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=red]Plugin[/color] is already enabled");
                     } else {
                         enabled = true;
                         ts3Functions.setPluginMenuEnabled(pluginID, menuItemID, 0);
                         ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_2, 1);
-                        sendMessage(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=#00aaff]Plugin[/color] has been [color=green]enabled[/color]");
+                        notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=#00aaff]Plugin[/color] has been [color=green]enabled[/color]");
                     }
                     break;
                 case MENU_ID_GLOBAL_2:
@@ -220,10 +818,32 @@ void ts3plugin_onMenuItemEvent(uint64 serverConnectionHandlerID, enum PluginMenu
                         enabled = false;
                         ts3Functions.setPluginMenuEnabled(pluginID, menuItemID, 0);
                         ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_1, 1);
-                        sendMessage(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=#00aaff]Plugin[/color] has been [color=red]disabled[/color]");
+                        notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=#00aaff]Plugin[/color] has been [color=red]disabled[/color]");
                     }
                     else {
-                        sendMessage(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=red]Plugin[/color] is already disabled");
+                        notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> The [color=red]Plugin[/color] is already disabled");
+                    }
+                    break;
+                case MENU_ID_GLOBAL_3:
+                    exchangeSetEnabled(true);
+                    ts3Functions.setPluginMenuEnabled(pluginID, menuItemID, 0);
+                    ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_4, 1);
+                    notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> [color=#00aaff]Data sharing[/color] has been [color=green]enabled[/color]");
+                    break;
+                case MENU_ID_GLOBAL_4:
+                    exchangeSetEnabled(false);
+                    ts3Functions.setPluginMenuEnabled(pluginID, menuItemID, 0);
+                    ts3Functions.setPluginMenuEnabled(pluginID, MENU_ID_GLOBAL_3, 1);
+                    notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> [color=#00aaff]Data sharing[/color] has been [color=red]disabled[/color]");
+                    break;
+                case MENU_ID_GLOBAL_5:
+                    char fileName[PATH_BUFSIZE];
+                    char message[PATH_BUFSIZE + COMMAND_BUFSIZE];
+                    if (snapshotExport(serverConnectionHandlerID, fileName, sizeof(fileName))) {
+                        snprintf(message, sizeof(message), "[color=black]<[b]Advanced Information[/b]> [color=#00aaff]Snapshot[/color] saved as [color=green]%s[/color]", fileName);
+                        notifyPost(serverConnectionHandlerID, message);
+                    } else {
+                        notifyPost(serverConnectionHandlerID, "[color=black]<[b]Advanced Information[/b]> [color=#00aaff]Snapshot[/color] could [color=red]not[/color] be saved");
                     }
                     break;
                 default:
@@ -234,15 +854,327 @@ void ts3plugin_onMenuItemEvent(uint64 serverConnectionHandlerID, enum PluginMenu
     }
 }
 
-/* Message to client */
-void sendMessage(uint64 serverConnectionHandlerID, const char* message) {
-    int status;
-    ts3Functions.getConnectionStatus(serverConnectionHandlerID, &status);
-    if (status == 0) {
-        ts3Functions.printMessageToCurrentTab(message);
+/* Connection state changes */
+void ts3plugin_onConnectStatusChangeEvent(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CONNECT_STATUS, "UIU", serverConnectionHandlerID, newStatus, (uint64)errorNumber);
+    LOG(LOG_INFO, "connect_status", "server=%llu status=%d error=%u", (unsigned long long)serverConnectionHandlerID, newStatus, errorNumber);
+    if (newStatus == STATUS_CONNECTION_ESTABLISHED) {
+        char* serverUID = NULL;
+        ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_UNIQUE_IDENTIFIER, &serverUID);
+        journalRecord(serverConnectionHandlerID, JOURNAL_EVENT_CONNECTED, 0, 0, 0, 0, NULL, serverUID);
+        if (serverUID) ts3Functions.freeMemory(serverUID);
+        warmupConnection(serverConnectionHandlerID);
+        metricsPump(serverConnectionHandlerID);
+    } else if (newStatus == STATUS_DISCONNECTED) {
+        journalRecord(serverConnectionHandlerID, JOURNAL_EVENT_DISCONNECTED, 0, 0, 0, 0, NULL, NULL);
+        warmupDropServer(serverConnectionHandlerID);
+        cacheLock();
+        cacheDestroyServer(serverConnectionHandlerID);
+        cacheUnlock();
+        exchangeDropServer(serverConnectionHandlerID);
+        talkDropServer(serverConnectionHandlerID);
+        addressDropServer(serverConnectionHandlerID);
+        bansDropServer(serverConnectionHandlerID);
+        presenceDropServer(serverConnectionHandlerID);
+        voiceDropServer(serverConnectionHandlerID);
+        metricsDropServer(serverConnectionHandlerID);
+    }
+    metricsCallback(__func__, started);
+}
+
+/* Channel heat is shown by the activity fields and answered on the query socket */
+static bool heatNeeded(void) {
+    return layoutNeeds(LAYOUT_NEEDS_HEAT) || queryRunning();
+}
+
+/* Client joins, moves and leaves */
+void ts3plugin_onClientMoveEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* moveMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_MOVE, "UUUUIS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, moveMessage);
+    LOG(LOG_DEBUG, "client_move", "server=%llu client=%u from=%llu to=%llu visibility=%d", (unsigned long long)serverConnectionHandlerID, (unsigned int)clientID, (unsigned long long)oldChannelID, (unsigned long long)newChannelID, visibility);
+    if (newChannelID == 0) {
+        journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_LEAVE, clientID, oldChannelID, 0, 0);
+        modelClientLeft(serverConnectionHandlerID, clientID);
+        talkClientLeft(serverConnectionHandlerID, clientID);
+        voiceClientLeft(serverConnectionHandlerID, clientID);
+    } else {
+        modelClientMoved(serverConnectionHandlerID, clientID, newChannelID);
+        if (heatNeeded()) modelChannelActivity(serverConnectionHandlerID, clientID, newChannelID);
+        journalClientEvent(serverConnectionHandlerID, oldChannelID == 0 ? JOURNAL_EVENT_JOIN : JOURNAL_EVENT_MOVE, clientID, oldChannelID, newChannelID, 0);
+        if (oldChannelID == 0 && layoutNeeds(LAYOUT_NEEDS_ADDRESSES)) addressQueueClient(serverConnectionHandlerID, clientID);
+    }
+    addressPump(serverConnectionHandlerID);
+    metricsPump(serverConnectionHandlerID);
+    metricsCallback(__func__, started);
+}
+
+/* Clients entering or leaving view through channel subscriptions */
+void ts3plugin_onClientMoveSubscriptionEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_MOVE_SUBSCRIPTION, "UUUUI", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility);
+    if (newChannelID == 0) {
+        modelClientLeft(serverConnectionHandlerID, clientID);
+    } else {
+        modelClientMoved(serverConnectionHandlerID, clientID, newChannelID);
+    }
+    metricsCallback(__func__, started);
+}
+
+/* Client connection timeouts */
+void ts3plugin_onClientMoveTimeoutEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* timeoutMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_MOVE_TIMEOUT, "UUUUIS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, timeoutMessage);
+    journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_TIMEOUT, clientID, oldChannelID, 0, 0);
+    modelClientLeft(serverConnectionHandlerID, clientID);
+    talkClientLeft(serverConnectionHandlerID, clientID);
+    voiceClientLeft(serverConnectionHandlerID, clientID);
+    metricsCallback(__func__, started);
+}
+
+/* Clients moved by another client */
+void ts3plugin_onClientMoveMovedEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID moverID, const char* moverName, const char* moverUniqueIdentifier, const char* moveMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_MOVE_MOVED, "UUUUIUSSS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, (uint64)moverID, moverName, moverUniqueIdentifier, moveMessage);
+    modelClientMoved(serverConnectionHandlerID, clientID, newChannelID);
+    journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_MOVE, clientID, oldChannelID, newChannelID, moverID);
+    metricsCallback(__func__, started);
+}
+
+/* Client kicks from a channel */
+void ts3plugin_onClientKickFromChannelEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_KICK_CHANNEL, "UUUUIUSSS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, (uint64)kickerID, kickerName, kickerUniqueIdentifier, kickMessage);
+    modelClientMoved(serverConnectionHandlerID, clientID, newChannelID);
+    journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_KICK_CHANNEL, clientID, oldChannelID, newChannelID, kickerID);
+    metricsCallback(__func__, started);
+}
+
+/* Client kicks from the server */
+void ts3plugin_onClientKickFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, const char* kickMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_KICK_SERVER, "UUUUIUSSS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, (uint64)kickerID, kickerName, kickerUniqueIdentifier, kickMessage);
+    journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_KICK_SERVER, clientID, oldChannelID, 0, kickerID);
+    modelClientLeft(serverConnectionHandlerID, clientID);
+    talkClientLeft(serverConnectionHandlerID, clientID);
+    voiceClientLeft(serverConnectionHandlerID, clientID);
+    metricsCallback(__func__, started);
+}
+
+/* Client bans from the server */
+void ts3plugin_onClientBanFromServerEvent(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, uint64 time,
+                                          const char* kickMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_BAN, "UUUUIUSSUS", serverConnectionHandlerID, (uint64)clientID, oldChannelID, newChannelID, visibility, (uint64)kickerID, kickerName, kickerUniqueIdentifier, time, kickMessage);
+    journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_BAN, clientID, oldChannelID, 0, kickerID);
+    modelClientLeft(serverConnectionHandlerID, clientID);
+    talkClientLeft(serverConnectionHandlerID, clientID);
+    voiceClientLeft(serverConnectionHandlerID, clientID);
+    metricsCallback(__func__, started);
+}
+
+/* Client nickname changes */
+void ts3plugin_onClientDisplayNameChanged(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName, const char* uniqueClientIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CLIENT_DISPLAY_NAME, "UUSS", serverConnectionHandlerID, (uint64)clientID, displayName, uniqueClientIdentifier);
+    if (modelClientUpdated(serverConnectionHandlerID, clientID)) journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_NICKNAME, clientID, 0, 0, 0);
+    metricsCallback(__func__, started);
+}
+
+/* Channels listed while connecting */
+void ts3plugin_onNewChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_NEW_CHANNEL, "UUU", serverConnectionHandlerID, channelID, channelParentID);
+    modelChannelUpdated(serverConnectionHandlerID, channelID);
+    metricsCallback(__func__, started);
+}
+
+/* Channels created while connected */
+void ts3plugin_onNewChannelCreatedEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_NEW_CHANNEL_CREATED, "UUUUSS", serverConnectionHandlerID, channelID, channelParentID, (uint64)invokerID, invokerName, invokerUniqueIdentifier);
+    modelChannelUpdated(serverConnectionHandlerID, channelID);
+    metricsCallback(__func__, started);
+}
+
+/* Channel deletions */
+void ts3plugin_onDelChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_DEL_CHANNEL, "UUUSS", serverConnectionHandlerID, channelID, (uint64)invokerID, invokerName, invokerUniqueIdentifier);
+    modelChannelDeleted(serverConnectionHandlerID, channelID);
+    metricsCallback(__func__, started);
+}
+
+/* Channel moves */
+void ts3plugin_onChannelMoveEvent(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CHANNEL_MOVE, "UUUUSS", serverConnectionHandlerID, channelID, newChannelParentID, (uint64)invokerID, invokerName, invokerUniqueIdentifier);
+    modelChannelMoved(serverConnectionHandlerID, channelID, newChannelParentID);
+    metricsCallback(__func__, started);
+}
+
+/* Channel variable updates */
+void ts3plugin_onUpdateChannelEvent(uint64 serverConnectionHandlerID, uint64 channelID) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_UPDATE_CHANNEL, "UU", serverConnectionHandlerID, channelID);
+    modelChannelUpdated(serverConnectionHandlerID, channelID);
+
+    /* Requested descriptions arrive as a channel update, an empty one is cached as well so the frame stops waiting for it */
+    bool selected = false;
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel && channel->descriptionRequestedAt != 0 && !channel->description && modelLoadChannelDescription(serverConnectionHandlerID, server, channel, true)) {
+        selected = server->selectedType == PLUGIN_CHANNEL && server->selectedID == channelID;
+    }
+    cacheUnlock();
+    if (selected) ts3Functions.requestInfoUpdate(serverConnectionHandlerID, PLUGIN_CHANNEL, channelID);
+    metricsCallback(__func__, started);
+}
+
+/* Channel edits */
+void ts3plugin_onUpdateChannelEditedEvent(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_UPDATE_CHANNEL_EDITED, "UUUSS", serverConnectionHandlerID, channelID, (uint64)invokerID, invokerName, invokerUniqueIdentifier);
+    modelChannelUpdated(serverConnectionHandlerID, channelID);
+
+    /* The description may have changed, the next frame reads or requests it again */
+    bool selected = false;
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, channelID, false) : NULL;
+    if (channel) {
+        cacheClearChannelDescription(server, channel);
+        channel->descriptionRequestedAt = 0;
+        selected                        = server->selectedType == PLUGIN_CHANNEL && server->selectedID == channelID;
+    }
+    cacheUnlock();
+    if (selected) ts3Functions.requestInfoUpdate(serverConnectionHandlerID, PLUGIN_CHANNEL, channelID);
+    metricsCallback(__func__, started);
+}
+
+/* Client variables, including those requested for identity records */
+void ts3plugin_onUpdateClientEvent(uint64 serverConnectionHandlerID, anyID clientID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_UPDATE_CLIENT, "UUUSS", serverConnectionHandlerID, (uint64)clientID, (uint64)invokerID, invokerName, invokerUniqueIdentifier);
+    addressPump(serverConnectionHandlerID);
+    metricsPump(serverConnectionHandlerID);
+    if (modelClientUpdated(serverConnectionHandlerID, clientID)) journalClientEvent(serverConnectionHandlerID, JOURNAL_EVENT_NICKNAME, clientID, 0, 0, 0);
+
+    struct IdentityRecord fetched;
+    bool                  updated  = false;
+    bool                  selected = false;
+
+    cacheLock();
+    struct ServerCache*    server   = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedClient*   client   = server ? cacheGetClient(server, clientID, false) : NULL;
+    struct IdentityRecord* identity = client && client->uniqueID[0] ? cacheGetIdentity(server, client->uniqueID, false) : NULL;
+    if (identity && identity->requestedAt != 0 && (identity->shared || identity->requestedAt > identity->updatedAt) && modelLoadIdentity(serverConnectionHandlerID, clientID, identity)) {
+        identity->updatedAt = timingMonotonicMs();
+        identity->shared    = false;
+        fetched             = *identity;
+        updated             = true;
+        selected            = server->selectedType == PLUGIN_CLIENT && server->selectedID == clientID;
+    }
+    cacheUnlock();
+
+    if (updated) {
+        exchangeQueueIdentity(serverConnectionHandlerID, &fetched);
+        if (selected) ts3Functions.requestInfoUpdate(serverConnectionHandlerID, PLUGIN_CLIENT, clientID);
+    }
+    metricsCallback(__func__, started);
+}
+
+/* Requested connection info of a client */
+void ts3plugin_onConnectionInfoEvent(uint64 serverConnectionHandlerID, anyID clientID) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_CONNECTION_INFO, "UU", serverConnectionHandlerID, (uint64)clientID);
+    addressPump(serverConnectionHandlerID);
+    metricsPump(serverConnectionHandlerID);
+    struct ConnectionStats stats = {0};
+    if (ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, CONNECTION_PING, &stats.ping) != ERROR_ok) {
+        metricsCallback(__func__, started);
         return;
     }
-    anyID ownID;
-    if (ts3Functions.getClientID(serverConnectionHandlerID, &ownID) != ERROR_ok) return;
-    ts3Functions.requestSendPrivateTextMsg(serverConnectionHandlerID, message, ownID, NULL);
-}
\ No newline at end of file
+    ts3Functions.getConnectionVariableAsDouble(serverConnectionHandlerID, clientID, CONNECTION_PACKETLOSS_TOTAL, &stats.packetLoss);
+    ts3Functions.getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, CONNECTION_CONNECTED_TIME, &stats.connectedTime);
+    stats.updatedAt = timingMonotonicMs();
+    char* address   = NULL;
+    if (ts3Functions.getConnectionVariableAsString(serverConnectionHandlerID, clientID, CONNECTION_CLIENT_IP, &address) != ERROR_ok) address = NULL;
+
+    bool cached   = false;
+    bool selected = false;
+    cacheLock();
+    struct ServerCache*  server = cacheGetServer(serverConnectionHandlerID, false);
+    struct CachedClient* client = server ? cacheGetClient(server, clientID, false) : NULL;
+    if (client) {
+        stats.requestedAt = client->stats.requestedAt;
+        client->stats     = stats;
+        cached            = true;
+        selected          = server->selectedType == PLUGIN_CLIENT && server->selectedID == clientID;
+        if (address) cacheSetClientTally(server, client, CACHE_TALLY_ADDRESS, address);
+    }
+    cacheUnlock();
+    if (address) ts3Functions.freeMemory(address);
+
+    if (cached) {
+        exchangeQueueStats(serverConnectionHandlerID, clientID, &stats);
+        if (selected) ts3Functions.requestInfoUpdate(serverConnectionHandlerID, PLUGIN_CLIENT, clientID);
+    }
+    metricsCallback(__func__, started);
+}
+
+/* Commands of other plugin instances */
+void ts3plugin_onPluginCommandEvent(uint64 serverConnectionHandlerID, const char* pluginName, const char* pluginCommand, anyID invokerClientID, const char* invokerName, const char* invokerUniqueIdentity) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_PLUGIN_COMMAND, "USSUSS", serverConnectionHandlerID, pluginName, pluginCommand, (uint64)invokerClientID, invokerName, invokerUniqueIdentity);
+    exchangeHandleCommand(serverConnectionHandlerID, pluginCommand, invokerClientID);
+    metricsCallback(__func__, started);
+}
+
+/* Entries of a requested ban list */
+void ts3plugin_onBanListEvent(uint64 serverConnectionHandlerID, uint64 banid, const char* ip, const char* name, const char* uid, const char* mytsid, uint64 creationTime, uint64 durationTime, const char* invokerName, uint64 invokercldbid,
+                              const char* invokeruid, const char* reason, int numberOfEnforcements, const char* lastNickName) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_BAN_LIST, "UUSSSSUUSUSSIS", serverConnectionHandlerID, banid, ip, name, uid, mytsid, creationTime, durationTime, invokerName, invokercldbid, invokeruid, reason, numberOfEnforcements, lastNickName);
+    bansAdd(serverConnectionHandlerID, banid, ip, name, uid, creationTime, durationTime, reason);
+    metricsCallback(__func__, started);
+}
+
+/* Answers to requests made with a return code, those of the ban list are handled here instead of being shown in the chat */
+int ts3plugin_onServerErrorEvent(uint64 serverConnectionHandlerID, const char* errorMessage, unsigned int error, const char* returnCode, const char* extraMessage) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_SERVER_ERROR, "USUSS", serverConnectionHandlerID, errorMessage, (uint64)error, returnCode, extraMessage);
+    const bool banList = returnCode && banListReturnCode[0] && strcmp(returnCode, banListReturnCode) == 0;
+    if (banList) {
+        /* The answer follows the last rule, an empty list sends no rule at all */
+        const bool denied = error == ERROR_permissions_client_insufficient || error == ERROR_permissions_insufficient_permission_power;
+        if (error == ERROR_ok || error == ERROR_database_empty_result || denied) bansRequestEnded(serverConnectionHandlerID, denied);
+        if (denied) LOG(LOG_INFO, "ban_list_denied", "server=%llu error=%u", (unsigned long long)serverConnectionHandlerID, error);
+    }
+    metricsCallback(__func__, started);
+    return banList ? 1 : 0;
+}
+
+/* Talk status of visible clients */
+void ts3plugin_onTalkStatusChangeEvent(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID) {
+    const uint64 started = timingMonotonicNs();
+    recorderEntry(RECORD_ENTRY_TALK_STATUS, "UIIU", serverConnectionHandlerID, status, isReceivedWhisper, (uint64)clientID);
+    /* Ends are always taken, a burst started before a reload removed the talk field must not run on */
+    if (status != STATUS_TALKING || layoutNeeds(LAYOUT_NEEDS_TALK)) talkStatusChanged(serverConnectionHandlerID, clientID, status == STATUS_TALKING);
+    if (status == STATUS_TALKING && layoutNeeds(LAYOUT_NEEDS_PLAYBACK_VOICE)) voicePreparePlayback(serverConnectionHandlerID, clientID);
+    addressPump(serverConnectionHandlerID);
+    metricsPump(serverConnectionHandlerID);
+    if (status == STATUS_TALKING && heatNeeded()) modelChannelActivity(serverConnectionHandlerID, clientID, 0);
+    metricsCallback(__func__, started);
+}
+
+/* Audio of other clients on the audio thread, only measured and never recorded or edited */
+void ts3plugin_onEditPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, anyID clientID, short* samples, int sampleCount, int channels) {
+    if (layoutNeeds(LAYOUT_NEEDS_PLAYBACK_VOICE)) voicePlayback(serverConnectionHandlerID, clientID, samples, sampleCount, channels);
+}
+
+/* Microphone audio on the audio thread, only measured and never recorded or edited */
+void ts3plugin_onEditCapturedVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, int* edited) {
+    if (layoutNeeds(LAYOUT_NEEDS_CAPTURED_VOICE)) voiceCaptured(serverConnectionHandlerID, samples, sampleCount, channels);
+}
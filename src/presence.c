@@ -0,0 +1,252 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#include "log.h"
+#include "presence.h"
+
+#define PRESENCE_INITIAL_CAPACITY 16384 /* Power of two */
+#define PRESENCE_EMPTY 0
+#define PRESENCE_DELETED 1
+
+/* Identities are keyed by a 64 bit hash of their unique identifier, keys below 2 mark free slots */
+struct PresenceSlot {
+    atomic_uint_least64_t key;
+    atomic_uint_least64_t serverConnectionHandlerID;
+    atomic_uint_least64_t clientID;
+};
+
+struct PresenceRecord {
+    uint64 key;
+    uint64 serverConnectionHandlerID;
+    anyID  clientID;
+};
+
+/* A full table is replaced by one of twice the size, readers may still scan the old one so it is kept until shutdown */
+struct PresenceTable {
+    struct PresenceTable* retired;
+    size_t                capacity; /* Power of two */
+    struct PresenceSlot   slots[];
+};
+
+static _Atomic(struct PresenceTable*) table        = NULL;
+static size_t                         usedSlots    = 0; /* Entries and deleted markers */
+static size_t                         deletedSlots = 0;
+static size_t                         dropped      = 0; /* Entries lost because no larger table could be allocated */
+static mtx_t                          writeMutex;
+static atomic_uint_least64_t          sequence; /* Odd while an update is in progress */
+
+/* FNV-1a hash of a unique identifier moved out of the free key range */
+static uint64 hashUniqueID(const char* uniqueID) {
+    uint64 hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)uniqueID; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return hash > PRESENCE_DELETED ? hash : hash + 2;
+}
+
+static struct PresenceTable* allocateTable(size_t capacity) {
+    struct PresenceTable* allocated = (struct PresenceTable*)calloc(1, sizeof(struct PresenceTable) + capacity * sizeof(struct PresenceSlot));
+    if (allocated) allocated->capacity = capacity;
+    return allocated;
+}
+
+/* Table of the writer, only called while holding the write mutex */
+static struct PresenceTable* currentTable(void) {
+    return atomic_load_explicit(&table, memory_order_relaxed);
+}
+
+static void beginUpdate(void) {
+    mtx_lock(&writeMutex);
+    atomic_store_explicit(&sequence, atomic_load_explicit(&sequence, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void endUpdate(void) {
+    atomic_store_explicit(&sequence, atomic_load_explicit(&sequence, memory_order_relaxed) + 1, memory_order_release);
+    mtx_unlock(&writeMutex);
+}
+
+static uint64 slotKey(const struct PresenceSlot* slot) {
+    return atomic_load_explicit(&slot->key, memory_order_relaxed);
+}
+
+static void storeSlot(struct PresenceSlot* slot, uint64 key, uint64 serverConnectionHandlerID, anyID clientID) {
+    atomic_store_explicit(&slot->serverConnectionHandlerID, serverConnectionHandlerID, memory_order_relaxed);
+    atomic_store_explicit(&slot->clientID, clientID, memory_order_relaxed);
+    atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+}
+
+static void insert(struct PresenceTable* into, uint64 key, uint64 serverConnectionHandlerID, anyID clientID) {
+    const size_t mask     = into->capacity - 1;
+    size_t       position = key & mask;
+    while (slotKey(&into->slots[position]) > PRESENCE_DELETED) position = (position + 1) & mask;
+    if (slotKey(&into->slots[position]) == PRESENCE_DELETED) {
+        --deletedSlots;
+    } else {
+        ++usedSlots;
+    }
+    storeSlot(&into->slots[position], key, serverConnectionHandlerID, clientID);
+}
+
+/* Copies the entries out of a table and marks its slots empty if clear is set, returns NULL and leaves it unchanged if out of memory */
+static struct PresenceRecord* takeRecords(struct PresenceTable* from, bool clear, size_t* count) {
+    struct PresenceRecord* records = (struct PresenceRecord*)malloc((usedSlots - deletedSlots) * sizeof(struct PresenceRecord) + 1);
+    *count                         = 0;
+    if (!records) return NULL;
+    for (size_t index = 0; index < from->capacity; ++index) {
+        const uint64 key = slotKey(&from->slots[index]);
+        if (key > PRESENCE_DELETED) {
+            records[(*count)++] = (struct PresenceRecord){key, atomic_load_explicit(&from->slots[index].serverConnectionHandlerID, memory_order_relaxed), (anyID)atomic_load_explicit(&from->slots[index].clientID, memory_order_relaxed)};
+        }
+        if (clear && key != PRESENCE_EMPTY) atomic_store_explicit(&from->slots[index].key, PRESENCE_EMPTY, memory_order_relaxed);
+    }
+    usedSlots    = 0;
+    deletedSlots = 0;
+    return records;
+}
+
+/* Reinserts all entries in place to clear deleted markers, called inside an update */
+static void rebuild(void) {
+    struct PresenceTable*  current = currentTable();
+    size_t                 count;
+    struct PresenceRecord* records = takeRecords(current, true, &count);
+    if (!records) return;
+    for (size_t index = 0; index < count; ++index) insert(current, records[index].key, records[index].serverConnectionHandlerID, records[index].clientID);
+    free(records);
+}
+
+/* Moves all entries into a table of twice the size, called inside an update, returns false if out of memory */
+static bool grow(void) {
+    struct PresenceTable* current = currentTable();
+    struct PresenceTable* larger  = allocateTable(current->capacity * 2);
+    if (!larger) return false;
+    size_t                 count;
+    struct PresenceRecord* records = takeRecords(current, false, &count);
+    if (!records) {
+        free(larger);
+        return false;
+    }
+    for (size_t index = 0; index < count; ++index) insert(larger, records[index].key, records[index].serverConnectionHandlerID, records[index].clientID);
+    free(records);
+    larger->retired = current;
+    atomic_store_explicit(&table, larger, memory_order_release);
+    return true;
+}
+
+/* Marks a slot deleted, or empty if the probe sequence ends behind it */
+static void removeSlot(struct PresenceTable* from, size_t position) {
+    if (slotKey(&from->slots[(position + 1) & (from->capacity - 1)]) == PRESENCE_EMPTY) {
+        atomic_store_explicit(&from->slots[position].key, PRESENCE_EMPTY, memory_order_relaxed);
+        --usedSlots;
+    } else {
+        atomic_store_explicit(&from->slots[position].key, PRESENCE_DELETED, memory_order_relaxed);
+        ++deletedSlots;
+    }
+}
+
+void presenceInit(void) {
+    mtx_init(&writeMutex, mtx_plain);
+    atomic_init(&sequence, 0);
+    atomic_store(&table, allocateTable(PRESENCE_INITIAL_CAPACITY));
+    usedSlots    = 0;
+    deletedSlots = 0;
+    dropped      = 0;
+}
+
+void presenceShutdown(void) {
+    struct PresenceTable* current = atomic_exchange(&table, NULL);
+    while (current) {
+        struct PresenceTable* retired = current->retired;
+        free(current);
+        current = retired;
+    }
+    mtx_destroy(&writeMutex);
+}
+
+void presenceAdd(uint64 serverConnectionHandlerID, anyID clientID, const char* uniqueID) {
+    if (!atomic_load(&table) || !uniqueID || !uniqueID[0]) return;
+    const uint64 key = hashUniqueID(uniqueID);
+    beginUpdate();
+    struct PresenceTable* current  = currentTable();
+    const size_t          mask     = current->capacity - 1;
+    size_t                position = key & mask;
+    bool                  present  = false;
+    for (size_t probe = 0; probe < current->capacity && slotKey(&current->slots[position]) != PRESENCE_EMPTY && !present; ++probe) {
+        present  = slotKey(&current->slots[position]) == key && atomic_load_explicit(&current->slots[position].serverConnectionHandlerID, memory_order_relaxed) == serverConnectionHandlerID &&
+                  atomic_load_explicit(&current->slots[position].clientID, memory_order_relaxed) == clientID;
+        position = (position + 1) & mask;
+    }
+    /* A quarter of the table stays empty so that probe sequences end quickly, deleted markers are cleared before growing */
+    bool full = !present && usedSlots >= current->capacity / 4 * 3;
+    if (full && deletedSlots != 0) rebuild();
+    full = full && usedSlots >= current->capacity / 4 * 3 && !grow();
+    if (!present && !full) insert(currentTable(), key, serverConnectionHandlerID, clientID);
+    const size_t lost = full ? ++dropped : 0;
+    endUpdate();
+    if (full) LOG(LOG_WARNING, "presence_entry_dropped", "server=%llu client=%u dropped=%zu", (unsigned long long)serverConnectionHandlerID, (unsigned int)clientID, lost);
+}
+
+void presenceRemove(uint64 serverConnectionHandlerID, anyID clientID, const char* uniqueID) {
+    if (!atomic_load(&table) || !uniqueID || !uniqueID[0]) return;
+    const uint64 key = hashUniqueID(uniqueID);
+    beginUpdate();
+    struct PresenceTable* current  = currentTable();
+    const size_t          mask     = current->capacity - 1;
+    size_t                position = key & mask;
+    for (size_t probe = 0; probe < current->capacity && slotKey(&current->slots[position]) != PRESENCE_EMPTY; ++probe) {
+        if (slotKey(&current->slots[position]) == key && atomic_load_explicit(&current->slots[position].serverConnectionHandlerID, memory_order_relaxed) == serverConnectionHandlerID &&
+            atomic_load_explicit(&current->slots[position].clientID, memory_order_relaxed) == clientID) {
+            removeSlot(current, position);
+            break;
+        }
+        position = (position + 1) & mask;
+    }
+    endUpdate();
+}
+
+void presenceDropServer(uint64 serverConnectionHandlerID) {
+    if (!atomic_load(&table)) return;
+    beginUpdate();
+    struct PresenceTable* current = currentTable();
+    for (size_t index = 0; index < current->capacity; ++index) {
+        if (slotKey(&current->slots[index]) > PRESENCE_DELETED && atomic_load_explicit(&current->slots[index].serverConnectionHandlerID, memory_order_relaxed) == serverConnectionHandlerID) {
+            atomic_store_explicit(&current->slots[index].key, PRESENCE_DELETED, memory_order_relaxed);
+            ++deletedSlots;
+        }
+    }
+    rebuild();
+    endUpdate();
+}
+
+size_t presenceFind(const char* uniqueID, uint64 serverConnectionHandlerID, struct PresenceEntry* entries, size_t count) {
+    if (!atomic_load(&table) || !uniqueID || !uniqueID[0]) return 0;
+    const uint64 key = hashUniqueID(uniqueID);
+    size_t       found;
+    uint64       started;
+    do {
+        while ((started = atomic_load_explicit(&sequence, memory_order_acquire)) & 1) thrd_yield();
+        found                                = 0;
+        const struct PresenceTable* scan     = atomic_load_explicit(&table, memory_order_acquire);
+        const size_t                mask     = scan->capacity - 1;
+        size_t                      position = key & mask;
+        for (size_t probe = 0; probe < scan->capacity; ++probe) {
+            const uint64 slot = slotKey(&scan->slots[position]);
+            if (slot == PRESENCE_EMPTY) break;
+            const uint64 server = atomic_load_explicit(&scan->slots[position].serverConnectionHandlerID, memory_order_relaxed);
+            if (slot == key && server != serverConnectionHandlerID) {
+                if (found < count) entries[found] = (struct PresenceEntry){server, (anyID)atomic_load_explicit(&scan->slots[position].clientID, memory_order_relaxed)};
+                ++found;
+            }
+            position = (position + 1) & mask;
+        }
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&sequence, memory_order_relaxed) != started);
+    return found;
+}
@@ -0,0 +1,40 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Client of an identity on one of the connections */
+struct PresenceEntry {
+    uint64 serverConnectionHandlerID;
+    anyID  clientID;
+};
+
+/*
+ * Process-wide index from unique identifiers to the clients using them on every connection.
+ * Updates are serialized and published through a sequence counter, lookups never lock and
+ * retry if an update happened while they were reading. The table doubles once three quarters are used.
+ */
+void presenceInit(void);
+void presenceShutdown(void);
+
+void presenceAdd(uint64 serverConnectionHandlerID, anyID clientID, const char* uniqueID);
+void presenceRemove(uint64 serverConnectionHandlerID, anyID clientID, const char* uniqueID);
+void presenceDropServer(uint64 serverConnectionHandlerID);
+
+/* Writes up to count clients of the identity on other connections than the given one, returns their number */
+size_t presenceFind(const char* uniqueID, uint64 serverConnectionHandlerID, struct PresenceEntry* entries, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,713 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include "query.h"
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+
+void queryInit(bool enabled) {}
+
+void queryShutdown(void) {}
+
+bool queryRunning(void) {
+    return false;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "teamspeak/public_rare_definitions.h"
+
+#include "cache.h"
+#include "log.h"
+#include "presence.h"
+#include "storage.h"
+
+#define QUERY_SOCKET "query.sock"
+#define QUERY_PATH_BUFSIZE 512
+#define QUERY_MAX_CONNECTIONS 16
+#define QUERY_INPUT_BUFSIZE 8192
+#define QUERY_OUTPUT_INITIAL 4096
+#define QUERY_OUTPUT_LIMIT (1 << 20) /* Pending answer bytes above which requests wait */
+#define QUERY_POLL_TIMEOUT 100
+#define QUERY_FIELD_BUFSIZE 64
+#define QUERY_PRESENCE_LIMIT 16
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct QueryConnection {
+    int    fd;
+    bool   closing; /* Closed once the pending answers are sent */
+    bool   ended;   /* The peer sent everything, closed once the received lines are answered and sent */
+    char   input[QUERY_INPUT_BUFSIZE];
+    size_t inputLength;
+    char*  output;
+    size_t outputLength;
+    size_t outputSent;
+    size_t outputCapacity;
+    bool   outputFailed;
+};
+
+struct QueryRequest {
+    char   query[QUERY_FIELD_BUFSIZE];
+    char   id[QUERY_FIELD_BUFSIZE];
+    bool   hasID;
+    bool   stringID;
+    uint64 server;
+    uint64 channel;
+    char   uniqueID[UID_BUFSIZE];
+};
+
+static struct QueryConnection* connections[QUERY_MAX_CONNECTIONS];
+static int                     listenSocket = -1;
+static char                    socketPath[QUERY_PATH_BUFSIZE];
+static atomic_bool             running = false;
+static thrd_t                  workerThread;
+
+/*********************************** Serialiser ************************************/
+
+/* Answers are written straight into the output buffer of the connection, which is also the send buffer */
+static bool reserve(struct QueryConnection* connection, size_t length) {
+    if (connection->outputFailed) return false;
+    if (connection->outputLength + length <= connection->outputCapacity) return true;
+    size_t capacity = connection->outputCapacity ? connection->outputCapacity : QUERY_OUTPUT_INITIAL;
+    while (capacity < connection->outputLength + length) capacity *= 2;
+    char* output = (char*)realloc(connection->output, capacity);
+    if (!output) {
+        connection->outputFailed = true;
+        return false;
+    }
+    connection->output         = output;
+    connection->outputCapacity = capacity;
+    return true;
+}
+
+static void putRaw(struct QueryConnection* connection, const char* data, size_t length) {
+    if (!reserve(connection, length)) return;
+    memcpy(connection->output + connection->outputLength, data, length);
+    connection->outputLength += length;
+}
+
+static void putLiteral(struct QueryConnection* connection, const char* text) {
+    putRaw(connection, text, strlen(text));
+}
+
+static void putString(struct QueryConnection* connection, const char* text) {
+    putRaw(connection, "\"", 1);
+    while (*text) {
+        size_t run = 0;
+        while (text[run] && text[run] != '"' && text[run] != '\\' && (unsigned char)text[run] >= 0x20) ++run;
+        putRaw(connection, text, run);
+        text += run;
+        if (!*text) break;
+        char escaped[8];
+        switch (*text) {
+            case '"':
+            case '\\':
+                escaped[0] = '\\';
+                escaped[1] = *text;
+                putRaw(connection, escaped, 2);
+                break;
+            case '\n':
+                putRaw(connection, "\\n", 2);
+                break;
+            case '\t':
+                putRaw(connection, "\\t", 2);
+                break;
+            default:
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)*text);
+                putRaw(connection, escaped, 6);
+        }
+        ++text;
+    }
+    putRaw(connection, "\"", 1);
+}
+
+static void putUnsigned(struct QueryConnection* connection, uint64 value) {
+    char      digits[24];
+    const int length = snprintf(digits, sizeof(digits), "%llu", (unsigned long long)value);
+    putRaw(connection, digits, (size_t)length);
+}
+
+static void putDouble(struct QueryConnection* connection, double value) {
+    char      digits[48];
+    const int length = snprintf(digits, sizeof(digits), "%.3f", value);
+    putRaw(connection, digits, (size_t)length);
+}
+
+static void putBool(struct QueryConnection* connection, bool value) {
+    putLiteral(connection, value ? "true" : "false");
+}
+
+static void beginAnswer(struct QueryConnection* connection, const struct QueryRequest* request) {
+    putRaw(connection, "{", 1);
+    if (!request->hasID) return;
+    putLiteral(connection, "\"id\":");
+    if (request->stringID) {
+        putString(connection, request->id);
+    } else {
+        putLiteral(connection, request->id);
+    }
+    putRaw(connection, ",", 1);
+}
+
+static void answerError(struct QueryConnection* connection, const struct QueryRequest* request, const char* message) {
+    beginAnswer(connection, request);
+    putLiteral(connection, "\"error\":");
+    putString(connection, message);
+    putLiteral(connection, "}\n");
+}
+
+static void putClient(struct QueryConnection* connection, uint64 serverConnectionHandlerID, const struct CachedClient* client) {
+    putLiteral(connection, "{\"server\":");
+    putUnsigned(connection, serverConnectionHandlerID);
+    putLiteral(connection, ",\"clientID\":");
+    putUnsigned(connection, client->clientID);
+    putLiteral(connection, ",\"uid\":");
+    putString(connection, client->uniqueID);
+    putLiteral(connection, ",\"nickname\":");
+    putString(connection, client->nickname);
+    putLiteral(connection, ",\"channelID\":");
+    putUnsigned(connection, client->channelID);
+    putLiteral(connection, ",\"databaseID\":");
+    putUnsigned(connection, client->databaseID);
+    putLiteral(connection, ",\"query\":");
+    putBool(connection, client->type == ClientType_SERVERQUERY);
+    putLiteral(connection, ",\"away\":");
+    putBool(connection, client->flags & CACHED_CLIENT_AWAY);
+    putLiteral(connection, ",\"inputMuted\":");
+    putBool(connection, client->flags & CACHED_CLIENT_INPUT_MUTED);
+    putLiteral(connection, ",\"outputMuted\":");
+    putBool(connection, client->flags & CACHED_CLIENT_OUTPUT_MUTED);
+    putLiteral(connection, ",\"country\":");
+    putString(connection, client->country);
+    putLiteral(connection, ",\"address\":");
+    if (client->tallies[CACHE_TALLY_ADDRESS]) {
+        putString(connection, client->tallies[CACHE_TALLY_ADDRESS]->value);
+    } else {
+        putLiteral(connection, "null");
+    }
+    if (client->stats.updatedAt != 0) {
+        putLiteral(connection, ",\"ping\":");
+        putUnsigned(connection, client->stats.ping);
+        putLiteral(connection, ",\"packetLoss\":");
+        putDouble(connection, client->stats.packetLoss);
+    }
+    putLiteral(connection, ",\"seenAt\":");
+    putUnsigned(connection, client->seenAt);
+    putRaw(connection, "}", 1);
+}
+
+/*********************************** Queries ************************************/
+
+/* Context of the cache visitors */
+struct QueryVisit {
+    struct QueryConnection* connection;
+    uint64                  serverConnectionHandlerID;
+    uint64                  channelID;
+    bool                    first;
+};
+
+static void putServer(struct ServerCache* server, void* context) {
+    struct QueryVisit* visit = (struct QueryVisit*)context;
+    putLiteral(visit->connection, visit->first ? "{\"server\":" : ",{\"server\":");
+    putUnsigned(visit->connection, server->serverConnectionHandlerID);
+    putLiteral(visit->connection, ",\"clients\":");
+    putUnsigned(visit->connection, server->clientCount);
+    putLiteral(visit->connection, ",\"channels\":");
+    putUnsigned(visit->connection, server->channelCount);
+    putLiteral(visit->connection, ",\"queries\":");
+    putUnsigned(visit->connection, server->queryCount);
+    putLiteral(visit->connection, ",\"populated\":");
+    putBool(visit->connection, server->populated);
+    putRaw(visit->connection, "}", 1);
+    visit->first = false;
+}
+
+static void putChannelClient(struct CachedClient* client, void* context) {
+    struct QueryVisit* visit = (struct QueryVisit*)context;
+    if (client->channelID != visit->channelID) return;
+    if (!visit->first) putRaw(visit->connection, ",", 1);
+    putClient(visit->connection, visit->serverConnectionHandlerID, client);
+    visit->first = false;
+}
+
+static void answerServers(struct QueryConnection* connection, const struct QueryRequest* request) {
+    struct QueryVisit visit = {connection, 0, 0, true};
+    beginAnswer(connection, request);
+    putLiteral(connection, "\"servers\":[");
+    cacheLock();
+    cacheForEachServer(putServer, &visit);
+    cacheUnlock();
+    putLiteral(connection, "]}\n");
+}
+
+static void answerServerSummary(struct QueryConnection* connection, const struct QueryRequest* request) {
+    cacheLock();
+    struct ServerCache* server = cacheGetServer(request->server, false);
+    if (!server) {
+        cacheUnlock();
+        answerError(connection, request, "unknown server");
+        return;
+    }
+    struct CacheUsage usage;
+    cacheGetUsage(server, &usage);
+    beginAnswer(connection, request);
+    putLiteral(connection, "\"server\":");
+    putUnsigned(connection, server->serverConnectionHandlerID);
+    putLiteral(connection, ",\"clients\":");
+    putUnsigned(connection, server->clientCount);
+    putLiteral(connection, ",\"channels\":");
+    putUnsigned(connection, server->channelCount);
+    putLiteral(connection, ",\"queries\":");
+    putUnsigned(connection, server->queryCount);
+    putLiteral(connection, ",\"identities\":");
+    putUnsigned(connection, server->identityCount);
+    putLiteral(connection, ",\"cacheBytes\":");
+    putUnsigned(connection, usage.totalBytes);
+    putLiteral(connection, ",\"hottest\":[");
+    struct CachedChannel* hottest[CACHE_HOTTEST_COUNT];
+    const size_t          count = cacheGetHottestChannels(server, hottest, CACHE_HOTTEST_COUNT);
+    for (size_t index = 0; index < count; ++index) {
+        putLiteral(connection, index ? ",{\"channelID\":" : "{\"channelID\":");
+        putUnsigned(connection, hottest[index]->channelID);
+        putLiteral(connection, ",\"name\":");
+        putString(connection, hottest[index]->name);
+        putLiteral(connection, ",\"heat\":");
+        putDouble(connection, cacheGetChannelHeat(server, hottest[index]));
+        putRaw(connection, "}", 1);
+    }
+    cacheUnlock();
+    putLiteral(connection, "]}\n");
+}
+
+static void answerChannelClients(struct QueryConnection* connection, const struct QueryRequest* request) {
+    cacheLock();
+    struct ServerCache*   server  = cacheGetServer(request->server, false);
+    struct CachedChannel* channel = server ? cacheGetChannel(server, request->channel, false) : NULL;
+    if (!channel) {
+        cacheUnlock();
+        answerError(connection, request, server ? "unknown channel" : "unknown server");
+        return;
+    }
+    struct QueryVisit visit = {connection, request->server, request->channel, true};
+    beginAnswer(connection, request);
+    putLiteral(connection, "\"server\":");
+    putUnsigned(connection, request->server);
+    putLiteral(connection, ",\"channel\":{\"channelID\":");
+    putUnsigned(connection, channel->channelID);
+    putLiteral(connection, ",\"parentID\":");
+    putUnsigned(connection, channel->parentID);
+    putLiteral(connection, ",\"name\":");
+    putString(connection, channel->name);
+    putLiteral(connection, "},\"clients\":[");
+    cacheForEachClient(server, putChannelClient, &visit);
+    cacheUnlock();
+    putLiteral(connection, "]}\n");
+}
+
+static void answerClientByUniqueID(struct QueryConnection* connection, const struct QueryRequest* request) {
+    if (!request->uniqueID[0]) {
+        answerError(connection, request, "missing uid");
+        return;
+    }
+    /* Connection 0 is never used, so the presence index returns the clients of every connection */
+    struct PresenceEntry entries[QUERY_PRESENCE_LIMIT];
+    size_t               count = presenceFind(request->uniqueID, 0, entries, QUERY_PRESENCE_LIMIT);
+    if (count > QUERY_PRESENCE_LIMIT) count = QUERY_PRESENCE_LIMIT;
+
+    bool first = true;
+    beginAnswer(connection, request);
+    putLiteral(connection, "\"clients\":[");
+    cacheLock();
+    for (size_t index = 0; index < count; ++index) {
+        struct ServerCache*  server = cacheGetServer(entries[index].serverConnectionHandlerID, false);
+        struct CachedClient* client = server ? cacheGetClient(server, entries[index].clientID, false) : NULL;
+        if (!client || !client->present || strcmp(client->uniqueID, request->uniqueID) != 0) continue;
+        if (!first) putRaw(connection, ",", 1);
+        putClient(connection, entries[index].serverConnectionHandlerID, client);
+        first = false;
+    }
+    cacheUnlock();
+    putLiteral(connection, "]}\n");
+}
+
+/*********************************** Request parser ************************************/
+
+static const char* skipSpace(const char* text) {
+    while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') ++text;
+    return text;
+}
+
+static size_t putUTF8(char* destination, unsigned int codePoint) {
+    if (codePoint < 0x80) {
+        destination[0] = (char)codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        destination[0] = (char)(0xC0 | (codePoint >> 6));
+        destination[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        destination[0] = (char)(0xE0 | (codePoint >> 12));
+        destination[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        destination[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    destination[0] = (char)(0xF0 | (codePoint >> 18));
+    destination[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+    destination[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    destination[3] = (char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+static bool parseHex(const char* text, unsigned int* value) {
+    *value = 0;
+    for (size_t index = 0; index < 4; ++index) {
+        const char c = text[index];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') {
+            *value |= (unsigned int)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            *value |= (unsigned int)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            *value |= (unsigned int)(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Parses a string at its opening quote into destination, NULL for destination skips it, returns the end or NULL */
+static const char* parseString(const char* text, char* destination, size_t size) {
+    if (*text++ != '"') return NULL;
+    size_t length = 0;
+    while (*text != '"') {
+        char   decoded[4];
+        size_t decodedLength = 1;
+        if ((unsigned char)*text < 0x20) return NULL;
+        if (*text != '\\') {
+            decoded[0] = *text++;
+        } else {
+            ++text;
+            switch (*text) {
+                case '"':
+                case '\\':
+                case '/':
+                    decoded[0] = *text;
+                    break;
+                case 'b':
+                    decoded[0] = '\b';
+                    break;
+                case 'f':
+                    decoded[0] = '\f';
+                    break;
+                case 'n':
+                    decoded[0] = '\n';
+                    break;
+                case 'r':
+                    decoded[0] = '\r';
+                    break;
+                case 't':
+                    decoded[0] = '\t';
+                    break;
+                case 'u': {
+                    unsigned int codePoint;
+                    if (!parseHex(text + 1, &codePoint)) return NULL;
+                    text += 4;
+                    unsigned int low;
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && text[1] == '\\' && text[2] == 'u' && parseHex(text + 3, &low) && low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        text += 6;
+                    }
+                    decodedLength = putUTF8(decoded, codePoint);
+                    break;
+                }
+                default:
+                    return NULL;
+            }
+            ++text;
+        }
+        if (destination && length + decodedLength < size) {
+            memcpy(destination + length, decoded, decodedLength);
+            length += decodedLength;
+        }
+    }
+    if (destination) destination[length] = '\0';
+    return text + 1;
+}
+
+/* Copies a number token into destination, returns the end or NULL */
+static const char* parseNumber(const char* text, char* destination, size_t size) {
+    const char* start  = text;
+    size_t      length = 0;
+    while (*text == '-' || *text == '+' || *text == '.' || *text == 'e' || *text == 'E' || (*text >= '0' && *text <= '9')) {
+        if (destination && length + 1 < size) destination[length++] = *text;
+        ++text;
+    }
+    if (destination) destination[length] = '\0';
+    return text != start ? text : NULL;
+}
+
+static bool parseUnsigned(const char* digits, uint64* value) {
+    if (!*digits) return false;
+    *value = 0;
+    for (; *digits; ++digits) {
+        if (*digits < '0' || *digits > '9') return false;
+        *value = *value * 10 + (uint64)(*digits - '0');
+    }
+    return true;
+}
+
+/* Reads a flat JSON object, returns an error message or NULL */
+static const char* parseRequest(const char* text, struct QueryRequest* request) {
+    memset(request, 0, sizeof(*request));
+    text = skipSpace(text);
+    if (*text++ != '{') return "expected an object";
+    text = skipSpace(text);
+    if (*text == '}') return "missing query";
+    for (;;) {
+        char key[QUERY_FIELD_BUFSIZE];
+        char number[QUERY_FIELD_BUFSIZE];
+        if (!(text = parseString(skipSpace(text), key, sizeof(key)))) return "malformed key";
+        text = skipSpace(text);
+        if (*text++ != ':') return "expected a colon";
+        text = skipSpace(text);
+
+        if (strcmp(key, "query") == 0 && *text == '"') {
+            text = parseString(text, request->query, sizeof(request->query));
+        } else if (strcmp(key, "uid") == 0 && *text == '"') {
+            text = parseString(text, request->uniqueID, sizeof(request->uniqueID));
+        } else if (strcmp(key, "id") == 0 && *text == '"') {
+            text              = parseString(text, request->id, sizeof(request->id));
+            request->hasID    = true;
+            request->stringID = true;
+        } else if (strcmp(key, "id") == 0) {
+            uint64 value;
+            text           = parseNumber(text, number, sizeof(number));
+            request->hasID = text && parseUnsigned(number, &value);
+            if (request->hasID) snprintf(request->id, sizeof(request->id), "%llu", (unsigned long long)value);
+        } else if (strcmp(key, "server") == 0 || strcmp(key, "channel") == 0) {
+            text = parseNumber(text, number, sizeof(number));
+            if (text && !parseUnsigned(number, strcmp(key, "server") == 0 ? &request->server : &request->channel)) return "expected an unsigned number";
+        } else if (*text == '"') {
+            text = parseString(text, NULL, 0);
+        } else if (strncmp(text, "true", 4) == 0 || strncmp(text, "null", 4) == 0) {
+            text += 4;
+        } else if (strncmp(text, "false", 5) == 0) {
+            text += 5;
+        } else {
+            text = parseNumber(text, NULL, 0);
+        }
+        if (!text) return "malformed value";
+
+        text = skipSpace(text);
+        if (*text == '}') break;
+        if (*text++ != ',') return "expected a comma";
+    }
+    return *skipSpace(text + 1) ? "trailing characters" : NULL;
+}
+
+static void answerLine(struct QueryConnection* connection, const char* line) {
+    struct QueryRequest request;
+    const char*         error = parseRequest(line, &request);
+    if (error) {
+        answerError(connection, &request, error);
+    } else if (strcmp(request.query, "servers") == 0) {
+        answerServers(connection, &request);
+    } else if (strcmp(request.query, "server_summary") == 0) {
+        answerServerSummary(connection, &request);
+    } else if (strcmp(request.query, "channel_clients") == 0) {
+        answerChannelClients(connection, &request);
+    } else if (strcmp(request.query, "client_by_uid") == 0) {
+        answerClientByUniqueID(connection, &request);
+    } else {
+        answerError(connection, &request, request.query[0] ? "unknown query" : "missing query");
+    }
+}
+
+/*********************************** Worker ************************************/
+
+static size_t pendingOutput(const struct QueryConnection* connection) {
+    return connection->outputLength - connection->outputSent;
+}
+
+/* Answers complete lines in order until the pending output reaches the limit */
+static void answerLines(struct QueryConnection* connection) {
+    size_t start = 0;
+    while (start < connection->inputLength && pendingOutput(connection) < QUERY_OUTPUT_LIMIT && !connection->closing) {
+        char* newline = (char*)memchr(connection->input + start, '\n', connection->inputLength - start);
+        if (!newline) break;
+        *newline = '\0';
+        if (newline > connection->input + start && newline[-1] == '\r') newline[-1] = '\0';
+        if (connection->input[start]) answerLine(connection, connection->input + start);
+        start = (size_t)(newline - connection->input) + 1;
+    }
+    memmove(connection->input, connection->input + start, connection->inputLength - start);
+    connection->inputLength -= start;
+    if (connection->inputLength == QUERY_INPUT_BUFSIZE) {
+        struct QueryRequest request = {0};
+        answerError(connection, &request, "request too long");
+        connection->closing = true;
+    }
+}
+
+/* Returns false once the connection failed, a peer that finished sending still gets its answers */
+static bool receive(struct QueryConnection* connection) {
+    const ssize_t received = recv(connection->fd, connection->input + connection->inputLength, QUERY_INPUT_BUFSIZE - connection->inputLength, 0);
+    if (received > 0) {
+        connection->inputLength += (size_t)received;
+        return true;
+    }
+    if (received == 0) {
+        /* A last line without a newline is still a request */
+        if (connection->inputLength > 0 && connection->inputLength < QUERY_INPUT_BUFSIZE && connection->input[connection->inputLength - 1] != '\n') connection->input[connection->inputLength++] = '\n';
+        connection->ended = true;
+        return true;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static bool flush(struct QueryConnection* connection) {
+    while (pendingOutput(connection) > 0) {
+        const ssize_t sent = send(connection->fd, connection->output + connection->outputSent, pendingOutput(connection), MSG_NOSIGNAL);
+        if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        connection->outputSent += (size_t)sent;
+    }
+    connection->outputLength = 0;
+    connection->outputSent   = 0;
+    return true;
+}
+
+static void closeConnection(size_t slot) {
+    close(connections[slot]->fd);
+    free(connections[slot]->output);
+    free(connections[slot]);
+    connections[slot] = NULL;
+}
+
+static void acceptConnections(void) {
+    for (;;) {
+        const int fd = accept(listenSocket, NULL, NULL);
+        if (fd < 0) return;
+        size_t slot = 0;
+        while (slot < QUERY_MAX_CONNECTIONS && connections[slot]) ++slot;
+        struct QueryConnection* connection = slot < QUERY_MAX_CONNECTIONS ? (struct QueryConnection*)calloc(1, sizeof(struct QueryConnection)) : NULL;
+        if (!connection) {
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        const int enabled = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+        connection->fd    = fd;
+        connections[slot] = connection;
+    }
+}
+
+static int workerMain(void* argument) {
+    struct pollfd polled[QUERY_MAX_CONNECTIONS + 1];
+    size_t        slots[QUERY_MAX_CONNECTIONS + 1];
+    while (atomic_load(&running)) {
+        size_t count = 0;
+        polled[count++] = (struct pollfd){listenSocket, POLLIN, 0};
+        for (size_t slot = 0; slot < QUERY_MAX_CONNECTIONS; ++slot) {
+            if (!connections[slot]) continue;
+            short events = 0;
+            if (!connections[slot]->closing && !connections[slot]->ended && pendingOutput(connections[slot]) < QUERY_OUTPUT_LIMIT) events |= POLLIN;
+            if (pendingOutput(connections[slot]) > 0) events |= POLLOUT;
+            slots[count]    = slot;
+            polled[count++] = (struct pollfd){connections[slot]->fd, events, 0};
+        }
+        if (poll(polled, (nfds_t)count, QUERY_POLL_TIMEOUT) < 0 && errno != EINTR) break;
+        if (polled[0].revents & POLLIN) acceptConnections();
+
+        for (size_t index = 1; index < count; ++index) {
+            struct QueryConnection* connection = connections[slots[index]];
+            bool                    open       = true;
+            if (polled[index].revents & (POLLIN | POLLHUP | POLLERR) && !connection->ended) open = receive(connection);
+            /* Lines held back by the output limit are answered as soon as the output drained, no further event announces them */
+            do {
+                answerLines(connection);
+                if (open) open = flush(connection) && !connection->outputFailed;
+            } while (open && !connection->closing && pendingOutput(connection) == 0 && memchr(connection->input, '\n', connection->inputLength));
+            const bool done = connection->closing || (connection->ended && connection->inputLength == 0);
+            if (!open || (done && pendingOutput(connection) == 0)) closeConnection(slots[index]);
+        }
+    }
+    for (size_t slot = 0; slot < QUERY_MAX_CONNECTIONS; ++slot) {
+        if (connections[slot]) closeConnection(slot);
+    }
+    return 0;
+}
+
+void queryInit(bool enabled) {
+    if (!enabled) return;
+    struct sockaddr_un address = {0};
+    address.sun_family         = AF_UNIX;
+    if (!storagePath(socketPath, sizeof(socketPath), QUERY_SOCKET) || strlen(socketPath) >= sizeof(address.sun_path)) return;
+    memcpy(address.sun_path, socketPath, strlen(socketPath) + 1);
+
+    /* A socket left behind by a crashed client would make the bind fail */
+    struct stat status;
+    if (lstat(socketPath, &status) == 0 && S_ISSOCK(status.st_mode)) unlink(socketPath);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        LOG(LOG_WARNING, "query_socket_failed", "path=%s errno=%d", socketPath, errno);
+        return;
+    }
+    fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL) | O_NONBLOCK);
+    fcntl(listenSocket, F_SETFD, FD_CLOEXEC);
+    if (bind(listenSocket, (const struct sockaddr*)&address, sizeof(address)) != 0 || chmod(socketPath, S_IRUSR | S_IWUSR) != 0 || listen(listenSocket, QUERY_MAX_CONNECTIONS) != 0) {
+        LOG(LOG_WARNING, "query_socket_failed", "path=%s errno=%d", socketPath, errno);
+        close(listenSocket);
+        listenSocket = -1;
+        return;
+    }
+    atomic_store(&running, true);
+    if (thrd_create(&workerThread, workerMain, NULL) != thrd_success) {
+        atomic_store(&running, false);
+        close(listenSocket);
+        listenSocket = -1;
+        unlink(socketPath);
+        return;
+    }
+    LOG(LOG_INFO, "query_socket_listening", "path=%s", socketPath);
+}
+
+void queryShutdown(void) {
+    if (listenSocket < 0) return;
+    atomic_store(&running, false);
+    thrd_join(workerThread, NULL);
+    close(listenSocket);
+    listenSocket = -1;
+    unlink(socketPath);
+}
+
+bool queryRunning(void) {
+    return atomic_load(&running);
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Local query endpoint on the Unix domain socket AdvancedInformation/query.sock, not available on Windows
+ *
+ * A worker thread accepts connections and answers one JSON object per line with one JSON line, in order,
+ * so requests can be pipelined. Answers are serialised from the cache straight into the output buffer of
+ * the connection and sent from there. Queries:
+ *   {"query": "servers"}
+ *   {"query": "server_summary", "server": <connection>}
+ *   {"query": "channel_clients", "server": <connection>, "channel": <channel id>}
+ *   {"query": "client_by_uid", "uid": "<unique identifier>"}
+ * An optional "id" string or number is echoed in the answer.
+ */
+void queryInit(bool enabled);
+void queryShutdown(void);
+
+/* Whether the socket is listening */
+bool queryRunning(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,428 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "plugin.h"
+#include "recorder.h"
+#include "timing.h"
+
+#define RECORD_ENVIRONMENT "ADVANCEDINFORMATION_RECORD"
+#define RECORD_FILE_BUFSIZE 65536
+
+static struct TS3Functions host;
+static mtx_t               recordMutex;
+static FILE*               recordFile = NULL;
+static atomic_bool         recording  = false;
+static atomic_uint         threadCount;
+
+static thread_local uint32_t threadNumber = 0;
+
+/*
+ * Writer format characters, stored with the tags of recordformat.h:
+ * 'U' uint64, 'I' int, 'D' double, 'S' const char*, 'a' zero terminated anyID list, 'c' zero terminated uint64 list
+ */
+
+static size_t fieldsSize(const char* format, va_list args) {
+    size_t size = 0;
+    for (const char* field = format; *field; ++field) {
+        switch (*field) {
+            case 'U':
+                va_arg(args, uint64);
+                size += 1 + sizeof(uint64_t);
+                break;
+            case 'I':
+                va_arg(args, int);
+                size += 1 + sizeof(int64_t);
+                break;
+            case 'D':
+                va_arg(args, double);
+                size += 1 + sizeof(double);
+                break;
+            case 'S': {
+                const char* text = va_arg(args, const char*);
+                size += 1 + sizeof(uint32_t) + (text ? strlen(text) + 1 : 0);
+                break;
+            }
+            case 'a': {
+                const anyID* list  = va_arg(args, const anyID*);
+                size_t       count = 0;
+                while (list && list[count]) ++count;
+                size += 1 + sizeof(uint32_t) + count * sizeof(uint64_t);
+                break;
+            }
+            case 'c': {
+                const uint64* list  = va_arg(args, const uint64*);
+                size_t        count = 0;
+                while (list && list[count]) ++count;
+                size += 1 + sizeof(uint32_t) + count * sizeof(uint64_t);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+static void writeTagged(char tag, const void* value, size_t size) {
+    fputc(tag, recordFile);
+    fwrite(value, size, 1, recordFile);
+}
+
+static void writeFields(const char* format, va_list args) {
+    for (const char* field = format; *field; ++field) {
+        switch (*field) {
+            case 'U': {
+                const uint64_t value = va_arg(args, uint64);
+                writeTagged('U', &value, sizeof(value));
+                break;
+            }
+            case 'I': {
+                const int64_t value = va_arg(args, int);
+                writeTagged('I', &value, sizeof(value));
+                break;
+            }
+            case 'D': {
+                const double value = va_arg(args, double);
+                writeTagged('D', &value, sizeof(value));
+                break;
+            }
+            case 'S': {
+                const char*    text   = va_arg(args, const char*);
+                const uint32_t length = text ? (uint32_t)strlen(text) : RECORD_NULL_STRING;
+                writeTagged('S', &length, sizeof(length));
+                if (text) fwrite(text, 1, (size_t)length + 1, recordFile);
+                break;
+            }
+            case 'a': {
+                const anyID* list  = va_arg(args, const anyID*);
+                uint32_t     count = 0;
+                while (list && list[count]) ++count;
+                writeTagged('L', &count, sizeof(count));
+                for (uint32_t index = 0; index < count; ++index) {
+                    const uint64_t value = list[index];
+                    fwrite(&value, sizeof(value), 1, recordFile);
+                }
+                break;
+            }
+            case 'c': {
+                const uint64* list  = va_arg(args, const uint64*);
+                uint32_t      count = 0;
+                while (list && list[count]) ++count;
+                writeTagged('L', &count, sizeof(count));
+                if (count) fwrite(list, sizeof(uint64_t), count, recordFile);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+static void writeEvent(enum RecordEventKind kind, uint16_t id, const char* format, va_list args) {
+    if (threadNumber == 0) threadNumber = atomic_fetch_add(&threadCount, 1) + 1;
+
+    va_list counted;
+    va_copy(counted, args);
+    struct RecordEventHeader header = {0};
+    header.size                     = (uint32_t)fieldsSize(format, counted);
+    header.kind                     = (uint16_t)kind;
+    header.id                       = id;
+    header.thread                   = threadNumber;
+    header.monotonicNs              = timingMonotonicNs();
+    va_end(counted);
+
+    mtx_lock(&recordMutex);
+    if (recordFile) {
+        fwrite(&header, sizeof(header), 1, recordFile);
+        writeFields(format, args);
+    }
+    mtx_unlock(&recordMutex);
+}
+
+static void recordHost(enum RecordHost function, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    writeEvent(RECORD_KIND_HOST, (uint16_t)function, format, args);
+    va_end(args);
+}
+
+bool recorderActive(void) {
+    return atomic_load_explicit(&recording, memory_order_relaxed);
+}
+
+void recorderEntry(enum RecordEntry entry, const char* format, ...) {
+    if (!atomic_load_explicit(&recording, memory_order_relaxed)) return;
+    va_list args;
+    va_start(args, format);
+    writeEvent(RECORD_KIND_ENTRY, (uint16_t)entry, format, args);
+    va_end(args);
+}
+
+/*********************************** Host function wrappers ************************************/
+
+static void recordGetAppPath(char* path, size_t maxLen) {
+    host.getAppPath(path, maxLen);
+    recordHost(RECORD_HOST_GET_APP_PATH, "US", (uint64)ERROR_ok, path);
+}
+
+static void recordGetResourcesPath(char* path, size_t maxLen) {
+    host.getResourcesPath(path, maxLen);
+    recordHost(RECORD_HOST_GET_RESOURCES_PATH, "US", (uint64)ERROR_ok, path);
+}
+
+static void recordGetConfigPath(char* path, size_t maxLen) {
+    host.getConfigPath(path, maxLen);
+    recordHost(RECORD_HOST_GET_CONFIG_PATH, "US", (uint64)ERROR_ok, path);
+}
+
+static void recordGetPluginPath(char* path, size_t maxLen, const char* id) {
+    host.getPluginPath(path, maxLen, id);
+    recordHost(RECORD_HOST_GET_PLUGIN_PATH, "US", (uint64)ERROR_ok, path);
+}
+
+static unsigned int recordGetServerConnectionHandlerList(uint64** result) {
+    const unsigned int error = host.getServerConnectionHandlerList(result);
+    recordHost(RECORD_HOST_GET_SERVER_CONNECTION_HANDLER_LIST, "Uc", (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetConnectionStatus(uint64 serverConnectionHandlerID, int* result) {
+    const unsigned int error = host.getConnectionStatus(serverConnectionHandlerID, result);
+    recordHost(RECORD_HOST_GET_CONNECTION_STATUS, "UUI", serverConnectionHandlerID, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetClientID(uint64 serverConnectionHandlerID, anyID* result) {
+    const unsigned int error = host.getClientID(serverConnectionHandlerID, result);
+    recordHost(RECORD_HOST_GET_CLIENT_ID, "UUU", serverConnectionHandlerID, (uint64)error, (uint64)(error == ERROR_ok ? *result : 0));
+    return error;
+}
+
+static unsigned int recordGetClientList(uint64 serverConnectionHandlerID, anyID** result) {
+    const unsigned int error = host.getClientList(serverConnectionHandlerID, result);
+    recordHost(RECORD_HOST_GET_CLIENT_LIST, "UUa", serverConnectionHandlerID, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetChannelList(uint64 serverConnectionHandlerID, uint64** result) {
+    const unsigned int error = host.getChannelList(serverConnectionHandlerID, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_LIST, "UUc", serverConnectionHandlerID, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetChannelClientList(uint64 serverConnectionHandlerID, uint64 channelID, anyID** result) {
+    const unsigned int error = host.getChannelClientList(serverConnectionHandlerID, channelID, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_CLIENT_LIST, "UUUa", serverConnectionHandlerID, channelID, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetChannelOfClient(uint64 serverConnectionHandlerID, anyID clientID, uint64* result) {
+    const unsigned int error = host.getChannelOfClient(serverConnectionHandlerID, clientID, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_OF_CLIENT, "UUUU", serverConnectionHandlerID, (uint64)clientID, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetParentChannelOfChannel(uint64 serverConnectionHandlerID, uint64 channelID, uint64* result) {
+    const unsigned int error = host.getParentChannelOfChannel(serverConnectionHandlerID, channelID, result);
+    recordHost(RECORD_HOST_GET_PARENT_CHANNEL_OF_CHANNEL, "UUUU", serverConnectionHandlerID, channelID, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetClientVariableAsInt(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, int* result) {
+    const unsigned int error = host.getClientVariableAsInt(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CLIENT_VARIABLE_AS_INT, "UUUUI", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetClientVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    const unsigned int error = host.getClientVariableAsUInt64(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CLIENT_VARIABLE_AS_UINT64, "UUUUU", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetClientVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    const unsigned int error = host.getClientVariableAsString(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CLIENT_VARIABLE_AS_STRING, "UUUUS", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetChannelVariableAsInt(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, int* result) {
+    const unsigned int error = host.getChannelVariableAsInt(serverConnectionHandlerID, channelID, flag, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_INT, "UUUUI", serverConnectionHandlerID, channelID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetChannelVariableAsUInt64(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, uint64* result) {
+    const unsigned int error = host.getChannelVariableAsUInt64(serverConnectionHandlerID, channelID, flag, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_UINT64, "UUUUU", serverConnectionHandlerID, channelID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetChannelVariableAsString(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, char** result) {
+    const unsigned int error = host.getChannelVariableAsString(serverConnectionHandlerID, channelID, flag, result);
+    recordHost(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_STRING, "UUUUS", serverConnectionHandlerID, channelID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetServerVariableAsString(uint64 serverConnectionHandlerID, size_t flag, char** result) {
+    const unsigned int error = host.getServerVariableAsString(serverConnectionHandlerID, flag, result);
+    recordHost(RECORD_HOST_GET_SERVER_VARIABLE_AS_STRING, "UUUS", serverConnectionHandlerID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordGetConnectionVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    const unsigned int error = host.getConnectionVariableAsUInt64(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_UINT64, "UUUUU", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0);
+    return error;
+}
+
+static unsigned int recordGetConnectionVariableAsDouble(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, double* result) {
+    const unsigned int error = host.getConnectionVariableAsDouble(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_DOUBLE, "UUUUD", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : 0.0);
+    return error;
+}
+
+static unsigned int recordGetConnectionVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    const unsigned int error = host.getConnectionVariableAsString(serverConnectionHandlerID, clientID, flag, result);
+    recordHost(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_STRING, "UUUUS", serverConnectionHandlerID, (uint64)clientID, (uint64)flag, (uint64)error, error == ERROR_ok ? *result : NULL);
+    return error;
+}
+
+static unsigned int recordRequestConnectionInfo(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    const unsigned int error = host.requestConnectionInfo(serverConnectionHandlerID, clientID, returnCode);
+    recordHost(RECORD_HOST_REQUEST_CONNECTION_INFO, "UUU", serverConnectionHandlerID, (uint64)clientID, (uint64)error);
+    return error;
+}
+
+static unsigned int recordRequestBanList(uint64 serverConnectionHandlerID, uint64 start, unsigned int duration, const char* returnCode) {
+    const unsigned int error = host.requestBanList(serverConnectionHandlerID, start, duration, returnCode);
+    recordHost(RECORD_HOST_REQUEST_BAN_LIST, "UUUU", serverConnectionHandlerID, start, (uint64)duration, (uint64)error);
+    return error;
+}
+
+static unsigned int recordRequestChannelDescription(uint64 serverConnectionHandlerID, uint64 channelID, const char* returnCode) {
+    const unsigned int error = host.requestChannelDescription(serverConnectionHandlerID, channelID, returnCode);
+    recordHost(RECORD_HOST_REQUEST_CHANNEL_DESCRIPTION, "UUU", serverConnectionHandlerID, channelID, (uint64)error);
+    return error;
+}
+
+static unsigned int recordRequestClientVariables(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    const unsigned int error = host.requestClientVariables(serverConnectionHandlerID, clientID, returnCode);
+    recordHost(RECORD_HOST_REQUEST_CLIENT_VARIABLES, "UUU", serverConnectionHandlerID, (uint64)clientID, (uint64)error);
+    return error;
+}
+
+static unsigned int recordRequestInfoUpdate(uint64 serverConnectionHandlerID, enum PluginItemType itemType, uint64 itemID) {
+    const unsigned int error = host.requestInfoUpdate(serverConnectionHandlerID, itemType, itemID);
+    recordHost(RECORD_HOST_REQUEST_INFO_UPDATE, "UIUU", serverConnectionHandlerID, (int)itemType, itemID, (uint64)error);
+    return error;
+}
+
+static unsigned int recordRequestSendPrivateTextMsg(uint64 serverConnectionHandlerID, const char* message, anyID targetClientID, const char* returnCode) {
+    const unsigned int error = host.requestSendPrivateTextMsg(serverConnectionHandlerID, message, targetClientID, returnCode);
+    recordHost(RECORD_HOST_REQUEST_SEND_PRIVATE_TEXT_MSG, "UUU", serverConnectionHandlerID, (uint64)targetClientID, (uint64)error);
+    return error;
+}
+
+static void recordSendPluginCommand(uint64 serverConnectionHandlerID, const char* id, const char* command, int targetMode, const anyID* targetIDs, const char* returnCode) {
+    host.sendPluginCommand(serverConnectionHandlerID, id, command, targetMode, targetIDs, returnCode);
+    recordHost(RECORD_HOST_SEND_PLUGIN_COMMAND, "UIU", serverConnectionHandlerID, targetMode, (uint64)ERROR_ok);
+}
+
+static void recordPrintMessageToCurrentTab(const char* message) {
+    host.printMessageToCurrentTab(message);
+    recordHost(RECORD_HOST_PRINT_MESSAGE_TO_CURRENT_TAB, "U", (uint64)ERROR_ok);
+}
+
+static void recordSetPluginMenuEnabled(const char* id, int menuID, int enabled) {
+    host.setPluginMenuEnabled(id, menuID, enabled);
+    recordHost(RECORD_HOST_SET_PLUGIN_MENU_ENABLED, "IIU", menuID, enabled, (uint64)ERROR_ok);
+}
+
+static void recordCreateReturnCode(const char* id, char* returnCode, size_t maxLen) {
+    host.createReturnCode(id, returnCode, maxLen);
+    recordHost(RECORD_HOST_CREATE_RETURN_CODE, "US", (uint64)ERROR_ok, returnCode);
+}
+
+static void recordPrintMessage(uint64 serverConnectionHandlerID, const char* message, enum PluginMessageTarget messageTarget) {
+    host.printMessage(serverConnectionHandlerID, message, messageTarget);
+    recordHost(RECORD_HOST_PRINT_MESSAGE, "UIU", serverConnectionHandlerID, (int)messageTarget, (uint64)ERROR_ok);
+}
+
+/*********************************** Recording control ************************************/
+
+void recorderInit(void) {
+    const char* path = getenv(RECORD_ENVIRONMENT);
+    if (!path || !path[0] || atomic_load(&recording)) return;
+
+    recordFile = fopen(path, "wb");
+    if (!recordFile) return;
+    setvbuf(recordFile, NULL, _IOFBF, RECORD_FILE_BUFSIZE);
+    struct RecordFileHeader header = {0};
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version   = RECORD_VERSION;
+    header.createdAt = timingWallclockNs();
+    fwrite(&header, sizeof(header), 1, recordFile);
+    mtx_init(&recordMutex, mtx_plain);
+
+    /* Calls through ts3Functions now pass the wrappers, the plugin code itself is unchanged */
+    host                                         = ts3Functions;
+    ts3Functions.getAppPath                      = recordGetAppPath;
+    ts3Functions.getResourcesPath                = recordGetResourcesPath;
+    ts3Functions.getConfigPath                   = recordGetConfigPath;
+    ts3Functions.getPluginPath                   = recordGetPluginPath;
+    ts3Functions.getServerConnectionHandlerList  = recordGetServerConnectionHandlerList;
+    ts3Functions.getConnectionStatus             = recordGetConnectionStatus;
+    ts3Functions.getClientID                     = recordGetClientID;
+    ts3Functions.getClientList                   = recordGetClientList;
+    ts3Functions.getChannelList                  = recordGetChannelList;
+    ts3Functions.getChannelClientList            = recordGetChannelClientList;
+    ts3Functions.getChannelOfClient              = recordGetChannelOfClient;
+    ts3Functions.getParentChannelOfChannel       = recordGetParentChannelOfChannel;
+    ts3Functions.getClientVariableAsInt          = recordGetClientVariableAsInt;
+    ts3Functions.getClientVariableAsUInt64       = recordGetClientVariableAsUInt64;
+    ts3Functions.getClientVariableAsString       = recordGetClientVariableAsString;
+    ts3Functions.getChannelVariableAsInt         = recordGetChannelVariableAsInt;
+    ts3Functions.getChannelVariableAsUInt64      = recordGetChannelVariableAsUInt64;
+    ts3Functions.getChannelVariableAsString      = recordGetChannelVariableAsString;
+    ts3Functions.getServerVariableAsString       = recordGetServerVariableAsString;
+    ts3Functions.getConnectionVariableAsUInt64   = recordGetConnectionVariableAsUInt64;
+    ts3Functions.getConnectionVariableAsDouble   = recordGetConnectionVariableAsDouble;
+    ts3Functions.getConnectionVariableAsString   = recordGetConnectionVariableAsString;
+    ts3Functions.requestConnectionInfo           = recordRequestConnectionInfo;
+    ts3Functions.requestChannelDescription       = recordRequestChannelDescription;
+    ts3Functions.requestClientVariables          = recordRequestClientVariables;
+    ts3Functions.requestBanList                  = recordRequestBanList;
+    ts3Functions.requestInfoUpdate               = recordRequestInfoUpdate;
+    ts3Functions.requestSendPrivateTextMsg       = recordRequestSendPrivateTextMsg;
+    ts3Functions.sendPluginCommand               = recordSendPluginCommand;
+    ts3Functions.printMessageToCurrentTab        = recordPrintMessageToCurrentTab;
+    ts3Functions.setPluginMenuEnabled            = recordSetPluginMenuEnabled;
+    ts3Functions.printMessage                    = recordPrintMessage;
+    ts3Functions.createReturnCode                = recordCreateReturnCode;
+    atomic_store(&recording, true);
+}
+
+void recorderShutdown(void) {
+    if (!atomic_exchange(&recording, false)) return;
+    ts3Functions = host;
+    mtx_lock(&recordMutex);
+    fclose(recordFile);
+    recordFile = NULL;
+    mtx_unlock(&recordMutex);
+    mtx_destroy(&recordMutex);
+}
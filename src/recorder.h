@@ -0,0 +1,29 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "recordformat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Starts recording if ADVANCEDINFORMATION_RECORD names an output file, wraps the host functions */
+void recorderInit(void);
+void recorderShutdown(void);
+
+/* Whether host calls are being recorded */
+bool recorderActive(void);
+
+/* Records an entry point, the format lists the argument fields described in recordformat.h */
+void recorderEntry(enum RecordEntry entry, const char* format, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef RECORDFORMAT_H
+#define RECORDFORMAT_H
+
+#include <stdint.h>
+
+/*
+ * Callback recording file, little endian
+ *
+ * A header is followed by events in the order they were recorded. Entry events hold the arguments of a
+ * plugin entry point, host events hold the result of a TS3Functions call made by the plugin and belong
+ * to the last entry event of the same thread.
+ *
+ * Payloads are sequences of tagged fields:
+ *   'U' unsigned 64 bit value, 'I' signed 64 bit value, 'D' double
+ *   'S' uint32 length followed by the bytes and a NUL, length UINT32_MAX for a NULL string
+ *   'L' uint32 count followed by unsigned 64 bit values
+ *
+ * Host payloads hold the numeric arguments, then the returned error code ('U', 0 for void functions),
+ * then the output values. Outputs of failed calls are recorded as 0, NULL or empty lists.
+ */
+
+#define RECORD_MAGIC "AIRC"
+#define RECORD_VERSION 1
+#define RECORD_NULL_STRING UINT32_MAX
+
+enum RecordEventKind {
+    RECORD_KIND_ENTRY = 1,
+    RECORD_KIND_HOST
+};
+
+/* Plugin entry points with their argument fields */
+enum RecordEntry {
+    RECORD_ENTRY_INIT = 1,                 /* - */
+    RECORD_ENTRY_SHUTDOWN,                 /* - */
+    RECORD_ENTRY_INFO_DATA,                /* U sch, U id, I type */
+    RECORD_ENTRY_INIT_MENUS,               /* - */
+    RECORD_ENTRY_MENU_ITEM,                /* U sch, I type, I menuItemID, U selectedItemID */
+    RECORD_ENTRY_CONNECT_STATUS,           /* U sch, I newStatus, U errorNumber */
+    RECORD_ENTRY_CLIENT_MOVE,              /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, S moveMessage */
+    RECORD_ENTRY_CLIENT_MOVE_SUBSCRIPTION, /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility */
+    RECORD_ENTRY_CLIENT_MOVE_TIMEOUT,      /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, S timeoutMessage */
+    RECORD_ENTRY_CLIENT_MOVE_MOVED,        /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, U moverID, S moverName, S moverUID, S moveMessage */
+    RECORD_ENTRY_CLIENT_KICK_CHANNEL,      /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, U kickerID, S kickerName, S kickerUID, S kickMessage */
+    RECORD_ENTRY_CLIENT_KICK_SERVER,       /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, U kickerID, S kickerName, S kickerUID, S kickMessage */
+    RECORD_ENTRY_CLIENT_BAN,               /* U sch, U clientID, U oldChannelID, U newChannelID, I visibility, U kickerID, S kickerName, S kickerUID, U time, S kickMessage */
+    RECORD_ENTRY_CLIENT_DISPLAY_NAME,      /* U sch, U clientID, S displayName, S uniqueClientIdentifier */
+    RECORD_ENTRY_NEW_CHANNEL,              /* U sch, U channelID, U channelParentID */
+    RECORD_ENTRY_NEW_CHANNEL_CREATED,      /* U sch, U channelID, U channelParentID, U invokerID, S invokerName, S invokerUID */
+    RECORD_ENTRY_DEL_CHANNEL,              /* U sch, U channelID, U invokerID, S invokerName, S invokerUID */
+    RECORD_ENTRY_CHANNEL_MOVE,             /* U sch, U channelID, U newChannelParentID, U invokerID, S invokerName, S invokerUID */
+    RECORD_ENTRY_UPDATE_CHANNEL,           /* U sch, U channelID */
+    RECORD_ENTRY_UPDATE_CHANNEL_EDITED,    /* U sch, U channelID, U invokerID, S invokerName, S invokerUID */
+    RECORD_ENTRY_UPDATE_CLIENT,            /* U sch, U clientID, U invokerID, S invokerName, S invokerUID */
+    RECORD_ENTRY_CONNECTION_INFO,          /* U sch, U clientID */
+    RECORD_ENTRY_PLUGIN_COMMAND,           /* U sch, S pluginName, S pluginCommand, U invokerClientID, S invokerName, S invokerUID */
+    RECORD_ENTRY_TALK_STATUS,              /* U sch, I status, I isReceivedWhisper, U clientID */
+    RECORD_ENTRY_BAN_LIST,                 /* U sch, U banID, S ip, S name, S uid, S mytsid, U creationTime, U durationTime, S invokerName, U invokerDatabaseID, S invokerUID, S reason, I enforcements, S lastNickname */
+    RECORD_ENTRY_SERVER_ERROR              /* U sch, S errorMessage, U error, S returnCode, S extraMessage */
+};
+
+/* Host functions with their argument | output fields */
+enum RecordHost {
+    RECORD_HOST_GET_APP_PATH = 1,                   /* - | S path */
+    RECORD_HOST_GET_RESOURCES_PATH,                 /* - | S path */
+    RECORD_HOST_GET_CONFIG_PATH,                    /* - | S path */
+    RECORD_HOST_GET_PLUGIN_PATH,                    /* - | S path */
+    RECORD_HOST_GET_SERVER_CONNECTION_HANDLER_LIST, /* - | L handlers */
+    RECORD_HOST_GET_CONNECTION_STATUS,              /* U sch | I status */
+    RECORD_HOST_GET_CLIENT_ID,                      /* U sch | U clientID */
+    RECORD_HOST_GET_CLIENT_LIST,                    /* U sch | L clientIDs */
+    RECORD_HOST_GET_CHANNEL_LIST,                   /* U sch | L channelIDs */
+    RECORD_HOST_GET_CHANNEL_OF_CLIENT,              /* U sch, U clientID | U channelID */
+    RECORD_HOST_GET_PARENT_CHANNEL_OF_CHANNEL,      /* U sch, U channelID | U parentID */
+    RECORD_HOST_GET_CLIENT_VARIABLE_AS_INT,         /* U sch, U clientID, U flag | I value */
+    RECORD_HOST_GET_CLIENT_VARIABLE_AS_UINT64,      /* U sch, U clientID, U flag | U value */
+    RECORD_HOST_GET_CLIENT_VARIABLE_AS_STRING,      /* U sch, U clientID, U flag | S value */
+    RECORD_HOST_GET_CHANNEL_VARIABLE_AS_INT,        /* U sch, U channelID, U flag | I value */
+    RECORD_HOST_GET_CHANNEL_VARIABLE_AS_UINT64,     /* U sch, U channelID, U flag | U value */
+    RECORD_HOST_GET_CHANNEL_VARIABLE_AS_STRING,     /* U sch, U channelID, U flag | S value */
+    RECORD_HOST_GET_SERVER_VARIABLE_AS_STRING,      /* U sch, U flag | S value */
+    RECORD_HOST_GET_CONNECTION_VARIABLE_AS_UINT64,  /* U sch, U clientID, U flag | U value */
+    RECORD_HOST_GET_CONNECTION_VARIABLE_AS_DOUBLE,  /* U sch, U clientID, U flag | D value */
+    RECORD_HOST_REQUEST_CONNECTION_INFO,            /* U sch, U clientID | - */
+    RECORD_HOST_REQUEST_CLIENT_VARIABLES,           /* U sch, U clientID | - */
+    RECORD_HOST_REQUEST_INFO_UPDATE,                /* U sch, I itemType, U itemID | - */
+    RECORD_HOST_REQUEST_SEND_PRIVATE_TEXT_MSG,      /* U sch, U targetClientID | - */
+    RECORD_HOST_SEND_PLUGIN_COMMAND,                /* U sch, I targetMode | - */
+    RECORD_HOST_PRINT_MESSAGE_TO_CURRENT_TAB,       /* - | - */
+    RECORD_HOST_SET_PLUGIN_MENU_ENABLED,            /* I menuID, I enabled | - */
+    RECORD_HOST_PRINT_MESSAGE,                      /* U sch, I messageTarget | - */
+    RECORD_HOST_GET_CONNECTION_VARIABLE_AS_STRING,  /* U sch, U clientID, U flag | S value */
+    RECORD_HOST_REQUEST_BAN_LIST,                   /* U sch, U start, U duration | - */
+    RECORD_HOST_REQUEST_CHANNEL_DESCRIPTION,        /* U sch, U channelID | - */
+    RECORD_HOST_GET_CHANNEL_CLIENT_LIST,            /* U sch, U channelID | L clientIDs */
+    RECORD_HOST_CREATE_RETURN_CODE                  /* - | S returnCode */
+};
+
+struct RecordFileHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t createdAt; /* Unix time in nanoseconds */
+};
+
+struct RecordEventHeader {
+    uint32_t size; /* Payload bytes following the header */
+    uint16_t kind;
+    uint16_t id;
+    uint32_t thread; /* Recording thread, numbered from 1 */
+    uint32_t reserved;
+    uint64_t monotonicNs;
+};
+
+_Static_assert(sizeof(struct RecordFileHeader) == 16, "record header must not contain padding");
+_Static_assert(sizeof(struct RecordEventHeader) == 24, "record event headers must not contain padding");
+
+#endif
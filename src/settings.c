@@ -0,0 +1,74 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+#include "storage.h"
+
+#define SETTINGS_FILE "settings.ini"
+#define SETTINGS_PATH_BUFSIZE 512
+#define SETTINGS_LINE_BUFSIZE 256
+#define SETTINGS_KEY_BUFSIZE 64
+#define SETTINGS_VALUE_BUFSIZE 128
+#define SETTINGS_MAX_ENTRIES 64
+
+struct SettingsEntry {
+    char key[SETTINGS_KEY_BUFSIZE];
+    char value[SETTINGS_VALUE_BUFSIZE];
+};
+
+static struct SettingsEntry entries[SETTINGS_MAX_ENTRIES];
+static size_t               entryCount = 0;
+
+/* Removes leading and trailing whitespace in place */
+static char* trim(char* text) {
+    while (isspace((unsigned char)*text)) ++text;
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char)text[length - 1])) text[--length] = '\0';
+    return text;
+}
+
+static const char* findValue(const char* key) {
+    for (size_t index = 0; index < entryCount; ++index) {
+        if (strcmp(entries[index].key, key) == 0) return entries[index].value;
+    }
+    return NULL;
+}
+
+void settingsLoad(void) {
+    char path[SETTINGS_PATH_BUFSIZE];
+    entryCount = 0;
+    if (!storagePath(path, sizeof(path), SETTINGS_FILE)) return;
+    FILE* file = fopen(path, "r");
+    if (!file) return;
+
+    char line[SETTINGS_LINE_BUFSIZE];
+    while (entryCount < SETTINGS_MAX_ENTRIES && fgets(line, sizeof(line), file)) {
+        char* text = trim(line);
+        if (*text == '\0' || *text == '#' || *text == ';' || *text == '[') continue;
+        char* separator = strchr(text, '=');
+        if (!separator) continue;
+        *separator        = '\0';
+        const char* key   = trim(text);
+        const char* value = trim(separator + 1);
+        if (*key == '\0' || strlen(key) >= SETTINGS_KEY_BUFSIZE || strlen(value) >= SETTINGS_VALUE_BUFSIZE) continue;
+        strcpy(entries[entryCount].key, key);
+        strcpy(entries[entryCount].value, value);
+        ++entryCount;
+    }
+    fclose(file);
+}
+
+uint64_t settingsGetUnsigned(const char* key, uint64_t defaultValue) {
+    const char* value = findValue(key);
+    if (!value || !isdigit((unsigned char)*value)) return defaultValue;
+    char*                    end    = NULL;
+    const unsigned long long parsed = strtoull(value, &end, 10);
+    return *end == '\0' ? (uint64_t)parsed : defaultValue;
+}
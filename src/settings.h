@@ -0,0 +1,31 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional settings file AdvancedInformation/settings.ini in the Teamspeak config directory
+ *
+ * One "key = value" pair per line, lines starting with '#' or ';' and section headers are ignored.
+ * Unknown keys are ignored and missing or malformed values keep their defaults.
+ */
+
+/* Reads the settings file, called once after storageInit */
+void settingsLoad(void);
+
+uint64_t settingsGetUnsigned(const char* key, uint64_t defaultValue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,303 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "ts3_functions.h"
+
+#include "cache.h"
+#include "model.h"
+#include "plugin.h"
+#include "snapshot.h"
+#include "snapshotformat.h"
+#include "storage.h"
+#include "timing.h"
+
+#define SNAPSHOT_MAX_COLUMNS 32
+#define DICTIONARY_INITIAL_SLOTS 1024
+#define DICTIONARY_INITIAL_DATA 16384
+
+/* Deduplicated strings of a snapshot */
+struct StringDictionary {
+    uint32_t* slots; /* Open addressing, string index + 1, 0 if empty */
+    size_t    slotCount;
+    uint32_t* offsets;
+    size_t    count;
+    char*     data;
+    size_t    dataLength;
+    size_t    dataCapacity;
+    bool      failed;
+};
+
+/* A column pending to be written */
+struct PendingColumn {
+    uint32_t    id;
+    uint32_t    elementSize;
+    const void* data;
+    uint64_t    count;
+};
+
+/* Columns collected from the cache */
+struct SnapshotColumns {
+    struct StringDictionary strings;
+    size_t                  channelCount;
+    uint64_t*               channelIDs;
+    uint64_t*               channelParents;
+    uint64_t*               channelOrders;
+    uint32_t*               channelNames;
+    int32_t*                channelMaxClients;
+    uint32_t*               channelFlags;
+    size_t                  clientCount;
+    uint16_t*               clientIDs;
+    uint64_t*               clientChannels;
+    uint64_t*               clientDatabaseIDs;
+    uint32_t*               clientUniqueIDs;
+    uint32_t*               clientNicknames;
+    uint32_t*               clientCountries;
+    uint8_t*                clientTypes;
+    uint32_t*               clientFlags;
+};
+
+static size_t hashString(const char* text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)text; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+static bool initDictionary(struct StringDictionary* strings, size_t expected) {
+    strings->slotCount = DICTIONARY_INITIAL_SLOTS;
+    while (strings->slotCount < expected * 2) strings->slotCount *= 2;
+    strings->slots        = (uint32_t*)calloc(strings->slotCount, sizeof(uint32_t));
+    strings->offsets      = (uint32_t*)malloc((strings->slotCount / 2 + 1) * sizeof(uint32_t));
+    strings->dataCapacity = DICTIONARY_INITIAL_DATA;
+    strings->data         = (char*)malloc(strings->dataCapacity);
+    return strings->slots && strings->offsets && strings->data;
+}
+
+static void freeDictionary(struct StringDictionary* strings) {
+    free(strings->slots);
+    free(strings->offsets);
+    free(strings->data);
+}
+
+/* Doubles the slots once half of them are used */
+static bool growDictionary(struct StringDictionary* strings) {
+    const size_t slotCount = strings->slotCount * 2;
+    uint32_t*    slots     = (uint32_t*)calloc(slotCount, sizeof(uint32_t));
+    uint32_t*    offsets   = (uint32_t*)realloc(strings->offsets, (slotCount / 2 + 1) * sizeof(uint32_t));
+    if (offsets) strings->offsets = offsets;
+    if (!slots || !offsets) {
+        free(slots);
+        return false;
+    }
+    for (size_t index = 0; index < strings->count; ++index) {
+        size_t slot = hashString(strings->data + strings->offsets[index]) & (slotCount - 1);
+        while (slots[slot]) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = (uint32_t)index + 1;
+    }
+    free(strings->slots);
+    strings->slots     = slots;
+    strings->slotCount = slotCount;
+    return true;
+}
+
+/* Index of a string in the dictionary, adding it if needed */
+static uint32_t internString(struct StringDictionary* strings, const char* text) {
+    size_t slot = hashString(text) & (strings->slotCount - 1);
+    while (strings->slots[slot]) {
+        const uint32_t index = strings->slots[slot] - 1;
+        if (strcmp(strings->data + strings->offsets[index], text) == 0) return index;
+        slot = (slot + 1) & (strings->slotCount - 1);
+    }
+
+    const size_t length = strlen(text) + 1;
+    if (strings->dataLength + length > strings->dataCapacity) {
+        size_t capacity = strings->dataCapacity * 2;
+        while (capacity < strings->dataLength + length) capacity *= 2;
+        char* data = (char*)realloc(strings->data, capacity);
+        if (!data) {
+            strings->failed = true;
+            return 0;
+        }
+        strings->data         = data;
+        strings->dataCapacity = capacity;
+    }
+    memcpy(strings->data + strings->dataLength, text, length);
+    const uint32_t index    = (uint32_t)strings->count++;
+    strings->offsets[index] = (uint32_t)strings->dataLength;
+    strings->dataLength += length;
+    strings->slots[slot] = index + 1;
+
+    if (strings->count * 2 >= strings->slotCount && !growDictionary(strings)) strings->failed = true;
+    return index;
+}
+
+static void collectChannel(struct CachedChannel* channel, void* context) {
+    struct SnapshotColumns* columns = (struct SnapshotColumns*)context;
+    const size_t            row     = columns->channelCount++;
+    columns->channelIDs[row]        = channel->channelID;
+    columns->channelParents[row]    = channel->parentID;
+    columns->channelOrders[row]     = channel->order;
+    columns->channelNames[row]      = internString(&columns->strings, channel->name);
+    columns->channelMaxClients[row] = channel->maxClients;
+    columns->channelFlags[row]      = channel->flags;
+}
+
+static void collectClient(struct CachedClient* client, void* context) {
+    struct SnapshotColumns* columns = (struct SnapshotColumns*)context;
+    const size_t            row     = columns->clientCount++;
+    columns->clientIDs[row]         = client->clientID;
+    columns->clientChannels[row]    = client->channelID;
+    columns->clientDatabaseIDs[row] = client->databaseID;
+    columns->clientUniqueIDs[row]   = internString(&columns->strings, client->uniqueID);
+    columns->clientNicknames[row]   = internString(&columns->strings, client->nickname);
+    columns->clientCountries[row]   = internString(&columns->strings, client->country);
+    columns->clientTypes[row]       = (uint8_t)client->type;
+    columns->clientFlags[row]       = client->flags;
+}
+
+static bool allocateColumns(struct SnapshotColumns* columns, size_t channels, size_t clients) {
+    columns->channelIDs        = (uint64_t*)malloc(channels * sizeof(uint64_t) + 1);
+    columns->channelParents    = (uint64_t*)malloc(channels * sizeof(uint64_t) + 1);
+    columns->channelOrders     = (uint64_t*)malloc(channels * sizeof(uint64_t) + 1);
+    columns->channelNames      = (uint32_t*)malloc(channels * sizeof(uint32_t) + 1);
+    columns->channelMaxClients = (int32_t*)malloc(channels * sizeof(int32_t) + 1);
+    columns->channelFlags      = (uint32_t*)malloc(channels * sizeof(uint32_t) + 1);
+    columns->clientIDs         = (uint16_t*)malloc(clients * sizeof(uint16_t) + 1);
+    columns->clientChannels    = (uint64_t*)malloc(clients * sizeof(uint64_t) + 1);
+    columns->clientDatabaseIDs = (uint64_t*)malloc(clients * sizeof(uint64_t) + 1);
+    columns->clientUniqueIDs   = (uint32_t*)malloc(clients * sizeof(uint32_t) + 1);
+    columns->clientNicknames   = (uint32_t*)malloc(clients * sizeof(uint32_t) + 1);
+    columns->clientCountries   = (uint32_t*)malloc(clients * sizeof(uint32_t) + 1);
+    columns->clientTypes       = (uint8_t*)malloc(clients * sizeof(uint8_t) + 1);
+    columns->clientFlags       = (uint32_t*)malloc(clients * sizeof(uint32_t) + 1);
+    return columns->channelIDs && columns->channelParents && columns->channelOrders && columns->channelNames && columns->channelMaxClients && columns->channelFlags && columns->clientIDs && columns->clientChannels &&
+           columns->clientDatabaseIDs && columns->clientUniqueIDs && columns->clientNicknames && columns->clientCountries && columns->clientTypes && columns->clientFlags;
+}
+
+static void freeColumns(struct SnapshotColumns* columns) {
+    freeDictionary(&columns->strings);
+    free(columns->channelIDs);
+    free(columns->channelParents);
+    free(columns->channelOrders);
+    free(columns->channelNames);
+    free(columns->channelMaxClients);
+    free(columns->channelFlags);
+    free(columns->clientIDs);
+    free(columns->clientChannels);
+    free(columns->clientDatabaseIDs);
+    free(columns->clientUniqueIDs);
+    free(columns->clientNicknames);
+    free(columns->clientCountries);
+    free(columns->clientTypes);
+    free(columns->clientFlags);
+}
+
+static size_t alignOffset(size_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+/* Lays out header, directory and columns into one buffer and writes it */
+static bool writeSnapshot(const char* fileName, const struct SnapshotColumns* columns) {
+    const struct PendingColumn pending[] = {
+        {SNAPSHOT_STRING_OFFSETS, sizeof(uint32_t), columns->strings.offsets, columns->strings.count + 1},
+        {SNAPSHOT_STRING_DATA, sizeof(char), columns->strings.data, columns->strings.dataLength},
+        {SNAPSHOT_CHANNEL_ID, sizeof(uint64_t), columns->channelIDs, columns->channelCount},
+        {SNAPSHOT_CHANNEL_PARENT, sizeof(uint64_t), columns->channelParents, columns->channelCount},
+        {SNAPSHOT_CHANNEL_ORDER, sizeof(uint64_t), columns->channelOrders, columns->channelCount},
+        {SNAPSHOT_CHANNEL_NAME, sizeof(uint32_t), columns->channelNames, columns->channelCount},
+        {SNAPSHOT_CHANNEL_MAXCLIENTS, sizeof(int32_t), columns->channelMaxClients, columns->channelCount},
+        {SNAPSHOT_CHANNEL_FLAGS, sizeof(uint32_t), columns->channelFlags, columns->channelCount},
+        {SNAPSHOT_CLIENT_ID, sizeof(uint16_t), columns->clientIDs, columns->clientCount},
+        {SNAPSHOT_CLIENT_CHANNEL, sizeof(uint64_t), columns->clientChannels, columns->clientCount},
+        {SNAPSHOT_CLIENT_DATABASE_ID, sizeof(uint64_t), columns->clientDatabaseIDs, columns->clientCount},
+        {SNAPSHOT_CLIENT_UNIQUE_ID, sizeof(uint32_t), columns->clientUniqueIDs, columns->clientCount},
+        {SNAPSHOT_CLIENT_NICKNAME, sizeof(uint32_t), columns->clientNicknames, columns->clientCount},
+        {SNAPSHOT_CLIENT_COUNTRY, sizeof(uint32_t), columns->clientCountries, columns->clientCount},
+        {SNAPSHOT_CLIENT_TYPE, sizeof(uint8_t), columns->clientTypes, columns->clientCount},
+        {SNAPSHOT_CLIENT_FLAGS, sizeof(uint32_t), columns->clientFlags, columns->clientCount},
+    };
+    const size_t columnCount = sizeof(pending) / sizeof(pending[0]);
+
+    struct SnapshotColumn directory[SNAPSHOT_MAX_COLUMNS];
+    size_t                size = alignOffset(sizeof(struct SnapshotHeader) + columnCount * sizeof(struct SnapshotColumn));
+    for (size_t column = 0; column < columnCount; ++column) {
+        directory[column].id          = pending[column].id;
+        directory[column].elementSize = pending[column].elementSize;
+        directory[column].offset      = size;
+        directory[column].count       = pending[column].count;
+        size                          = alignOffset(size + pending[column].elementSize * pending[column].count);
+    }
+
+    unsigned char* buffer = (unsigned char*)calloc(1, size);
+    if (!buffer) return false;
+    struct SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version      = SNAPSHOT_VERSION;
+    header.createdAt    = timingWallclockNs();
+    header.channelCount = (uint32_t)columns->channelCount;
+    header.clientCount  = (uint32_t)columns->clientCount;
+    header.stringCount  = (uint32_t)columns->strings.count;
+    header.columnCount  = (uint32_t)columnCount;
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), directory, columnCount * sizeof(struct SnapshotColumn));
+    for (size_t column = 0; column < columnCount; ++column) {
+        memcpy(buffer + directory[column].offset, pending[column].data, pending[column].elementSize * pending[column].count);
+    }
+
+    const bool written = storageWriteFile(fileName, buffer, size);
+    free(buffer);
+    return written;
+}
+
+/* File name from the virtual server unique identifier */
+static void snapshotFileName(uint64 serverConnectionHandlerID, char* fileName, size_t size) {
+    char* serverUID;
+    if (ts3Functions.getServerVariableAsString(serverConnectionHandlerID, VIRTUALSERVER_UNIQUE_IDENTIFIER, &serverUID) != ERROR_ok) {
+        snprintf(fileName, size, "snapshot-%llu.aisnap", (unsigned long long)serverConnectionHandlerID);
+        return;
+    }
+    int length = snprintf(fileName, size, "snapshot-%s", serverUID);
+    ts3Functions.freeMemory(serverUID);
+    for (char* c = fileName + strlen("snapshot-"); *c; ++c) {
+        if (!isalnum((unsigned char)*c)) *c = '_';
+    }
+    if (length > 0 && (size_t)length < size) snprintf(fileName + length, size - (size_t)length, ".aisnap");
+}
+
+bool snapshotExport(uint64 serverConnectionHandlerID, char* fileName, size_t size) {
+    cacheLock();
+    struct ServerCache* server    = cacheGetServer(serverConnectionHandlerID, false);
+    const bool          populated = server && server->populated;
+    cacheUnlock();
+    if (!populated) modelPopulate(serverConnectionHandlerID);
+
+    struct SnapshotColumns columns = {0};
+    bool                   success = false;
+    cacheLock();
+    server = cacheGetServer(serverConnectionHandlerID, false);
+    if (server && initDictionary(&columns.strings, server->clientCount * 2 + server->channelCount) && allocateColumns(&columns, server->channelCount, server->clientCount)) {
+        cacheForEachChannel(server, collectChannel, &columns);
+        cacheForEachClient(server, collectClient, &columns);
+        columns.strings.offsets[columns.strings.count] = (uint32_t)columns.strings.dataLength;
+        success                                        = !columns.strings.failed;
+    }
+    cacheUnlock();
+
+    if (success) {
+        snapshotFileName(serverConnectionHandlerID, fileName, size);
+        success = writeSnapshot(fileName, &columns);
+    }
+    freeColumns(&columns);
+    return success;
+}
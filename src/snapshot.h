@@ -0,0 +1,24 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Writes the cached channels and clients of a connection to the plugin data directory */
+bool snapshotExport(uint64 serverConnectionHandlerID, char* fileName, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef SNAPSHOTFORMAT_H
+#define SNAPSHOTFORMAT_H
+
+#include <stdint.h>
+
+/*
+ * Server tree snapshot file, little endian
+ *
+ * A header is followed by a directory of columns. Every column is a contiguous array of one property
+ * for all channels or all clients, aligned to 8 bytes. Strings are stored once in a dictionary made of
+ * an offsets column (stringCount + 1 entries) and a data column of NUL terminated strings, string
+ * columns hold dictionary indexes. Readers skip column IDs they do not know.
+ */
+
+#define SNAPSHOT_MAGIC "AISN"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGNMENT 8
+
+struct SnapshotHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t createdAt; /* Unix time in nanoseconds */
+    uint32_t channelCount;
+    uint32_t clientCount;
+    uint32_t stringCount;
+    uint32_t columnCount;
+};
+
+struct SnapshotColumn {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset; /* From the start of the file */
+    uint64_t count;
+};
+
+enum SnapshotColumnID {
+    SNAPSHOT_STRING_OFFSETS = 1, /* uint32_t */
+    SNAPSHOT_STRING_DATA,        /* char */
+
+    SNAPSHOT_CHANNEL_ID = 16,    /* uint64_t */
+    SNAPSHOT_CHANNEL_PARENT,     /* uint64_t */
+    SNAPSHOT_CHANNEL_ORDER,      /* uint64_t */
+    SNAPSHOT_CHANNEL_NAME,       /* uint32_t string */
+    SNAPSHOT_CHANNEL_MAXCLIENTS, /* int32_t */
+    SNAPSHOT_CHANNEL_FLAGS,      /* uint32_t CachedChannelFlags */
+
+    SNAPSHOT_CLIENT_ID = 32,     /* uint16_t */
+    SNAPSHOT_CLIENT_CHANNEL,     /* uint64_t */
+    SNAPSHOT_CLIENT_DATABASE_ID, /* uint64_t */
+    SNAPSHOT_CLIENT_UNIQUE_ID,   /* uint32_t string */
+    SNAPSHOT_CLIENT_NICKNAME,    /* uint32_t string */
+    SNAPSHOT_CLIENT_COUNTRY,     /* uint32_t string */
+    SNAPSHOT_CLIENT_TYPE,        /* uint8_t ClientType */
+    SNAPSHOT_CLIENT_FLAGS        /* uint32_t CachedClientFlags */
+};
+
+#endif
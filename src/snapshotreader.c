@@ -0,0 +1,86 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshotreader.h"
+
+static unsigned char* readFile(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    unsigned char* data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        const long length = ftell(file);
+        if (length > 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = (unsigned char*)malloc((size_t)length);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+/* Checks that every column lies inside the file and the dictionary is well formed */
+static bool validate(struct Snapshot* snapshot) {
+    if (snapshot->size < sizeof(struct SnapshotHeader)) return false;
+    snapshot->header = (const struct SnapshotHeader*)snapshot->data;
+    if (memcmp(snapshot->header->magic, SNAPSHOT_MAGIC, sizeof(snapshot->header->magic)) != 0 || snapshot->header->version != SNAPSHOT_VERSION) return false;
+    if (snapshot->header->columnCount > (snapshot->size - sizeof(struct SnapshotHeader)) / sizeof(struct SnapshotColumn)) return false;
+    snapshot->columns = (const struct SnapshotColumn*)(snapshot->data + sizeof(struct SnapshotHeader));
+
+    for (uint32_t index = 0; index < snapshot->header->columnCount; ++index) {
+        const struct SnapshotColumn* column = &snapshot->columns[index];
+        if (column->elementSize == 0 || column->offset % SNAPSHOT_ALIGNMENT != 0 || column->offset > snapshot->size) return false;
+        if (column->count > (snapshot->size - column->offset) / column->elementSize) return false;
+    }
+
+    uint64_t offsetCount, dataLength;
+    snapshot->stringOffsets = (const uint32_t*)snapshotColumn(snapshot, SNAPSHOT_STRING_OFFSETS, sizeof(uint32_t), &offsetCount);
+    snapshot->stringData    = (const char*)snapshotColumn(snapshot, SNAPSHOT_STRING_DATA, sizeof(char), &dataLength);
+    if (!snapshot->stringOffsets || !snapshot->stringData || offsetCount != (uint64_t)snapshot->header->stringCount + 1) return false;
+    if (snapshot->stringOffsets[snapshot->header->stringCount] != dataLength || (dataLength > 0 && snapshot->stringData[dataLength - 1] != '\0')) return false;
+    for (uint32_t index = 0; index < snapshot->header->stringCount; ++index) {
+        if (snapshot->stringOffsets[index] > snapshot->stringOffsets[index + 1]) return false;
+    }
+    return true;
+}
+
+bool snapshotOpen(struct Snapshot* snapshot, const char* path) {
+    memset(snapshot, 0, sizeof(struct Snapshot));
+    snapshot->data = readFile(path, &snapshot->size);
+    if (!snapshot->data) return false;
+    if (!validate(snapshot)) {
+        snapshotClose(snapshot);
+        return false;
+    }
+    return true;
+}
+
+void snapshotClose(struct Snapshot* snapshot) {
+    free(snapshot->data);
+    memset(snapshot, 0, sizeof(struct Snapshot));
+}
+
+const void* snapshotColumn(const struct Snapshot* snapshot, uint32_t id, uint32_t elementSize, uint64_t* count) {
+    for (uint32_t index = 0; index < snapshot->header->columnCount; ++index) {
+        const struct SnapshotColumn* column = &snapshot->columns[index];
+        if (column->id != id) continue;
+        if (column->elementSize != elementSize) return NULL;
+        if (count) *count = column->count;
+        return snapshot->data + column->offset;
+    }
+    return NULL;
+}
+
+const char* snapshotString(const struct Snapshot* snapshot, uint32_t index) {
+    if (index >= snapshot->header->stringCount) return "";
+    return snapshot->stringData + snapshot->stringOffsets[index];
+}
@@ -0,0 +1,42 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef SNAPSHOTREADER_H
+#define SNAPSHOTREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "snapshotformat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A snapshot file loaded into memory */
+struct Snapshot {
+    unsigned char*               data;
+    size_t                       size;
+    const struct SnapshotHeader* header;
+    const struct SnapshotColumn* columns;
+    const uint32_t*              stringOffsets;
+    const char*                  stringData;
+};
+
+/* Loads and validates a snapshot file, returns false if it is missing or malformed */
+bool snapshotOpen(struct Snapshot* snapshot, const char* path);
+void snapshotClose(struct Snapshot* snapshot);
+
+/* Column data of a known ID and element size, NULL if the snapshot does not contain it */
+const void* snapshotColumn(const struct Snapshot* snapshot, uint32_t id, uint32_t elementSize, uint64_t* count);
+
+/* String of a dictionary index, empty for invalid indexes */
+const char* snapshotString(const struct Snapshot* snapshot, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <Windows.h>
+#include <direct.h>
+#else
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "storage.h"
+
+#define STORAGE_PATH_BUFSIZE 512
+#define STORAGE_DIRECTORY "AdvancedInformation"
+
+#ifdef _WIN32
+#define PATH_SEPARATOR "\\"
+#else
+#define PATH_SEPARATOR "/"
+#endif
+
+static char dataDirectory[STORAGE_PATH_BUFSIZE];
+
+void storageInit(const char* configPath) {
+    const size_t length    = strlen(configPath);
+    const bool   separator = length > 0 && (configPath[length - 1] == '/' || configPath[length - 1] == '\\');
+    snprintf(dataDirectory, sizeof(dataDirectory), "%s%s%s", configPath, separator ? "" : PATH_SEPARATOR, STORAGE_DIRECTORY);
+    storageCreateDirectory(dataDirectory);
+}
+
+bool storagePath(char* path, size_t size, const char* fileName) {
+    if (dataDirectory[0] == '\0') return false;
+    const int written = snprintf(path, size, "%s" PATH_SEPARATOR "%s", dataDirectory, fileName);
+    return written > 0 && (size_t)written < size;
+}
+
+bool storageCreateDirectory(const char* path) {
+#ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+bool storageReplaceFile(const char* source, const char* destination) {
+#ifdef _WIN32
+    return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(source, destination) == 0;
+#endif
+}
+
+bool storageWriteFile(const char* fileName, const void* data, size_t size) {
+    char path[STORAGE_PATH_BUFSIZE];
+    char temporaryPath[STORAGE_PATH_BUFSIZE + 4];
+    if (!storagePath(path, sizeof(path), fileName)) return false;
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+    FILE* file = fopen(temporaryPath, "wb");
+    if (!file) return false;
+    const bool written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0 || !written) {
+        remove(temporaryPath);
+        return false;
+    }
+    if (!storageReplaceFile(temporaryPath, path)) {
+        remove(temporaryPath);
+        return false;
+    }
+    return true;
+}
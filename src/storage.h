@@ -0,0 +1,34 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Creates the plugin data directory below the client config path */
+void storageInit(const char* configPath);
+
+/* Full path of a file in the plugin data directory */
+bool storagePath(char* path, size_t size, const char* fileName);
+
+/* Creates a directory, succeeds if it already exists */
+bool storageCreateDirectory(const char* path);
+
+/* Replaces destination with source in a single rename */
+bool storageReplaceFile(const char* source, const char* destination);
+
+/* Writes a file in the plugin data directory through a temporary file and a rename */
+bool storageWriteFile(const char* fileName, const void* data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
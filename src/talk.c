@@ -0,0 +1,134 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "talk.h"
+#include "timing.h"
+
+#define TALK_MAX_SERVERS 32
+
+/* Counters of one client, startedAt is 0 while the client is silent */
+struct TalkSlot {
+    atomic_uint_least64_t startedAt;
+    atomic_uint_least64_t talkMs;
+    atomic_uint_least64_t longestMs;
+    atomic_uint_least64_t bursts;
+};
+
+/* Connection slots are released on disconnect, their pages are kept for the next connection that claims the slot */
+struct TalkServer {
+    atomic_uint_least64_t serverConnectionHandlerID;
+    _Atomic(struct TalkSlot*) pages[CACHE_PAGE_COUNT];
+};
+
+static struct TalkServer servers[TALK_MAX_SERVERS];
+
+static struct TalkServer* findServer(uint64 serverConnectionHandlerID, bool create) {
+    for (size_t index = 0; index < TALK_MAX_SERVERS; ++index) {
+        if (atomic_load_explicit(&servers[index].serverConnectionHandlerID, memory_order_acquire) == serverConnectionHandlerID) return &servers[index];
+    }
+    if (!create) return NULL;
+    for (size_t index = 0; index < TALK_MAX_SERVERS; ++index) {
+        uint_least64_t expected = 0;
+        if (atomic_compare_exchange_strong(&servers[index].serverConnectionHandlerID, &expected, serverConnectionHandlerID)) return &servers[index];
+        if (expected == serverConnectionHandlerID) return &servers[index];
+    }
+    return NULL;
+}
+
+static struct TalkSlot* findSlot(struct TalkServer* server, anyID clientID, bool create) {
+    _Atomic(struct TalkSlot*)* page  = &server->pages[clientID >> CACHE_PAGE_BITS];
+    struct TalkSlot*           slots = atomic_load_explicit(page, memory_order_acquire);
+    if (!slots && create) {
+        struct TalkSlot* allocated = (struct TalkSlot*)calloc(CACHE_PAGE_SIZE, sizeof(struct TalkSlot));
+        if (!allocated) return NULL;
+        if (atomic_compare_exchange_strong_explicit(page, &slots, allocated, memory_order_acq_rel, memory_order_acquire)) {
+            slots = allocated;
+        } else {
+            free(allocated);
+        }
+    }
+    return slots ? &slots[clientID & (CACHE_PAGE_SIZE - 1)] : NULL;
+}
+
+static void resetSlot(struct TalkSlot* slot) {
+    atomic_store_explicit(&slot->startedAt, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->talkMs, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->longestMs, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->bursts, 0, memory_order_release);
+}
+
+void talkInit(void) {
+    for (size_t index = 0; index < TALK_MAX_SERVERS; ++index) {
+        atomic_init(&servers[index].serverConnectionHandlerID, 0);
+        for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) atomic_init(&servers[index].pages[page], NULL);
+    }
+}
+
+void talkShutdown(void) {
+    for (size_t index = 0; index < TALK_MAX_SERVERS; ++index) {
+        for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) free(atomic_exchange(&servers[index].pages[page], NULL));
+        atomic_store(&servers[index].serverConnectionHandlerID, 0);
+    }
+}
+
+void talkStatusChanged(uint64 serverConnectionHandlerID, anyID clientID, bool talking) {
+    struct TalkServer* server = findServer(serverConnectionHandlerID, true);
+    struct TalkSlot*   slot   = server ? findSlot(server, clientID, talking) : NULL;
+    if (!slot) return;
+
+    const uint64 now       = timingMonotonicMs();
+    const uint64 startedAt = atomic_load_explicit(&slot->startedAt, memory_order_relaxed);
+    if (talking) {
+        if (startedAt != 0) return;
+        atomic_fetch_add_explicit(&slot->bursts, 1, memory_order_relaxed);
+        atomic_store_explicit(&slot->startedAt, now ? now : 1, memory_order_release);
+    } else if (startedAt != 0) {
+        /* The running burst disappears before it is added, so readers never count it twice */
+        const uint64 burstMs = now - startedAt;
+        atomic_store_explicit(&slot->startedAt, 0, memory_order_release);
+        atomic_fetch_add_explicit(&slot->talkMs, burstMs, memory_order_release);
+        if (burstMs > atomic_load_explicit(&slot->longestMs, memory_order_relaxed)) atomic_store_explicit(&slot->longestMs, burstMs, memory_order_release);
+    }
+}
+
+void talkClientLeft(uint64 serverConnectionHandlerID, anyID clientID) {
+    struct TalkServer* server = findServer(serverConnectionHandlerID, false);
+    struct TalkSlot*   slot   = server ? findSlot(server, clientID, false) : NULL;
+    if (slot) resetSlot(slot);
+}
+
+void talkDropServer(uint64 serverConnectionHandlerID) {
+    struct TalkServer* server = findServer(serverConnectionHandlerID, false);
+    if (!server) return;
+    for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) {
+        struct TalkSlot* slots = atomic_load_explicit(&server->pages[page], memory_order_acquire);
+        if (!slots) continue;
+        for (size_t slot = 0; slot < CACHE_PAGE_SIZE; ++slot) resetSlot(&slots[slot]);
+    }
+    /* Handler IDs are not reused by the client, a kept slot would be lost for the session */
+    atomic_store_explicit(&server->serverConnectionHandlerID, 0, memory_order_release);
+}
+
+bool talkGetStats(uint64 serverConnectionHandlerID, anyID clientID, struct TalkStats* stats) {
+    struct TalkServer* server = findServer(serverConnectionHandlerID, false);
+    struct TalkSlot*   slot   = server ? findSlot(server, clientID, false) : NULL;
+    if (!slot) return false;
+
+    const uint64 startedAt = atomic_load_explicit(&slot->startedAt, memory_order_acquire);
+    stats->bursts          = atomic_load_explicit(&slot->bursts, memory_order_acquire);
+    stats->talkMs          = atomic_load_explicit(&slot->talkMs, memory_order_acquire);
+    stats->longestMs       = atomic_load_explicit(&slot->longestMs, memory_order_acquire);
+    stats->talking         = startedAt != 0;
+    if (stats->talking) {
+        const uint64 runningMs = timingMonotonicMs() - startedAt;
+        stats->talkMs += runningMs;
+        if (runningMs > stats->longestMs) stats->longestMs = runningMs;
+    }
+    return stats->bursts != 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef TALK_H
+#define TALK_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Talk time of a client since it joined the server */
+struct TalkStats {
+    uint64 talkMs;    /* Finished bursts and the running one */
+    uint64 longestMs;
+    uint64 bursts;
+    bool   talking;
+};
+
+/*
+ * Counters live in per-connection slot pages that are never freed while the plugin runs.
+ * Events update them with atomics and readers never lock, a reader racing with the end of
+ * a burst may miss that burst once.
+ */
+void talkInit(void);
+void talkShutdown(void);
+
+void talkStatusChanged(uint64 serverConnectionHandlerID, anyID clientID, bool talking);
+void talkClientLeft(uint64 serverConnectionHandlerID, anyID clientID);
+void talkDropServer(uint64 serverConnectionHandlerID);
+
+/* Returns false if the client has not talked in this session */
+bool talkGetStats(uint64 serverConnectionHandlerID, anyID clientID, struct TalkStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "timing.h"
+
+/* Offset between 1601-01-01 (FILETIME epoch) and 1970-01-01 in 100ns units */
+#define FILETIME_UNIX_OFFSET 116444736000000000ULL
+
+uint64_t timingMonotonicNs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000ULL + (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t timingMonotonicMs(void) {
+    return timingMonotonicNs() / 1000000ULL;
+}
+
+uint64_t timingWallclockNs(void) {
+#ifdef _WIN32
+    FILETIME fileTime;
+    GetSystemTimePreciseAsFileTime(&fileTime);
+    const uint64_t ticks = ((uint64_t)fileTime.dwHighDateTime << 32) | fileTime.dwLowDateTime;
+    return (ticks - FILETIME_UNIX_OFFSET) * 100ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
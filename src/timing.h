@@ -0,0 +1,26 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Monotonic clock, unaffected by wall clock changes */
+uint64_t timingMonotonicNs(void);
+uint64_t timingMonotonicMs(void);
+
+/* Wall clock as unix time */
+uint64_t timingWallclockNs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,476 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VOICE_X86
+#include <immintrin.h>
+#endif
+
+#include "cache.h"
+#include "timing.h"
+#include "voice.h"
+
+#define VOICE_MAX_SERVERS 32
+#define VOICE_FULL_SCALE 32767
+#define VOICE_CLIP_FLUSH 32767 /* Vector iterations before the 16 bit clip counters could overflow */
+#define VOICE_WINDOW_MS 1000
+#define VOICE_FLOOR_WINDOWS 10
+#define VOICE_STALE_MS 3000
+#define VOICE_SAMPLE_RATE 48000
+#define VOICE_SHORT_TERM_MS 3000
+
+/* Adds count samples to a block */
+typedef void (*VoiceMeasure)(const short* samples, size_t count, struct VoiceBlock* block);
+
+static void measureScalar(const short* samples, size_t count, struct VoiceBlock* block) {
+    uint64   sumSquares = 0;
+    uint32_t peak       = block->peak;
+    uint32_t clipped    = 0;
+    for (size_t index = 0; index < count; ++index) {
+        const int32_t sample    = samples[index];
+        uint32_t      magnitude = (uint32_t)(sample < 0 ? -sample : sample);
+        if (magnitude > VOICE_FULL_SCALE) magnitude = VOICE_FULL_SCALE;
+        sumSquares += (uint64)(sample * sample);
+        if (magnitude > peak) peak = magnitude;
+        if (magnitude == VOICE_FULL_SCALE) ++clipped;
+    }
+    block->sumSquares += sumSquares;
+    block->peak        = peak;
+    block->clipped    += clipped;
+}
+
+#ifdef VOICE_X86
+/* Squares of sample pairs reach 2^31 at most, so they are widened as unsigned 32 bit values */
+__attribute__((target("sse2"))) static __m128i addSquaresSSE2(__m128i sums, __m128i samples) {
+    const __m128i squares = _mm_madd_epi16(samples, samples);
+    return _mm_add_epi64(sums, _mm_add_epi64(_mm_unpacklo_epi32(squares, _mm_setzero_si128()), _mm_unpackhi_epi32(squares, _mm_setzero_si128())));
+}
+
+__attribute__((target("sse2"))) static void measureSSE2(const short* samples, size_t count, struct VoiceBlock* block) {
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i clip    = _mm_set1_epi16(VOICE_FULL_SCALE - 1);
+    __m128i       sums    = zero;
+    __m128i       peaks   = zero;
+    size_t        offset  = 0;
+    uint32_t      clipped = 0;
+    while (offset + 8 <= count) {
+        __m128i clips = zero;
+        for (size_t iteration = 0; iteration < VOICE_CLIP_FLUSH && offset + 8 <= count; ++iteration, offset += 8) {
+            const __m128i chunk     = _mm_loadu_si128((const __m128i*)(samples + offset));
+            const __m128i magnitude = _mm_max_epi16(chunk, _mm_subs_epi16(zero, chunk));
+            sums                    = addSquaresSSE2(sums, chunk);
+            peaks                   = _mm_max_epi16(peaks, magnitude);
+            clips                   = _mm_sub_epi16(clips, _mm_cmpgt_epi16(magnitude, clip));
+        }
+        uint16_t lanes[8];
+        _mm_storeu_si128((__m128i*)lanes, clips);
+        for (size_t lane = 0; lane < 8; ++lane) clipped += lanes[lane];
+    }
+    uint64  laneSums[2];
+    int16_t lanePeaks[8];
+    _mm_storeu_si128((__m128i*)laneSums, sums);
+    _mm_storeu_si128((__m128i*)lanePeaks, peaks);
+    block->sumSquares += laneSums[0] + laneSums[1];
+    block->clipped    += clipped;
+    for (size_t lane = 0; lane < 8; ++lane) {
+        if ((uint32_t)lanePeaks[lane] > block->peak) block->peak = (uint32_t)lanePeaks[lane];
+    }
+    measureScalar(samples + offset, count - offset, block);
+}
+
+__attribute__((target("avx2"))) static void measureAVX2(const short* samples, size_t count, struct VoiceBlock* block) {
+    const __m256i zero    = _mm256_setzero_si256();
+    const __m256i clip    = _mm256_set1_epi16(VOICE_FULL_SCALE - 1);
+    __m256i       sums    = zero;
+    __m256i       peaks   = zero;
+    size_t        offset  = 0;
+    uint32_t      clipped = 0;
+    while (offset + 16 <= count) {
+        __m256i clips = zero;
+        for (size_t iteration = 0; iteration < VOICE_CLIP_FLUSH && offset + 16 <= count; ++iteration, offset += 16) {
+            const __m256i chunk     = _mm256_loadu_si256((const __m256i*)(samples + offset));
+            const __m256i squares   = _mm256_madd_epi16(chunk, chunk);
+            const __m256i magnitude = _mm256_max_epi16(chunk, _mm256_subs_epi16(zero, chunk));
+            sums                    = _mm256_add_epi64(sums, _mm256_add_epi64(_mm256_unpacklo_epi32(squares, zero), _mm256_unpackhi_epi32(squares, zero)));
+            peaks                   = _mm256_max_epi16(peaks, magnitude);
+            clips                   = _mm256_sub_epi16(clips, _mm256_cmpgt_epi16(magnitude, clip));
+        }
+        uint16_t lanes[16];
+        _mm256_storeu_si256((__m256i*)lanes, clips);
+        for (size_t lane = 0; lane < 16; ++lane) clipped += lanes[lane];
+    }
+    /* The tail stays in VEX encoded code, calling the SSE2 kernel here would pay for a state transition */
+    __m128i sums128  = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    __m128i peaks128 = _mm_max_epi16(_mm256_castsi256_si128(peaks), _mm256_extracti128_si256(peaks, 1));
+    if (offset + 8 <= count) {
+        const __m128i chunk     = _mm_loadu_si128((const __m128i*)(samples + offset));
+        const __m128i squares   = _mm_madd_epi16(chunk, chunk);
+        const __m128i magnitude = _mm_max_epi16(chunk, _mm_subs_epi16(_mm256_castsi256_si128(zero), chunk));
+        sums128                 = _mm_add_epi64(sums128, _mm_add_epi64(_mm_unpacklo_epi32(squares, _mm256_castsi256_si128(zero)), _mm_unpackhi_epi32(squares, _mm256_castsi256_si128(zero))));
+        peaks128                = _mm_max_epi16(peaks128, magnitude);
+        clipped                += (uint32_t)__builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi16(magnitude, _mm256_castsi256_si128(clip)))) / 2;
+        offset                 += 8;
+    }
+    uint64  laneSums[2];
+    int16_t lanePeaks[8];
+    _mm_storeu_si128((__m128i*)laneSums, sums128);
+    _mm_storeu_si128((__m128i*)lanePeaks, peaks128);
+    block->sumSquares += laneSums[0] + laneSums[1];
+    block->clipped    += clipped;
+    for (size_t lane = 0; lane < 8; ++lane) {
+        if ((uint32_t)lanePeaks[lane] > block->peak) block->peak = (uint32_t)lanePeaks[lane];
+    }
+    measureScalar(samples + offset, count - offset, block);
+}
+#endif
+
+static VoiceMeasure     measure = measureScalar;
+static enum VoiceKernel active  = VOICE_KERNEL_SCALAR;
+static bool             selected;
+
+static bool kernelSupported(enum VoiceKernel kernel) {
+    switch (kernel) {
+        case VOICE_KERNEL_SCALAR:
+            return true;
+#ifdef VOICE_X86
+        case VOICE_KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case VOICE_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+bool voiceSelectKernel(enum VoiceKernel kernel) {
+#ifdef VOICE_X86
+    __builtin_cpu_init();
+#endif
+    if (kernel == VOICE_KERNEL_AUTO) {
+        kernel = kernelSupported(VOICE_KERNEL_AVX2) ? VOICE_KERNEL_AVX2 : kernelSupported(VOICE_KERNEL_SSE2) ? VOICE_KERNEL_SSE2 : VOICE_KERNEL_SCALAR;
+    }
+    if (!kernelSupported(kernel)) return false;
+    switch (kernel) {
+#ifdef VOICE_X86
+        case VOICE_KERNEL_SSE2:
+            measure = measureSSE2;
+            break;
+        case VOICE_KERNEL_AVX2:
+            measure = measureAVX2;
+            break;
+#endif
+        default:
+            measure = measureScalar;
+    }
+    active   = kernel;
+    selected = true;
+    return true;
+}
+
+enum VoiceKernel voiceActiveKernel(void) {
+    return active;
+}
+
+const char* voiceKernelName(enum VoiceKernel kernel) {
+    switch (kernel) {
+        case VOICE_KERNEL_SCALAR:
+            return "scalar";
+        case VOICE_KERNEL_SSE2:
+            return "sse2";
+        case VOICE_KERNEL_AVX2:
+            return "avx2";
+        default:
+            return "auto";
+    }
+}
+
+void voiceMeasure(const short* samples, size_t count, struct VoiceBlock* block) {
+    if (!selected) voiceSelectKernel(VOICE_KERNEL_AUTO);
+    measure(samples, count, block);
+}
+
+/*********************************** Captured audio ************************************/
+
+/* Window sums are only touched by the audio thread of the connection, the published levels by the reader */
+struct VoiceCapture {
+    atomic_uint_least64_t serverConnectionHandlerID;
+    atomic_bool           reset; /* Set when the slot is given back, the next audio thread using it clears the window */
+
+    uint64            windowStartedAt;
+    uint64            windowSamples;
+    struct VoiceBlock window;
+    double            windowFloor;                 /* Lowest frame mean square, 0 if none */
+    double            floors[VOICE_FLOOR_WINDOWS]; /* Of the last windows */
+    size_t            floorIndex;
+
+    atomic_uint_least64_t sequence; /* Odd while the audio thread publishes */
+    atomic_uint_least64_t publishedAt;
+    atomic_uint_least64_t sumSquares;
+    atomic_uint_least64_t samples;
+    atomic_uint_least64_t peak;
+    atomic_uint_least64_t clipped;
+    atomic_uint_least64_t floor; /* Bits of the mean square */
+};
+
+static struct VoiceCapture captures[VOICE_MAX_SERVERS];
+
+/* Levels of one speaker, heardAt is 0 until the first played frame */
+struct VoiceSpeaker {
+    atomic_uint_least64_t heardAt;
+    atomic_uint_least64_t meanSquare; /* Bits of the smoothed mean square */
+    atomic_uint_least64_t peak;
+    atomic_uint_least64_t peakAt;
+};
+
+/* Given back on disconnect like the capture slots, the speaker pages stay allocated for the next connection */
+struct VoicePlayback {
+    atomic_uint_least64_t serverConnectionHandlerID;
+    _Atomic(struct VoiceSpeaker*) pages[CACHE_PAGE_COUNT];
+};
+
+static struct VoicePlayback playbacks[VOICE_MAX_SERVERS];
+
+static struct VoiceCapture* findCapture(uint64 serverConnectionHandlerID, bool create) {
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        if (atomic_load_explicit(&captures[index].serverConnectionHandlerID, memory_order_acquire) == serverConnectionHandlerID) return &captures[index];
+    }
+    if (!create) return NULL;
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        uint_least64_t expected = 0;
+        if (atomic_compare_exchange_strong(&captures[index].serverConnectionHandlerID, &expected, serverConnectionHandlerID)) return &captures[index];
+        if (expected == serverConnectionHandlerID) return &captures[index];
+    }
+    return NULL;
+}
+
+static struct VoicePlayback* findPlayback(uint64 serverConnectionHandlerID, bool create) {
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        if (atomic_load_explicit(&playbacks[index].serverConnectionHandlerID, memory_order_acquire) == serverConnectionHandlerID) return &playbacks[index];
+    }
+    if (!create) return NULL;
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        uint_least64_t expected = 0;
+        if (atomic_compare_exchange_strong(&playbacks[index].serverConnectionHandlerID, &expected, serverConnectionHandlerID)) return &playbacks[index];
+        if (expected == serverConnectionHandlerID) return &playbacks[index];
+    }
+    return NULL;
+}
+
+static struct VoiceSpeaker* findSpeaker(uint64 serverConnectionHandlerID, anyID clientID) {
+    struct VoicePlayback* playback = findPlayback(serverConnectionHandlerID, false);
+    struct VoiceSpeaker*  speakers = playback ? atomic_load_explicit(&playback->pages[clientID >> CACHE_PAGE_BITS], memory_order_acquire) : NULL;
+    return speakers ? &speakers[clientID & (CACHE_PAGE_SIZE - 1)] : NULL;
+}
+
+static void resetSpeaker(struct VoiceSpeaker* speaker) {
+    atomic_store_explicit(&speaker->heardAt, 0, memory_order_release);
+    atomic_store_explicit(&speaker->meanSquare, 0, memory_order_relaxed);
+    atomic_store_explicit(&speaker->peak, 0, memory_order_relaxed);
+    atomic_store_explicit(&speaker->peakAt, 0, memory_order_relaxed);
+}
+
+static void clearWindow(struct VoiceCapture* capture) {
+    capture->windowStartedAt = 0;
+    capture->windowSamples   = 0;
+    capture->window          = (struct VoiceBlock){0, 0, 0};
+    capture->windowFloor     = 0;
+}
+
+static void publish(struct VoiceCapture* capture, uint64 now) {
+    capture->floors[capture->floorIndex] = capture->windowFloor;
+    capture->floorIndex                  = (capture->floorIndex + 1) % VOICE_FLOOR_WINDOWS;
+    double floor                         = 0;
+    for (size_t index = 0; index < VOICE_FLOOR_WINDOWS; ++index) {
+        if (capture->floors[index] != 0 && (floor == 0 || capture->floors[index] < floor)) floor = capture->floors[index];
+    }
+    uint64 floorBits;
+    memcpy(&floorBits, &floor, sizeof(floorBits));
+
+    atomic_store_explicit(&capture->sequence, atomic_load_explicit(&capture->sequence, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&capture->sumSquares, capture->window.sumSquares, memory_order_relaxed);
+    atomic_store_explicit(&capture->samples, capture->windowSamples, memory_order_relaxed);
+    atomic_store_explicit(&capture->peak, capture->window.peak, memory_order_relaxed);
+    atomic_store_explicit(&capture->clipped, capture->window.clipped, memory_order_relaxed);
+    atomic_store_explicit(&capture->floor, floorBits, memory_order_relaxed);
+    atomic_store_explicit(&capture->publishedAt, now, memory_order_relaxed);
+    atomic_store_explicit(&capture->sequence, atomic_load_explicit(&capture->sequence, memory_order_relaxed) + 1, memory_order_release);
+}
+
+void voiceInit(void) {
+    voiceSelectKernel(VOICE_KERNEL_AUTO);
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        atomic_init(&playbacks[index].serverConnectionHandlerID, 0);
+        for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) atomic_init(&playbacks[index].pages[page], NULL);
+        struct VoiceCapture* capture = &captures[index];
+        atomic_init(&capture->serverConnectionHandlerID, 0);
+        atomic_init(&capture->reset, false);
+        clearWindow(capture);
+        memset(capture->floors, 0, sizeof(capture->floors));
+        capture->floorIndex = 0;
+        atomic_init(&capture->sequence, 0);
+        atomic_init(&capture->publishedAt, 0);
+        atomic_init(&capture->sumSquares, 0);
+        atomic_init(&capture->samples, 0);
+        atomic_init(&capture->peak, 0);
+        atomic_init(&capture->clipped, 0);
+        atomic_init(&capture->floor, 0);
+    }
+}
+
+void voiceShutdown(void) {
+    for (size_t index = 0; index < VOICE_MAX_SERVERS; ++index) {
+        atomic_store(&captures[index].serverConnectionHandlerID, 0);
+        for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) free(atomic_exchange(&playbacks[index].pages[page], NULL));
+        atomic_store(&playbacks[index].serverConnectionHandlerID, 0);
+    }
+}
+
+void voiceCaptured(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels) {
+    if (!samples || sampleCount <= 0 || channels <= 0) return;
+    struct VoiceCapture* capture = findCapture(serverConnectionHandlerID, true);
+    if (!capture) return;
+    if (atomic_exchange_explicit(&capture->reset, false, memory_order_acquire)) {
+        clearWindow(capture);
+        memset(capture->floors, 0, sizeof(capture->floors));
+    }
+
+    const size_t      count = (size_t)sampleCount * (size_t)channels;
+    struct VoiceBlock frame = {0, 0, 0};
+    measure(samples, count, &frame);
+
+    const uint64 now = timingMonotonicMs();
+    if (capture->windowStartedAt == 0) capture->windowStartedAt = now ? now : 1;
+    capture->window.sumSquares += frame.sumSquares;
+    capture->window.clipped    += frame.clipped;
+    capture->windowSamples     += count;
+    if (frame.peak > capture->window.peak) capture->window.peak = frame.peak;
+    const double meanSquare = (double)frame.sumSquares / (double)count;
+    if (meanSquare != 0 && (capture->windowFloor == 0 || meanSquare < capture->windowFloor)) capture->windowFloor = meanSquare;
+
+    if (now - capture->windowStartedAt >= VOICE_WINDOW_MS) {
+        publish(capture, now);
+        clearWindow(capture);
+    }
+}
+
+void voiceDropServer(uint64 serverConnectionHandlerID) {
+    /* Handler IDs are not reused by the client, kept slots would be lost for the session */
+    struct VoiceCapture* capture = findCapture(serverConnectionHandlerID, false);
+    if (capture) {
+        atomic_store_explicit(&capture->reset, true, memory_order_release);
+        atomic_store_explicit(&capture->serverConnectionHandlerID, 0, memory_order_release);
+    }
+    struct VoicePlayback* playback = findPlayback(serverConnectionHandlerID, false);
+    if (!playback) return;
+    for (size_t page = 0; page < CACHE_PAGE_COUNT; ++page) {
+        struct VoiceSpeaker* speakers = atomic_load_explicit(&playback->pages[page], memory_order_acquire);
+        if (!speakers) continue;
+        for (size_t speaker = 0; speaker < CACHE_PAGE_SIZE; ++speaker) resetSpeaker(&speakers[speaker]);
+    }
+    atomic_store_explicit(&playback->serverConnectionHandlerID, 0, memory_order_release);
+}
+
+/* Decibels relative to full scale of a mean square */
+static double fullScaleDb(double meanSquare) {
+    return 10.0 * log10(meanSquare / ((double)VOICE_FULL_SCALE * VOICE_FULL_SCALE));
+}
+
+bool voiceGetCaptured(uint64 serverConnectionHandlerID, struct VoiceLevels* levels) {
+    struct VoiceCapture* capture = findCapture(serverConnectionHandlerID, false);
+    if (!capture || atomic_load_explicit(&capture->reset, memory_order_acquire)) return false;
+
+    uint64 started, publishedAt, sumSquares, samples, peak, clipped, floorBits;
+    do {
+        while ((started = atomic_load_explicit(&capture->sequence, memory_order_acquire)) & 1) thrd_yield();
+        publishedAt = atomic_load_explicit(&capture->publishedAt, memory_order_relaxed);
+        sumSquares  = atomic_load_explicit(&capture->sumSquares, memory_order_relaxed);
+        samples     = atomic_load_explicit(&capture->samples, memory_order_relaxed);
+        peak        = atomic_load_explicit(&capture->peak, memory_order_relaxed);
+        clipped     = atomic_load_explicit(&capture->clipped, memory_order_relaxed);
+        floorBits   = atomic_load_explicit(&capture->floor, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(&capture->sequence, memory_order_relaxed) != started);
+    if (publishedAt == 0 || samples == 0 || timingMonotonicMs() - publishedAt > VOICE_STALE_MS) return false;
+
+    double floor;
+    memcpy(&floor, &floorBits, sizeof(floor));
+    levels->rmsDb     = sumSquares ? fullScaleDb((double)sumSquares / (double)samples) : -INFINITY;
+    levels->peakDb    = peak ? 20.0 * log10((double)peak / VOICE_FULL_SCALE) : -INFINITY;
+    levels->clipRatio = (double)clipped / (double)samples;
+    levels->hasFloor  = floor != 0;
+    levels->floorDb   = levels->hasFloor ? fullScaleDb(floor) : -INFINITY;
+    return true;
+}
+
+/*********************************** Played back audio ************************************/
+
+void voicePreparePlayback(uint64 serverConnectionHandlerID, anyID clientID) {
+    struct VoicePlayback* playback = findPlayback(serverConnectionHandlerID, true);
+    if (!playback) return;
+    _Atomic(struct VoiceSpeaker*)* page     = &playback->pages[clientID >> CACHE_PAGE_BITS];
+    struct VoiceSpeaker*           speakers = atomic_load_explicit(page, memory_order_acquire);
+    if (speakers) return;
+    struct VoiceSpeaker* allocated = (struct VoiceSpeaker*)calloc(CACHE_PAGE_SIZE, sizeof(struct VoiceSpeaker));
+    if (allocated && !atomic_compare_exchange_strong_explicit(page, &speakers, allocated, memory_order_acq_rel, memory_order_acquire)) free(allocated);
+}
+
+void voicePlayback(uint64 serverConnectionHandlerID, anyID clientID, const short* samples, int sampleCount, int channels) {
+    if (!samples || sampleCount <= 0 || channels <= 0) return;
+    struct VoiceSpeaker* speaker = findSpeaker(serverConnectionHandlerID, clientID);
+    if (!speaker) return;
+
+    const size_t      count = (size_t)sampleCount * (size_t)channels;
+    struct VoiceBlock frame = {0, 0, 0};
+    measure(samples, count, &frame);
+
+    /* An exponential average over the short-term window, restarted when the speaker was silent for longer */
+    const uint64 now        = timingMonotonicMs();
+    const uint64 heardAt    = atomic_load_explicit(&speaker->heardAt, memory_order_relaxed);
+    const double meanSquare = (double)frame.sumSquares / (double)count;
+    double       smoothed   = meanSquare;
+    if (heardAt != 0 && now - heardAt <= VOICE_SHORT_TERM_MS) {
+        const uint64 previousBits = atomic_load_explicit(&speaker->meanSquare, memory_order_relaxed);
+        double       previous;
+        memcpy(&previous, &previousBits, sizeof(previous));
+        smoothed = previous + (meanSquare - previous) * ((double)sampleCount * 1000.0 / VOICE_SAMPLE_RATE / VOICE_SHORT_TERM_MS);
+    }
+    uint64 smoothedBits;
+    memcpy(&smoothedBits, &smoothed, sizeof(smoothedBits));
+    atomic_store_explicit(&speaker->meanSquare, smoothedBits, memory_order_relaxed);
+    if (frame.peak >= atomic_load_explicit(&speaker->peak, memory_order_relaxed) || now - atomic_load_explicit(&speaker->peakAt, memory_order_relaxed) > VOICE_SHORT_TERM_MS) {
+        atomic_store_explicit(&speaker->peak, frame.peak, memory_order_relaxed);
+        atomic_store_explicit(&speaker->peakAt, now, memory_order_relaxed);
+    }
+    atomic_store_explicit(&speaker->heardAt, now ? now : 1, memory_order_release);
+}
+
+void voiceClientLeft(uint64 serverConnectionHandlerID, anyID clientID) {
+    struct VoiceSpeaker* speaker = findSpeaker(serverConnectionHandlerID, clientID);
+    if (speaker) resetSpeaker(speaker);
+}
+
+bool voiceGetPlayback(uint64 serverConnectionHandlerID, anyID clientID, struct VoiceLoudness* loudness) {
+    struct VoiceSpeaker* speaker = findSpeaker(serverConnectionHandlerID, clientID);
+    const uint64         heardAt = speaker ? atomic_load_explicit(&speaker->heardAt, memory_order_acquire) : 0;
+    if (heardAt == 0) return false;
+
+    const uint64 meanSquareBits = atomic_load_explicit(&speaker->meanSquare, memory_order_relaxed);
+    const uint64 peak           = atomic_load_explicit(&speaker->peak, memory_order_relaxed);
+    double       meanSquare;
+    memcpy(&meanSquare, &meanSquareBits, sizeof(meanSquare));
+    const uint64 now     = timingMonotonicMs();
+    loudness->loudnessDb = meanSquare > 0 ? fullScaleDb(meanSquare) : -INFINITY;
+    loudness->peakDb     = peak ? 20.0 * log10((double)peak / VOICE_FULL_SCALE) : -INFINITY;
+    loudness->ageMs      = now > heardAt ? now - heardAt : 0;
+    return true;
+}
@@ -0,0 +1,87 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef VOICE_H
+#define VOICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Level kernels over 16 bit samples, the widest one the CPU supports is used by default */
+enum VoiceKernel {
+    VOICE_KERNEL_AUTO,
+    VOICE_KERNEL_SCALAR,
+    VOICE_KERNEL_SSE2,
+    VOICE_KERNEL_AVX2
+};
+
+/* Raw sums of a block of samples, magnitudes saturate at 32767 */
+struct VoiceBlock {
+    uint64   sumSquares;
+    uint32_t peak;
+    uint32_t clipped; /* Samples at full scale */
+};
+
+/* Levels of one second of audio in dB relative to full scale */
+struct VoiceLevels {
+    double rmsDb;
+    double peakDb;
+    double clipRatio;
+    double floorDb; /* Quietest 20 ms frame of the last seconds, digital silence is ignored */
+    bool   hasFloor;
+};
+
+/* Short-term loudness of a speaker as played back, an unweighted RMS over the last seconds */
+struct VoiceLoudness {
+    double loudnessDb;
+    double peakDb; /* Highest sample of the last seconds */
+    uint64 ageMs;  /* Since the last played frame */
+};
+
+/* Selects a kernel, returns false and keeps the current one if the CPU does not support it */
+bool             voiceSelectKernel(enum VoiceKernel kernel);
+enum VoiceKernel voiceActiveKernel(void);
+const char*      voiceKernelName(enum VoiceKernel kernel);
+
+/* Adds count samples to a block */
+void voiceMeasure(const short* samples, size_t count, struct VoiceBlock* block);
+
+/*
+ * Captured audio is summed per connection on the audio thread into slots that are claimed once
+ * and never freed, so frames never lock or allocate. Each second the levels are published through
+ * a sequence counter, readers retry if a frame published while they were reading.
+ */
+void voiceInit(void);
+void voiceShutdown(void);
+
+void voiceCaptured(uint64 serverConnectionHandlerID, const short* samples, int sampleCount, int channels);
+void voiceDropServer(uint64 serverConnectionHandlerID);
+
+/* Returns false if nothing was captured on the connection in the last seconds */
+bool voiceGetCaptured(uint64 serverConnectionHandlerID, struct VoiceLevels* levels);
+
+/*
+ * Played back audio is measured per client into slot pages like the talk counters. Pages are only
+ * allocated by voicePreparePlayback on the event thread when a client starts talking, the audio thread
+ * skips clients without a slot. Readers never lock and may see a frame half applied.
+ */
+void voicePreparePlayback(uint64 serverConnectionHandlerID, anyID clientID);
+void voicePlayback(uint64 serverConnectionHandlerID, anyID clientID, const short* samples, int sampleCount, int channels);
+void voiceClientLeft(uint64 serverConnectionHandlerID, anyID clientID);
+
+/* Returns false if the client was not heard on this connection */
+bool voiceGetPlayback(uint64 serverConnectionHandlerID, anyID clientID, struct VoiceLoudness* loudness);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
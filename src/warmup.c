@@ -0,0 +1,185 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#include <stdatomic.h>
+#include <threads.h>
+#include <time.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "ts3_functions.h"
+
+#include "cache.h"
+#include "journal.h"
+#include "log.h"
+#include "model.h"
+#include "plugin.h"
+#include "timing.h"
+#include "warmup.h"
+
+#define WARMUP_QUEUE_SIZE 32
+#define WARMUP_CHUNK 64 /* Channels or clients loaded per hold of the cache lock */
+#define WARMUP_POLL_INTERVAL 100
+
+struct WarmupRequest {
+    uint64 serverConnectionHandlerID;
+    bool   present; /* Journal the clients as present once loaded */
+};
+
+static mtx_t                warmupMutex;
+static struct WarmupRequest queue[WARMUP_QUEUE_SIZE];
+static size_t               queueLength = 0;
+static uint64               current     = 0; /* Connection the worker populates */
+static atomic_bool          cancelled   = false;
+static atomic_bool          running     = false;
+static thrd_t               workerThread;
+
+/* Loads a chunk of channels, returns false if the connection was dropped */
+static bool loadChannels(uint64 serverConnectionHandlerID, const uint64** channels) {
+    cacheLock();
+    struct ServerCache* server = atomic_load(&cancelled) ? NULL : cacheGetServer(serverConnectionHandlerID, true);
+    for (size_t count = 0; server && **channels && count < WARMUP_CHUNK; ++*channels, ++count) {
+        uint64 parentID;
+        /* Channels deleted since the list was read are not brought back */
+        if (ts3Functions.getParentChannelOfChannel(serverConnectionHandlerID, **channels, &parentID) == ERROR_ok) modelLoadChannel(serverConnectionHandlerID, server, **channels);
+    }
+    cacheUnlock();
+    return server != NULL;
+}
+
+/* Loads a chunk of clients, returns false if the connection was dropped */
+static bool loadClients(uint64 serverConnectionHandlerID, const anyID** clients) {
+    cacheLock();
+    struct ServerCache* server = atomic_load(&cancelled) ? NULL : cacheGetServer(serverConnectionHandlerID, true);
+    for (size_t count = 0; server && **clients && count < WARMUP_CHUNK; ++*clients, ++count) {
+        const struct CachedClient* client = cacheGetClient(server, **clients, false);
+        uint64                     channelID;
+        if (client && client->loaded) continue;
+        /* Clients that left since the list was read are not brought back */
+        if (ts3Functions.getChannelOfClient(serverConnectionHandlerID, **clients, &channelID) == ERROR_ok) modelLoadClient(serverConnectionHandlerID, server, **clients);
+    }
+    if (server && !**clients) server->populated = true;
+    cacheUnlock();
+    return server != NULL;
+}
+
+static void populate(const struct WarmupRequest* request) {
+    const uint64 serverConnectionHandlerID = request->serverConnectionHandlerID;
+    const uint64 started                   = timingMonotonicMs();
+    uint64*      channels                  = NULL;
+    anyID*       clients                   = NULL;
+    bool         loaded                    = true;
+
+    if (ts3Functions.getChannelList(serverConnectionHandlerID, &channels) == ERROR_ok) {
+        const uint64* next = channels;
+        while (*next && atomic_load(&running) && (loaded = loadChannels(serverConnectionHandlerID, &next))) thrd_yield();
+        loaded = loaded && !*next;
+        ts3Functions.freeMemory(channels);
+    }
+    if (loaded && ts3Functions.getClientList(serverConnectionHandlerID, &clients) == ERROR_ok) {
+        const anyID* next = clients;
+        while (atomic_load(&running) && (loaded = loadClients(serverConnectionHandlerID, &next)) && *next) thrd_yield();
+        loaded = loaded && !*next;
+        ts3Functions.freeMemory(clients);
+    } else {
+        loaded = false;
+    }
+
+    if (!loaded) {
+        LOG(LOG_DEBUG, "warmup_aborted", "server=%llu", (unsigned long long)serverConnectionHandlerID);
+        return;
+    }
+    if (request->present) journalPresentClients(serverConnectionHandlerID);
+    LOG(LOG_DEBUG, "warmup_done", "server=%llu ms=%llu", (unsigned long long)serverConnectionHandlerID, (unsigned long long)(timingMonotonicMs() - started));
+}
+
+/* Takes the oldest request, returns false if there is none */
+static bool takeRequest(struct WarmupRequest* request) {
+    mtx_lock(&warmupMutex);
+    const bool taken = queueLength > 0;
+    if (taken) {
+        *request = queue[0];
+        --queueLength;
+        for (size_t index = 0; index < queueLength; ++index) queue[index] = queue[index + 1];
+        current = request->serverConnectionHandlerID;
+        atomic_store(&cancelled, false);
+    }
+    mtx_unlock(&warmupMutex);
+    return taken;
+}
+
+static int workerMain(void* argument) {
+    while (atomic_load(&running)) {
+        struct WarmupRequest request;
+        if (takeRequest(&request)) {
+            populate(&request);
+            mtx_lock(&warmupMutex);
+            current = 0;
+            mtx_unlock(&warmupMutex);
+        } else {
+            thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = WARMUP_POLL_INTERVAL * 1000000L}, NULL);
+        }
+    }
+    return 0;
+}
+
+static void enqueue(uint64 serverConnectionHandlerID, bool present) {
+    if (!atomic_load(&running)) {
+        modelPopulate(serverConnectionHandlerID);
+        if (present) journalPresentClients(serverConnectionHandlerID);
+        return;
+    }
+    mtx_lock(&warmupMutex);
+    bool queued = current == serverConnectionHandlerID && !atomic_load(&cancelled);
+    for (size_t index = 0; index < queueLength && !queued; ++index) queued = queue[index].serverConnectionHandlerID == serverConnectionHandlerID;
+    const bool full = !queued && queueLength == WARMUP_QUEUE_SIZE;
+    if (!queued && !full) queue[queueLength++] = (struct WarmupRequest){serverConnectionHandlerID, present};
+    mtx_unlock(&warmupMutex);
+
+    /* Only reached with more open tabs than the queue holds */
+    if (full) {
+        modelPopulate(serverConnectionHandlerID);
+        if (present) journalPresentClients(serverConnectionHandlerID);
+    }
+}
+
+void warmupInit(bool threaded) {
+    mtx_init(&warmupMutex, mtx_plain);
+    queueLength = 0;
+    current     = 0;
+    if (!threaded) return;
+    atomic_store(&running, true);
+    if (thrd_create(&workerThread, workerMain, NULL) != thrd_success) atomic_store(&running, false);
+}
+
+void warmupShutdown(void) {
+    if (atomic_exchange(&running, false)) thrd_join(workerThread, NULL);
+    mtx_destroy(&warmupMutex);
+}
+
+void warmupConnection(uint64 serverConnectionHandlerID) {
+    enqueue(serverConnectionHandlerID, true);
+}
+
+void warmupAll(void) {
+    uint64* handlers;
+    if (ts3Functions.getServerConnectionHandlerList(&handlers) != ERROR_ok) return;
+    for (uint64* handler = handlers; *handler; ++handler) {
+        int status;
+        if (ts3Functions.getConnectionStatus(*handler, &status) == ERROR_ok && status == STATUS_CONNECTION_ESTABLISHED) enqueue(*handler, false);
+    }
+    ts3Functions.freeMemory(handlers);
+}
+
+void warmupDropServer(uint64 serverConnectionHandlerID) {
+    mtx_lock(&warmupMutex);
+    if (current == serverConnectionHandlerID) atomic_store(&cancelled, true);
+    size_t kept = 0;
+    for (size_t index = 0; index < queueLength; ++index) {
+        if (queue[index].serverConnectionHandlerID != serverConnectionHandlerID) queue[kept++] = queue[index];
+    }
+    queueLength = kept;
+    mtx_unlock(&warmupMutex);
+}
@@ -0,0 +1,39 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include "teamspeak/public_definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Initial population of the channel and client cache of a connection
+ *
+ * With a worker the channel and client lists are read into the cache in chunks, releasing the cache lock
+ * between them so that callbacks and info frames keep running on the partial data. Clients loaded by an
+ * event in the meantime are skipped. Without a worker, and always while recording, a connection is
+ * populated at once on the calling thread so that its host calls belong to the recorded entry point.
+ */
+void warmupInit(bool threaded);
+void warmupShutdown(void);
+
+/* Populates a connection that was just established, its clients are journaled as present once loaded */
+void warmupConnection(uint64 serverConnectionHandlerID);
+
+/* Populates all established connections when the plugin is loaded */
+void warmupAll(void);
+
+/* Stops the population of a closed connection */
+void warmupDropServer(uint64 serverConnectionHandlerID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+/*
+ * Measures the BBCode escaping kernels against memcpy
+ *
+ * Usage: AdvancedInformationEscapeBench [-n megabytes]
+ *
+ * Every kernel the CPU supports is first checked against the scalar kernel on random text, then timed on
+ * texts of nickname, channel name and description length, once without anything to escape and once with
+ * an escaped character every 16 bytes. Throughput is given in MB of input per second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "escape.h"
+#include "mockhost.h"
+
+#define BENCH_CHECK_ROUNDS 20000
+#define BENCH_CHECK_BUFSIZE 160
+#define BENCH_MAX_LENGTH 8192
+
+static const size_t lengths[] = {32, 256, 8192};
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+/* Random text of a length with escaped characters at the given rate, 0 for none */
+static void fillText(char* text, size_t length, size_t escapeEvery) {
+    static const char special[] = "[]\\";
+    for (size_t index = 0; index < length; ++index) {
+        text[index] = escapeEvery && nextRandom() % escapeEvery == 0 ? special[nextRandom() % 3] : (char)('a' + nextRandom() % 26);
+    }
+    text[length] = '\0';
+}
+
+/* Compares a kernel with the scalar one on random text and output sizes */
+static bool checkKernel(enum EscapeKernel kernel) {
+    char text[BENCH_CHECK_BUFSIZE];
+    char expected[BENCH_CHECK_BUFSIZE * 2];
+    char actual[BENCH_CHECK_BUFSIZE * 2];
+    for (size_t round = 0; round < BENCH_CHECK_ROUNDS; ++round) {
+        const size_t length = nextRandom() % (BENCH_CHECK_BUFSIZE - 1);
+        const size_t size   = 1 + nextRandom() % sizeof(expected);
+        fillText(text, length, 1 + nextRandom() % 64);
+        escapeSelectKernel(ESCAPE_KERNEL_SCALAR);
+        const size_t expectedLength = escapeBBCode(expected, size, text);
+        escapeSelectKernel(kernel);
+        const size_t actualLength = escapeBBCode(actual, size, text);
+        if (actualLength != expectedLength || memcmp(actual, expected, expectedLength + 1) != 0) {
+            fprintf(stderr, "%s kernel differs from scalar for \"%s\" with size %zu\n", escapeKernelName(kernel), text, size);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns MB of input per second for escaping or copying the text repeatedly */
+static double measure(const char* text, size_t length, char* output, size_t outputSize, size_t megabytes, bool copy) {
+    const size_t   rounds  = megabytes * 1000000 / length + 1;
+    size_t         sink    = 0;
+    const uint64_t started = mockMonotonicNs();
+    for (size_t round = 0; round < rounds; ++round) {
+        if (copy) {
+            memcpy(output, text, length + 1);
+            sink += (unsigned char)output[round % length];
+        } else {
+            sink += escapeBBCode(output, outputSize, text);
+        }
+    }
+    const uint64_t elapsed = mockMonotonicNs() - started;
+    if (sink == 1) printf(" ");
+    return (double)(rounds * length) / 1e6 / ((double)elapsed / 1e9);
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = 200;
+    if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+        megabytes = strtoul(argv[2], NULL, 10);
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [-n megabytes]\n", argv[0]);
+        return 1;
+    }
+
+    char*  clean      = (char*)malloc(BENCH_MAX_LENGTH + 1);
+    char*  dirty      = (char*)malloc(BENCH_MAX_LENGTH + 1);
+    char*  output     = (char*)malloc(BENCH_MAX_LENGTH * 2 + 1);
+    size_t outputSize = BENCH_MAX_LENGTH * 2 + 1;
+    if (!clean || !dirty || !output) return 1;
+
+    escapeSelectKernel(ESCAPE_KERNEL_AUTO);
+    printf("Selected kernel: %s\n\n", escapeKernelName(escapeActiveKernel()));
+    printf("%-8s  %6s  %12s  %12s\n", "Kernel", "Length", "Clean MB/s", "Dirty MB/s");
+
+    for (size_t index = 0; index < sizeof(lengths) / sizeof(lengths[0]); ++index) {
+        fillText(clean, lengths[index], 0);
+        fillText(dirty, lengths[index], 16);
+        printf("%-8s  %6zu  %12.0f  %12s\n", "memcpy", lengths[index], measure(clean, lengths[index], output, outputSize, megabytes, true), "-");
+        for (enum EscapeKernel kernel = ESCAPE_KERNEL_SCALAR; kernel <= ESCAPE_KERNEL_AVX2; ++kernel) {
+            if (!escapeSelectKernel(kernel)) continue;
+            if (index == 0 && kernel != ESCAPE_KERNEL_SCALAR && !checkKernel(kernel)) return 1;
+            escapeSelectKernel(kernel);
+            const double cleanRate = measure(clean, lengths[index], output, outputSize, megabytes, false);
+            const double dirtyRate = measure(dirty, lengths[index], output, outputSize, megabytes, false);
+            printf("%-8s  %6zu  %12.0f  %12.0f\n", escapeKernelName(kernel), lengths[index], cleanRate, dirtyRate);
+        }
+    }
+
+    free(clean);
+    free(dirty);
+    free(output);
+    return 0;
+}
@@ -0,0 +1,841 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+/*
+ * Offline statistics over recorded event journals
+ *
+ * Usage: AdvancedInformationJournalStats [-j workers] <journal file or directory>...
+ *
+ * All journals are memory mapped and scanned by every worker in file name order. Client records are
+ * partitioned between the workers by connection and clientID, connection records are seen by all of
+ * them, so every worker follows complete sessions without any locking. The per worker results are
+ * merged afterwards, concurrency changes are merged by their position in the journal.
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "journalformat.h"
+
+#define STATS_MAX_WORKERS 64
+#define STATS_PATH_BUFSIZE 1024
+#define STATS_TEXT_BUFSIZE 64
+#define STATS_PAGE_COUNT 256
+#define STATS_PAGE_SIZE 256
+#define STATS_CHANNEL_BUCKETS 1024
+#define NS_PER_SECOND 1000000000ULL
+#define NS_PER_HOUR (3600ULL * NS_PER_SECOND)
+
+/* Memory mapped journal file */
+struct JournalFile {
+    char*                       path;
+    const char*                 name;
+    void*                       mapping;
+    size_t                      size;
+    const struct JournalRecord* records;
+    size_t                      recordCount;
+    uint64_t                    firstPosition;
+};
+
+/* Client session as followed by a worker */
+struct Session {
+    bool     open;
+    bool     joined; /* Start was recorded, not only seen as present */
+    uint64_t channelID;
+    uint64_t startMonotonic;
+    uint64_t channelSince;
+};
+
+/* Own connection of the plugin, sessions are paged by clientID like in the plugin cache */
+struct Connection {
+    uint64_t        serverConnectionHandlerID;
+    uint32_t        server;
+    bool            connected;
+    uint64_t        connectedSince;
+    size_t          openSessions;
+    struct Session* pages[STATS_PAGE_COUNT];
+};
+
+struct ServerStats {
+    char     uniqueID[JOURNAL_TEXT_SIZE + 1];
+    uint64_t observedNs;
+    uint64_t completeSessions;
+    uint64_t truncatedSessions;
+    uint64_t joins;
+    uint64_t leaves;
+    uint64_t timeouts;
+    uint64_t kicks;
+    uint64_t bans;
+    uint64_t nicknames;
+};
+
+struct ChannelStats {
+    uint32_t server;
+    uint64_t channelID;
+    uint64_t dwellNs;
+    uint64_t visits;
+    uint64_t arrivals;
+    uint64_t departures;
+};
+
+struct ChannelTable {
+    struct ChannelStats* entries;
+    size_t               capacity;
+    size_t               count;
+};
+
+struct Duration {
+    uint32_t server;
+    uint64_t durationNs;
+};
+
+enum ConcurrencyKind { CONCURRENCY_PRESENT, CONCURRENCY_JOIN, CONCURRENCY_LEAVE, CONCURRENCY_CLOSED };
+
+/* Change of the number of connected clients at a position in the journal */
+struct ConcurrencyEvent {
+    uint64_t position;
+    uint64_t wallclockNs;
+    uint32_t server;
+    int8_t   delta;
+    uint8_t  kind;
+};
+
+struct HourStats {
+    uint64_t hour;
+    uint64_t peak;
+    uint64_t joins;
+    uint64_t leaves;
+};
+
+struct Worker {
+    thrd_t                   thread;
+    unsigned int             index;
+    struct Connection*       connections;
+    size_t                   connectionCount;
+    size_t                   connectionCapacity;
+    struct ServerStats*      servers;
+    size_t                   serverCount;
+    size_t                   serverCapacity;
+    struct ChannelTable      channels;
+    struct Duration*         durations;
+    size_t                   durationCount;
+    size_t                   durationCapacity;
+    struct ConcurrencyEvent* events;
+    size_t                   eventCount;
+    size_t                   eventCapacity;
+    uint64_t                 previousMonotonic;
+    uint64_t                 previousWallclock;
+    bool                     failed;
+};
+
+static struct JournalFile* files        = NULL;
+static size_t              fileCount    = 0;
+static size_t              fileCapacity = 0;
+static unsigned int        workerCount  = 1;
+
+/* Grows a dynamic array so that one more element fits */
+static bool reserve(void** items, size_t* capacity, size_t count, size_t elementSize) {
+    if (count < *capacity) return true;
+    const size_t newCapacity = *capacity ? *capacity * 2 : 64;
+    void*        grown       = realloc(*items, newCapacity * elementSize);
+    if (!grown) return false;
+    *items    = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+static unsigned int processorCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
+
+static bool addFile(const char* path) {
+    if (!reserve((void**)&files, &fileCapacity, fileCount, sizeof(struct JournalFile))) return false;
+    struct JournalFile* file = &files[fileCount];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    if (!file->path) return false;
+    const char* slash = strrchr(file->path, '/');
+#ifdef _WIN32
+    const char* backslash = strrchr(file->path, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+#endif
+    file->name = slash ? slash + 1 : file->path;
+    ++fileCount;
+    return true;
+}
+
+static bool hasJournalExtension(const char* name) {
+    const size_t length = strlen(name);
+    return length > 4 && strcmp(name + length - 4, ".aij") == 0;
+}
+
+/* Adds a journal file or all journals of a directory */
+static bool collectPath(const char* path) {
+    char entryPath[STATS_PATH_BUFSIZE];
+#ifdef _WIN32
+    const DWORD attributes = GetFileAttributesA(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES) return false;
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY)) return addFile(path);
+
+    char pattern[STATS_PATH_BUFSIZE];
+    snprintf(pattern, sizeof(pattern), "%s\\*.aij", path);
+    WIN32_FIND_DATAA entry;
+    HANDLE           search = FindFirstFileA(pattern, &entry);
+    if (search == INVALID_HANDLE_VALUE) return true;
+    do {
+        if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !hasJournalExtension(entry.cFileName)) continue;
+        snprintf(entryPath, sizeof(entryPath), "%s\\%s", path, entry.cFileName);
+        if (!addFile(entryPath)) {
+            FindClose(search);
+            return false;
+        }
+    } while (FindNextFileA(search, &entry));
+    FindClose(search);
+#else
+    struct stat status;
+    if (stat(path, &status) != 0) return false;
+    if (!S_ISDIR(status.st_mode)) return addFile(path);
+
+    DIR* directory = opendir(path);
+    if (!directory) return false;
+    struct dirent* entry;
+    while ((entry = readdir(directory))) {
+        if (!hasJournalExtension(entry->d_name)) continue;
+        snprintf(entryPath, sizeof(entryPath), "%s/%s", path, entry->d_name);
+        if (stat(entryPath, &status) != 0 || !S_ISREG(status.st_mode)) continue;
+        if (!addFile(entryPath)) {
+            closedir(directory);
+            return false;
+        }
+    }
+    closedir(directory);
+#endif
+    return true;
+}
+
+/* Journal names contain the day, sorting by name restores the recording order */
+static int compareFiles(const void* left, const void* right) {
+    const struct JournalFile* a     = left;
+    const struct JournalFile* b     = right;
+    const int                 order = strcmp(a->name, b->name);
+    return order ? order : strcmp(a->path, b->path);
+}
+
+static bool mapFile(struct JournalFile* file) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file->size = (size_t)size.QuadPart;
+    if (file->size > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            file->mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(handle);
+#else
+    const int descriptor = open(file->path, O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        return false;
+    }
+    file->size = (size_t)status.st_size;
+    if (file->size > 0) {
+        file->mapping = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (file->mapping == MAP_FAILED) {
+            file->mapping = NULL;
+        } else {
+            madvise(file->mapping, file->size, MADV_SEQUENTIAL);
+        }
+    }
+    close(descriptor);
+#endif
+    if (file->size > 0 && !file->mapping) return false;
+
+    /* A crash may leave a partial record at the end, it is ignored */
+    const struct JournalFileHeader* header = file->mapping;
+    if (file->size < sizeof(*header) || memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0 || header->version != JOURNAL_VERSION ||
+        header->recordSize != JOURNAL_RECORD_SIZE) {
+        return false;
+    }
+    file->records     = (const struct JournalRecord*)((const char*)file->mapping + sizeof(*header));
+    file->recordCount = (file->size - sizeof(*header)) / JOURNAL_RECORD_SIZE;
+    return true;
+}
+
+static void unmapFile(struct JournalFile* file) {
+    if (!file->mapping) return;
+#ifdef _WIN32
+    UnmapViewOfFile(file->mapping);
+#else
+    munmap(file->mapping, file->size);
+#endif
+    file->mapping = NULL;
+}
+
+/* Worker that follows the sessions of a connection and clientID */
+static unsigned int ownerOf(uint64_t serverConnectionHandlerID, uint16_t clientID) {
+    uint64_t key = serverConnectionHandlerID << 16 | clientID;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (unsigned int)(key % workerCount);
+}
+
+static size_t channelSlot(uint32_t key, uint64_t channelID, size_t capacity) {
+    return (size_t)((channelID * 31 + key) * 0x9E3779B97F4A7C15ULL >> 32) & (capacity - 1);
+}
+
+/* Channel statistics of a server, entries are keyed by server index + 1 so that an all zero entry is empty */
+static struct ChannelStats* getChannel(struct ChannelTable* table, uint32_t server, uint64_t channelID) {
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        const size_t         capacity = table->capacity ? table->capacity * 2 : STATS_CHANNEL_BUCKETS;
+        struct ChannelStats* entries  = calloc(capacity, sizeof(struct ChannelStats));
+        if (!entries) return NULL;
+        for (size_t index = 0; index < table->capacity; ++index) {
+            const struct ChannelStats* entry = &table->entries[index];
+            if (entry->server == 0) continue;
+            size_t slot = channelSlot(entry->server, entry->channelID, capacity);
+            while (entries[slot].server != 0) slot = (slot + 1) & (capacity - 1);
+            entries[slot] = *entry;
+        }
+        free(table->entries);
+        table->entries  = entries;
+        table->capacity = capacity;
+    }
+
+    const uint32_t key  = server + 1;
+    size_t         slot = channelSlot(key, channelID, table->capacity);
+    for (;;) {
+        struct ChannelStats* entry = &table->entries[slot];
+        if (entry->server == key && entry->channelID == channelID) return entry;
+        if (entry->server == 0) {
+            entry->server    = key;
+            entry->channelID = channelID;
+            ++table->count;
+            return entry;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+}
+
+/* Server index of a virtual server unique identifier, index 0 collects connections without one */
+static uint32_t internServer(struct Worker* worker, const char* uniqueID) {
+    for (size_t index = 0; index < worker->serverCount; ++index) {
+        if (strncmp(worker->servers[index].uniqueID, uniqueID, JOURNAL_TEXT_SIZE) == 0) return (uint32_t)index;
+    }
+    if (!reserve((void**)&worker->servers, &worker->serverCapacity, worker->serverCount, sizeof(struct ServerStats))) {
+        worker->failed = true;
+        return 0;
+    }
+    struct ServerStats* server = &worker->servers[worker->serverCount];
+    memset(server, 0, sizeof(*server));
+    memcpy(server->uniqueID, uniqueID, strnlen(uniqueID, JOURNAL_TEXT_SIZE));
+    return (uint32_t)worker->serverCount++;
+}
+
+static struct Connection* getConnection(struct Worker* worker, uint64_t serverConnectionHandlerID) {
+    for (size_t index = 0; index < worker->connectionCount; ++index) {
+        if (worker->connections[index].serverConnectionHandlerID == serverConnectionHandlerID) return &worker->connections[index];
+    }
+    if (!reserve((void**)&worker->connections, &worker->connectionCapacity, worker->connectionCount, sizeof(struct Connection))) {
+        worker->failed = true;
+        return NULL;
+    }
+    struct Connection* connection = &worker->connections[worker->connectionCount++];
+    memset(connection, 0, sizeof(*connection));
+    connection->serverConnectionHandlerID = serverConnectionHandlerID;
+    return connection;
+}
+
+static struct Session* getSession(struct Worker* worker, struct Connection* connection, uint16_t clientID) {
+    struct Session** page = &connection->pages[clientID / STATS_PAGE_SIZE];
+    if (!*page) {
+        *page = calloc(STATS_PAGE_SIZE, sizeof(struct Session));
+        if (!*page) {
+            worker->failed = true;
+            return NULL;
+        }
+    }
+    return &(*page)[clientID % STATS_PAGE_SIZE];
+}
+
+static void addEvent(struct Worker* worker, uint64_t position, uint64_t wallclockNs, uint32_t server, int8_t delta, enum ConcurrencyKind kind) {
+    if (!reserve((void**)&worker->events, &worker->eventCapacity, worker->eventCount, sizeof(struct ConcurrencyEvent))) {
+        worker->failed = true;
+        return;
+    }
+    worker->events[worker->eventCount++] = (struct ConcurrencyEvent){position, wallclockNs, server, delta, (uint8_t)kind};
+}
+
+static void addDwell(struct Worker* worker, uint32_t server, struct Session* session, uint64_t monotonicNs) {
+    struct ChannelStats* channel = getChannel(&worker->channels, server, session->channelID);
+    if (!channel) {
+        worker->failed = true;
+        return;
+    }
+    if (monotonicNs > session->channelSince) channel->dwellNs += monotonicNs - session->channelSince;
+}
+
+static void openSession(struct Worker* worker, struct Connection* connection, struct Session* session, const struct JournalRecord* record, uint64_t position, bool joined) {
+    session->open           = true;
+    session->joined         = joined;
+    session->channelID      = record->toChannelID;
+    session->startMonotonic = record->monotonicNs;
+    session->channelSince   = record->monotonicNs;
+    ++connection->openSessions;
+
+    struct ChannelStats* channel = getChannel(&worker->channels, connection->server, session->channelID);
+    if (channel) {
+        ++channel->visits;
+        if (joined) ++channel->arrivals;
+    } else {
+        worker->failed = true;
+    }
+    addEvent(worker, position, record->wallclockNs, connection->server, 1, joined ? CONCURRENCY_JOIN : CONCURRENCY_PRESENT);
+}
+
+/* Ends a session, only sessions with a recorded join and leave have a known duration */
+static void closeSession(struct Worker* worker, struct Connection* connection, struct Session* session, uint64_t position, uint64_t monotonicNs, uint64_t wallclockNs, bool left) {
+    addDwell(worker, connection->server, session, monotonicNs);
+    if (left) {
+        struct ChannelStats* channel = getChannel(&worker->channels, connection->server, session->channelID);
+        if (channel) ++channel->departures;
+    }
+    struct ServerStats* server = &worker->servers[connection->server];
+    if (left && session->joined) {
+        ++server->completeSessions;
+        if (reserve((void**)&worker->durations, &worker->durationCapacity, worker->durationCount, sizeof(struct Duration))) {
+            worker->durations[worker->durationCount++] = (struct Duration){connection->server, monotonicNs > session->startMonotonic ? monotonicNs - session->startMonotonic : 0};
+        } else {
+            worker->failed = true;
+        }
+    } else {
+        ++server->truncatedSessions;
+    }
+    session->open = false;
+    --connection->openSessions;
+    addEvent(worker, position, wallclockNs, connection->server, -1, left ? CONCURRENCY_LEAVE : CONCURRENCY_CLOSED);
+}
+
+/* Our own connection ended, all sessions lose their end */
+static void closeConnection(struct Worker* worker, struct Connection* connection, uint64_t position, uint64_t monotonicNs, uint64_t wallclockNs) {
+    for (size_t page = 0; page < STATS_PAGE_COUNT && connection->openSessions > 0; ++page) {
+        if (!connection->pages[page]) continue;
+        for (size_t slot = 0; slot < STATS_PAGE_SIZE; ++slot) {
+            struct Session* session = &connection->pages[page][slot];
+            if (session->open) closeSession(worker, connection, session, position, monotonicNs, wallclockNs, false);
+        }
+    }
+    if (connection->connected && monotonicNs > connection->connectedSince) worker->servers[connection->server].observedNs += monotonicNs - connection->connectedSince;
+    connection->connected = false;
+}
+
+static void closeAllConnections(struct Worker* worker, uint64_t position, uint64_t monotonicNs, uint64_t wallclockNs) {
+    for (size_t index = 0; index < worker->connectionCount; ++index) closeConnection(worker, &worker->connections[index], position, monotonicNs, wallclockNs);
+}
+
+static void clientEvent(struct Worker* worker, const struct JournalRecord* record, uint64_t position) {
+    struct Connection* connection = getConnection(worker, record->serverConnectionHandlerID);
+    if (!connection) return;
+    struct Session* session = getSession(worker, connection, record->clientID);
+    if (!session) return;
+    struct ServerStats* server = &worker->servers[connection->server];
+
+    switch (record->type) {
+    case JOURNAL_EVENT_PRESENT:
+    case JOURNAL_EVENT_JOIN:
+        if (session->open) closeSession(worker, connection, session, position, record->monotonicNs, record->wallclockNs, false);
+        if (record->type == JOURNAL_EVENT_JOIN) ++server->joins;
+        openSession(worker, connection, session, record, position, record->type == JOURNAL_EVENT_JOIN);
+        break;
+    case JOURNAL_EVENT_LEAVE:
+    case JOURNAL_EVENT_TIMEOUT:
+    case JOURNAL_EVENT_KICK_SERVER:
+    case JOURNAL_EVENT_BAN:
+        if (record->type == JOURNAL_EVENT_LEAVE) ++server->leaves;
+        if (record->type == JOURNAL_EVENT_TIMEOUT) ++server->timeouts;
+        if (record->type == JOURNAL_EVENT_KICK_SERVER) ++server->kicks;
+        if (record->type == JOURNAL_EVENT_BAN) ++server->bans;
+        if (session->open) closeSession(worker, connection, session, position, record->monotonicNs, record->wallclockNs, true);
+        break;
+    case JOURNAL_EVENT_MOVE:
+    case JOURNAL_EVENT_KICK_CHANNEL: {
+        if (!session->open) break;
+        addDwell(worker, connection->server, session, record->monotonicNs);
+        struct ChannelStats* from = getChannel(&worker->channels, connection->server, session->channelID);
+        if (from) ++from->departures;
+        struct ChannelStats* to = getChannel(&worker->channels, connection->server, record->toChannelID);
+        if (to) {
+            ++to->visits;
+            ++to->arrivals;
+        }
+        if (!from || !to) worker->failed = true;
+        session->channelID    = record->toChannelID;
+        session->channelSince = record->monotonicNs;
+        break;
+    }
+    case JOURNAL_EVENT_NICKNAME:
+        ++server->nicknames;
+        break;
+    default:
+        break;
+    }
+}
+
+static int workerMain(void* argument) {
+    struct Worker* worker = argument;
+    internServer(worker, "");
+
+    for (size_t fileIndex = 0; fileIndex < fileCount && !worker->failed; ++fileIndex) {
+        const struct JournalFile* file = &files[fileIndex];
+        for (size_t index = 0; index < file->recordCount; ++index) {
+            const struct JournalRecord* record   = &file->records[index];
+            const uint64_t              position = file->firstPosition + index;
+            switch (record->type) {
+            case JOURNAL_EVENT_START:
+                /* The previous run ended without a stop record, close everything at its last record */
+                closeAllConnections(worker, position, worker->previousMonotonic, worker->previousWallclock);
+                break;
+            case JOURNAL_EVENT_STOP:
+                closeAllConnections(worker, position, record->monotonicNs, record->wallclockNs);
+                break;
+            case JOURNAL_EVENT_CONNECTED: {
+                struct Connection* connection = getConnection(worker, record->serverConnectionHandlerID);
+                if (!connection) break;
+                closeConnection(worker, connection, position, record->monotonicNs, record->wallclockNs);
+                connection->server         = internServer(worker, record->text);
+                connection->connected      = true;
+                connection->connectedSince = record->monotonicNs;
+                break;
+            }
+            case JOURNAL_EVENT_DISCONNECTED: {
+                struct Connection* connection = getConnection(worker, record->serverConnectionHandlerID);
+                if (connection) closeConnection(worker, connection, position, record->monotonicNs, record->wallclockNs);
+                break;
+            }
+            default:
+                if (ownerOf(record->serverConnectionHandlerID, record->clientID) == worker->index) clientEvent(worker, record, position);
+                break;
+            }
+            worker->previousMonotonic = record->monotonicNs;
+            worker->previousWallclock = record->wallclockNs;
+        }
+    }
+    return 0;
+}
+
+static int compareDurations(const void* left, const void* right) {
+    const struct Duration* a = left;
+    const struct Duration* b = right;
+    if (a->server != b->server) return a->server < b->server ? -1 : 1;
+    return a->durationNs < b->durationNs ? -1 : a->durationNs > b->durationNs;
+}
+
+static int compareChannels(const void* left, const void* right) {
+    const struct ChannelStats* a = left;
+    const struct ChannelStats* b = right;
+    if (a->server != b->server) return a->server < b->server ? -1 : 1;
+    return a->dwellNs > b->dwellNs ? -1 : a->dwellNs < b->dwellNs;
+}
+
+static void formatDuration(char* text, size_t size, uint64_t nanoseconds) {
+    const unsigned long long seconds = nanoseconds / NS_PER_SECOND;
+    if (seconds >= 86400) {
+        snprintf(text, size, "%llud %02lluh %02llum", seconds / 86400, seconds % 86400 / 3600, seconds % 3600 / 60);
+    } else {
+        snprintf(text, size, "%lluh %02llum %02llus", seconds / 3600, seconds % 3600 / 60, seconds % 60);
+    }
+}
+
+/* Wall clock timestamp as UTC date */
+static void formatDate(char* text, size_t size, uint64_t wallclockNs) {
+    const time_t time = (time_t)(wallclockNs / NS_PER_SECOND);
+    struct tm    utc;
+#ifdef _WIN32
+    const bool converted = gmtime_s(&utc, &time) == 0;
+#else
+    const bool converted = gmtime_r(&time, &utc) != NULL;
+#endif
+    if (!converted || strftime(text, size, "%Y-%m-%d %H:%M", &utc) == 0) snprintf(text, size, "%llu", (unsigned long long)(wallclockNs / NS_PER_SECOND));
+}
+
+static uint64_t percentile(const struct Duration* durations, size_t count, unsigned int percent) {
+    return count ? durations[(count - 1) * percent / 100].durationNs : 0;
+}
+
+/* Replays the concurrency changes of all workers in journal order into hourly peaks per server */
+static struct HourStats** mergeConcurrency(struct Worker* workers, size_t serverCount, size_t* hourCounts) {
+    struct HourStats** hours     = calloc(serverCount, sizeof(struct HourStats*));
+    size_t*            capacity  = calloc(serverCount, sizeof(size_t));
+    uint64_t*          current   = calloc(serverCount, sizeof(uint64_t));
+    size_t             cursors[STATS_MAX_WORKERS] = {0};
+    if (!hours || !capacity || !current) {
+        free(hours);
+        free(capacity);
+        free(current);
+        return NULL;
+    }
+
+    for (;;) {
+        struct ConcurrencyEvent* next = NULL;
+        unsigned int             from = 0;
+        for (unsigned int index = 0; index < workerCount; ++index) {
+            if (cursors[index] == workers[index].eventCount) continue;
+            struct ConcurrencyEvent* event = &workers[index].events[cursors[index]];
+            if (!next || event->position < next->position) {
+                next = event;
+                from = index;
+            }
+        }
+        if (!next) break;
+        ++cursors[from];
+
+        const uint32_t server = next->server;
+        const uint64_t hour   = next->wallclockNs / NS_PER_HOUR;
+        if (hourCounts[server] == 0 || hours[server][hourCounts[server] - 1].hour != hour) {
+            if (!reserve((void**)&hours[server], &capacity[server], hourCounts[server], sizeof(struct HourStats))) continue;
+            hours[server][hourCounts[server]++] = (struct HourStats){hour, current[server], 0, 0};
+        }
+        struct HourStats* stats = &hours[server][hourCounts[server] - 1];
+        if (next->delta > 0) {
+            ++current[server];
+        } else if (current[server] > 0) {
+            --current[server];
+        }
+        if (current[server] > stats->peak) stats->peak = current[server];
+        if (next->kind == CONCURRENCY_JOIN) ++stats->joins;
+        if (next->kind == CONCURRENCY_LEAVE) ++stats->leaves;
+    }
+    free(capacity);
+    free(current);
+    return hours;
+}
+
+static void printServer(const struct ServerStats* server, const struct Duration* durations, size_t durationCount, const struct HourStats* hours, size_t hourCount,
+                        const struct ChannelStats* channels, size_t channelCount, size_t openSessions) {
+    char text[4][STATS_TEXT_BUFSIZE];
+    printf("\nServer %s\n", server->uniqueID[0] ? server->uniqueID : "(unknown)");
+    formatDuration(text[0], sizeof(text[0]), server->observedNs);
+    printf("  Observed: %s\n", text[0]);
+    printf("  Sessions: %llu complete, %llu truncated, %zu still open\n", (unsigned long long)server->completeSessions, (unsigned long long)server->truncatedSessions, openSessions);
+    printf("  Joins: %llu, leaves: %llu, timeouts: %llu, kicks: %llu, bans: %llu, nickname changes: %llu\n", (unsigned long long)server->joins, (unsigned long long)server->leaves,
+           (unsigned long long)server->timeouts, (unsigned long long)server->kicks, (unsigned long long)server->bans, (unsigned long long)server->nicknames);
+
+    if (durationCount > 0) {
+        uint64_t total = 0;
+        for (size_t index = 0; index < durationCount; ++index) total += durations[index].durationNs;
+        formatDuration(text[0], sizeof(text[0]), total / durationCount);
+        formatDuration(text[1], sizeof(text[1]), percentile(durations, durationCount, 50));
+        formatDuration(text[2], sizeof(text[2]), percentile(durations, durationCount, 90));
+        formatDuration(text[3], sizeof(text[3]), durations[durationCount - 1].durationNs);
+        printf("  Session duration: mean %s, median %s, p90 %s, max %s\n", text[0], text[1], text[2], text[3]);
+    }
+
+    if (hourCount > 0) {
+        printf("  Peak concurrency per hour (UTC, hours without events are omitted)\n");
+        printf("    %-16s  %6s  %6s  %6s\n", "Hour", "Peak", "Joins", "Leaves");
+        for (size_t index = 0; index < hourCount; ++index) {
+            formatDate(text[0], sizeof(text[0]), hours[index].hour * NS_PER_HOUR);
+            printf("    %-16s  %6llu  %6llu  %6llu\n", text[0], (unsigned long long)hours[index].peak, (unsigned long long)hours[index].joins, (unsigned long long)hours[index].leaves);
+        }
+    }
+
+    if (channelCount > 0) {
+        const double observedHours = (double)server->observedNs / (double)NS_PER_HOUR;
+        printf("  Channels by dwell time (churn counts arrivals and departures per observed hour)\n");
+        printf("    %-10s  %-13s  %-13s  %8s  %10s  %10s  %8s\n", "ChannelID", "Dwell", "Average", "Visits", "Arrivals", "Departures", "Churn/h");
+        for (size_t index = 0; index < channelCount; ++index) {
+            const struct ChannelStats* channel = &channels[index];
+            formatDuration(text[0], sizeof(text[0]), channel->dwellNs);
+            formatDuration(text[1], sizeof(text[1]), channel->visits ? channel->dwellNs / channel->visits : 0);
+            printf("    %-10llu  %-13s  %-13s  %8llu  %10llu  %10llu  %8.2f\n", (unsigned long long)channel->channelID, text[0], text[1], (unsigned long long)channel->visits,
+                   (unsigned long long)channel->arrivals, (unsigned long long)channel->departures,
+                   observedHours > 0 ? (double)(channel->arrivals + channel->departures) / observedHours : 0.0);
+        }
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-j workers] <journal file or directory>...\n", program);
+}
+
+int main(int argc, char** argv) {
+    workerCount = processorCount();
+    int argument = 1;
+    for (; argument < argc && argv[argument][0] == '-'; ++argument) {
+        if (strcmp(argv[argument], "-j") == 0 && argument + 1 < argc) {
+            workerCount = (unsigned int)strtoul(argv[++argument], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argument == argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (workerCount == 0) workerCount = 1;
+    if (workerCount > STATS_MAX_WORKERS) workerCount = STATS_MAX_WORKERS;
+
+    for (; argument < argc; ++argument) {
+        if (!collectPath(argv[argument])) {
+            fprintf(stderr, "Cannot read %s\n", argv[argument]);
+            return 1;
+        }
+    }
+    if (fileCount == 0) {
+        fprintf(stderr, "No journals found\n");
+        return 1;
+    }
+    qsort(files, fileCount, sizeof(struct JournalFile), compareFiles);
+
+    const clock_t   started = clock();
+    struct timespec wallStart;
+    timespec_get(&wallStart, TIME_UTC);
+    uint64_t recordCount = 0;
+    for (size_t index = 0; index < fileCount; ++index) {
+        if (!mapFile(&files[index])) {
+            fprintf(stderr, "Skipping %s, not a journal\n", files[index].path);
+            unmapFile(&files[index]);
+            files[index].recordCount = 0;
+        }
+        files[index].firstPosition = recordCount;
+        recordCount += files[index].recordCount;
+    }
+
+    struct Worker* workers = calloc(workerCount, sizeof(struct Worker));
+    if (!workers) return 1;
+    unsigned int startedWorkers = 0;
+    for (unsigned int index = 0; index < workerCount; ++index) {
+        workers[index].index = index;
+        if (thrd_create(&workers[index].thread, workerMain, &workers[index]) != thrd_success) break;
+        ++startedWorkers;
+    }
+    for (unsigned int index = 0; index < startedWorkers; ++index) thrd_join(workers[index].thread, NULL);
+    bool failed = startedWorkers != workerCount;
+    for (unsigned int index = 0; index < startedWorkers; ++index) failed |= workers[index].failed;
+    if (failed) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Every worker saw the same connection records, so server indices match between workers */
+    const size_t        serverCount = workers[0].serverCount;
+    struct ServerStats* servers     = workers[0].servers;
+    size_t*             openCounts  = calloc(serverCount, sizeof(size_t));
+    size_t*             hourCounts  = calloc(serverCount, sizeof(size_t));
+    struct ChannelTable channels    = {0};
+    size_t              durationCount = 0;
+    if (!openCounts || !hourCounts) return 1;
+    for (unsigned int index = 0; index < workerCount; ++index) {
+        struct Worker* worker = &workers[index];
+        durationCount += worker->durationCount;
+        for (size_t connection = 0; connection < worker->connectionCount; ++connection) openCounts[worker->connections[connection].server] += worker->connections[connection].openSessions;
+        for (size_t channel = 0; channel < worker->channels.capacity; ++channel) {
+            const struct ChannelStats* entry = &worker->channels.entries[channel];
+            if (entry->server == 0) continue;
+            struct ChannelStats* merged = getChannel(&channels, entry->server - 1, entry->channelID);
+            if (!merged) return 1;
+            merged->dwellNs += entry->dwellNs;
+            merged->visits += entry->visits;
+            merged->arrivals += entry->arrivals;
+            merged->departures += entry->departures;
+        }
+        if (index == 0) continue;
+        for (size_t server = 0; server < serverCount; ++server) {
+            servers[server].completeSessions += worker->servers[server].completeSessions;
+            servers[server].truncatedSessions += worker->servers[server].truncatedSessions;
+            servers[server].joins += worker->servers[server].joins;
+            servers[server].leaves += worker->servers[server].leaves;
+            servers[server].timeouts += worker->servers[server].timeouts;
+            servers[server].kicks += worker->servers[server].kicks;
+            servers[server].bans += worker->servers[server].bans;
+            servers[server].nicknames += worker->servers[server].nicknames;
+        }
+    }
+
+    struct Duration* durations = malloc((durationCount ? durationCount : 1) * sizeof(struct Duration));
+    if (!durations) return 1;
+    size_t durationOffset = 0;
+    for (unsigned int index = 0; index < workerCount; ++index) {
+        if (workers[index].durationCount == 0) continue;
+        memcpy(&durations[durationOffset], workers[index].durations, workers[index].durationCount * sizeof(struct Duration));
+        durationOffset += workers[index].durationCount;
+    }
+    qsort(durations, durationCount, sizeof(struct Duration), compareDurations);
+
+    size_t channelCount = 0;
+    for (size_t index = 0; index < channels.capacity; ++index) {
+        if (channels.entries[index].server == 0) continue;
+        channels.entries[channelCount] = channels.entries[index];
+        --channels.entries[channelCount++].server;
+    }
+    qsort(channels.entries, channelCount, sizeof(struct ChannelStats), compareChannels);
+
+    struct HourStats** hours = mergeConcurrency(workers, serverCount, hourCounts);
+    if (!hours) return 1;
+
+    struct timespec wallEnd;
+    timespec_get(&wallEnd, TIME_UTC);
+    const double elapsed = (double)(wallEnd.tv_sec - wallStart.tv_sec) + (double)(wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+    char         first[STATS_TEXT_BUFSIZE] = "-";
+    char         last[STATS_TEXT_BUFSIZE]  = "-";
+    for (size_t index = 0; index < fileCount; ++index) {
+        if (files[index].recordCount == 0) continue;
+        if (first[0] == '-') formatDate(first, sizeof(first), files[index].records[0].wallclockNs);
+        formatDate(last, sizeof(last), files[index].records[files[index].recordCount - 1].wallclockNs);
+    }
+    printf("Journals: %zu files, %llu records from %s to %s (UTC)\n", fileCount, (unsigned long long)recordCount, first, last);
+    printf("Analyzed with %u workers in %.3f s (%.3f s CPU)\n", workerCount, elapsed, (double)(clock() - started) / CLOCKS_PER_SEC);
+
+    size_t durationStart = 0;
+    size_t channelStart  = 0;
+    for (uint32_t server = 0; server < serverCount; ++server) {
+        size_t durationEnd = durationStart;
+        while (durationEnd < durationCount && durations[durationEnd].server == server) ++durationEnd;
+        size_t channelEnd = channelStart;
+        while (channelEnd < channelCount && channels.entries[channelEnd].server == server) ++channelEnd;
+        if (server != 0 || servers[0].completeSessions + servers[0].truncatedSessions + openCounts[0] > 0) {
+            printServer(&servers[server], &durations[durationStart], durationEnd - durationStart, hours[server], hourCounts[server], &channels.entries[channelStart],
+                        channelEnd - channelStart, openCounts[server]);
+        }
+        durationStart = durationEnd;
+        channelStart  = channelEnd;
+    }
+
+    for (size_t index = 0; index < fileCount; ++index) unmapFile(&files[index]);
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#include <time.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_errors.h"
+
+#include "mockhost.h"
+
+static atomic_bool           counting = false;
+static atomic_uint_least64_t allocations;
+static atomic_uint_least64_t allocatedBytes;
+static atomic_int_least64_t  liveBytes;
+static atomic_int_least64_t  peakLiveBytes;
+
+/* Host code of the current thread, its allocations do not belong to the plugin */
+static thread_local unsigned int hostDepth = 0;
+
+/*********************************** Allocation counting ************************************/
+
+#if defined(__GLIBC__)
+/* glibc supports replacing malloc, the plugin library resolves these definitions first */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* pointer, size_t size);
+extern void  __libc_free(void* pointer);
+
+static void countAllocation(void* pointer) {
+    if (!pointer || !atomic_load_explicit(&counting, memory_order_relaxed) || hostDepth) return;
+    const int64_t size = (int64_t)malloc_usable_size(pointer);
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocatedBytes, (uint64_t)size, memory_order_relaxed);
+    const int64_t live = atomic_fetch_add_explicit(&liveBytes, size, memory_order_relaxed) + size;
+    int64_t       peak = atomic_load_explicit(&peakLiveBytes, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&peakLiveBytes, &peak, live, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+static void countRelease(void* pointer) {
+    if (!pointer || !atomic_load_explicit(&counting, memory_order_relaxed) || hostDepth) return;
+    atomic_fetch_sub_explicit(&liveBytes, (int64_t)malloc_usable_size(pointer), memory_order_relaxed);
+}
+
+void* malloc(size_t size) {
+    void* pointer = __libc_malloc(size);
+    countAllocation(pointer);
+    return pointer;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* pointer = __libc_calloc(count, size);
+    countAllocation(pointer);
+    return pointer;
+}
+
+void* realloc(void* pointer, size_t size) {
+    countRelease(pointer);
+    void* resized = __libc_realloc(pointer, size);
+    countAllocation(resized ? resized : (size ? pointer : NULL));
+    return resized;
+}
+
+void free(void* pointer) {
+    countRelease(pointer);
+    __libc_free(pointer);
+}
+
+bool mockAllocationCounting(void) {
+    return true;
+}
+#else
+bool mockAllocationCounting(void) {
+    return false;
+}
+#endif
+
+void mockCountAllocations(bool enabled) {
+    atomic_store(&counting, enabled);
+}
+
+void mockResetPeak(void) {
+    atomic_store(&peakLiveBytes, atomic_load(&liveBytes));
+}
+
+void mockUsage(struct MockUsage* usage) {
+    usage->allocations    = atomic_load(&allocations);
+    usage->allocatedBytes = atomic_load(&allocatedBytes);
+    usage->liveBytes      = atomic_load(&liveBytes);
+    usage->peakLiveBytes  = atomic_load(&peakLiveBytes);
+}
+
+/*********************************** Host memory ************************************/
+
+void* mockAllocate(size_t size) {
+    ++hostDepth;
+    void* pointer = malloc(size);
+    --hostDepth;
+    return pointer;
+}
+
+char* mockString(const char* text) {
+    const size_t length = strlen(text);
+    char*        copy   = mockAllocate(length + 1);
+    if (copy) memcpy(copy, text, length + 1);
+    return copy;
+}
+
+unsigned int mockFreeMemory(void* pointer) {
+    ++hostDepth;
+    free(pointer);
+    --hostDepth;
+    return ERROR_ok;
+}
+
+unsigned int mockLogMessage(const char* logMessage, enum LogLevel severity, const char* channel, uint64 logID) {
+    return ERROR_ok;
+}
+
+/*********************************** Plugin library ************************************/
+
+static void* findSymbol(void* library, const char* name) {
+#ifdef _WIN32
+    return (void*)GetProcAddress((HMODULE)library, name);
+#else
+    return dlsym(library, name);
+#endif
+}
+
+#define MOCK_SYMBOL(field, name) *(void**)&plugin->field = findSymbol(plugin->library, "ts3plugin_" name)
+
+bool mockLoadPlugin(struct MockPlugin* plugin, const char* path) {
+    memset(plugin, 0, sizeof(*plugin));
+#ifdef _WIN32
+    plugin->library = (void*)LoadLibraryA(path);
+#else
+    plugin->library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!plugin->library) fprintf(stderr, "%s\n", dlerror());
+#endif
+    if (!plugin->library) return false;
+
+    MOCK_SYMBOL(setFunctionPointers, "setFunctionPointers");
+    MOCK_SYMBOL(init, "init");
+    MOCK_SYMBOL(shutdown, "shutdown");
+    MOCK_SYMBOL(registerPluginID, "registerPluginID");
+    MOCK_SYMBOL(freeMemory, "freeMemory");
+    MOCK_SYMBOL(infoData, "infoData");
+    MOCK_SYMBOL(initMenus, "initMenus");
+    MOCK_SYMBOL(onMenuItemEvent, "onMenuItemEvent");
+    MOCK_SYMBOL(onConnectStatusChangeEvent, "onConnectStatusChangeEvent");
+    MOCK_SYMBOL(onClientMoveEvent, "onClientMoveEvent");
+    MOCK_SYMBOL(onClientMoveSubscriptionEvent, "onClientMoveSubscriptionEvent");
+    MOCK_SYMBOL(onClientMoveTimeoutEvent, "onClientMoveTimeoutEvent");
+    MOCK_SYMBOL(onClientMoveMovedEvent, "onClientMoveMovedEvent");
+    MOCK_SYMBOL(onClientKickFromChannelEvent, "onClientKickFromChannelEvent");
+    MOCK_SYMBOL(onClientKickFromServerEvent, "onClientKickFromServerEvent");
+    MOCK_SYMBOL(onClientBanFromServerEvent, "onClientBanFromServerEvent");
+    MOCK_SYMBOL(onClientDisplayNameChanged, "onClientDisplayNameChanged");
+    MOCK_SYMBOL(onNewChannelEvent, "onNewChannelEvent");
+    MOCK_SYMBOL(onNewChannelCreatedEvent, "onNewChannelCreatedEvent");
+    MOCK_SYMBOL(onDelChannelEvent, "onDelChannelEvent");
+    MOCK_SYMBOL(onChannelMoveEvent, "onChannelMoveEvent");
+    MOCK_SYMBOL(onUpdateChannelEvent, "onUpdateChannelEvent");
+    MOCK_SYMBOL(onUpdateChannelEditedEvent, "onUpdateChannelEditedEvent");
+    MOCK_SYMBOL(onUpdateClientEvent, "onUpdateClientEvent");
+    MOCK_SYMBOL(onConnectionInfoEvent, "onConnectionInfoEvent");
+    MOCK_SYMBOL(onPluginCommandEvent, "onPluginCommandEvent");
+    MOCK_SYMBOL(onTalkStatusChangeEvent, "onTalkStatusChangeEvent");
+    MOCK_SYMBOL(onBanListEvent, "onBanListEvent");
+    MOCK_SYMBOL(onServerErrorEvent, "onServerErrorEvent");
+    MOCK_SYMBOL(onServerGroupClientAddedEvent, "onServerGroupClientAddedEvent");
+    MOCK_SYMBOL(onServerGroupClientDeletedEvent, "onServerGroupClientDeletedEvent");
+    MOCK_SYMBOL(onClientChannelGroupChangedEvent, "onClientChannelGroupChangedEvent");
+
+    if (!plugin->setFunctionPointers || !plugin->init || !plugin->shutdown) {
+        fprintf(stderr, "%s is not a TeamSpeak plugin\n", path);
+        mockUnloadPlugin(plugin);
+        return false;
+    }
+    return true;
+}
+
+void mockUnloadPlugin(struct MockPlugin* plugin) {
+    if (!plugin->library) return;
+#ifdef _WIN32
+    FreeLibrary((HMODULE)plugin->library);
+#else
+    dlclose(plugin->library);
+#endif
+    plugin->library = NULL;
+}
+
+void mockFreeMenus(const struct MockPlugin* plugin, struct PluginMenuItem** menuItems, char* menuIcon) {
+    if (!plugin->freeMemory) return;
+    if (menuItems) {
+        for (size_t index = 0; menuItems[index]; ++index) plugin->freeMemory(menuItems[index]);
+        plugin->freeMemory(menuItems);
+    }
+    if (menuIcon) plugin->freeMemory(menuIcon);
+}
+
+/*********************************** Clocks ************************************/
+
+#ifdef _WIN32
+static uint64_t fileTimeNs(FILETIME time) {
+    return (((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 100;
+}
+#else
+static uint64_t clockNs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+#endif
+
+uint64_t mockMonotonicNs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000000ULL + counter.QuadPart % frequency.QuadPart * 1000000000ULL / frequency.QuadPart);
+#else
+    return clockNs(CLOCK_MONOTONIC);
+#endif
+}
+
+uint64_t mockThreadCpuNs(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user);
+    return fileTimeNs(kernel) + fileTimeNs(user);
+#else
+    return clockNs(CLOCK_THREAD_CPUTIME_ID);
+#endif
+}
+
+uint64_t mockProcessCpuNs(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    return fileTimeNs(kernel) + fileTimeNs(user);
+#else
+    return clockNs(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+}
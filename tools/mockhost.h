@@ -0,0 +1,100 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+#ifndef MOCKHOST_H
+#define MOCKHOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "teamspeak/public_definitions.h"
+#include "plugin_definitions.h"
+#include "ts3_functions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Plugin library loaded into a headless host, missing optional exports are NULL */
+struct MockPlugin {
+    void* library;
+    void (*setFunctionPointers)(const struct TS3Functions funcs);
+    int (*init)(void);
+    void (*shutdown)(void);
+    void (*registerPluginID)(const char* id);
+    void (*freeMemory)(void* data);
+    void (*infoData)(uint64 serverConnectionHandlerID, uint64 id, enum PluginItemType type, char** data);
+    void (*initMenus)(struct PluginMenuItem*** menuItems, char** menuIcon);
+    void (*onMenuItemEvent)(uint64 serverConnectionHandlerID, enum PluginMenuType type, int menuItemID, uint64 selectedItemID);
+    void (*onConnectStatusChangeEvent)(uint64 serverConnectionHandlerID, int newStatus, unsigned int errorNumber);
+    void (*onClientMoveEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* moveMessage);
+    void (*onClientMoveSubscriptionEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility);
+    void (*onClientMoveTimeoutEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, const char* timeoutMessage);
+    void (*onClientMoveMovedEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID moverID, const char* moverName, const char* moverUniqueIdentifier, const char* moveMessage);
+    void (*onClientKickFromChannelEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier,
+                                         const char* kickMessage);
+    void (*onClientKickFromServerEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier,
+                                        const char* kickMessage);
+    void (*onClientBanFromServerEvent)(uint64 serverConnectionHandlerID, anyID clientID, uint64 oldChannelID, uint64 newChannelID, int visibility, anyID kickerID, const char* kickerName, const char* kickerUniqueIdentifier, uint64 time,
+                                       const char* kickMessage);
+    void (*onClientDisplayNameChanged)(uint64 serverConnectionHandlerID, anyID clientID, const char* displayName, const char* uniqueClientIdentifier);
+    void (*onNewChannelEvent)(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID);
+    void (*onNewChannelCreatedEvent)(uint64 serverConnectionHandlerID, uint64 channelID, uint64 channelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier);
+    void (*onDelChannelEvent)(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier);
+    void (*onChannelMoveEvent)(uint64 serverConnectionHandlerID, uint64 channelID, uint64 newChannelParentID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier);
+    void (*onUpdateChannelEvent)(uint64 serverConnectionHandlerID, uint64 channelID);
+    void (*onUpdateChannelEditedEvent)(uint64 serverConnectionHandlerID, uint64 channelID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier);
+    void (*onUpdateClientEvent)(uint64 serverConnectionHandlerID, anyID clientID, anyID invokerID, const char* invokerName, const char* invokerUniqueIdentifier);
+    void (*onConnectionInfoEvent)(uint64 serverConnectionHandlerID, anyID clientID);
+    void (*onPluginCommandEvent)(uint64 serverConnectionHandlerID, const char* pluginName, const char* pluginCommand, anyID invokerClientID, const char* invokerName, const char* invokerUniqueIdentity);
+    void (*onTalkStatusChangeEvent)(uint64 serverConnectionHandlerID, int status, int isReceivedWhisper, anyID clientID);
+    void (*onBanListEvent)(uint64 serverConnectionHandlerID, uint64 banid, const char* ip, const char* name, const char* uid, const char* mytsid, uint64 creationTime, uint64 durationTime, const char* invokerName, uint64 invokercldbid,
+                           const char* invokeruid, const char* reason, int numberOfEnforcements, const char* lastNickName);
+    int (*onServerErrorEvent)(uint64 serverConnectionHandlerID, const char* errorMessage, unsigned int error, const char* returnCode, const char* extraMessage);
+    void (*onServerGroupClientAddedEvent)(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName, const char* clientUniqueIdentity, uint64 serverGroupID, anyID invokerClientID, const char* invokerName,
+                                          const char* invokerUniqueIdentity);
+    void (*onServerGroupClientDeletedEvent)(uint64 serverConnectionHandlerID, anyID clientID, const char* clientName, const char* clientUniqueIdentity, uint64 serverGroupID, anyID invokerClientID, const char* invokerName,
+                                            const char* invokerUniqueIdentity);
+    void (*onClientChannelGroupChangedEvent)(uint64 serverConnectionHandlerID, uint64 channelGroupID, uint64 channelID, anyID clientID, anyID invokerClientID, const char* invokerName, const char* invokerUniqueIdentity);
+};
+
+/* Loads a plugin library, the required exports must exist */
+bool mockLoadPlugin(struct MockPlugin* plugin, const char* path);
+void mockUnloadPlugin(struct MockPlugin* plugin);
+
+/* Releases the menus created by ts3plugin_initMenus like the client does */
+void mockFreeMenus(const struct MockPlugin* plugin, struct PluginMenuItem** menuItems, char* menuIcon);
+
+/* Host memory handed to the plugin, released by the plugin through freeMemory, not counted as plugin allocations */
+void*        mockAllocate(size_t size);
+char*        mockString(const char* text);
+unsigned int mockFreeMemory(void* pointer);
+
+/* Client log of the headless host, messages are discarded */
+unsigned int mockLogMessage(const char* logMessage, enum LogLevel severity, const char* channel, uint64 logID);
+
+/* Allocations made by the plugin and its threads while counting, zero where counting is unsupported */
+struct MockUsage {
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    int64_t  liveBytes;
+    int64_t  peakLiveBytes;
+};
+
+bool mockAllocationCounting(void); /* Returns false if this platform cannot count allocations */
+void mockCountAllocations(bool enabled);
+void mockResetPeak(void);
+void mockUsage(struct MockUsage* usage);
+
+/* Clocks in nanoseconds */
+uint64_t mockMonotonicNs(void);
+uint64_t mockThreadCpuNs(void);
+uint64_t mockProcessCpuNs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
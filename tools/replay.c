@@ -0,0 +1,880 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+/*
+ * Replays a callback recording against a plugin build without a TeamSpeak client
+ *
+ * Usage: AdvancedInformationReplay [--realtime] [--data directory] <plugin library> <recording>
+ *
+ * Entry points are invoked in recorded order on one thread. Host functions answer with the results
+ * recorded for the same entry point, matched by function and numeric arguments. Calls the recorded
+ * plugin did not make are answered with ERROR_undefined and counted as divergent, which happens when
+ * a build changes its host calls or when time based decisions differ. --realtime keeps the recorded
+ * gaps between entry points so that those decisions are reproduced as well.
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "mockhost.h"
+#include "recordformat.h"
+
+#define REPLAY_PLUGIN_ID "AdvancedInformationReplay"
+#define REPLAY_DATA_DIRECTORY "replay-data"
+#define REPLAY_STORAGE_DIRECTORY "AdvancedInformation"
+#define REPLAY_PATH_BUFSIZE 512
+#define REPLAY_ENTRY_COUNT (RECORD_ENTRY_SERVER_ERROR + 1)
+#define REPLAY_HOST_COUNT (RECORD_HOST_CREATE_RETURN_CODE + 1)
+#define NO_EVENT SIZE_MAX
+
+/* Recorded event, host results are linked to their entry point */
+struct Event {
+    const struct RecordEventHeader* header;
+    const uint8_t*                  payload;
+    size_t                          next;
+    size_t                          nextSame; /* Next host result of the same function and entry point */
+    bool                            consumed;
+};
+
+struct Reader {
+    const uint8_t* data;
+    size_t         size;
+    size_t         offset;
+    bool           failed;
+};
+
+struct EntryStats {
+    uint64_t calls;
+    uint64_t cpuNs;
+    uint64_t maxCpuNs;
+};
+
+static const char* entryNames[REPLAY_ENTRY_COUNT] = {
+    [RECORD_ENTRY_INIT]                     = "init",
+    [RECORD_ENTRY_SHUTDOWN]                 = "shutdown",
+    [RECORD_ENTRY_INFO_DATA]                = "infoData",
+    [RECORD_ENTRY_INIT_MENUS]               = "initMenus",
+    [RECORD_ENTRY_MENU_ITEM]                = "onMenuItemEvent",
+    [RECORD_ENTRY_CONNECT_STATUS]           = "onConnectStatusChangeEvent",
+    [RECORD_ENTRY_CLIENT_MOVE]              = "onClientMoveEvent",
+    [RECORD_ENTRY_CLIENT_MOVE_SUBSCRIPTION] = "onClientMoveSubscriptionEvent",
+    [RECORD_ENTRY_CLIENT_MOVE_TIMEOUT]      = "onClientMoveTimeoutEvent",
+    [RECORD_ENTRY_CLIENT_MOVE_MOVED]        = "onClientMoveMovedEvent",
+    [RECORD_ENTRY_CLIENT_KICK_CHANNEL]      = "onClientKickFromChannelEvent",
+    [RECORD_ENTRY_CLIENT_KICK_SERVER]       = "onClientKickFromServerEvent",
+    [RECORD_ENTRY_CLIENT_BAN]               = "onClientBanFromServerEvent",
+    [RECORD_ENTRY_CLIENT_DISPLAY_NAME]      = "onClientDisplayNameChanged",
+    [RECORD_ENTRY_NEW_CHANNEL]              = "onNewChannelEvent",
+    [RECORD_ENTRY_NEW_CHANNEL_CREATED]      = "onNewChannelCreatedEvent",
+    [RECORD_ENTRY_DEL_CHANNEL]              = "onDelChannelEvent",
+    [RECORD_ENTRY_CHANNEL_MOVE]             = "onChannelMoveEvent",
+    [RECORD_ENTRY_UPDATE_CHANNEL]           = "onUpdateChannelEvent",
+    [RECORD_ENTRY_UPDATE_CHANNEL_EDITED]    = "onUpdateChannelEditedEvent",
+    [RECORD_ENTRY_UPDATE_CLIENT]            = "onUpdateClientEvent",
+    [RECORD_ENTRY_CONNECTION_INFO]          = "onConnectionInfoEvent",
+    [RECORD_ENTRY_PLUGIN_COMMAND]           = "onPluginCommandEvent",
+    [RECORD_ENTRY_TALK_STATUS]              = "onTalkStatusChangeEvent",
+    [RECORD_ENTRY_BAN_LIST]                 = "onBanListEvent",
+    [RECORD_ENTRY_SERVER_ERROR]             = "onServerErrorEvent",
+};
+
+static struct Event*     events         = NULL;
+static size_t            eventCount     = 0;
+static size_t            currentEntry   = NO_EVENT;
+static uint64_t          matchedCalls   = 0;
+static uint64_t          divergentCalls = 0;
+static const char*       dataDirectory  = REPLAY_DATA_DIRECTORY;
+static struct EntryStats entryStats[REPLAY_ENTRY_COUNT];
+static size_t            firstResult[REPLAY_HOST_COUNT]; /* First unconsumed result of each function of the current entry point */
+
+/*********************************** Payload reader ************************************/
+
+static struct Reader openReader(const struct Event* event) {
+    return (struct Reader){event->payload, event->header->size, 0, false};
+}
+
+static bool readTag(struct Reader* reader, char tag, size_t size) {
+    if (reader->failed || reader->offset + 1 + size > reader->size || reader->data[reader->offset] != tag) {
+        reader->failed = true;
+        return false;
+    }
+    ++reader->offset;
+    return true;
+}
+
+static uint64_t readUnsigned(struct Reader* reader) {
+    uint64_t value = 0;
+    if (readTag(reader, 'U', sizeof(value))) memcpy(&value, reader->data + reader->offset, sizeof(value));
+    if (!reader->failed) reader->offset += sizeof(value);
+    return value;
+}
+
+static int64_t readSigned(struct Reader* reader) {
+    int64_t value = 0;
+    if (readTag(reader, 'I', sizeof(value))) memcpy(&value, reader->data + reader->offset, sizeof(value));
+    if (!reader->failed) reader->offset += sizeof(value);
+    return value;
+}
+
+static double readDouble(struct Reader* reader) {
+    double value = 0.0;
+    if (readTag(reader, 'D', sizeof(value))) memcpy(&value, reader->data + reader->offset, sizeof(value));
+    if (!reader->failed) reader->offset += sizeof(value);
+    return value;
+}
+
+/* Numeric argument of either signedness */
+static uint64_t readNumber(struct Reader* reader) {
+    if (reader->offset < reader->size && reader->data[reader->offset] == 'I') return (uint64_t)readSigned(reader);
+    return readUnsigned(reader);
+}
+
+/* Strings point into the recording, they are stored with their NUL */
+static const char* readString(struct Reader* reader) {
+    uint32_t length = 0;
+    if (!readTag(reader, 'S', sizeof(length))) return NULL;
+    memcpy(&length, reader->data + reader->offset, sizeof(length));
+    reader->offset += sizeof(length);
+    if (length == RECORD_NULL_STRING) return NULL;
+    if (reader->offset + length + 1 > reader->size) {
+        reader->failed = true;
+        return NULL;
+    }
+    const char* text = (const char*)reader->data + reader->offset;
+    reader->offset += (size_t)length + 1;
+    return text;
+}
+
+static const uint8_t* readList(struct Reader* reader, uint32_t* count) {
+    *count = 0;
+    if (!readTag(reader, 'L', sizeof(*count))) return NULL;
+    memcpy(count, reader->data + reader->offset, sizeof(*count));
+    reader->offset += sizeof(*count);
+    if (reader->offset + (size_t)*count * sizeof(uint64_t) > reader->size) {
+        reader->failed = true;
+        *count         = 0;
+        return NULL;
+    }
+    const uint8_t* values = reader->data + reader->offset;
+    reader->offset += (size_t)*count * sizeof(uint64_t);
+    return values;
+}
+
+/*********************************** Recorded host ************************************/
+
+/* Links the host results of an entry point by function, done before its CPU time is measured */
+static void indexEntry(size_t entry) {
+    size_t lastResult[REPLAY_HOST_COUNT];
+    for (size_t function = 0; function < REPLAY_HOST_COUNT; ++function) firstResult[function] = lastResult[function] = NO_EVENT;
+    for (size_t index = events[entry].next; index != NO_EVENT; index = events[index].next) {
+        const uint16_t function = events[index].header->id;
+        events[index].nextSame  = NO_EVENT;
+        if (function >= REPLAY_HOST_COUNT) continue;
+        if (lastResult[function] == NO_EVENT) {
+            firstResult[function] = index;
+        } else {
+            events[lastResult[function]].nextSame = index;
+        }
+        lastResult[function] = index;
+    }
+}
+
+/*
+ * Finds the recorded result of a host call of the current entry point and positions the reader at its outputs.
+ * Calls mostly come in recorded order, so consumed results at the front of a function are skipped for good.
+ */
+static bool takeResult(enum RecordHost function, const uint64_t* arguments, size_t argumentCount, struct Reader* reader, unsigned int* error) {
+    if (currentEntry != NO_EVENT && (size_t)function < REPLAY_HOST_COUNT) {
+        while (firstResult[function] != NO_EVENT && events[firstResult[function]].consumed) firstResult[function] = events[firstResult[function]].nextSame;
+        for (size_t index = firstResult[function]; index != NO_EVENT; index = events[index].nextSame) {
+            struct Event* event = &events[index];
+            if (event->consumed) continue;
+            *reader      = openReader(event);
+            bool matches = true;
+            for (size_t argument = 0; argument < argumentCount && matches; ++argument) matches = readNumber(reader) == arguments[argument];
+            if (!matches || reader->failed) continue;
+            *error = (unsigned int)readUnsigned(reader);
+            if (reader->failed) continue;
+            event->consumed = true;
+            ++matchedCalls;
+            return true;
+        }
+    }
+    ++divergentCalls;
+    *error = ERROR_undefined;
+    return false;
+}
+
+static void copyRecordedPath(enum RecordHost function, char* path, size_t maxLen) {
+    struct Reader reader;
+    unsigned int  error;
+    const char*   recorded = takeResult(function, NULL, 0, &reader, &error) ? readString(&reader) : NULL;
+    snprintf(path, maxLen, "%s", recorded ? recorded : "");
+}
+
+static void replayGetAppPath(char* path, size_t maxLen) {
+    copyRecordedPath(RECORD_HOST_GET_APP_PATH, path, maxLen);
+}
+
+static void replayGetResourcesPath(char* path, size_t maxLen) {
+    copyRecordedPath(RECORD_HOST_GET_RESOURCES_PATH, path, maxLen);
+}
+
+/* Plugin data is written below the replay data directory instead of the recorded client configuration */
+static void replayGetConfigPath(char* path, size_t maxLen) {
+    copyRecordedPath(RECORD_HOST_GET_CONFIG_PATH, path, maxLen);
+    snprintf(path, maxLen, "%s/", dataDirectory);
+}
+
+static void replayGetPluginPath(char* path, size_t maxLen, const char* id) {
+    copyRecordedPath(RECORD_HOST_GET_PLUGIN_PATH, path, maxLen);
+}
+
+static unsigned int replayUnsigned(enum RecordHost function, const uint64_t* arguments, size_t argumentCount, uint64* result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (takeResult(function, arguments, argumentCount, &reader, &error) && error == ERROR_ok) *result = readUnsigned(&reader);
+    return error;
+}
+
+static unsigned int replayInt(enum RecordHost function, const uint64_t* arguments, size_t argumentCount, int* result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (takeResult(function, arguments, argumentCount, &reader, &error) && error == ERROR_ok) *result = (int)readSigned(&reader);
+    return error;
+}
+
+static unsigned int replayString(enum RecordHost function, const uint64_t* arguments, size_t argumentCount, char** result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (takeResult(function, arguments, argumentCount, &reader, &error) && error == ERROR_ok) {
+        const char* text = readString(&reader);
+        *result          = mockString(text ? text : "");
+    }
+    return error;
+}
+
+static unsigned int replayRequest(enum RecordHost function, const uint64_t* arguments, size_t argumentCount) {
+    struct Reader reader;
+    unsigned int  error;
+    takeResult(function, arguments, argumentCount, &reader, &error);
+    return error;
+}
+
+static unsigned int replayGetServerConnectionHandlerList(uint64** result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (!takeResult(RECORD_HOST_GET_SERVER_CONNECTION_HANDLER_LIST, NULL, 0, &reader, &error) || error != ERROR_ok) return error;
+    uint32_t       count;
+    const uint8_t* values = readList(&reader, &count);
+    *result               = mockAllocate((count + 1) * sizeof(uint64));
+    if (count) memcpy(*result, values, count * sizeof(uint64));
+    (*result)[count] = 0;
+    return error;
+}
+
+static unsigned int replayGetConnectionStatus(uint64 serverConnectionHandlerID, int* result) {
+    return replayInt(RECORD_HOST_GET_CONNECTION_STATUS, (uint64_t[]){serverConnectionHandlerID}, 1, result);
+}
+
+static unsigned int replayGetClientID(uint64 serverConnectionHandlerID, anyID* result) {
+    uint64             clientID = 0;
+    const unsigned int error    = replayUnsigned(RECORD_HOST_GET_CLIENT_ID, (uint64_t[]){serverConnectionHandlerID}, 1, &clientID);
+    if (error == ERROR_ok) *result = (anyID)clientID;
+    return error;
+}
+
+/* Recorded client ID list, terminated by 0 like the host lists */
+static unsigned int replayClientList(enum RecordHost function, const uint64_t* arguments, size_t argumentCount, anyID** result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (!takeResult(function, arguments, argumentCount, &reader, &error) || error != ERROR_ok) return error;
+    uint32_t       count;
+    const uint8_t* values = readList(&reader, &count);
+    *result               = mockAllocate((count + 1) * sizeof(anyID));
+    for (uint32_t index = 0; index < count; ++index) {
+        uint64_t value;
+        memcpy(&value, values + index * sizeof(value), sizeof(value));
+        (*result)[index] = (anyID)value;
+    }
+    (*result)[count] = 0;
+    return error;
+}
+
+static unsigned int replayGetClientList(uint64 serverConnectionHandlerID, anyID** result) {
+    return replayClientList(RECORD_HOST_GET_CLIENT_LIST, (uint64_t[]){serverConnectionHandlerID}, 1, result);
+}
+
+static unsigned int replayGetChannelClientList(uint64 serverConnectionHandlerID, uint64 channelID, anyID** result) {
+    return replayClientList(RECORD_HOST_GET_CHANNEL_CLIENT_LIST, (uint64_t[]){serverConnectionHandlerID, channelID}, 2, result);
+}
+
+static unsigned int replayGetChannelList(uint64 serverConnectionHandlerID, uint64** result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (!takeResult(RECORD_HOST_GET_CHANNEL_LIST, (uint64_t[]){serverConnectionHandlerID}, 1, &reader, &error) || error != ERROR_ok) return error;
+    uint32_t       count;
+    const uint8_t* values = readList(&reader, &count);
+    *result               = mockAllocate((count + 1) * sizeof(uint64));
+    if (count) memcpy(*result, values, count * sizeof(uint64));
+    (*result)[count] = 0;
+    return error;
+}
+
+static unsigned int replayGetChannelOfClient(uint64 serverConnectionHandlerID, anyID clientID, uint64* result) {
+    return replayUnsigned(RECORD_HOST_GET_CHANNEL_OF_CLIENT, (uint64_t[]){serverConnectionHandlerID, clientID}, 2, result);
+}
+
+static unsigned int replayGetParentChannelOfChannel(uint64 serverConnectionHandlerID, uint64 channelID, uint64* result) {
+    return replayUnsigned(RECORD_HOST_GET_PARENT_CHANNEL_OF_CHANNEL, (uint64_t[]){serverConnectionHandlerID, channelID}, 2, result);
+}
+
+static unsigned int replayGetClientVariableAsInt(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, int* result) {
+    return replayInt(RECORD_HOST_GET_CLIENT_VARIABLE_AS_INT, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, result);
+}
+
+static unsigned int replayGetClientVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    return replayUnsigned(RECORD_HOST_GET_CLIENT_VARIABLE_AS_UINT64, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, result);
+}
+
+static unsigned int replayGetClientVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    return replayString(RECORD_HOST_GET_CLIENT_VARIABLE_AS_STRING, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, result);
+}
+
+static unsigned int replayGetChannelVariableAsInt(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, int* result) {
+    return replayInt(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_INT, (uint64_t[]){serverConnectionHandlerID, channelID, flag}, 3, result);
+}
+
+static unsigned int replayGetChannelVariableAsUInt64(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, uint64* result) {
+    return replayUnsigned(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_UINT64, (uint64_t[]){serverConnectionHandlerID, channelID, flag}, 3, result);
+}
+
+static unsigned int replayGetChannelVariableAsString(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, char** result) {
+    return replayString(RECORD_HOST_GET_CHANNEL_VARIABLE_AS_STRING, (uint64_t[]){serverConnectionHandlerID, channelID, flag}, 3, result);
+}
+
+static unsigned int replayGetServerVariableAsString(uint64 serverConnectionHandlerID, size_t flag, char** result) {
+    return replayString(RECORD_HOST_GET_SERVER_VARIABLE_AS_STRING, (uint64_t[]){serverConnectionHandlerID, flag}, 2, result);
+}
+
+static unsigned int replayGetConnectionVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    return replayUnsigned(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_UINT64, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, result);
+}
+
+static unsigned int replayGetConnectionVariableAsDouble(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, double* result) {
+    struct Reader reader;
+    unsigned int  error;
+    if (takeResult(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_DOUBLE, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, &reader, &error) && error == ERROR_ok) *result = readDouble(&reader);
+    return error;
+}
+
+static unsigned int replayGetConnectionVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    return replayString(RECORD_HOST_GET_CONNECTION_VARIABLE_AS_STRING, (uint64_t[]){serverConnectionHandlerID, clientID, flag}, 3, result);
+}
+
+static unsigned int replayRequestConnectionInfo(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    return replayRequest(RECORD_HOST_REQUEST_CONNECTION_INFO, (uint64_t[]){serverConnectionHandlerID, clientID}, 2);
+}
+
+static unsigned int replayRequestClientVariables(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    return replayRequest(RECORD_HOST_REQUEST_CLIENT_VARIABLES, (uint64_t[]){serverConnectionHandlerID, clientID}, 2);
+}
+
+static unsigned int replayRequestChannelDescription(uint64 serverConnectionHandlerID, uint64 channelID, const char* returnCode) {
+    return replayRequest(RECORD_HOST_REQUEST_CHANNEL_DESCRIPTION, (uint64_t[]){serverConnectionHandlerID, channelID}, 2);
+}
+
+static unsigned int replayRequestBanList(uint64 serverConnectionHandlerID, uint64 start, unsigned int duration, const char* returnCode) {
+    return replayRequest(RECORD_HOST_REQUEST_BAN_LIST, (uint64_t[]){serverConnectionHandlerID, start, duration}, 3);
+}
+
+static unsigned int replayRequestInfoUpdate(uint64 serverConnectionHandlerID, enum PluginItemType itemType, uint64 itemID) {
+    return replayRequest(RECORD_HOST_REQUEST_INFO_UPDATE, (uint64_t[]){serverConnectionHandlerID, (uint64_t)(int64_t)itemType, itemID}, 3);
+}
+
+static unsigned int replayRequestSendPrivateTextMsg(uint64 serverConnectionHandlerID, const char* message, anyID targetClientID, const char* returnCode) {
+    return replayRequest(RECORD_HOST_REQUEST_SEND_PRIVATE_TEXT_MSG, (uint64_t[]){serverConnectionHandlerID, targetClientID}, 2);
+}
+
+static void replaySendPluginCommand(uint64 serverConnectionHandlerID, const char* id, const char* command, int targetMode, const anyID* targetIDs, const char* returnCode) {
+    replayRequest(RECORD_HOST_SEND_PLUGIN_COMMAND, (uint64_t[]){serverConnectionHandlerID, (uint64_t)(int64_t)targetMode}, 2);
+}
+
+static void replayPrintMessageToCurrentTab(const char* message) {
+    replayRequest(RECORD_HOST_PRINT_MESSAGE_TO_CURRENT_TAB, NULL, 0);
+}
+
+static void replaySetPluginMenuEnabled(const char* id, int menuID, int enabled) {
+    replayRequest(RECORD_HOST_SET_PLUGIN_MENU_ENABLED, (uint64_t[]){(uint64_t)(int64_t)menuID, (uint64_t)(int64_t)enabled}, 2);
+}
+
+static void replayPrintMessage(uint64 serverConnectionHandlerID, const char* message, enum PluginMessageTarget messageTarget) {
+    replayRequest(RECORD_HOST_PRINT_MESSAGE, (uint64_t[]){serverConnectionHandlerID, (uint64_t)(int64_t)messageTarget}, 2);
+}
+
+/* Codes are replayed as recorded so that the recorded server errors carry them */
+static void replayCreateReturnCode(const char* id, char* returnCode, size_t maxLen) {
+    copyRecordedPath(RECORD_HOST_CREATE_RETURN_CODE, returnCode, maxLen);
+}
+
+static struct TS3Functions replayFunctions(void) {
+    struct TS3Functions functions            = {0};
+    functions.freeMemory                     = mockFreeMemory;
+    functions.logMessage                     = mockLogMessage;
+    functions.getAppPath                     = replayGetAppPath;
+    functions.getResourcesPath               = replayGetResourcesPath;
+    functions.getConfigPath                  = replayGetConfigPath;
+    functions.getPluginPath                  = replayGetPluginPath;
+    functions.getServerConnectionHandlerList = replayGetServerConnectionHandlerList;
+    functions.getConnectionStatus            = replayGetConnectionStatus;
+    functions.getClientID                    = replayGetClientID;
+    functions.getClientList                  = replayGetClientList;
+    functions.getChannelList                 = replayGetChannelList;
+    functions.getChannelClientList           = replayGetChannelClientList;
+    functions.getChannelOfClient             = replayGetChannelOfClient;
+    functions.getParentChannelOfChannel      = replayGetParentChannelOfChannel;
+    functions.getClientVariableAsInt         = replayGetClientVariableAsInt;
+    functions.getClientVariableAsUInt64      = replayGetClientVariableAsUInt64;
+    functions.getClientVariableAsString      = replayGetClientVariableAsString;
+    functions.getChannelVariableAsInt        = replayGetChannelVariableAsInt;
+    functions.getChannelVariableAsUInt64     = replayGetChannelVariableAsUInt64;
+    functions.getChannelVariableAsString     = replayGetChannelVariableAsString;
+    functions.getServerVariableAsString      = replayGetServerVariableAsString;
+    functions.getConnectionVariableAsUInt64  = replayGetConnectionVariableAsUInt64;
+    functions.getConnectionVariableAsDouble  = replayGetConnectionVariableAsDouble;
+    functions.getConnectionVariableAsString  = replayGetConnectionVariableAsString;
+    functions.requestConnectionInfo          = replayRequestConnectionInfo;
+    functions.requestChannelDescription      = replayRequestChannelDescription;
+    functions.requestClientVariables         = replayRequestClientVariables;
+    functions.requestBanList                 = replayRequestBanList;
+    functions.requestInfoUpdate              = replayRequestInfoUpdate;
+    functions.requestSendPrivateTextMsg      = replayRequestSendPrivateTextMsg;
+    functions.sendPluginCommand              = replaySendPluginCommand;
+    functions.printMessageToCurrentTab       = replayPrintMessageToCurrentTab;
+    functions.setPluginMenuEnabled           = replaySetPluginMenuEnabled;
+    functions.printMessage                   = replayPrintMessage;
+    functions.createReturnCode               = replayCreateReturnCode;
+    return functions;
+}
+
+/*********************************** Recording ************************************/
+
+static uint8_t* readFile(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+/* Splits the recording into events and links host results to the last entry point of their thread */
+static bool parseRecording(const uint8_t* data, size_t size) {
+    const struct RecordFileHeader* header = (const struct RecordFileHeader*)data;
+    if (size < sizeof(*header) || memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0 || header->version != RECORD_VERSION) return false;
+
+    size_t capacity = 0;
+    size_t threads  = 0;
+    size_t* lastOfThread = NULL;
+    for (size_t offset = sizeof(*header); offset + sizeof(struct RecordEventHeader) <= size;) {
+        const struct RecordEventHeader* eventHeader = (const struct RecordEventHeader*)(data + offset);
+        if (offset + sizeof(*eventHeader) + eventHeader->size > size) break; /* Cut off while recording */
+        if (eventCount == capacity) {
+            capacity             = capacity ? capacity * 2 : 4096;
+            struct Event* grown  = realloc(events, capacity * sizeof(struct Event));
+            if (!grown) return false;
+            events = grown;
+        }
+        if (eventHeader->thread >= threads) {
+            const size_t newThreads = eventHeader->thread + 1;
+            size_t*      grown      = realloc(lastOfThread, newThreads * sizeof(size_t));
+            if (!grown) return false;
+            for (size_t thread = threads; thread < newThreads; ++thread) grown[thread] = NO_EVENT;
+            lastOfThread = grown;
+            threads      = newThreads;
+        }
+
+        struct Event* event = &events[eventCount];
+        event->header       = eventHeader;
+        event->payload      = data + offset + sizeof(*eventHeader);
+        event->next         = NO_EVENT;
+        event->nextSame     = NO_EVENT;
+        event->consumed     = false;
+        if (eventHeader->kind == RECORD_KIND_ENTRY) {
+            lastOfThread[eventHeader->thread] = eventCount;
+        } else if (lastOfThread[eventHeader->thread] != NO_EVENT) {
+            events[lastOfThread[eventHeader->thread]].next = eventCount;
+            lastOfThread[eventHeader->thread]               = eventCount;
+        }
+        ++eventCount;
+        offset += sizeof(*eventHeader) + eventHeader->size;
+    }
+    free(lastOfThread);
+    return true;
+}
+
+/*********************************** Replay ************************************/
+
+/* Invokes a recorded entry point, returns false if the plugin does not export it */
+static bool invokeEntry(const struct MockPlugin* plugin, enum RecordEntry entry, struct Reader* reader) {
+    switch (entry) {
+        case RECORD_ENTRY_INIT:
+            plugin->init();
+            return true;
+        case RECORD_ENTRY_SHUTDOWN:
+            plugin->shutdown();
+            return true;
+        case RECORD_ENTRY_INFO_DATA: {
+            if (!plugin->infoData) return false;
+            const uint64 sch  = readUnsigned(reader);
+            const uint64 id   = readUnsigned(reader);
+            const int    type = (int)readSigned(reader);
+            char*        data = NULL;
+            plugin->infoData(sch, id, (enum PluginItemType)type, &data);
+            if (data && plugin->freeMemory) plugin->freeMemory(data);
+            return true;
+        }
+        case RECORD_ENTRY_INIT_MENUS: {
+            if (!plugin->initMenus) return false;
+            struct PluginMenuItem** menuItems = NULL;
+            char*                   menuIcon  = NULL;
+            plugin->initMenus(&menuItems, &menuIcon);
+            mockFreeMenus(plugin, menuItems, menuIcon);
+            return true;
+        }
+        case RECORD_ENTRY_MENU_ITEM: {
+            if (!plugin->onMenuItemEvent) return false;
+            const uint64 sch        = readUnsigned(reader);
+            const int    type       = (int)readSigned(reader);
+            const int    menuItemID = (int)readSigned(reader);
+            plugin->onMenuItemEvent(sch, (enum PluginMenuType)type, menuItemID, readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_CONNECT_STATUS: {
+            if (!plugin->onConnectStatusChangeEvent) return false;
+            const uint64 sch       = readUnsigned(reader);
+            const int    newStatus = (int)readSigned(reader);
+            plugin->onConnectStatusChangeEvent(sch, newStatus, (unsigned int)readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_CLIENT_MOVE:
+        case RECORD_ENTRY_CLIENT_MOVE_SUBSCRIPTION:
+        case RECORD_ENTRY_CLIENT_MOVE_TIMEOUT: {
+            const uint64 sch          = readUnsigned(reader);
+            const anyID  clientID     = (anyID)readUnsigned(reader);
+            const uint64 oldChannelID = readUnsigned(reader);
+            const uint64 newChannelID = readUnsigned(reader);
+            const int    visibility   = (int)readSigned(reader);
+            if (entry == RECORD_ENTRY_CLIENT_MOVE_SUBSCRIPTION) {
+                if (!plugin->onClientMoveSubscriptionEvent) return false;
+                plugin->onClientMoveSubscriptionEvent(sch, clientID, oldChannelID, newChannelID, visibility);
+            } else if (entry == RECORD_ENTRY_CLIENT_MOVE) {
+                if (!plugin->onClientMoveEvent) return false;
+                plugin->onClientMoveEvent(sch, clientID, oldChannelID, newChannelID, visibility, readString(reader));
+            } else {
+                if (!plugin->onClientMoveTimeoutEvent) return false;
+                plugin->onClientMoveTimeoutEvent(sch, clientID, oldChannelID, newChannelID, visibility, readString(reader));
+            }
+            return true;
+        }
+        case RECORD_ENTRY_CLIENT_MOVE_MOVED:
+        case RECORD_ENTRY_CLIENT_KICK_CHANNEL:
+        case RECORD_ENTRY_CLIENT_KICK_SERVER:
+        case RECORD_ENTRY_CLIENT_BAN: {
+            const uint64 sch          = readUnsigned(reader);
+            const anyID  clientID     = (anyID)readUnsigned(reader);
+            const uint64 oldChannelID = readUnsigned(reader);
+            const uint64 newChannelID = readUnsigned(reader);
+            const int    visibility   = (int)readSigned(reader);
+            const anyID  invokerID    = (anyID)readUnsigned(reader);
+            const char*  invokerName  = readString(reader);
+            const char*  invokerUID   = readString(reader);
+            if (entry == RECORD_ENTRY_CLIENT_BAN) {
+                if (!plugin->onClientBanFromServerEvent) return false;
+                const uint64 time = readUnsigned(reader);
+                plugin->onClientBanFromServerEvent(sch, clientID, oldChannelID, newChannelID, visibility, invokerID, invokerName, invokerUID, time, readString(reader));
+            } else if (entry == RECORD_ENTRY_CLIENT_MOVE_MOVED) {
+                if (!plugin->onClientMoveMovedEvent) return false;
+                plugin->onClientMoveMovedEvent(sch, clientID, oldChannelID, newChannelID, visibility, invokerID, invokerName, invokerUID, readString(reader));
+            } else if (entry == RECORD_ENTRY_CLIENT_KICK_CHANNEL) {
+                if (!plugin->onClientKickFromChannelEvent) return false;
+                plugin->onClientKickFromChannelEvent(sch, clientID, oldChannelID, newChannelID, visibility, invokerID, invokerName, invokerUID, readString(reader));
+            } else {
+                if (!plugin->onClientKickFromServerEvent) return false;
+                plugin->onClientKickFromServerEvent(sch, clientID, oldChannelID, newChannelID, visibility, invokerID, invokerName, invokerUID, readString(reader));
+            }
+            return true;
+        }
+        case RECORD_ENTRY_CLIENT_DISPLAY_NAME: {
+            if (!plugin->onClientDisplayNameChanged) return false;
+            const uint64 sch         = readUnsigned(reader);
+            const anyID  clientID    = (anyID)readUnsigned(reader);
+            const char*  displayName = readString(reader);
+            plugin->onClientDisplayNameChanged(sch, clientID, displayName, readString(reader));
+            return true;
+        }
+        case RECORD_ENTRY_NEW_CHANNEL: {
+            if (!plugin->onNewChannelEvent) return false;
+            const uint64 sch       = readUnsigned(reader);
+            const uint64 channelID = readUnsigned(reader);
+            plugin->onNewChannelEvent(sch, channelID, readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_NEW_CHANNEL_CREATED:
+        case RECORD_ENTRY_CHANNEL_MOVE: {
+            const uint64 sch         = readUnsigned(reader);
+            const uint64 channelID   = readUnsigned(reader);
+            const uint64 parentID    = readUnsigned(reader);
+            const anyID  invokerID   = (anyID)readUnsigned(reader);
+            const char*  invokerName = readString(reader);
+            const char*  invokerUID  = readString(reader);
+            if (entry == RECORD_ENTRY_NEW_CHANNEL_CREATED) {
+                if (!plugin->onNewChannelCreatedEvent) return false;
+                plugin->onNewChannelCreatedEvent(sch, channelID, parentID, invokerID, invokerName, invokerUID);
+            } else {
+                if (!plugin->onChannelMoveEvent) return false;
+                plugin->onChannelMoveEvent(sch, channelID, parentID, invokerID, invokerName, invokerUID);
+            }
+            return true;
+        }
+        case RECORD_ENTRY_DEL_CHANNEL:
+        case RECORD_ENTRY_UPDATE_CHANNEL_EDITED:
+        case RECORD_ENTRY_UPDATE_CLIENT: {
+            const uint64 sch         = readUnsigned(reader);
+            const uint64 id          = readUnsigned(reader);
+            const anyID  invokerID   = (anyID)readUnsigned(reader);
+            const char*  invokerName = readString(reader);
+            const char*  invokerUID  = readString(reader);
+            if (entry == RECORD_ENTRY_DEL_CHANNEL) {
+                if (!plugin->onDelChannelEvent) return false;
+                plugin->onDelChannelEvent(sch, id, invokerID, invokerName, invokerUID);
+            } else if (entry == RECORD_ENTRY_UPDATE_CHANNEL_EDITED) {
+                if (!plugin->onUpdateChannelEditedEvent) return false;
+                plugin->onUpdateChannelEditedEvent(sch, id, invokerID, invokerName, invokerUID);
+            } else {
+                if (!plugin->onUpdateClientEvent) return false;
+                plugin->onUpdateClientEvent(sch, (anyID)id, invokerID, invokerName, invokerUID);
+            }
+            return true;
+        }
+        case RECORD_ENTRY_UPDATE_CHANNEL: {
+            if (!plugin->onUpdateChannelEvent) return false;
+            const uint64 sch = readUnsigned(reader);
+            plugin->onUpdateChannelEvent(sch, readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_CONNECTION_INFO: {
+            if (!plugin->onConnectionInfoEvent) return false;
+            const uint64 sch = readUnsigned(reader);
+            plugin->onConnectionInfoEvent(sch, (anyID)readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_PLUGIN_COMMAND: {
+            if (!plugin->onPluginCommandEvent) return false;
+            const uint64 sch           = readUnsigned(reader);
+            const char*  pluginName    = readString(reader);
+            const char*  pluginCommand = readString(reader);
+            const anyID  invokerID     = (anyID)readUnsigned(reader);
+            const char*  invokerName   = readString(reader);
+            plugin->onPluginCommandEvent(sch, pluginName, pluginCommand, invokerID, invokerName, readString(reader));
+            return true;
+        }
+        case RECORD_ENTRY_TALK_STATUS: {
+            if (!plugin->onTalkStatusChangeEvent) return false;
+            const uint64 sch               = readUnsigned(reader);
+            const int    status            = (int)readSigned(reader);
+            const int    isReceivedWhisper = (int)readSigned(reader);
+            plugin->onTalkStatusChangeEvent(sch, status, isReceivedWhisper, (anyID)readUnsigned(reader));
+            return true;
+        }
+        case RECORD_ENTRY_BAN_LIST: {
+            if (!plugin->onBanListEvent) return false;
+            const uint64 sch               = readUnsigned(reader);
+            const uint64 banID             = readUnsigned(reader);
+            const char*  ip                = readString(reader);
+            const char*  name              = readString(reader);
+            const char*  uid               = readString(reader);
+            const char*  mytsid            = readString(reader);
+            const uint64 creationTime      = readUnsigned(reader);
+            const uint64 durationTime      = readUnsigned(reader);
+            const char*  invokerName       = readString(reader);
+            const uint64 invokerDatabaseID = readUnsigned(reader);
+            const char*  invokerUID        = readString(reader);
+            const char*  reason            = readString(reader);
+            const int    enforcements      = (int)readSigned(reader);
+            plugin->onBanListEvent(sch, banID, ip, name, uid, mytsid, creationTime, durationTime, invokerName, invokerDatabaseID, invokerUID, reason, enforcements, readString(reader));
+            return true;
+        }
+        case RECORD_ENTRY_SERVER_ERROR: {
+            if (!plugin->onServerErrorEvent) return false;
+            const uint64       sch          = readUnsigned(reader);
+            const char*        errorMessage = readString(reader);
+            const unsigned int error        = (unsigned int)readUnsigned(reader);
+            const char*        returnCode   = readString(reader);
+            plugin->onServerErrorEvent(sch, errorMessage, error, returnCode, readString(reader));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static void sleepUntil(uint64_t monotonicNs) {
+    const uint64_t now = mockMonotonicNs();
+    if (monotonicNs <= now) return;
+    const uint64_t delay = monotonicNs - now;
+    thrd_sleep(&(struct timespec){.tv_sec = (time_t)(delay / 1000000000ULL), .tv_nsec = (long)(delay % 1000000000ULL)}, NULL);
+}
+
+/* Recordings populate connections inside the entry point, so the warm-up worker is disabled unless the data directory has its own settings */
+static void writeSettings(void) {
+    char path[REPLAY_PATH_BUFSIZE];
+    snprintf(path, sizeof(path), "%s/" REPLAY_STORAGE_DIRECTORY "/settings.ini", dataDirectory);
+    FILE* file = fopen(path, "r");
+    if (file) {
+        fclose(file);
+        return;
+    }
+    file = fopen(path, "w");
+    if (!file) return;
+    fputs("warmup_thread = 0\n", file);
+    fclose(file);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--realtime] [--data directory] <plugin library> <recording>\n", program);
+}
+
+int main(int argc, char** argv) {
+    bool realtime = false;
+    int  argument = 1;
+    for (; argument < argc && strncmp(argv[argument], "--", 2) == 0; ++argument) {
+        if (strcmp(argv[argument], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[argument], "--data") == 0 && argument + 1 < argc) {
+            dataDirectory = argv[++argument];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - argument != 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t         size;
+    const uint8_t* recording = readFile(argv[argument + 1], &size);
+    if (!recording || !parseRecording(recording, size)) {
+        fprintf(stderr, "Cannot read recording %s\n", argv[argument + 1]);
+        return 1;
+    }
+    char path[REPLAY_PATH_BUFSIZE];
+    snprintf(path, sizeof(path), "%s/" REPLAY_STORAGE_DIRECTORY, dataDirectory);
+#ifdef _WIN32
+    _mkdir(dataDirectory);
+    _mkdir(path);
+#else
+    mkdir(dataDirectory, 0755);
+    mkdir(path, 0755);
+#endif
+    writeSettings();
+
+    struct MockPlugin plugin;
+    if (!mockLoadPlugin(&plugin, argv[argument])) return 1;
+    plugin.setFunctionPointers(replayFunctions());
+    if (plugin.registerPluginID) plugin.registerPluginID(REPLAY_PLUGIN_ID);
+
+    uint64_t entries = 0, skipped = 0, callbackCpuNs = 0;
+    bool     shutDown         = false;
+    uint64_t recordedStart    = 0;
+    mockCountAllocations(true);
+    const uint64_t processCpu = mockProcessCpuNs();
+    const uint64_t started    = mockMonotonicNs();
+    for (size_t index = 0; index < eventCount; ++index) {
+        const struct Event* event = &events[index];
+        if (event->header->kind != RECORD_KIND_ENTRY) continue;
+        if (realtime) {
+            if (entries == 0) recordedStart = event->header->monotonicNs;
+            sleepUntil(started + (event->header->monotonicNs - recordedStart));
+        }
+
+        const enum RecordEntry entry  = (enum RecordEntry)event->header->id;
+        struct Reader          reader = openReader(event);
+        indexEntry(index);
+        currentEntry                  = index;
+        const uint64_t cpu            = mockThreadCpuNs();
+        const bool     invoked        = invokeEntry(&plugin, entry, &reader);
+        const uint64_t elapsed        = mockThreadCpuNs() - cpu;
+        currentEntry                  = NO_EVENT;
+        if (!invoked) {
+            ++skipped;
+            continue;
+        }
+        ++entries;
+        callbackCpuNs += elapsed;
+        if (entry < REPLAY_ENTRY_COUNT) {
+            struct EntryStats* stats = &entryStats[entry];
+            ++stats->calls;
+            stats->cpuNs += elapsed;
+            if (elapsed > stats->maxCpuNs) stats->maxCpuNs = elapsed;
+        }
+        if (entry == RECORD_ENTRY_SHUTDOWN) {
+            shutDown = true;
+            break;
+        }
+    }
+    if (!shutDown) plugin.shutdown(); /* Recording ended without unloading the plugin */
+    const uint64_t wallNs    = mockMonotonicNs() - started;
+    const uint64_t processNs = mockProcessCpuNs() - processCpu;
+    mockCountAllocations(false);
+
+    uint64_t unused = 0;
+    for (size_t index = 0; index < eventCount; ++index) {
+        if (events[index].header->kind == RECORD_KIND_HOST && !events[index].consumed) ++unused;
+    }
+
+    printf("Replayed %llu entry points (%llu not exported by this build) in %.3f s\n", (unsigned long long)entries, (unsigned long long)skipped, (double)wallNs / 1e9);
+    printf("CPU: %.3f ms in entry points, %.3f ms for the process including plugin threads\n", (double)callbackCpuNs / 1e6, (double)processNs / 1e6);
+    printf("Host calls: %llu matched, %llu divergent, %llu recorded but not made\n", (unsigned long long)matchedCalls, (unsigned long long)divergentCalls, (unsigned long long)unused);
+    if (mockAllocationCounting()) {
+        struct MockUsage usage;
+        mockUsage(&usage);
+        printf("Allocations: %llu (%llu bytes), peak live %lld bytes, live after shutdown %lld bytes\n", (unsigned long long)usage.allocations, (unsigned long long)usage.allocatedBytes, (long long)usage.peakLiveBytes,
+               (long long)usage.liveBytes);
+    } else {
+        printf("Allocations: not counted on this platform\n");
+    }
+
+    printf("\n%-32s  %8s  %12s  %12s  %12s\n", "Entry point", "Calls", "Total ms", "Mean us", "Max us");
+    for (size_t entry = 0; entry < REPLAY_ENTRY_COUNT; ++entry) {
+        const struct EntryStats* stats = &entryStats[entry];
+        if (stats->calls == 0) continue;
+        printf("%-32s  %8llu  %12.3f  %12.3f  %12.3f\n", entryNames[entry], (unsigned long long)stats->calls, (double)stats->cpuNs / 1e6, (double)stats->cpuNs / (double)stats->calls / 1e3, (double)stats->maxCpuNs / 1e3);
+    }
+
+    mockUnloadPlugin(&plugin);
+    return 0;
+}
@@ -0,0 +1,735 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+/*
+ * Drives a plugin build with event storms of a synthetic server
+ *
+ * Usage: AdvancedInformationStress [-c clients] [-C channels] [-e events] [-s steps] [--data directory] <plugin library>
+ *
+ * The host answers from a generated server with the given number of clients and channels. Every step
+ * loads the plugin again with clients and channels scaled to step/steps of the given size, so several
+ * steps print a scaling curve. Each phase reports the CPU time spent in plugin callbacks per event, the
+ * process CPU including plugin threads, the worst ts3plugin_infoData latency measured between events,
+ * and the growth of memory allocated by the plugin. Requests for connection info and client variables
+ * are answered with the matching callbacks after the event that caused them, like the client does.
+ */
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "teamspeak/public_definitions.h"
+#include "teamspeak/public_errors.h"
+#include "teamspeak/public_rare_definitions.h"
+#include "ts3_functions.h"
+
+#include "mockhost.h"
+
+#define STRESS_PLUGIN_ID "AdvancedInformationStress"
+#define STRESS_DATA_DIRECTORY "stress-data"
+#define STRESS_SERVER 1
+#define STRESS_OWN_CLIENT 1
+#define STRESS_CLIENT_LIMIT 65000
+#define STRESS_INFO_INTERVAL 32
+#define STRESS_PENDING_LIMIT 1024
+#define STRESS_TEXT_BUFSIZE 64
+#define STRESS_DESCRIPTION_BUFSIZE 4096
+#define STRESS_BAN_RULES 400
+
+enum StressPhase {
+    PHASE_CONNECT,
+    PHASE_JOIN,
+    PHASE_MOVE,
+    PHASE_TALK,
+    PHASE_GROUP,
+    PHASE_RECONNECT,
+    PHASE_LEAVE,
+    PHASE_COUNT
+};
+
+static const char* phaseNames[PHASE_COUNT] = {"connect", "join", "move", "talk", "group", "reconnect", "leave"};
+
+/* Synthetic server, index 0 of both tables is unused */
+struct SyntheticClient {
+    uint64 channelID; /* 0 while not on the server */
+    int    talking;
+    uint64 serverGroup;
+};
+
+struct SyntheticChannel {
+    uint64 parentID;
+    uint64 order;
+    bool   described; /* The description was requested, the client does not know it before */
+};
+
+enum PendingKind {
+    PENDING_CONNECTION_INFO,
+    PENDING_CLIENT_VARIABLES,
+    PENDING_CHANNEL_DESCRIPTION
+};
+
+/* Callback the client would send in answer to a request */
+struct PendingResponse {
+    enum PendingKind kind;
+    uint64           id; /* Client or channel */
+};
+
+struct PhaseResult {
+    uint64_t events;
+    uint64_t responses;
+    uint64_t callbackCpuNs;
+    uint64_t processCpuNs;
+    uint64_t infoCalls;
+    uint64_t infoMaxNs;
+    uint64_t infoP99Ns;
+    int64_t  liveGrowth;
+    int64_t  peakLive;
+    bool     exported;
+};
+
+static struct SyntheticClient*  clients;
+static struct SyntheticChannel* channels;
+static size_t                   clientCount;
+static size_t                   channelCount;
+static bool                     connected      = false;
+static const char*              dataDirectory  = STRESS_DATA_DIRECTORY;
+static uint64_t                 randomState    = 0x9E3779B97F4A7C15ULL;
+static struct PendingResponse   pending[STRESS_PENDING_LIMIT];
+static size_t                   pendingCount   = 0;
+static uint64_t                 droppedPending = 0;
+static bool                     banListPending = false;
+static char                     banListReturnCode[STRESS_TEXT_BUFSIZE];
+static unsigned int             returnCodes    = 0;
+
+static uint64_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+static size_t randomBelow(size_t limit) {
+    return (size_t)(nextRandom() % limit);
+}
+
+static uint64 randomChannel(void) {
+    return 1 + randomBelow(channelCount);
+}
+
+/* Random client other than the own one, present or absent as requested */
+static anyID randomClient(bool present) {
+    for (size_t attempt = 0; attempt < 64; ++attempt) {
+        const anyID clientID = (anyID)(STRESS_OWN_CLIENT + 1 + randomBelow(clientCount - 1));
+        if ((clients[clientID].channelID != 0) == present) return clientID;
+    }
+    return 0;
+}
+
+/*********************************** Synthetic host ************************************/
+
+static void stressGetPath(char* path, size_t maxLen) {
+    snprintf(path, maxLen, "%s/", dataDirectory);
+}
+
+static void stressGetPluginPath(char* path, size_t maxLen, const char* id) {
+    snprintf(path, maxLen, "%s/", dataDirectory);
+}
+
+static bool validClient(uint64 serverConnectionHandlerID, anyID clientID) {
+    return connected && serverConnectionHandlerID == STRESS_SERVER && clientID > 0 && clientID <= clientCount && clients[clientID].channelID != 0;
+}
+
+static bool validChannel(uint64 serverConnectionHandlerID, uint64 channelID) {
+    return connected && serverConnectionHandlerID == STRESS_SERVER && channelID > 0 && channelID <= channelCount;
+}
+
+static unsigned int stressGetServerConnectionHandlerList(uint64** result) {
+    *result      = mockAllocate(2 * sizeof(uint64));
+    (*result)[0] = connected ? STRESS_SERVER : 0;
+    (*result)[1] = 0;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetConnectionStatus(uint64 serverConnectionHandlerID, int* result) {
+    if (serverConnectionHandlerID != STRESS_SERVER) return ERROR_invalid_server_connection_handler_id;
+    *result = connected ? STATUS_CONNECTION_ESTABLISHED : STATUS_DISCONNECTED;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetClientID(uint64 serverConnectionHandlerID, anyID* result) {
+    if (!connected || serverConnectionHandlerID != STRESS_SERVER) return ERROR_not_connected;
+    *result = STRESS_OWN_CLIENT;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetClientList(uint64 serverConnectionHandlerID, anyID** result) {
+    if (!connected || serverConnectionHandlerID != STRESS_SERVER) return ERROR_not_connected;
+    *result      = mockAllocate((clientCount + 1) * sizeof(anyID));
+    size_t count = 0;
+    for (size_t clientID = 1; clientID <= clientCount; ++clientID) {
+        if (clients[clientID].channelID) (*result)[count++] = (anyID)clientID;
+    }
+    (*result)[count] = 0;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetChannelList(uint64 serverConnectionHandlerID, uint64** result) {
+    if (!connected || serverConnectionHandlerID != STRESS_SERVER) return ERROR_not_connected;
+    *result = mockAllocate((channelCount + 1) * sizeof(uint64));
+    for (size_t channelID = 1; channelID <= channelCount; ++channelID) (*result)[channelID - 1] = channelID;
+    (*result)[channelCount] = 0;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetChannelClientList(uint64 serverConnectionHandlerID, uint64 channelID, anyID** result) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    size_t count = 0;
+    for (size_t clientID = 1; clientID <= clientCount; ++clientID) count += clients[clientID].channelID == channelID;
+    *result = mockAllocate((count + 1) * sizeof(anyID));
+    count   = 0;
+    for (size_t clientID = 1; clientID <= clientCount; ++clientID) {
+        if (clients[clientID].channelID == channelID) (*result)[count++] = (anyID)clientID;
+    }
+    (*result)[count] = 0;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetChannelOfClient(uint64 serverConnectionHandlerID, anyID clientID, uint64* result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    *result = clients[clientID].channelID;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetParentChannelOfChannel(uint64 serverConnectionHandlerID, uint64 channelID, uint64* result) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    *result = channels[channelID].parentID;
+    return ERROR_ok;
+}
+
+/* Every fiftieth client is a query client */
+static unsigned int stressGetClientVariableAsInt(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, int* result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    if (flag == CLIENT_TYPE) {
+        *result = clientID % 50 == 0 ? ClientType_SERVERQUERY : ClientType_NORMAL;
+    } else {
+        *result = flag == CLIENT_FLAG_TALKING ? clients[clientID].talking : 0;
+    }
+    return ERROR_ok;
+}
+
+static unsigned int stressGetClientVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    switch (flag) {
+        case CLIENT_DATABASE_ID:
+            *result = 1000 + clientID;
+            break;
+        case CLIENT_CREATED:
+            *result = 1500000000 + clientID * 60;
+            break;
+        case CLIENT_LASTCONNECTED:
+            *result = 1700000000 + clientID * 60;
+            break;
+        case CLIENT_TOTALCONNECTIONS:
+            *result = 1 + clientID % 500;
+            break;
+        default:
+            *result = 0;
+            break;
+    }
+    return ERROR_ok;
+}
+
+static unsigned int stressGetClientVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    char text[STRESS_TEXT_BUFSIZE] = "";
+    if (flag == CLIENT_NICKNAME) {
+        snprintf(text, sizeof(text), "Stress client %u", (unsigned int)clientID);
+    } else if (flag == CLIENT_UNIQUE_IDENTIFIER) {
+        snprintf(text, sizeof(text), "stress%022u=", (unsigned int)clientID);
+    } else if (flag == CLIENT_SERVERGROUPS) {
+        snprintf(text, sizeof(text), "%llu", (unsigned long long)clients[clientID].serverGroup);
+    } else if (flag == CLIENT_VERSION) {
+        snprintf(text, sizeof(text), "3.%u.%u [Build: %u]", 5 + clientID % 2, clientID % 7, 1600000000 + clientID % 13);
+    } else if (flag == CLIENT_PLATFORM) {
+        snprintf(text, sizeof(text), "%s", (const char*[]){"Windows", "Linux", "OS X", "Android"}[clientID % 4]);
+    } else if (flag == CLIENT_COUNTRY) {
+        snprintf(text, sizeof(text), "%s", (const char*[]){"DE", "US", "FR", "GB", "PL", "NL"}[clientID % 6]);
+    } else if (flag == CLIENT_DESCRIPTION && clientID % 3 == 0) {
+        snprintf(text, sizeof(text), "Stress client %u with a [b]description[/b]", (unsigned int)clientID);
+    }
+    *result = mockString(text);
+    return ERROR_ok;
+}
+
+static unsigned int stressGetChannelVariableAsInt(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, int* result) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    *result = flag == CHANNEL_MAXCLIENTS ? -1 : 0;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetChannelVariableAsUInt64(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, uint64* result) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    *result = flag == CHANNEL_ORDER ? channels[channelID].order : 0;
+    return ERROR_ok;
+}
+
+/* Descriptions of a few kilobytes with BBCode, only known to the client after they were requested */
+static unsigned int stressGetChannelVariableAsString(uint64 serverConnectionHandlerID, uint64 channelID, size_t flag, char** result) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    char text[STRESS_DESCRIPTION_BUFSIZE] = "";
+    if (flag == CHANNEL_NAME) {
+        snprintf(text, sizeof(text), "Stress channel %llu", (unsigned long long)channelID);
+    } else if (flag == CHANNEL_TOPIC) {
+        snprintf(text, sizeof(text), "Topic of stress channel %llu", (unsigned long long)channelID);
+    } else if (flag == CHANNEL_DESCRIPTION && channels[channelID].described) {
+        size_t length = (size_t)snprintf(text, sizeof(text), "[center][size=14][b]Stress channel %llu[/b][/size][/center]\n", (unsigned long long)channelID);
+        while (length + STRESS_TEXT_BUFSIZE < sizeof(text)) length += (size_t)snprintf(text + length, sizeof(text) - length, "[*] Rule %zu of the channel, see [url=https://example.com]the website[/url].\n", length);
+    }
+    *result = mockString(text);
+    return ERROR_ok;
+}
+
+static unsigned int stressGetServerVariableAsString(uint64 serverConnectionHandlerID, size_t flag, char** result) {
+    if (!connected || serverConnectionHandlerID != STRESS_SERVER) return ERROR_not_connected;
+    const char* text = "";
+    if (flag == VIRTUALSERVER_UNIQUE_IDENTIFIER) {
+        text = "stressserver0000000000000000=";
+    } else if (flag == VIRTUALSERVER_ID) {
+        text = "1";
+    } else if (flag == VIRTUALSERVER_QUERYCLIENTS_ONLINE) {
+        text = "0";
+    }
+    *result = mockString(text);
+    return ERROR_ok;
+}
+
+static unsigned int stressGetConnectionVariableAsUInt64(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, uint64* result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    *result = flag == CONNECTION_PING ? 20 + clientID % 80 : 3600000;
+    return ERROR_ok;
+}
+
+static unsigned int stressGetConnectionVariableAsDouble(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, double* result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    *result = (double)(clientID % 10) / 1000.0;
+    return ERROR_ok;
+}
+
+/* Every third client shares its address with the next two */
+static unsigned int stressGetConnectionVariableAsString(uint64 serverConnectionHandlerID, anyID clientID, size_t flag, char** result) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    char text[STRESS_TEXT_BUFSIZE] = "";
+    if (flag == CONNECTION_CLIENT_IP) snprintf(text, sizeof(text), "10.%u.%u.%u", clientID / 3 >> 16 & 255, clientID / 3 >> 8 & 255, clientID / 3 & 255);
+    *result = mockString(text);
+    return ERROR_ok;
+}
+
+static void queueResponse(enum PendingKind kind, uint64 id) {
+    if (pendingCount == STRESS_PENDING_LIMIT) {
+        ++droppedPending;
+        return;
+    }
+    pending[pendingCount++] = (struct PendingResponse){kind, id};
+}
+
+static unsigned int stressRequestConnectionInfo(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    queueResponse(PENDING_CONNECTION_INFO, clientID);
+    return ERROR_ok;
+}
+
+static unsigned int stressRequestClientVariables(uint64 serverConnectionHandlerID, anyID clientID, const char* returnCode) {
+    if (!validClient(serverConnectionHandlerID, clientID)) return ERROR_client_invalid_id;
+    queueResponse(PENDING_CLIENT_VARIABLES, clientID);
+    return ERROR_ok;
+}
+
+static unsigned int stressRequestChannelDescription(uint64 serverConnectionHandlerID, uint64 channelID, const char* returnCode) {
+    if (!validChannel(serverConnectionHandlerID, channelID)) return ERROR_channel_invalid_id;
+    queueResponse(PENDING_CHANNEL_DESCRIPTION, channelID);
+    return ERROR_ok;
+}
+
+static unsigned int stressRequestBanList(uint64 serverConnectionHandlerID, uint64 start, unsigned int duration, const char* returnCode) {
+    if (!connected || serverConnectionHandlerID != STRESS_SERVER) return ERROR_not_connected;
+    banListPending = true;
+    snprintf(banListReturnCode, sizeof(banListReturnCode), "%s", returnCode ? returnCode : "");
+    return ERROR_ok;
+}
+
+static unsigned int stressRequestInfoUpdate(uint64 serverConnectionHandlerID, enum PluginItemType itemType, uint64 itemID) {
+    return ERROR_ok;
+}
+
+static unsigned int stressRequestSendPrivateTextMsg(uint64 serverConnectionHandlerID, const char* message, anyID targetClientID, const char* returnCode) {
+    return ERROR_ok;
+}
+
+static void stressSendPluginCommand(uint64 serverConnectionHandlerID, const char* id, const char* command, int targetMode, const anyID* targetIDs, const char* returnCode) {}
+
+static void stressPrintMessageToCurrentTab(const char* message) {}
+
+static void stressSetPluginMenuEnabled(const char* id, int menuID, int enabled) {}
+
+static void stressPrintMessage(uint64 serverConnectionHandlerID, const char* message, enum PluginMessageTarget messageTarget) {}
+
+static void stressCreateReturnCode(const char* id, char* returnCode, size_t maxLen) {
+    snprintf(returnCode, maxLen, "stress%u", ++returnCodes);
+}
+
+static struct TS3Functions stressFunctions(void) {
+    struct TS3Functions functions            = {0};
+    functions.freeMemory                     = mockFreeMemory;
+    functions.logMessage                     = mockLogMessage;
+    functions.getAppPath                     = stressGetPath;
+    functions.getResourcesPath               = stressGetPath;
+    functions.getConfigPath                  = stressGetPath;
+    functions.getPluginPath                  = stressGetPluginPath;
+    functions.getServerConnectionHandlerList = stressGetServerConnectionHandlerList;
+    functions.getConnectionStatus            = stressGetConnectionStatus;
+    functions.getClientID                    = stressGetClientID;
+    functions.getClientList                  = stressGetClientList;
+    functions.getChannelList                 = stressGetChannelList;
+    functions.getChannelClientList           = stressGetChannelClientList;
+    functions.getChannelOfClient             = stressGetChannelOfClient;
+    functions.getParentChannelOfChannel      = stressGetParentChannelOfChannel;
+    functions.getClientVariableAsInt         = stressGetClientVariableAsInt;
+    functions.getClientVariableAsUInt64      = stressGetClientVariableAsUInt64;
+    functions.getClientVariableAsString      = stressGetClientVariableAsString;
+    functions.getChannelVariableAsInt        = stressGetChannelVariableAsInt;
+    functions.getChannelVariableAsUInt64     = stressGetChannelVariableAsUInt64;
+    functions.getChannelVariableAsString     = stressGetChannelVariableAsString;
+    functions.getServerVariableAsString      = stressGetServerVariableAsString;
+    functions.getConnectionVariableAsUInt64  = stressGetConnectionVariableAsUInt64;
+    functions.getConnectionVariableAsDouble  = stressGetConnectionVariableAsDouble;
+    functions.getConnectionVariableAsString  = stressGetConnectionVariableAsString;
+    functions.requestConnectionInfo          = stressRequestConnectionInfo;
+    functions.requestClientVariables         = stressRequestClientVariables;
+    functions.requestChannelDescription      = stressRequestChannelDescription;
+    functions.requestBanList                 = stressRequestBanList;
+    functions.requestInfoUpdate              = stressRequestInfoUpdate;
+    functions.requestSendPrivateTextMsg      = stressRequestSendPrivateTextMsg;
+    functions.sendPluginCommand              = stressSendPluginCommand;
+    functions.printMessageToCurrentTab       = stressPrintMessageToCurrentTab;
+    functions.setPluginMenuEnabled           = stressSetPluginMenuEnabled;
+    functions.printMessage                   = stressPrintMessage;
+    functions.createReturnCode               = stressCreateReturnCode;
+    return functions;
+}
+
+/* Channel tree with a tenth of the channels at the top level, siblings ordered by creation */
+static bool buildServer(size_t newClientCount, size_t newChannelCount) {
+    clientCount  = newClientCount;
+    channelCount = newChannelCount;
+    free(clients);
+    free(channels);
+    clients  = calloc(clientCount + 1, sizeof(struct SyntheticClient));
+    channels = calloc(channelCount + 1, sizeof(struct SyntheticChannel));
+    uint64* lastChild = calloc(channelCount + 1, sizeof(uint64));
+    if (!clients || !channels || !lastChild) {
+        free(lastChild);
+        return false;
+    }
+    const size_t roots = channelCount / 10 + 1;
+    for (size_t channelID = 1; channelID <= channelCount; ++channelID) {
+        const uint64 parentID        = channelID <= roots ? 0 : 1 + randomBelow(channelID - 1);
+        channels[channelID].parentID = parentID;
+        channels[channelID].order    = lastChild[parentID];
+        lastChild[parentID]          = channelID;
+    }
+    free(lastChild);
+    clients[STRESS_OWN_CLIENT].channelID = 1;
+    return true;
+}
+
+/*********************************** Storms ************************************/
+
+static uint64_t timedInfoData(const struct MockPlugin* plugin, uint64 id, enum PluginItemType type) {
+    char*          data    = NULL;
+    const uint64_t started = mockMonotonicNs();
+    plugin->infoData(STRESS_SERVER, id, type, &data);
+    const uint64_t elapsed = mockMonotonicNs() - started;
+    if (data && plugin->freeMemory) plugin->freeMemory(data);
+    return elapsed;
+}
+
+/* Ban list mixing address prefixes, address and name patterns and unique identifiers, a few of them expired */
+static uint64_t deliverBanList(const struct MockPlugin* plugin) {
+    const uint64 now = (uint64)time(NULL);
+    for (unsigned int banID = 1; banID <= STRESS_BAN_RULES; ++banID) {
+        char         ip[STRESS_TEXT_BUFSIZE]   = "";
+        char         name[STRESS_TEXT_BUFSIZE] = "";
+        char         uid[STRESS_TEXT_BUFSIZE]  = "";
+        const uint64 duration                  = banID % 10 == 0 ? 1 : 0;
+        switch (banID % 4) {
+            case 0:
+                snprintf(ip, sizeof(ip), "10.0.%u.*", banID);
+                break;
+            case 1:
+                snprintf(ip, sizeof(ip), "^10\\.%u\\.[0-9]+\\.(1|2)$", banID);
+                break;
+            case 2:
+                snprintf(name, sizeof(name), "stress client %u[0-9]*7$", banID);
+                break;
+            default:
+                snprintf(uid, sizeof(uid), "stress%022u=", banID * 97);
+        }
+        plugin->onBanListEvent(STRESS_SERVER, banID, ip, name, uid, "", now - 60, duration, "Stress admin", 1, "stressadmin=", "Stress ban", 0, "");
+    }
+    return STRESS_BAN_RULES;
+}
+
+/* Answers requests made by the plugin, returns the number of callbacks sent */
+static uint64_t deliverResponses(const struct MockPlugin* plugin) {
+    uint64_t delivered = 0;
+    for (size_t index = 0; index < pendingCount; ++index) {
+        const struct PendingResponse* response = &pending[index];
+        if (response->kind == PENDING_CHANNEL_DESCRIPTION) {
+            if (!validChannel(STRESS_SERVER, response->id)) continue;
+            channels[response->id].described = true;
+            if (plugin->onUpdateChannelEvent) {
+                plugin->onUpdateChannelEvent(STRESS_SERVER, response->id);
+                ++delivered;
+            }
+            continue;
+        }
+        if (!validClient(STRESS_SERVER, (anyID)response->id)) continue;
+        if (response->kind == PENDING_CONNECTION_INFO && plugin->onConnectionInfoEvent) {
+            plugin->onConnectionInfoEvent(STRESS_SERVER, (anyID)response->id);
+            ++delivered;
+        } else if (response->kind == PENDING_CLIENT_VARIABLES && plugin->onUpdateClientEvent) {
+            plugin->onUpdateClientEvent(STRESS_SERVER, (anyID)response->id, 0, "", "");
+            ++delivered;
+        }
+    }
+    pendingCount = 0;
+    if (banListPending && plugin->onBanListEvent) delivered += deliverBanList(plugin);
+    /* The server ends every command with its error answer */
+    if (banListPending && plugin->onServerErrorEvent) {
+        plugin->onServerErrorEvent(STRESS_SERVER, "ok", ERROR_ok, banListReturnCode, "");
+        ++delivered;
+    }
+    banListPending = false;
+    return delivered;
+}
+
+static void setConnected(const struct MockPlugin* plugin, bool established) {
+    connected = established;
+    for (size_t channelID = 1; channelID <= channelCount && !established; ++channelID) channels[channelID].described = false;
+    if (plugin->onConnectStatusChangeEvent) plugin->onConnectStatusChangeEvent(STRESS_SERVER, established ? STATUS_CONNECTION_ESTABLISHED : STATUS_DISCONNECTED, ERROR_ok);
+}
+
+/* Fires one event of a phase, returns false if the plugin does not handle it */
+static bool fireEvent(const struct MockPlugin* plugin, enum StressPhase phase, size_t index) {
+    switch (phase) {
+        case PHASE_CONNECT:
+        case PHASE_RECONNECT:
+            if (phase == PHASE_RECONNECT) setConnected(plugin, false);
+            setConnected(plugin, true);
+            return plugin->onConnectStatusChangeEvent != NULL;
+        case PHASE_JOIN: {
+            if (!plugin->onClientMoveEvent) return false;
+            const anyID  clientID  = (anyID)(STRESS_OWN_CLIENT + 1 + index);
+            const uint64 channelID = randomChannel();
+            clients[clientID].channelID = channelID;
+            plugin->onClientMoveEvent(STRESS_SERVER, clientID, 0, channelID, ENTER_VISIBILITY, "");
+            return true;
+        }
+        case PHASE_MOVE: {
+            if (!plugin->onClientMoveEvent) return false;
+            const anyID clientID = randomClient(true);
+            if (!clientID) return true;
+            const uint64 oldChannelID   = clients[clientID].channelID;
+            clients[clientID].channelID = randomChannel();
+            plugin->onClientMoveEvent(STRESS_SERVER, clientID, oldChannelID, clients[clientID].channelID, RETAIN_VISIBILITY, "");
+            return true;
+        }
+        case PHASE_TALK: {
+            if (!plugin->onTalkStatusChangeEvent) return false;
+            const anyID clientID = randomClient(true);
+            if (!clientID) return true;
+            clients[clientID].talking = !clients[clientID].talking;
+            plugin->onTalkStatusChangeEvent(STRESS_SERVER, clients[clientID].talking ? STATUS_TALKING : STATUS_NOT_TALKING, 0, clientID);
+            return true;
+        }
+        case PHASE_GROUP: {
+            /* Group changes arrive as group events followed by a client update of CLIENT_SERVERGROUPS */
+            if (!plugin->onUpdateClientEvent) return false;
+            const anyID clientID = randomClient(true);
+            if (!clientID) return true;
+            char name[STRESS_TEXT_BUFSIZE], uniqueID[STRESS_TEXT_BUFSIZE];
+            snprintf(name, sizeof(name), "Stress client %u", (unsigned int)clientID);
+            snprintf(uniqueID, sizeof(uniqueID), "stress%022u=", (unsigned int)clientID);
+            const bool   added            = clients[clientID].serverGroup == 0;
+            const uint64 serverGroup      = added ? 6 + randomBelow(8) : clients[clientID].serverGroup;
+            clients[clientID].serverGroup = added ? serverGroup : 0;
+            if (added && plugin->onServerGroupClientAddedEvent) {
+                plugin->onServerGroupClientAddedEvent(STRESS_SERVER, clientID, name, uniqueID, serverGroup, STRESS_OWN_CLIENT, "Stress admin", "stressadmin=");
+            } else if (!added && plugin->onServerGroupClientDeletedEvent) {
+                plugin->onServerGroupClientDeletedEvent(STRESS_SERVER, clientID, name, uniqueID, serverGroup, STRESS_OWN_CLIENT, "Stress admin", "stressadmin=");
+            }
+            plugin->onUpdateClientEvent(STRESS_SERVER, clientID, STRESS_OWN_CLIENT, "Stress admin", "stressadmin=");
+            return true;
+        }
+        case PHASE_LEAVE: {
+            if (!plugin->onClientMoveEvent) return false;
+            const anyID clientID = (anyID)(STRESS_OWN_CLIENT + 1 + index);
+            if (!clients[clientID].channelID) return true;
+            const uint64 oldChannelID   = clients[clientID].channelID;
+            clients[clientID].channelID = 0;
+            plugin->onClientMoveEvent(STRESS_SERVER, clientID, oldChannelID, 0, LEAVE_VISIBILITY, "");
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static int compareTimes(const void* left, const void* right) {
+    const uint64_t a = *(const uint64_t*)left, b = *(const uint64_t*)right;
+    return (a > b) - (a < b);
+}
+
+static void runPhase(const struct MockPlugin* plugin, enum StressPhase phase, size_t events, struct PhaseResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->exported     = true;
+    uint64_t* infoTimes  = malloc((events / STRESS_INFO_INTERVAL + 1) * sizeof(uint64_t));
+    struct MockUsage before;
+    mockResetPeak();
+    mockUsage(&before);
+    const uint64_t processCpu = mockProcessCpuNs();
+
+    for (size_t index = 0; index < events; ++index) {
+        const uint64_t cpu     = mockThreadCpuNs();
+        result->exported       = fireEvent(plugin, phase, index);
+        result->responses     += deliverResponses(plugin);
+        result->callbackCpuNs += mockThreadCpuNs() - cpu;
+        if (!result->exported) break;
+        ++result->events;
+
+        if (plugin->infoData && infoTimes && index % STRESS_INFO_INTERVAL == 0) {
+            const anyID clientID = randomClient(true);
+            uint64_t    elapsed;
+            if (index % (8 * STRESS_INFO_INTERVAL) == 0) {
+                elapsed = timedInfoData(plugin, STRESS_SERVER, PLUGIN_SERVER);
+            } else if (clientID && index % (2 * STRESS_INFO_INTERVAL) == 0) {
+                elapsed = timedInfoData(plugin, clientID, PLUGIN_CLIENT);
+            } else {
+                elapsed = timedInfoData(plugin, randomChannel(), PLUGIN_CHANNEL);
+            }
+            infoTimes[result->infoCalls++] = elapsed;
+            if (elapsed > result->infoMaxNs) result->infoMaxNs = elapsed;
+            result->responses += deliverResponses(plugin);
+        }
+    }
+
+    struct MockUsage after;
+    mockUsage(&after);
+    result->processCpuNs = mockProcessCpuNs() - processCpu;
+    result->liveGrowth   = after.liveBytes - before.liveBytes;
+    result->peakLive     = after.peakLiveBytes;
+    if (infoTimes && result->infoCalls) {
+        qsort(infoTimes, result->infoCalls, sizeof(uint64_t), compareTimes);
+        result->infoP99Ns = infoTimes[(result->infoCalls - 1) * 99 / 100];
+    }
+    free(infoTimes);
+}
+
+static size_t phaseEvents(enum StressPhase phase, size_t events) {
+    switch (phase) {
+        case PHASE_CONNECT:
+        case PHASE_RECONNECT:
+            return 1;
+        case PHASE_JOIN:
+        case PHASE_LEAVE:
+            return clientCount - 1;
+        default:
+            return events;
+    }
+}
+
+static bool runStep(const char* library, size_t stepClients, size_t stepChannels, size_t events) {
+    if (!buildServer(stepClients, stepChannels)) return false;
+    connected      = false;
+    pendingCount   = 0;
+    banListPending = false;
+
+    struct MockPlugin plugin;
+    if (!mockLoadPlugin(&plugin, library)) return false;
+    plugin.setFunctionPointers(stressFunctions());
+    if (plugin.registerPluginID) plugin.registerPluginID(STRESS_PLUGIN_ID);
+    mockCountAllocations(true);
+    plugin.init();
+
+    for (enum StressPhase phase = 0; phase < PHASE_COUNT; ++phase) {
+        struct PhaseResult result;
+        runPhase(&plugin, phase, phaseEvents(phase, events), &result);
+        if (!result.exported) {
+            printf("%8zu  %8zu  %-10s  not handled by this build\n", stepClients, stepChannels, phaseNames[phase]);
+            continue;
+        }
+        printf("%8zu  %8zu  %-10s  %8llu  %9llu  %10.3f  %11.3f  %9.1f  %9.1f  %10.1f  %9.1f\n", stepClients, stepChannels, phaseNames[phase], (unsigned long long)result.events, (unsigned long long)result.responses,
+               result.events ? (double)result.callbackCpuNs / (double)result.events / 1e3 : 0.0, (double)result.processCpuNs / 1e6, (double)result.infoMaxNs / 1e3, (double)result.infoP99Ns / 1e3,
+               (double)result.liveGrowth / 1024.0, (double)result.peakLive / 1024.0);
+    }
+
+    setConnected(&plugin, false);
+    plugin.shutdown();
+    mockCountAllocations(false);
+    mockUnloadPlugin(&plugin);
+    return true;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-c clients] [-C channels] [-e events] [-s steps] [--data directory] <plugin library>\n", program);
+}
+
+int main(int argc, char** argv) {
+    size_t maxClients = 10000, maxChannels = 3000, events = 20000, steps = 1;
+    int    argument   = 1;
+    for (; argument + 1 < argc && argv[argument][0] == '-'; argument += 2) {
+        const char*         option = argv[argument];
+        const unsigned long value  = strtoul(argv[argument + 1], NULL, 10);
+        if (strcmp(option, "-c") == 0) {
+            maxClients = value;
+        } else if (strcmp(option, "-C") == 0) {
+            maxChannels = value;
+        } else if (strcmp(option, "-e") == 0) {
+            events = value;
+        } else if (strcmp(option, "-s") == 0) {
+            steps = value;
+        } else if (strcmp(option, "--data") == 0) {
+            dataDirectory = argv[argument + 1];
+        } else {
+            break;
+        }
+    }
+    if (argc - argument != 1 || maxClients < 2 || maxClients > STRESS_CLIENT_LIMIT || maxChannels < 1 || steps < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+#ifdef _WIN32
+    _mkdir(dataDirectory);
+#else
+    mkdir(dataDirectory, 0755);
+#endif
+
+    printf("%8s  %8s  %-10s  %8s  %9s  %10s  %11s  %9s  %9s  %10s  %9s\n", "Clients", "Channels", "Phase", "Events", "Responses", "CPU us/ev", "Process ms", "Info max", "Info p99", "Live KB +", "Peak KB");
+    for (size_t step = 1; step <= steps; ++step) {
+        const size_t stepClients  = maxClients * step / steps < 2 ? 2 : maxClients * step / steps;
+        const size_t stepChannels = maxChannels * step / steps < 1 ? 1 : maxChannels * step / steps;
+        if (!runStep(argv[argument], stepClients, stepChannels, events)) return 1;
+    }
+    if (!mockAllocationCounting()) printf("Memory columns are not measured on this platform\n");
+    if (droppedPending) printf("%llu requests were not answered, the response queue was full\n", (unsigned long long)droppedPending);
+    return 0;
+}
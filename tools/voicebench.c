@@ -0,0 +1,150 @@
+/*
+ * AdvancedInformation Teamspeak3 plugin
+ * Copyright (c) EricZones
+ */
+
+/*
+ * Measures the voice level kernels and the captured audio path
+ *
+ * Usage: AdvancedInformationVoiceBench [-n seconds]
+ *
+ * Every kernel the CPU supports is first checked against the scalar kernel on random buffers with full scale
+ * samples, then timed on 20 ms frames of 48 kHz mono and stereo audio. Throughput is given in million samples
+ * per second and as the share of the 20 ms budget one frame costs. The captured audio path and the playback
+ * path with a frame of every speaker in each 20 ms round are timed with allocation counting enabled, the
+ * benchmark fails if a frame allocates.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mockhost.h"
+#include "voice.h"
+
+#define BENCH_CHECK_ROUNDS 20000
+#define BENCH_CHECK_SAMPLES 4096
+#define BENCH_FRAME_SAMPLES 960 /* 20 ms at 48 kHz */
+#define BENCH_FRAME_NS 20000000.0
+#define BENCH_SERVER 1
+#define BENCH_SPEAKERS 64
+
+static uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t nextRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+/* Random samples, every clipEvery-th one at either end of the range, 0 for none */
+static void fillSamples(short* samples, size_t count, size_t clipEvery) {
+    for (size_t index = 0; index < count; ++index) {
+        if (clipEvery && nextRandom() % clipEvery == 0) {
+            samples[index] = nextRandom() & 1 ? 32767 : -32768;
+        } else {
+            samples[index] = (short)(int16_t)(nextRandom() >> 48);
+        }
+    }
+}
+
+/* Compares a kernel with the scalar one on random lengths and offsets */
+static bool checkKernel(enum VoiceKernel kernel) {
+    short samples[BENCH_CHECK_SAMPLES];
+    for (size_t round = 0; round < BENCH_CHECK_ROUNDS; ++round) {
+        const size_t offset = nextRandom() % 16;
+        const size_t count  = nextRandom() % (BENCH_CHECK_SAMPLES - offset);
+        fillSamples(samples, BENCH_CHECK_SAMPLES, 1 + nextRandom() % 64);
+        if (round % 7 == 0) {
+            for (size_t index = 0; index < BENCH_CHECK_SAMPLES; ++index) samples[index] = -32768;
+        }
+        struct VoiceBlock expected = {0, 0, 0};
+        struct VoiceBlock actual   = {0, 0, 0};
+        voiceSelectKernel(VOICE_KERNEL_SCALAR);
+        voiceMeasure(samples + offset, count, &expected);
+        voiceSelectKernel(kernel);
+        voiceMeasure(samples + offset, count, &actual);
+        if (actual.sumSquares != expected.sumSquares || actual.peak != expected.peak || actual.clipped != expected.clipped) {
+            fprintf(stderr, "%s kernel differs from scalar for %zu samples at offset %zu\n", voiceKernelName(kernel), count, offset);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns nanoseconds per frame for measuring the frame repeatedly */
+static double measureKernel(const short* samples, size_t count, double seconds) {
+    const size_t      rounds  = (size_t)(seconds * 48000.0 * 50.0 / (double)count) + 1;
+    struct VoiceBlock sink    = {0, 0, 0};
+    const uint64_t    started = mockMonotonicNs();
+    for (size_t round = 0; round < rounds; ++round) voiceMeasure(samples, count, &sink);
+    const uint64_t elapsed = mockMonotonicNs() - started;
+    if (sink.sumSquares == 1) printf(" ");
+    return (double)elapsed / (double)rounds;
+}
+
+int main(int argc, char** argv) {
+    double seconds = 1.0;
+    if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+        seconds = strtod(argv[2], NULL);
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [-n seconds]\n", argv[0]);
+        return 1;
+    }
+
+    short* frame = (short*)malloc(BENCH_FRAME_SAMPLES * 2 * sizeof(short));
+    if (!frame) return 1;
+    fillSamples(frame, BENCH_FRAME_SAMPLES * 2, 0);
+
+    voiceSelectKernel(VOICE_KERNEL_AUTO);
+    printf("Selected kernel: %s\n\n", voiceKernelName(voiceActiveKernel()));
+    printf("%-8s  %8s  %12s  %10s  %8s\n", "Kernel", "Channels", "MSamples/s", "ns/frame", "Budget");
+
+    for (int channels = 1; channels <= 2; ++channels) {
+        const size_t count = BENCH_FRAME_SAMPLES * (size_t)channels;
+        for (enum VoiceKernel kernel = VOICE_KERNEL_SCALAR; kernel <= VOICE_KERNEL_AVX2; ++kernel) {
+            if (!voiceSelectKernel(kernel)) continue;
+            if (channels == 1 && kernel != VOICE_KERNEL_SCALAR && !checkKernel(kernel)) return 1;
+            voiceSelectKernel(kernel);
+            const double frameNs = measureKernel(frame, count, seconds);
+            printf("%-8s  %8d  %12.0f  %10.0f  %7.4f%%\n", voiceKernelName(kernel), channels, (double)count / frameNs * 1000.0, frameNs, frameNs / BENCH_FRAME_NS * 100.0);
+        }
+    }
+
+    /* The whole audio paths with the default kernel, as the audio thread runs them */
+    voiceInit();
+    for (anyID speaker = 1; speaker <= BENCH_SPEAKERS; ++speaker) voicePreparePlayback(BENCH_SERVER, speaker);
+    const size_t rounds = (size_t)(seconds * 50.0 * 1000.0);
+    if (mockAllocationCounting()) mockCountAllocations(true);
+    uint64_t started = mockMonotonicNs();
+    for (size_t round = 0; round < rounds; ++round) voiceCaptured(BENCH_SERVER, frame, BENCH_FRAME_SAMPLES, 2);
+    const uint64_t capturedNs = mockMonotonicNs() - started;
+    started                   = mockMonotonicNs();
+    for (size_t round = 0; round < rounds / BENCH_SPEAKERS + 1; ++round) {
+        for (anyID speaker = 1; speaker <= BENCH_SPEAKERS; ++speaker) voicePlayback(BENCH_SERVER, speaker, frame, BENCH_FRAME_SAMPLES, 1);
+    }
+    const uint64_t playbackNs = mockMonotonicNs() - started;
+    mockCountAllocations(false);
+    struct MockUsage usage;
+    mockUsage(&usage);
+
+    const double capturedFrameNs = (double)capturedNs / (double)rounds;
+    const double playbackRoundNs = (double)playbackNs / (double)(rounds / BENCH_SPEAKERS + 1);
+    printf("\n%-10s  %8s  %10s  %8s\n", "Path", "Speakers", "ns/round", "Budget");
+    printf("%-10s  %8d  %10.0f  %7.4f%%\n", "captured", 1, capturedFrameNs, capturedFrameNs / BENCH_FRAME_NS * 100.0);
+    printf("%-10s  %8d  %10.0f  %7.4f%%\n", "playback", BENCH_SPEAKERS, playbackRoundNs, playbackRoundNs / BENCH_FRAME_NS * 100.0);
+    struct VoiceLoudness loudness;
+    if (!voiceGetPlayback(BENCH_SERVER, BENCH_SPEAKERS, &loudness)) {
+        fprintf(stderr, "Playback of speaker %d was not measured\n", BENCH_SPEAKERS);
+        return 1;
+    }
+    voiceShutdown();
+    free(frame);
+
+    if (usage.allocations != 0) {
+        fprintf(stderr, "Audio paths allocated %llu times\n", (unsigned long long)usage.allocations);
+        return 1;
+    }
+    return 0;
+}